@@ -0,0 +1 @@
+#include <../private/package/hpkg/CachedPackageFileHeapReader.h>
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _GNU_UNISTD_H_
+#define _GNU_UNISTD_H_
+
+
+#include_next <unistd.h>
+
+
+#ifdef _GNU_SOURCE
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern ssize_t	copy_file_range(int inFD, off_t* inOffset, int outFD,
+	off_t* outOffset, size_t length, unsigned int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
+
+
+#endif	/* _GNU_UNISTD_H_ */
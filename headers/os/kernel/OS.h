@@ -659,6 +659,37 @@ extern ssize_t		wait_for_objects(object_wait_info* infos, int numInfos);
 extern ssize_t		wait_for_objects_etc(object_wait_info* infos, int numInfos,
 						uint32 flags, bigtime_t timeout);
 
+/* event queue behavior flags, or'ed into event_wait_info::events */
+enum {
+	B_EVENT_LEVEL_TRIGGERED		= 0,			/* default */
+	B_EVENT_EDGE_TRIGGERED		= 0x00100000,
+	B_EVENT_ONE_SHOT			= 0x00200000
+};
+
+typedef struct event_wait_info {
+	int32		object;						/* ID of the object */
+	uint16		type;						/* type of the object */
+	int32		events;						/* events mask */
+	void*		user_data;					/* returned as is */
+} event_wait_info;
+
+/* Event queues are the persistent counterpart to wait_for_objects(): objects
+   are selected once via event_queue_select() and stay selected until they
+   are deselected (by selecting them with an events mask of 0), become
+   invalid, or the queue is closed. event_queue_wait() only returns the
+   objects that have events pending, so its cost doesn't depend on the number
+   of selected objects.
+   Level-triggered events are reported for as long as the condition persists,
+   edge-triggered ones only when the object notifies a new event, and one-shot
+   events are deselected after they have been reported once.
+   An event queue is a file descriptor, close() destroys it. */
+
+extern int			event_queue_create(int openFlags);
+extern status_t		event_queue_select(int queue, event_wait_info* infos,
+						int numInfos);
+extern ssize_t		event_queue_wait(int queue, event_wait_info* infos,
+						int numInfos, uint32 flags, bigtime_t timeout);
+
 
 #ifdef __cplusplus
 }
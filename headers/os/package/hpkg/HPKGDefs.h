@@ -128,14 +128,21 @@ enum {
 		// when updating a pre-existing entry, don't fail, but replace the
 		// entry, if possible (directories will be merged, but won't replace a
 		// non-directory)
+
+	// bits 16-31 are used internally by BPackageWriterParameters
 };
 
 
 // Reader Init() flags
 enum {
-	B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE	= 0x01
+	B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE	= 0x01,
 		// Fail silently when encountering a package format version mismatch.
 		// Don't print anything to the error output.
+	B_HPKG_READER_CACHE_CHUNKS							= 0x02
+		// Keep recently decompressed heap chunks in memory and decompress
+		// the following chunks in advance, when the heap is read
+		// sequentially. Useful when reading most of a package's contents.
+		// Ignored in the kernel.
 };
 
 
@@ -57,6 +57,10 @@ public:
 			int32				CompressionLevel() const;
 			void				SetCompressionLevel(int32 compressionLevel);
 
+			int32				CompressionThreadCount() const;
+			void				SetCompressionThreadCount(int32 threadCount);
+									// <= 0: one thread per CPU
+
 private:
 			uint32				fFlags;
 			uint32				fCompression;
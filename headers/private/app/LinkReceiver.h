@@ -31,6 +31,7 @@ class LinkReceiver {
 
 		status_t GetNextMessage(int32& code, bigtime_t timeout = B_INFINITE_TIMEOUT);
 		bool HasMessages() const;
+		bool HasBufferedMessages() const;
 		bool NeedsReply() const;
 		int32 Code() const;
 
@@ -44,6 +45,8 @@ class LinkReceiver {
 		template <class Type> status_t Read(Type *data)
 			{ return Read(data, sizeof(Type)); }
 
+		void SetRing(void* memory, size_t size);
+
 	protected:
 		virtual status_t ReadFromPort(bigtime_t timeout);
 		virtual status_t AdjustReplyBuffer(bigtime_t timeout);
@@ -52,6 +55,7 @@ class LinkReceiver {
 		port_id fReceivePort;
 
 		char*	fRecvBuffer;
+		char*	fData;		// either fRecvBuffer, or a segment of the ring
 		int32	fRecvPosition;	//current read position
 		int32	fRecvStart;	//start of current message
 		int32	fRecvBufferSize;
@@ -60,6 +64,11 @@ class LinkReceiver {
 		int32	fReplySize;	//size of current reply message
 
 		status_t fReadError;	//Read failed for current message
+
+		char*	fRing;			// shared with the sender, if any
+		size_t	fRingSize;		// size of the ring data
+		uint32	fRingSegmentEnd;
+		bool	fReadingRing;
 };
 
 }	// namespace BPrivate
@@ -33,6 +33,8 @@ class LinkSender {
 
 		status_t Flush(bigtime_t timeout = B_INFINITE_TIMEOUT, bool needsReply = false);
 
+		status_t SetRing(void* memory, size_t size);
+
 		status_t Attach(const void *data, size_t size);
 		status_t AttachString(const char *string, int32 maxLength = -1);
 		template <class Type> status_t Attach(const Type& data)
@@ -46,6 +48,7 @@ class LinkSender {
 
 		status_t AdjustBuffer(size_t newBufferSize, char **_oldBuffer = NULL);
 		status_t FlushCompleted(size_t newBufferSize);
+		bool ReserveRingSegment(size_t size, uint32& _offset, uint32& _end);
 
 		port_id	fPort;
 		team_id fTargetTeam;
@@ -57,6 +60,13 @@ class LinkSender {
 		uint32	fCurrentStart;		// start of current message
 
 		status_t fCurrentStatus;
+
+		size_t	fMinBufferSize;
+
+		char*	fRing;			// shared with the receiver, if any
+		size_t	fRingSize;		// size of the ring data
+		uint32	fRingWritten;	// total bytes written to the ring
+		uint32	fRingOffset;	// current write position in the ring data
 };
 
 
@@ -109,6 +109,7 @@ enum {
 	AS_SET_SIZE_LIMITS,
 	AS_ACTIVATE_WINDOW,
 	AS_IS_FRONT_WINDOW,
+	AS_CREATE_COMMAND_RING,
 
 	// BPicture definitions
 	AS_CREATE_PICTURE,
@@ -357,6 +358,7 @@ enum {
 	// debugging helper
 	AS_DUMP_ALLOCATOR,
 	AS_DUMP_BITMAPS,
+	AS_DUMP_FRAME_TIMES,
 
 	// transformation in addition to origin/scale
 	AS_VIEW_SET_TRANSFORM,
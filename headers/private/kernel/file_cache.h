@@ -14,8 +14,13 @@
 // temporary/optional cache syscall API
 #define CACHE_SYSCALLS "cache"
 
-#define CACHE_CLEAR			1	// takes no parameters
-#define CACHE_SET_MODULE	2	// gets the module name as parameter
+#define CACHE_CLEAR				1	// takes no parameters
+#define CACHE_SET_MODULE		2	// gets the module name as parameter
+#define CACHE_GET_STATS			3	// fills in a file_cache_stats
+#define CACHE_GET_FILE_STATS	4	// fills in a file_cache_file_stats for
+									// the FD it contains
+#define CACHE_SET_READ_AHEAD	5	// gets the maximum read-ahead window size
+									// in bytes (uint32), 0 disables it
 
 #define CACHE_MODULES_NAME	"file_cache"
 
@@ -23,6 +28,24 @@
 #define FILE_CACHE_LOADED_COMPLETELY	0x02
 #define FILE_CACHE_NO_IO				0x04
 
+struct file_cache_stats {
+	uint64	hits;				// pages read that were already cached
+	uint64	misses;				// pages read that had to be loaded
+	uint64	read_ahead_pages;	// pages loaded by read-ahead
+	uint64	read_ahead_grown;	// times a read-ahead window grew
+	uint64	read_ahead_shrunk;	// times a read-ahead window shrunk
+	uint32	max_read_ahead;		// maximum read-ahead window size
+};
+
+struct file_cache_file_stats {
+	int		fd;					// in: the file to get the statistics for
+	uint64	hits;
+	uint64	misses;
+	uint64	read_ahead_pages;
+	uint32	read_ahead_window;	// current read-ahead window size
+	off_t	read_ahead_end;		// end of the data read ahead so far
+};
+
 struct cache_module_info {
 	module_info	info;
 
@@ -31,6 +54,8 @@ struct cache_module_info {
 	void (*node_closed)(struct vnode *vnode, int32 fdType, dev_t mountID,
 				ino_t vnodeID, int32 accessType);
 	void (*node_launched)(size_t argCount, char * const *args);
+	void (*node_read)(struct vnode *vnode, dev_t mountID, ino_t vnodeID,
+				off_t offset, size_t size);
 };
 
 #ifdef __cplusplus
@@ -42,8 +67,11 @@ extern void cache_node_opened(struct vnode *vnode, int32 fdType, VMCache *cache,
 extern void cache_node_closed(struct vnode *vnode, int32 fdType, VMCache *cache,
 				dev_t mountID, ino_t vnodeID);
 extern void cache_node_launched(size_t argCount, char * const *args);
-extern void cache_prefetch_vnode(struct vnode *vnode, off_t offset, size_t size);
-extern void cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size);
+extern void cache_node_read(struct vnode *vnode, off_t offset, size_t size);
+extern size_t cache_prefetch_vnode(struct vnode *vnode, off_t offset,
+				size_t size);
+extern size_t cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset,
+				size_t size);
 
 extern status_t file_map_init(void);
 extern status_t file_cache_init_post_boot_device(void);
@@ -10,6 +10,8 @@
 #include <lock.h>
 #include <KernelExport.h>
 
+#include <slab/SlabStatistics.h>
+
 
 struct DepotMagazine;
 
@@ -22,7 +24,17 @@ typedef struct object_depot {
 	size_t					empty_count;
 	size_t					max_count;
 	size_t					magazine_capacity;
+	size_t					initial_capacity;
+	size_t					max_capacity;
 	struct depot_cpu_store*	stores;
+
+	// protected by the inner lock
+	uint32					window_acquisitions;
+	uint32					window_contentions;
+	uint64					lock_acquisitions;
+	uint64					lock_contentions;
+	uint64					resizes;
+
 	void*					cookie;
 
 	void (*return_object)(struct object_depot* depot, void* cookie,
@@ -45,6 +57,8 @@ void object_depot_store(object_depot* depot, void* object, uint32 flags);
 
 void object_depot_make_empty(object_depot* depot, uint32 flags);
 
+void object_depot_get_stats(object_depot* depot, slab_depot_stats* stats);
+
 #if PARANOID_KERNEL_FREE
 bool object_depot_contains_object(object_depot* depot, void* object);
 #endif
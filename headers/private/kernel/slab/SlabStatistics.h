@@ -0,0 +1,39 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SLAB_SLAB_STATISTICS_H_
+#define _SLAB_SLAB_STATISTICS_H_
+
+
+#include <OS.h>
+
+
+// slab statistics syscall API
+#define SLAB_SYSCALLS "slab"
+
+#define SLAB_GET_DEPOT_STATS	1	// fills in a slab_depot_stats_request
+
+
+typedef struct slab_depot_stats {
+	char	name[B_OS_NAME_LENGTH];
+	size_t	object_size;
+	uint32	magazine_capacity;	// current capacity of new magazines
+	uint32	max_magazine_capacity;
+	uint64	obtain_hits;		// allocations served from a CPU magazine
+	uint64	obtain_misses;		// allocations that had to go to the slabs
+	uint64	store_hits;			// frees that went into a CPU magazine
+	uint64	store_misses;		// frees that went back to the slabs
+	uint64	lock_acquisitions;	// depot lock acquisitions
+	uint64	lock_contentions;	// ... of those, the ones that had to wait
+	uint64	resizes;			// times the magazine capacity grew
+} slab_depot_stats;
+
+typedef struct slab_depot_stats_request {
+	slab_depot_stats*	stats;
+	uint32				count;
+		// in: number of entries in stats, out: number of caches with a depot
+} slab_depot_stats_request;
+
+
+#endif	/* _SLAB_SLAB_STATISTICS_H_ */
@@ -237,6 +237,10 @@ status_t	_user_setcwd(int fd, const char *path);
 status_t	_user_change_root(const char *path);
 int			_user_open_query(dev_t device, const char *query,
 				size_t queryLength, uint32 flags, port_id port, int32 token);
+ssize_t		_user_send_file(int outFD, int inFD, off_t *offset,
+				size_t count);
+ssize_t		_user_copy_file_range(int inFD, off_t *inOffset, int outFD,
+				off_t *outOffset, size_t length, uint32 flags);
 
 /* fd user prototypes (implementation located in fd.cpp)  */
 ssize_t		_user_read(int fd, off_t pos, void *buffer, size_t bufferSize);
@@ -287,6 +291,11 @@ status_t	_user_socketpair(int family, int type, int protocol,
 status_t	_user_get_next_socket_stat(int family, uint32 *cookie,
 				struct net_stat *stat);
 
+/* socket calls used by the VFS (implementation in socket.cpp) */
+ssize_t		socket_send_external(struct file_descriptor *descriptor,
+				const void *data, size_t length, int flags,
+				struct net_buffer_external *external);
+
 #ifdef __cplusplus
 }
 #endif
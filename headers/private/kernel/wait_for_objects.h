@@ -21,12 +21,25 @@ typedef struct select_info {
 	uint16				selected_events;
 } select_info;
 
-typedef struct select_sync {
+/*!	Base class of everything select_infos can be attached to.
+
+	Whenever an object a select_info has been selected for changes its state,
+	Notify() is invoked, possibly with spinlocks held and interrupts disabled.
+	The object is reference counted: every object list a select_info is part
+	of holds a reference to its sync, which is released via put_select_sync().
+*/
+struct select_sync {
 	int32				ref_count;
-	sem_id				sem;
-	uint32				count;
-	struct select_info*	set;
-} select_sync;
+
+						select_sync()
+							:
+							ref_count(1)
+						{
+						}
+	virtual				~select_sync();
+
+	virtual	status_t	Notify(select_info* info, uint16 events) = 0;
+};
 
 #define SELECT_FLAG(type) (1L << (type - 1))
 
@@ -46,6 +59,11 @@ extern void		put_select_sync(select_sync* sync);
 extern status_t	notify_select_events(select_info* info, uint16 events);
 extern void		notify_select_events_list(select_info* list, uint16 events);
 
+extern status_t	select_object(uint32 type, int32 object,
+					struct select_info* info, bool kernel);
+extern status_t	deselect_object(uint32 type, int32 object,
+					struct select_info* info, bool kernel);
+
 extern ssize_t	_user_wait_for_objects(object_wait_info* userInfos,
 					int numInfos, uint32 flags, bigtime_t timeout);
 
@@ -39,6 +39,17 @@ typedef struct net_buffer {
 
 struct ancillary_data_container;
 
+/*!	Memory not owned by the network stack that can be referenced by buffers
+	without copying it, see net_buffer_module_info::append_external().
+	The owner creates it with a reference count of one and releases its own
+	reference when done; \c free is called once the last reference is gone.
+	It may be called in any context that may free net_buffers.
+*/
+typedef struct net_buffer_external {
+	int32			ref_count;
+	void			(*free)(struct net_buffer_external* external);
+} net_buffer_external;
+
 struct net_buffer_module_info {
 	module_info info;
 
@@ -101,6 +112,9 @@ struct net_buffer_module_info {
 	void			(*swap_addresses)(net_buffer* buffer);
 
 	void			(*dump)(net_buffer* buffer);
+
+	status_t		(*append_external)(net_buffer* buffer, const void* data,
+						size_t bytes, net_buffer_external* external);
 };
 
 
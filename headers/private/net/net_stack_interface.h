@@ -17,6 +17,7 @@
 	"network/stack/userland_interface/v1"
 
 
+struct net_buffer_external;
 struct net_socket;
 struct net_stat;
 
@@ -75,6 +76,10 @@ struct net_stack_interface_module_info {
 
 	status_t (*get_next_socket_stat)(int family, uint32 *cookie,
 					struct net_stat *stat);
+
+	ssize_t (*send_external)(net_socket* socket, const void* data,
+					size_t length, int flags,
+					struct net_buffer_external* external);
 };
 
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__HPKG__PRIVATE__CACHED_PACKAGE_FILE_HEAP_READER_H_
+#define _PACKAGE__HPKG__PRIVATE__CACHED_PACKAGE_FILE_HEAP_READER_H_
+
+
+#include <pthread.h>
+
+#include <package/hpkg/DataReader.h>
+
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+class PackageFileHeapReader;
+
+
+struct ChunkCacheStatistics {
+	uint64	hits;
+	uint64	misses;
+	uint64	readAheadHits;
+		// hits on chunks that had been decompressed in advance
+	uint64	readAheadWaits;
+		// accesses that had to wait for a read-ahead in progress
+	uint64	readAheadChunks;
+	uint64	evictions;
+	size_t	cachedChunks;
+	size_t	memoryUsage;
+	size_t	memoryBudget;
+};
+
+
+/*!	Userland heap reader keeping recently decompressed chunks of a
+	PackageFileHeapReader in an LRU cache. When the chunks are accessed
+	sequentially, the following chunks are decompressed in advance by a few
+	worker threads.
+
+	Not available in the kernel and the boot loader; packagefs has its own
+	CachedDataReader.
+*/
+class CachedPackageFileHeapReader : public BAbstractBufferedDataReader {
+public:
+								CachedPackageFileHeapReader(
+									PackageFileHeapReader* heapReader);
+	virtual						~CachedPackageFileHeapReader();
+
+			status_t			Init(size_t memoryBudget
+										= kDefaultMemoryBudget,
+									int32 readAheadThreadCount
+										= kDefaultReadAheadThreadCount);
+
+			void				SetMemoryBudget(size_t memoryBudget);
+			void				GetStatistics(
+									ChunkCacheStatistics& _statistics);
+
+	// BAbstractBufferedDataReader
+	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
+									BDataIO* output);
+
+public:
+	static	const size_t		kDefaultMemoryBudget = 8 * 1024 * 1024;
+	static	const int32			kDefaultReadAheadThreadCount = 2;
+
+private:
+			struct Chunk;
+			struct ChunkHashDefinition;
+
+			typedef BOpenHashTable<ChunkHashDefinition> ChunkTable;
+			typedef DoublyLinkedList<Chunk> ChunkList;
+
+private:
+			status_t			_GetChunk(size_t chunkIndex,
+									void* compressedBuffer, Chunk*& _chunk);
+			void				_PutChunk(Chunk* chunk);
+			Chunk*				_CreateChunk(size_t chunkIndex);
+			void				_DeleteChunk(Chunk* chunk);
+			void				_ReadAhead(size_t chunkIndex,
+									size_t endIndex);
+			void				_EvictChunks(size_t requiredMemory);
+			status_t			_LoadChunk(Chunk* chunk,
+									void* compressedBuffer);
+
+	static	void*				_ReadAheadThreadEntry(void* data);
+			void				_ReadAheadThread();
+
+private:
+			PackageFileHeapReader* fHeapReader;
+			size_t				fChunkCount;
+			pthread_mutex_t		fLock;
+			pthread_mutex_t		fFileLock;
+			pthread_cond_t		fChunkLoadedCondition;
+			pthread_cond_t		fReadAheadCondition;
+			ChunkTable*			fChunks;
+			ChunkList			fUnusedChunks;
+				// least recently used first
+			ChunkList			fReadAheadQueue;
+			pthread_t*			fThreads;
+			int32				fThreadCount;
+			int32				fReadAheadWindow;
+			size_t				fLastChunkIndex;
+			size_t				fMemoryUsage;
+			size_t				fMemoryBudget;
+			ChunkCacheStatistics fStatistics;
+			bool				fTerminating;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
+
+
+#endif	// _PACKAGE__HPKG__PRIVATE__CACHED_PACKAGE_FILE_HEAP_READER_H_
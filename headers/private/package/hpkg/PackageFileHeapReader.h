@@ -22,6 +22,8 @@ class BErrorOutput;
 namespace BPrivate {
 
 
+class CachedPackageFileHeapReader;
+
 class PackageFileHeapReader : public PackageFileHeapAccessorBase {
 public:
 								PackageFileHeapReader(BErrorOutput* errorOutput,
@@ -44,6 +46,14 @@ protected:
 									void* compressedDataBuffer,
 									void* uncompressedDataBuffer);
 
+private:
+			friend class CachedPackageFileHeapReader;
+
+private:
+			void				_GetChunkLocation(size_t chunkIndex,
+									uint64& _offset, size_t& _compressedSize,
+									size_t& _uncompressedSize) const;
+
 private:
 			OffsetArray			fOffsets;
 };
@@ -42,7 +42,7 @@ public:
 										decompressionAlgorithm);
 								~PackageFileHeapWriter();
 
-			void				Init();
+			void				Init(int32 compressionThreadCount = 1);
 			void				Reinit(PackageFileHeapReader* heapReader);
 
 			status_t			AddData(BDataReader& dataReader, off_t size,
@@ -63,6 +63,8 @@ private:
 			struct Chunk;
 			struct ChunkSegment;
 			struct ChunkBuffer;
+			struct CompressionJob;
+			struct CompressionPipeline;
 
 			friend struct ChunkBuffer;
 
@@ -72,11 +74,13 @@ private:
 			status_t			_FlushPendingData();
 			status_t			_WriteChunk(const void* data, size_t size,
 									bool mayCompress);
-			status_t			_WriteDataCompressed(const void* data,
-									size_t size);
+			status_t			_AppendChunk(const void* data, size_t size);
 			status_t			_WriteDataUncompressed(const void* data,
 									size_t size);
 
+			status_t			_WriteCompressedChunks(bool wait);
+			status_t			_DrainPipeline();
+
 			void				_PushChunks(ChunkBuffer& chunkBuffer,
 									uint64 startOffset, uint64 endOffset);
 			void				_UnwriteLastPartialChunk();
@@ -87,6 +91,8 @@ private:
 			size_t				fPendingDataSize;
 			Array<uint64>		fOffsets;
 			CompressionAlgorithmOwner* fCompressionAlgorithm;
+			CompressionPipeline* fPipeline;
+			bool				fPipelineEnabled;
 };
 
 
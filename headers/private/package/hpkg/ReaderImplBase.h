@@ -127,7 +127,7 @@ protected:
 			status_t			InitHeapReader(uint32 compression,
 									uint32 chunkSize, off_t offset,
 									uint64 compressedSize,
-									uint64 uncompressedSize);
+									uint64 uncompressedSize, uint32 flags);
 	virtual	status_t			CreateCachedHeapReader(
 									PackageFileHeapReader* heapReader,
 									BAbstractBufferedDataReader*&
@@ -517,7 +517,7 @@ ReaderImplBase::Init(BPositionIO* file, bool keepFile, Header& header, uint32 fl
 		B_BENDIAN_TO_HOST_INT16(header.heap_compression),
 		B_BENDIAN_TO_HOST_INT32(header.heap_chunk_size), heapOffset,
 		compressedHeapSize,
-		B_BENDIAN_TO_HOST_INT64(header.heap_size_uncompressed));
+		B_BENDIAN_TO_HOST_INT64(header.heap_size_uncompressed), flags);
 	if (error != B_OK)
 		return error;
 
@@ -109,6 +109,7 @@ typedef struct image_t {
 
 	// pointer to symbol participation data structures
 	uint32				*symhash;
+	uint32				*gnuhash;		// GNU-style hash table, if present
 	elf_sym				*syms;
 	char				*strtab;
 	elf_rel				*rel;
@@ -176,6 +177,16 @@ typedef struct image_queue_t {
 #define HASHBUCKETS(image) ((unsigned int*)&(image)->symhash[2])
 #define HASHCHAINS(image) ((unsigned int*)&(image)->symhash[2+HASHTABSIZE(image)])
 
+#define GNUHASHBUCKETCOUNT(image) ((image)->gnuhash[0])
+#define GNUHASHSYMOFFSET(image) ((image)->gnuhash[1])
+#define GNUHASHBLOOMSIZE(image) ((image)->gnuhash[2])
+#define GNUHASHBLOOMSHIFT(image) ((image)->gnuhash[3])
+#define GNUHASHBLOOM(image) ((elf_addr*)&(image)->gnuhash[4])
+#define GNUHASHBUCKETS(image) \
+	((uint32*)(GNUHASHBLOOM(image) + GNUHASHBLOOMSIZE(image)))
+#define GNUHASHCHAINS(image) \
+	(GNUHASHBUCKETS(image) + GNUHASHBUCKETCOUNT(image))
+
 
 // The name of the area the runtime loader creates for debugging purposes.
 #define RUNTIME_LOADER_DEBUG_AREA_NAME	"_rld_debug_"
@@ -89,6 +89,11 @@ public:
 									const char* attribute,
 									uint32 attributeType, status_t error);
 
+	virtual	bool				FileDataCopied(const char* path, off_t size);
+									// Called after each chunk of a file's
+									// data, with the total size copied so
+									// far. Returning false cancels the copy.
+
 	virtual	void				ErrorOccurred(const char* message,
 									status_t error);
 };
@@ -74,6 +74,12 @@ extern status_t		_kern_get_safemode_option(const char *parameter,
 extern ssize_t		_kern_wait_for_objects(object_wait_info* infos, int numInfos,
 						uint32 flags, bigtime_t timeout);
 
+extern int			_kern_event_queue_create(int openFlags);
+extern status_t		_kern_event_queue_select(int queue,
+						event_wait_info* infos, int numInfos);
+extern ssize_t		_kern_event_queue_wait(int queue, event_wait_info* infos,
+						int numInfos, uint32 flags, bigtime_t timeout);
+
 /* user mutex functions */
 extern status_t		_kern_mutex_lock(int32* mutex, const char* name,
 						uint32 flags, bigtime_t timeout);
@@ -345,6 +351,11 @@ extern status_t		_kern_unlock_node(int fd);
 extern status_t		_kern_get_next_fd_info(team_id team, uint32 *_cookie,
 						struct fd_info *info, size_t infoSize);
 extern status_t		_kern_preallocate(int fd, off_t offset, off_t length);
+extern ssize_t		_kern_send_file(int outFD, int inFD, off_t *_offset,
+						size_t count);
+extern ssize_t		_kern_copy_file_range(int inFD, off_t *_inOffset,
+						int outFD, off_t *_outOffset, size_t length,
+						uint32 flags);
 
 // socket functions
 extern int			_kern_socket(int family, int type, int protocol);
@@ -263,23 +263,7 @@ mmc_disk_init_driver(device_node* node, void** cookie)
 		return error;
 	}
 
-	info->scheduler = new(std::nothrow) IOSchedulerSimple(info->dmaResource);
-	if (info->scheduler == NULL) {
-		TRACE("Failed to allocate scheduler");
-		delete info->dmaResource;
-		free(info);
-		return B_NO_MEMORY;
-	}
-
-	error = info->scheduler->Init("mmc storage");
-	if (error != B_OK) {
-		TRACE("Failed to init scheduler");
-		delete info->scheduler;
-		delete info->dmaResource;
-		free(info);
-		return error;
-	}
-	info->scheduler->SetCallback(&mmc_disk_execute_iorequest, info);
+	// the I/O scheduler is created once we know our device name
 
 	memset(&info->geometry, 0, sizeof(info->geometry));
 
@@ -315,6 +299,14 @@ mmc_disk_register_child_devices(void* _cookie)
 	char name[64];
 	snprintf(name, sizeof(name), "disk/mmc/%" B_PRId32 "/raw", id);
 
+	status = IOSchedulerRoster::Default()->CreateScheduler(info->dmaResource,
+		"mmc storage", name, info->scheduler);
+	if (status != B_OK) {
+		TRACE("Failed to create scheduler");
+		return status;
+	}
+	info->scheduler->SetCallback(&mmc_disk_execute_iorequest, info);
+
 	status = sDeviceManager->publish_device(info->node, name,
 		MMC_DISK_DEVICE_MODULE_NAME);
 
@@ -17,7 +17,7 @@
 
 #include <mmc.h>
 
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 enum MMCDiskFlags {
@@ -31,7 +31,7 @@
 
 #include "dma_resources.h"
 #include "io_requests.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_RAM_DISK
@@ -349,13 +349,8 @@ struct RawDevice : Device, DoublyLinkedListLinkImpl<RawDevice> {
 			return error;
 		}
 
-		fIOScheduler = new(std::nothrow) IOSchedulerSimple(fDMAResource);
-		if (fIOScheduler == NULL) {
-			Unprepare();
-			return B_NO_MEMORY;
-		}
-
-		error = fIOScheduler->Init("ram disk device scheduler");
+		error = IOSchedulerRoster::Default()->CreateScheduler(fDMAResource,
+			"ram disk device scheduler", fDeviceName, fIOScheduler);
 		if (error != B_OK) {
 			Unprepare();
 			return error;
@@ -60,6 +60,7 @@ typedef struct {
 	uint32					block_size;
 	uint32					physical_block_size;
 	status_t				media_status;
+	char					device_name[64];
 
 	sem_id 	sem_cb;
 } virtio_block_driver_info;
@@ -78,7 +79,7 @@ typedef struct {
 
 #include "dma_resources.h"
 #include "IORequest.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_VIRTIO_BLOCK
@@ -456,15 +457,11 @@ virtio_block_set_capacity(virtio_block_driver_info* info)
 	if (status != B_OK)
 		panic("initializing DMAResource failed: %s", strerror(status));
 
-	info->io_scheduler = new(std::nothrow) IOSchedulerSimple(
-		info->dma_resource);
-	if (info->io_scheduler == NULL)
-		panic("allocating IOScheduler failed.");
-
-	// TODO: use whole device name here
-	status = info->io_scheduler->Init("virtio");
+	status = IOSchedulerRoster::Default()->CreateScheduler(info->dma_resource,
+		"virtio", info->device_name[0] != '\0' ? info->device_name : NULL,
+		info->io_scheduler);
 	if (status != B_OK)
-		panic("initializing IOScheduler failed: %s", strerror(status));
+		panic("creating IOScheduler failed: %s", strerror(status));
 
 	info->io_scheduler->SetCallback(do_io, info);
 
@@ -571,11 +568,11 @@ virtio_block_register_child_devices(void* _cookie)
 	if (id < 0)
 		return id;
 
-	char name[64];
-	snprintf(name, sizeof(name), "disk/virtual/virtio_block/%" B_PRId32 "/raw",
-		id);
+	// the name is also used to look up the I/O scheduler settings
+	snprintf(info->device_name, sizeof(info->device_name),
+		"disk/virtual/virtio_block/%" B_PRId32 "/raw", id);
 
-	status = sDeviceManager->publish_device(info->node, name,
+	status = sDeviceManager->publish_device(info->node, info->device_name,
 		VIRTIO_BLOCK_DEVICE_MODULE_NAME);
 
 	return status;
@@ -3,10 +3,13 @@
  * Distributed under the terms of the MIT License.
  */
 
-/** This module memorizes all opened files for a certain session. A session
- *	can be the start of an application or the boot process.
- *	When a session is started, it will prefetch all files from an earlier
- *	session in order to speed up the launching or booting process.
+/** This module memorizes all opened files, and the parts of them that were
+ *	read, for a certain session. A session can be the start of an application
+ *	or the boot process.
+ *	The profile of a session is the intersection of the last few sessions of
+ *	the same name; when a session is started, the files in its profile are
+ *	prefetched by a number of threads in parallel in order to speed up the
+ *	launching or booting process.
  *
  *	Note: this module is using private kernel API and is definitely not
  *		meant to be an example on how to write modules.
@@ -20,12 +23,17 @@
 
 #include <util/kernel_cpp.h>
 #include <util/AutoLock.h>
+#include <util/OpenHashTable.h>
 #include <thread.h>
 #include <team.h>
 #include <file_cache.h>
 #include <generic_syscall.h>
 #include <syscalls.h>
+#include <vfs.h>
 
+#include <algorithm>
+
+#include <dirent.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,7 +44,6 @@
 extern dev_t gBootDevice;
 
 
-// ToDo: combine the last 3-5 sessions to their intersection
 // ToDo: maybe ignore sessions if the node count is < 3 (without system libs)
 
 #define TRACE_CACHE_MODULE
@@ -49,6 +56,14 @@ extern dev_t gBootDevice;
 #define VNODE_HASH(mountid, vnodeid) (((uint32)((vnodeid) >> 32) \
 	+ (uint32)(vnodeid)) ^ (uint32)(mountid))
 
+#define MAX_DATA_PARTS			8
+#define DATA_PART_MERGE_GAP		(64 * 1024)
+	// parts that are closer than this are merged into one
+#define MAX_SESSION_HISTORY		4
+	// the number of sessions that are intersected into a profile
+#define MAX_PREFETCH_THREADS	4
+#define MAX_PROFILE_SIZE		(1024 * 1024)
+
 struct data_part {
 	off_t		offset;
 	off_t		size;
@@ -59,8 +74,12 @@ struct node {
 	node_ref	ref;
 	int32		ref_count;
 	bigtime_t	timestamp;
-	data_part	parts[5];
+		// time of the first access, used to order the profile
+	uint32		history;
+		// bit n is set if the node was used in the n-th last session
+	data_part	parts[MAX_DATA_PARTS];
 	size_t		part_count;
+		// if 0, the whole file is used
 };
 
 struct NodeHash {
@@ -108,6 +127,7 @@ class Session {
 
 		void AddNode(dev_t device, ino_t node);
 		void RemoveNode(dev_t device, ino_t node);
+		void AddData(dev_t device, ino_t node, off_t offset, off_t size);
 
 		void Lock() { mutex_lock(&fLock); }
 		void Unlock() { mutex_unlock(&fLock); }
@@ -116,13 +136,18 @@ class Session {
 		void StopWatchingTeam();
 
 		status_t LoadFromDirectory(int fd);
-		status_t Save();
-		void Prefetch();
+		Session *Save();
+		struct prefetch_job *Prefetch();
+		void SetPrefetchJob(struct prefetch_job *job) { fPrefetchJob = job; }
+		void Report();
 
 		Session *&Next() { return fNext; }
 
 	private:
 		struct node *_FindNode(dev_t device, ino_t node);
+		void _GetFileName(char *buffer, size_t bufferSize) const;
+		Session *_CreateProfile();
+		status_t _Write(const char *path);
 
 		Session		*fNext;
 		char		fName[B_OS_NAME_LENGTH];
@@ -130,14 +155,37 @@ class Session {
 		NodeTable	*fNodeHash;
 		struct node	*fNodes;
 		int32		fNodeCount;
+		int32		fSessionCount;
 		team_id		fTeam;
 		node_ref	fNodeRef;
 		bigtime_t	fActiveUntil;
 		bigtime_t	fTimestamp;
+		struct prefetch_job *fPrefetchJob;
 		bool		fClosing;
 		bool		fIsWatchingTeam;
 };
 
+struct prefetch_entry {
+	node_ref	ref;
+	uint32		history;
+	bool		prefetch;
+		// false if the node is not part of the intersection of the sessions
+	data_part	parts[MAX_DATA_PARTS];
+	size_t		part_count;
+};
+
+/*!	A copy of a profile, so that it can be prefetched, and later merged with
+	the session that started it, independently of the profile's lifetime.
+*/
+struct prefetch_job {
+	int32			ref_count;
+	int32			next_entry;
+	int32			entry_count;
+	int32			session_count;
+	int64			read_bytes;
+	prefetch_entry	entries[0];
+};
+
 class SessionGetter {
 	public:
 		SessionGetter(team_id team, Session **_session);
@@ -151,14 +199,6 @@ class SessionGetter {
 		Session	*fSession;
 };
 
-static Session *sMainSession;
-static SessionTable *sTeamHash;
-static PrefetchTable *sPrefetchHash;
-static Session *sMainPrefetchSessions;
-	// singly-linked list
-static recursive_lock sLock;
-
-
 node_ref::node_ref()
 {
 	// part of libbe.so
@@ -210,7 +250,7 @@ struct SessionHash {
 
 	bool Compare(KeyType key, ValueType* session) const
 	{
-		return session->Team == key;
+		return session->Team() == key;
 	}
 
 	ValueType*& GetLink(ValueType* value) const
@@ -222,6 +262,228 @@ struct SessionHash {
 typedef BOpenHashTable<SessionHash> SessionTable;
 
 
+static Session *sMainSession;
+static SessionTable *sTeamHash;
+static PrefetchTable *sPrefetchHash;
+static Session *sMainPrefetchSessions;
+	// singly-linked list
+static recursive_lock sLock;
+static launch_speedup_stats sStats;
+
+
+static void
+put_prefetch_job(prefetch_job *job)
+{
+	if (job != NULL && atomic_add(&job->ref_count, -1) == 1)
+		free(job);
+}
+
+
+static off_t
+data_size(const data_part *parts, size_t count)
+{
+	off_t size = 0;
+	for (size_t i = 0; i < count; i++)
+		size += parts[i].size;
+
+	return size;
+}
+
+
+/*!	Returns how many bytes of the parts in \a a are also part of \a b. Both
+	must be sorted, and must not overlap themselves. A count of 0 stands for
+	the whole file.
+*/
+static off_t
+data_overlap(const data_part *a, size_t aCount, const data_part *b,
+	size_t bCount)
+{
+	if (aCount == 0)
+		return data_size(b, bCount);
+	if (bCount == 0)
+		return data_size(a, aCount);
+
+	off_t overlap = 0;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < aCount && j < bCount) {
+		off_t start = std::max(a[i].offset, b[j].offset);
+		off_t end = std::min(a[i].offset + a[i].size, b[j].offset + b[j].size);
+		if (end > start)
+			overlap += end - start;
+
+		if (a[i].offset + a[i].size < b[j].offset + b[j].size)
+			i++;
+		else
+			j++;
+	}
+
+	return overlap;
+}
+
+
+/*!	Adds the range to the (sorted) parts of the node. Ranges are page aligned,
+	and merged with their neighbours if they are close to each other. If there
+	are too many parts, the two closest ones are merged.
+*/
+static void
+add_data_part(struct node *node, off_t offset, off_t size)
+{
+	off_t end = (offset + size + B_PAGE_SIZE - 1) & ~((off_t)B_PAGE_SIZE - 1);
+	offset &= ~((off_t)B_PAGE_SIZE - 1);
+
+	// find the first part that isn't completely before the new range
+	size_t index = 0;
+	while (index < node->part_count && node->parts[index].offset
+			+ node->parts[index].size + DATA_PART_MERGE_GAP < offset) {
+		index++;
+	}
+
+	// merge all parts that are close to the new range into it
+	size_t last = index;
+	while (last < node->part_count
+		&& node->parts[last].offset <= end + DATA_PART_MERGE_GAP) {
+		offset = std::min(offset, node->parts[last].offset);
+		end = std::max(end, node->parts[last].offset + node->parts[last].size);
+		last++;
+	}
+
+	if (last > index) {
+		// replace the merged parts with the new one
+		node->parts[index].offset = offset;
+		node->parts[index].size = end - offset;
+		memmove(&node->parts[index + 1], &node->parts[last],
+			(node->part_count - last) * sizeof(data_part));
+		node->part_count -= last - index - 1;
+		return;
+	}
+
+	if (node->part_count == MAX_DATA_PARTS) {
+		// merge the two parts with the smallest gap between them
+		size_t closest = 0;
+		off_t smallestGap = -1;
+		for (size_t i = 0; i + 1 < node->part_count; i++) {
+			off_t gap = node->parts[i + 1].offset
+				- (node->parts[i].offset + node->parts[i].size);
+			if (smallestGap < 0 || gap < smallestGap) {
+				closest = i;
+				smallestGap = gap;
+			}
+		}
+
+		node->parts[closest].size = node->parts[closest + 1].offset
+			+ node->parts[closest + 1].size - node->parts[closest].offset;
+		memmove(&node->parts[closest + 1], &node->parts[closest + 2],
+			(node->part_count - closest - 2) * sizeof(data_part));
+		node->part_count--;
+
+		// the new range lies in the gap that has just been closed
+		if (index == closest + 1)
+			return;
+		if (index > closest + 1)
+			index--;
+	}
+
+	memmove(&node->parts[index + 1], &node->parts[index],
+		(node->part_count - index) * sizeof(data_part));
+	node->parts[index].offset = offset;
+	node->parts[index].size = end - offset;
+	node->part_count++;
+}
+
+
+/*!	Prefetches the entries of the job until there are none left. Runs in
+	several threads at once for every job.
+*/
+static status_t
+prefetch_thread(void *_job)
+{
+	prefetch_job *job = (prefetch_job *)_job;
+
+	while (true) {
+		int32 index = atomic_add(&job->next_entry, 1);
+		if (index >= job->entry_count)
+			break;
+
+		prefetch_entry &entry = job->entries[index];
+		if (!entry.prefetch)
+			continue;
+
+		struct vnode *vnode;
+		if (vfs_get_vnode(entry.ref.device, entry.ref.node, true, &vnode)
+				!= B_OK)
+			continue;
+
+		size_t bytesRead = 0;
+		if (entry.part_count == 0)
+			bytesRead = cache_prefetch_vnode(vnode, 0, ~0UL);
+		for (size_t i = 0; i < entry.part_count; i++) {
+			bytesRead += cache_prefetch_vnode(vnode, entry.parts[i].offset,
+				entry.parts[i].size);
+		}
+
+		vfs_put_vnode(vnode);
+		atomic_add64(&job->read_bytes, bytesRead);
+	}
+
+	put_prefetch_job(job);
+	return B_OK;
+}
+
+
+static Session *
+find_prefetch_session(const char *name, dev_t device, ino_t node)
+{
+	if (node == -1) {
+		// search for session by name
+		for (Session *session = sMainPrefetchSessions; session != NULL;
+				session = session->Next()) {
+			if (!strcmp(session->Name(), name))
+				return session;
+		}
+		return NULL;
+	}
+
+	node_ref key;
+	key.device = device;
+	key.node = node;
+	return sPrefetchHash->Lookup(key);
+}
+
+
+/*!	Adds \a profile to the known prefetch sessions, and replaces and deletes
+	the previous version of it, if any. sLock must be held.
+*/
+static void
+replace_prefetch_session(Session *profile)
+{
+	if (profile->IsMainSession()) {
+		Session **link = &sMainPrefetchSessions;
+		while (*link != NULL) {
+			if (!strcmp((*link)->Name(), profile->Name())) {
+				Session *previous = *link;
+				*link = previous->Next();
+				delete previous;
+				break;
+			}
+			link = &(*link)->Next();
+		}
+
+		profile->Next() = sMainPrefetchSessions;
+		sMainPrefetchSessions = profile;
+		return;
+	}
+
+	Session *previous = sPrefetchHash->Lookup(profile->NodeRef());
+	if (previous != NULL) {
+		sPrefetchHash->Remove(previous);
+		delete previous;
+	}
+
+	sPrefetchHash->Insert(profile);
+}
+
+
 static void
 stop_session(Session *session)
 {
@@ -230,8 +492,11 @@ stop_session(Session *session)
 
 	TRACE(("stop_session(%s)\n", session->Name()));
 
+	session->Report();
+
+	Session *profile = NULL;
 	if (session->IsWorthSaving())
-		session->Save();
+		profile = session->Save();
 
 	{
 		RecursiveLocker locker(&sLock);
@@ -241,6 +506,9 @@ stop_session(Session *session)
 
 		if (session == sMainSession)
 			sMainSession = NULL;
+
+		if (profile != NULL)
+			replace_prefetch_session(profile);
 	}
 
 	delete session;
@@ -264,24 +532,11 @@ start_session(team_id team, dev_t device, ino_t node, const char *name,
 
 	// let's see if there is a prefetch session for this session
 
-	Session *prefetchSession;
-	if (session->IsMainSession()) {
-		// search for session by name
-		for (prefetchSession = sMainPrefetchSessions;
-				prefetchSession != NULL;
-				prefetchSession = prefetchSession->Next()) {
-			if (!strcmp(prefetchSession->Name(), name)) {
-				// found session!
-				break;
-			}
-		}
-	} else {
-		// ToDo: search for session by device/node ID
-		prefetchSession = NULL;
-	}
+	Session *prefetchSession = find_prefetch_session(session->Name(), device,
+		node);
 	if (prefetchSession != NULL) {
 		TRACE(("found prefetch session %s\n", prefetchSession->Name()));
-		prefetchSession->Prefetch();
+		session->SetPrefetchJob(prefetchSession->Prefetch());
 	}
 
 	if (team >= B_OK)
@@ -322,18 +577,29 @@ parse_node_ref(const char *string, node_ref &ref, const char **_end = NULL)
 static struct node *
 new_node(dev_t device, ino_t id)
 {
-	struct node *node = new ::node;
+	struct node *node = new(std::nothrow) ::node;
 	if (node == NULL)
 		return NULL;
 
+	node->next = NULL;
 	node->ref.device = device;
 	node->ref.node = id;
+	node->ref_count = 1;
 	node->timestamp = system_time();
+	node->history = 1;
+	node->part_count = 0;
 
 	return node;
 }
 
 
+static bool
+node_timestamp_less(const struct node *a, const struct node *b)
+{
+	return a->timestamp < b->timestamp;
+}
+
+
 static void
 load_prefetch_data()
 {
@@ -346,7 +612,9 @@ load_prefetch_data()
 		if (dirent->d_name[0] == '.')
 			continue;
 
-		Session *session = new Session(dirent->d_name);
+		Session *session = new(std::nothrow) Session(dirent->d_name);
+		if (session == NULL)
+			break;
 
 		if (session->LoadFromDirectory(dirfd(dir)) != B_OK) {
 			delete session;
@@ -373,7 +641,9 @@ Session::Session(team_id team, const char *name, dev_t device,
 	:
 	fNodes(NULL),
 	fNodeCount(0),
+	fSessionCount(0),
 	fTeam(team),
+	fPrefetchJob(NULL),
 	fClosing(false),
 	fIsWatchingTeam(false)
 {
@@ -407,6 +677,9 @@ Session::Session(const char *name)
 	:
 	fNodeHash(NULL),
 	fNodes(NULL),
+	fNodeCount(0),
+	fSessionCount(0),
+	fPrefetchJob(NULL),
 	fClosing(false),
 	fIsWatchingTeam(false)
 {
@@ -414,9 +687,13 @@ Session::Session(const char *name)
 	fNodeRef.device = -1;
 	fNodeRef.node = -1;
 
-	if (isdigit(name[0]))
-		parse_node_ref(name, fNodeRef);
+	const char *end = name;
+	if (isdigit(name[0]) && parse_node_ref(name, fNodeRef, &end)) {
+		// the file name is "<device>:<node> <name>"
+		name = end[0] == ' ' ? end + 1 : end;
+	}
 
+	mutex_init(&fLock, "launch speedup profile");
 	strlcpy(fName, name, B_OS_NAME_LENGTH);
 }
 
@@ -438,10 +715,11 @@ Session::~Session()
 
 	for (; node != NULL; node = next) {
 		next = node->next;
-		free(node);
+		delete node;
 	}
 
 	delete fNodeHash;
+	put_prefetch_job(fPrefetchJob);
 	StopWatchingTeam();
 }
 
@@ -492,7 +770,26 @@ Session::RemoveNode(dev_t device, ino_t id)
 	if (node != NULL && --node->ref_count <= 0) {
 		fNodeHash->Remove(node);
 		fNodeCount--;
+		delete node;
+	}
+}
+
+
+void
+Session::AddData(dev_t device, ino_t id, off_t offset, off_t size)
+{
+	struct node *node = _FindNode(device, id);
+	if (node == NULL) {
+		// the file might have been opened before the session started
+		node = new_node(device, id);
+		if (node == NULL)
+			return;
+
+		fNodeHash->Insert(node);
+		fNodeCount++;
 	}
+
+	add_data_part(node, offset, size);
 }
 
 
@@ -518,15 +815,109 @@ Session::StopWatchingTeam()
 }
 
 
-void
+/*!	Starts prefetching the nodes of this profile that were used in all of the
+	last sessions, in the order they were first accessed. Returns the job,
+	which also contains a copy of the profile to be merged with the new
+	session later.
+*/
+prefetch_job *
 Session::Prefetch()
 {
 	if (fNodes == NULL || fNodeHash != NULL)
-		return;
+		return NULL;
+
+	prefetch_job *job = (prefetch_job *)malloc(sizeof(prefetch_job)
+		+ fNodeCount * sizeof(prefetch_entry));
+	if (job == NULL)
+		return NULL;
+
+	job->ref_count = 1;
+	job->next_entry = 0;
+	job->entry_count = 0;
+	job->session_count = fSessionCount;
+	job->read_bytes = 0;
+
+	uint32 intersection = (1 << std::min(fSessionCount,
+		(int32)MAX_SESSION_HISTORY)) - 1;
+	int32 prefetchCount = 0;
 
 	for (struct node *node = fNodes; node != NULL; node = node->next) {
-		cache_prefetch(node->ref.device, node->ref.node, 0, ~0UL);
+		prefetch_entry &entry = job->entries[job->entry_count++];
+		entry.ref = node->ref;
+		entry.history = node->history;
+		entry.prefetch = (node->history & intersection) == intersection;
+		entry.part_count = node->part_count;
+		memcpy(entry.parts, node->parts, node->part_count * sizeof(data_part));
+
+		if (entry.prefetch)
+			prefetchCount++;
+	}
+
+	int32 threadCount = std::min(prefetchCount, (int32)MAX_PREFETCH_THREADS);
+	for (int32 i = 0; i < threadCount; i++) {
+		atomic_add(&job->ref_count, 1);
+
+		thread_id thread = spawn_kernel_thread(prefetch_thread,
+			"launch speedup prefetcher", B_NORMAL_PRIORITY, job);
+		if (thread < 0 || resume_thread(thread) != B_OK) {
+			atomic_add(&job->ref_count, -1);
+			break;
+		}
+	}
+
+	TRACE(("prefetch %s: %" B_PRId32 " of %" B_PRId32 " nodes, %" B_PRId32
+		" threads\n", Name(), prefetchCount, job->entry_count, threadCount));
+	return job;
+}
+
+
+/*!	Prints how much of the prefetched data has actually been used during
+	this session, and adds it to the global statistics.
+*/
+void
+Session::Report()
+{
+	bigtime_t duration = system_time() - fTimestamp;
+	if (IsMainSession() && !strcmp(Name(), "system boot"))
+		sStats.boot_time = duration;
+
+	if (fPrefetchJob == NULL || fNodeHash == NULL)
+		return;
+
+	off_t profileBytes = 0;
+	off_t usedBytes = 0;
+	int32 prefetched = 0;
+	int32 used = 0;
+
+	for (int32 i = 0; i < fPrefetchJob->entry_count; i++) {
+		const prefetch_entry &entry = fPrefetchJob->entries[i];
+		if (!entry.prefetch)
+			continue;
+
+		prefetched++;
+		profileBytes += data_size(entry.parts, entry.part_count);
+
+		struct node *node = _FindNode(entry.ref.device, entry.ref.node);
+		if (node == NULL)
+			continue;
+
+		used++;
+		usedBytes += data_overlap(entry.parts, entry.part_count, node->parts,
+			node->part_count);
 	}
+
+	int64 readBytes = atomic_get64(&fPrefetchJob->read_bytes);
+
+	TRACE(("launch_speedup: \"%s\" took %" B_PRIdBIGTIME " ms, prefetched %"
+		B_PRId32 " files (%" B_PRIdOFF " KB, %" B_PRId64 " KB read), %" B_PRId32
+		" files (%" B_PRIdOFF " KB) of them were used\n", Name(),
+		duration / 1000, prefetched, profileBytes / 1024, readBytes / 1024,
+		used, usedBytes / 1024));
+
+	atomic_add((int32 *)&sStats.sessions, 1);
+	atomic_add64((int64 *)&sStats.profile_bytes, profileBytes);
+	atomic_add64((int64 *)&sStats.read_bytes, readBytes);
+	atomic_add64((int64 *)&sStats.used_bytes, usedBytes);
 }
 
 
@@ -545,14 +936,13 @@ Session::LoadFromDirectory(int directoryFD)
 		return errno;
 	}
 
-	if (stat.st_size > 32768) {
+	if (stat.st_size > MAX_PROFILE_SIZE) {
 		// for safety reasons
-		// ToDo: make a bit larger later
 		close(fd);
 		return B_BAD_DATA;
 	}
 
-	char *buffer = (char *)malloc(stat.st_size);
+	char *buffer = (char *)malloc(stat.st_size + 1);
 	if (buffer == NULL) {
 		close(fd);
 		return B_NO_MEMORY;
@@ -563,16 +953,58 @@ Session::LoadFromDirectory(int directoryFD)
 		close(fd);
 		return B_ERROR;
 	}
+	buffer[stat.st_size] = '\0';
+
+	// Profiles start with a "# launch_speedup <session count>" line, and
+	// contain a "<device>:<node> <history> [<offset>:<size> ...]" line per
+	// node. Old profiles only list the node refs.
 
 	const char *line = buffer;
+	fSessionCount = 1;
+	if (line[0] == '#') {
+		const char *count = strchr(line, ' ');
+		if (count != NULL)
+			count = strchr(count + 1, ' ');
+		if (count != NULL)
+			fSessionCount = std::max(strtol(count + 1, NULL, 10), 1L);
+
+		line = strchr(line, '\n');
+		line = line != NULL ? line + 1 : "";
+	}
+
+	struct node **tail = &fNodes;
 	node_ref nodeRef;
 	while (parse_node_ref(line, nodeRef, &line)) {
 		struct node *node = new_node(nodeRef.device, nodeRef.node);
-		if (node != NULL) {
-			// note: this reverses the order of the nodes in the file
-			node->next = fNodes;
-			fNodes = node;
+		if (node == NULL)
+			break;
+
+		char *end;
+		if (line[0] == ' ') {
+			node->history = strtoul(line + 1, &end, 16);
+			line = end;
+		}
+
+		while (line[0] == ' ' && node->part_count < MAX_DATA_PARTS) {
+			data_part &part = node->parts[node->part_count];
+			part.offset = strtoll(line + 1, &end, 0);
+			if (end[0] != ':')
+				break;
+			part.size = strtoll(end + 1, &end, 0);
+			line = end;
+
+			if (part.offset >= 0 && part.size > 0)
+				node->part_count++;
 		}
+
+		// keep the order of the file
+		*tail = node;
+		tail = &node->next;
+		fNodeCount++;
+
+		line = strchr(line, '\n');
+		if (line == NULL)
+			break;
 		line++;
 	}
 
@@ -582,43 +1014,171 @@ Session::LoadFromDirectory(int directoryFD)
 }
 
 
-status_t
-Session::Save()
+void
+Session::_GetFileName(char *buffer, size_t bufferSize) const
 {
-	fClosing = true;
-
-	char name[B_OS_NAME_LENGTH + 25];
 	if (!IsMainSession()) {
-		snprintf(name, sizeof(name), "/etc/launch_cache/%ld:%lld %s",
+		snprintf(buffer, bufferSize, "%" B_PRIdDEV ":%" B_PRIdINO " %s",
 			fNodeRef.device, fNodeRef.node, Name());
 	} else
-		snprintf(name, sizeof(name), "/etc/launch_cache/%s", Name());
+		strlcpy(buffer, Name(), bufferSize);
+}
+
+
+/*!	Merges this session with the profile it has been prefetched from, if any,
+	and returns the resulting new profile.
+	Nodes that have not been used in any of the last MAX_SESSION_HISTORY
+	sessions are dropped; the parts of the others are combined.
+*/
+Session *
+Session::_CreateProfile()
+{
+	char name[B_OS_NAME_LENGTH + 25];
+	_GetFileName(name, sizeof(name));
+
+	Session *profile = new(std::nothrow) Session(name);
+	if (profile == NULL)
+		return NULL;
+
+	NodeTable nodes;
+	if (nodes.Init(fNodeCount * 2) != B_OK) {
+		delete profile;
+		return NULL;
+	}
+
+	uint32 historyMask = (1 << MAX_SESSION_HISTORY) - 1;
+	int32 count = 0;
+
+	if (fPrefetchJob != NULL) {
+		profile->fSessionCount = fPrefetchJob->session_count;
+
+		for (int32 i = 0; i < fPrefetchJob->entry_count; i++) {
+			const prefetch_entry &entry = fPrefetchJob->entries[i];
+			if (((entry.history << 1) & historyMask) == 0)
+				continue;
+
+			struct node *node = new_node(entry.ref.device, entry.ref.node);
+			if (node == NULL)
+				continue;
+
+			// order unused nodes after the ones of this session
+			node->timestamp = B_INFINITE_TIMEOUT - fPrefetchJob->entry_count
+				+ i;
+			node->history = (entry.history << 1) & historyMask;
+			node->part_count = entry.part_count;
+			memcpy(node->parts, entry.parts,
+				entry.part_count * sizeof(data_part));
+
+			nodes.Insert(node);
+			count++;
+		}
+	}
 
-	int fd = open(name, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	profile->fSessionCount = std::min(profile->fSessionCount + 1,
+		(int32)MAX_SESSION_HISTORY);
+
+	NodeTable::Iterator iterator(fNodeHash);
+	while (iterator.HasNext()) {
+		struct node *sessionNode = iterator.Next();
+
+		struct node *node = nodes.Lookup(sessionNode->ref);
+		if (node == NULL) {
+			node = new_node(sessionNode->ref.device, sessionNode->ref.node);
+			if (node == NULL)
+				continue;
+
+			node->history = 0;
+			nodes.Insert(node);
+			count++;
+		} else if (node->part_count == 0 || sessionNode->part_count == 0) {
+			// one of them used the whole file
+			node->part_count = 0;
+		}
+
+		node->timestamp = sessionNode->timestamp;
+		node->history |= 1;
+
+		bool wholeFile = node->history != 1 && node->part_count == 0;
+		if (!wholeFile) {
+			for (size_t i = 0; i < sessionNode->part_count; i++) {
+				add_data_part(node, sessionNode->parts[i].offset,
+					sessionNode->parts[i].size);
+			}
+		}
+	}
+
+	// order the nodes by their first access
+
+	struct node **array = (struct node **)malloc(count * sizeof(void *));
+	struct node *node = nodes.Clear(true);
+	if (array == NULL) {
+		while (node != NULL) {
+			struct node *next = node->next;
+			delete node;
+			node = next;
+		}
+		delete profile;
+		return NULL;
+	}
+
+	for (int32 i = 0; node != NULL; node = node->next)
+		array[i++] = node;
+
+	std::sort(array, array + count, node_timestamp_less);
+
+	struct node **tail = &profile->fNodes;
+	for (int32 i = 0; i < count; i++) {
+		*tail = array[i];
+		tail = &array[i]->next;
+	}
+	*tail = NULL;
+	profile->fNodeCount = count;
+
+	free(array);
+	return profile;
+}
+
+
+status_t
+Session::_Write(const char *path)
+{
+	int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
 	if (fd < B_OK)
 		return errno;
 
 	status_t status = B_OK;
 	off_t fileSize = 0;
 
-	// ToDo: order nodes by timestamp... (should improve launch speed)
-	// ToDo: test which parts of a file have been read (and save that as well)
-
 	// enlarge file, so that it can be written faster
 	ftruncate(fd, 512 * 1024);
 
-	NodeTable::Iterator iterator(fNodeHash);
-	while (iterator.HasNext()) {
-		struct node *node = iterator.Next();
-		snprintf(name, sizeof(name), "%ld:%lld\n", node->ref.device, node->ref.node);
+	char line[512];
+	int length = snprintf(line, sizeof(line), "# launch_speedup %" B_PRId32
+		"\n", fSessionCount);
+	struct node *node = fNodes;
 
-		ssize_t bytesWritten = write(fd, name, strlen(name));
+	while (true) {
+		ssize_t bytesWritten = write(fd, line, length);
 		if (bytesWritten < B_OK) {
 			status = bytesWritten;
 			break;
 		}
 
 		fileSize += bytesWritten;
+
+		if (node == NULL)
+			break;
+
+		length = snprintf(line, sizeof(line), "%" B_PRIdDEV ":%" B_PRIdINO
+			" %" B_PRIx32, node->ref.device, node->ref.node, node->history);
+		for (size_t i = 0; i < node->part_count; i++) {
+			length += snprintf(line + length, sizeof(line) - length,
+				" %" B_PRIdOFF ":%" B_PRIdOFF, node->parts[i].offset,
+				node->parts[i].size);
+		}
+		length += snprintf(line + length, sizeof(line) - length, "\n");
+
+		node = node->next;
 	}
 
 	ftruncate(fd, fileSize);
@@ -628,6 +1188,32 @@ Session::Save()
 }
 
 
+/*!	Saves the profile resulting from this session and the previous ones, and
+	returns it.
+*/
+Session *
+Session::Save()
+{
+	fClosing = true;
+
+	Session *profile = _CreateProfile();
+	if (profile == NULL)
+		return NULL;
+
+	char name[B_OS_NAME_LENGTH + 25];
+	char path[B_PATH_NAME_LENGTH];
+	_GetFileName(name, sizeof(name));
+	snprintf(path, sizeof(path), "/etc/launch_cache/%s", name);
+
+	if (profile->_Write(path) != B_OK) {
+		delete profile;
+		return NULL;
+	}
+
+	return profile;
+}
+
+
 bool
 Session::IsWorthSaving() const
 {
@@ -743,6 +1329,23 @@ node_opened(struct vnode *vnode, int32 fdType, dev_t device, ino_t parent,
 }
 
 
+static void
+node_read(struct vnode *vnode, dev_t device, ino_t node, off_t offset,
+	size_t size)
+{
+	if (device < gBootDevice)
+		return;
+
+	Session *session;
+	SessionGetter getter(team_get_current_team_id(), &session);
+
+	if (session == NULL || !session->IsActive())
+		return;
+
+	session->AddData(device, node, offset, size);
+}
+
+
 static void
 node_closed(struct vnode *vnode, int32 fdType, dev_t device, ino_t node,
 	int32 accessType)
@@ -797,6 +1400,16 @@ launch_speedup_control(const char *subsystem, uint32 function,
 			sMainSession = NULL;
 			return B_OK;
 		}
+
+		case LAUNCH_SPEEDUP_GET_STATS:
+		{
+			if (bufferSize != sizeof(launch_speedup_stats))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer))
+				return B_BAD_ADDRESS;
+
+			return user_memcpy(buffer, &sStats, sizeof(launch_speedup_stats));
+		}
 	}
 
 	return B_BAD_VALUE;
@@ -814,13 +1427,13 @@ uninit()
 
 	Session *session = sTeamHash->Clear(true);
 	while (session != NULL) {
-		Session *next = session->next;
+		Session *next = session->Next();
 		delete session;
 		session = next;
 	}
 	session = sPrefetchHash->Clear(true);
 	while (session != NULL) {
-		Session *next = session->next;
+		Session *next = session->Next();
 		delete session;
 		session = next;
 	}
@@ -910,6 +1523,7 @@ static struct cache_module_info sLaunchSpeedupModule = {
 	node_opened,
 	node_closed,
 	NULL,
+	node_read,
 };
 
 
@@ -6,11 +6,23 @@
 #define LAUNCH_SPEEDUP_H
 
 
+#include <OS.h>
+
+
 // generic syscall interface
 #define LAUNCH_SPEEDUP_SYSCALLS "launch_speedup"
 
 #define LAUNCH_SPEEDUP_START_SESSION	1
 #define LAUNCH_SPEEDUP_STOP_SESSION		2
+#define LAUNCH_SPEEDUP_GET_STATS		3	// fills in a launch_speedup_stats
+
+typedef struct launch_speedup_stats {
+	uint32		sessions;		// sessions that were prefetched for
+	uint64		profile_bytes;	// bytes listed in the profiles used
+	uint64		read_bytes;		// bytes actually read by prefetching
+	uint64		used_bytes;		// bytes of the profiles accessed afterwards
+	bigtime_t	boot_time;		// duration of the last boot session
+} launch_speedup_stats;
 
 
 #endif	/* LAUNCH_SPEEDUP_H */
@@ -10,6 +10,9 @@
 //! B+Tree implementation
 
 
+// This needs to be the first include because of the fs shell API wrapper
+#include <algorithm>
+
 #include "BPlusTree.h"
 
 #include <file_systems/QueryParserUtils.h>
@@ -582,7 +585,8 @@ CachedNode::Allocate(Transaction& transaction, bplustree_node** _node,
 BPlusTree::BPlusTree(Transaction& transaction, Inode* stream, int32 nodeSize)
 	:
 	fStream(NULL),
-	fInTransaction(false)
+	fInTransaction(false),
+	fStatistics(NULL)
 {
 	mutex_init(&fIteratorLock, "bfs b+tree iterator");
 	SetTo(transaction, stream);
@@ -597,6 +601,7 @@ BPlusTree::BPlusTree(Inode* stream)
 {
 #if !_BOOT_MODE
 	mutex_init(&fIteratorLock, "bfs b+tree iterator");
+	fStatistics = NULL;
 #endif
 
 	SetTo(stream);
@@ -613,6 +618,7 @@ BPlusTree::BPlusTree()
 {
 #if !_BOOT_MODE
 	mutex_init(&fIteratorLock, "bfs b+tree iterator");
+	fStatistics = NULL;
 #endif
 }
 
@@ -632,6 +638,8 @@ BPlusTree::~BPlusTree()
 
 	mutex_destroy(&fIteratorLock);
 
+	delete fStatistics;
+
 	ASSERT(!fInTransaction);
 #endif // !_BOOT_MODE
 }
@@ -2327,6 +2335,197 @@ BPlusTree::Find(const uint8* key, uint16 keyLength, off_t* _value)
 
 
 #if !_BOOT_MODE
+static const bigtime_t kStatisticsLifetime = 30000000LL;
+	// 30 seconds
+static const int32 kMaxSampledDuplicateNodes = 4;
+
+// node writes of a TreeBuilder, or inserts of a TreeBatch, before the
+// transaction is restarted
+static const uint32 kMaxBuilderTransactionNodes = 1024;
+
+
+/*!	Estimates the number of entries in the tree, and samples a histogram of
+	its keys that can be used to estimate the selectivity of a key range.
+	Since the tree is balanced, descending to a relative position in each
+	level ends up at about the same relative position in its leaves, so the
+	histogram keys are evenly spaced over the keys of the tree.
+	The number of entries is extrapolated from the number of values found in
+	a few of these leaves, including their duplicates.
+
+	The result is cached until the tree has changed its size by more than
+	an eighth, or after kStatisticsLifetime.
+*/
+status_t
+BPlusTree::GetStatistics(bplustree_statistics& statistics)
+{
+	InodeReadLocker locker(fStream);
+
+	off_t nodes = fHeader.MaximumSize() / fNodeSize - 1;
+
+	MutexLocker statisticsLocker(fIteratorLock);
+
+	if (fStatistics != NULL
+		&& system_time() - fStatistics->sampled < kStatisticsLifetime) {
+		off_t difference = nodes - fStatistics->nodes;
+		if (difference < 0)
+			difference = -difference;
+
+		if (difference <= fStatistics->nodes / 8) {
+			memcpy(&statistics, fStatistics, sizeof(bplustree_statistics));
+			return B_OK;
+		}
+	}
+
+	statisticsLocker.Unlock();
+
+	status_t status = _SampleStatistics(statistics);
+	if (status != B_OK)
+		return status;
+
+	statisticsLocker.Lock();
+
+	if (fStatistics == NULL)
+		fStatistics = new(std::nothrow) bplustree_statistics;
+	if (fStatistics != NULL)
+		memcpy(fStatistics, &statistics, sizeof(bplustree_statistics));
+
+	return B_OK;
+}
+
+
+status_t
+BPlusTree::_SampleStatistics(bplustree_statistics& statistics)
+{
+	memset(&statistics, 0, sizeof(bplustree_statistics));
+	statistics.nodes = fHeader.MaximumSize() / fNodeSize - 1;
+	statistics.levels = fHeader.MaxNumberOfLevels();
+	statistics.sampled = system_time();
+
+	// A fragment is the smallest unit of a node that can be used up by
+	// a key, a full node is worth maxFragments of them
+	const uint32 maxFragments = bplustree_node::MaxFragments(fNodeSize);
+
+	CachedNode cached(this);
+	CachedNode duplicateCached(this);
+	off_t sampledKeys = 0;
+	off_t sampledValues = 0;
+	off_t sampledFragments = 0;
+
+	for (int32 i = 0; i < BPLUSTREE_HISTOGRAM_KEYS; i++) {
+		uint32 position = ((i + 1) << 16) / (BPLUSTREE_HISTOGRAM_KEYS + 1);
+		int32 keyIndex;
+		const bplustree_node* node = _SeekPosition(cached, position,
+			&keyIndex);
+		if (node == NULL)
+			RETURN_ERROR(B_BAD_DATA);
+		if (node->NumKeys() == 0) {
+			// the tree is empty
+			break;
+		}
+
+		uint16 length;
+		uint8* key = node->KeyAt(keyIndex, &length);
+		if (key + length > (uint8*)node + fNodeSize
+			|| length > BPLUSTREE_MAX_KEY_LENGTH)
+			RETURN_ERROR(B_BAD_DATA);
+
+		length = min_c(length, BPLUSTREE_HISTOGRAM_KEY_LENGTH);
+
+		// small trees may give us the same key more than once
+		uint32 count = statistics.histogram_count;
+		if (count == 0 || statistics.histogram[count - 1].length != length
+			|| memcmp(statistics.histogram[count - 1].data, key, length)
+				!= 0) {
+			statistics.histogram[count].length = length;
+			memcpy(statistics.histogram[count].data, key, length);
+			statistics.histogram_count++;
+		}
+
+		// only look at the values of every fourth leaf
+		if ((i % 4) != 1)
+			continue;
+
+		sampledKeys += node->NumKeys();
+		sampledFragments += maxFragments;
+
+		for (int32 j = 0; j < node->NumKeys(); j++) {
+			off_t value = BFS_ENDIAN_TO_HOST_INT64(node->Values()[j]);
+			uint8 type = bplustree_node::LinkType(value);
+
+			if (type == BPLUSTREE_DUPLICATE_FRAGMENT) {
+				const bplustree_node* fragment = duplicateCached.SetTo(
+					bplustree_node::FragmentOffset(value), false);
+				if (fragment == NULL)
+					continue;
+
+				sampledValues += fragment->CountDuplicates(value, true);
+				sampledFragments++;
+			} else if (type == BPLUSTREE_DUPLICATE_NODE) {
+				off_t offset = bplustree_node::FragmentOffset(value);
+
+				for (int32 count = 0; count < kMaxSampledDuplicateNodes
+						&& offset != BPLUSTREE_NULL; count++) {
+					const bplustree_node* duplicate = duplicateCached.SetTo(
+						offset, false);
+					if (duplicate == NULL)
+						break;
+
+					sampledValues += duplicate->CountDuplicates(offset, false);
+					sampledFragments += maxFragments;
+					offset = duplicate->RightLink();
+				}
+			} else
+				sampledValues++;
+		}
+	}
+
+	if (sampledFragments > 0 && sampledValues > 0) {
+		statistics.entries = statistics.nodes * sampledValues * maxFragments
+			/ sampledFragments;
+		statistics.keys = max_c(1,
+			statistics.entries * sampledKeys / sampledValues);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Descends the tree to the leaf key at the relative \a position, where
+	0 is its first, and 65536 would be one beyond its last key.
+	Returns the leaf, and its key index in \a _keyIndex.
+*/
+const bplustree_node*
+BPlusTree::_SeekPosition(CachedNode& cached, uint32 position,
+	int32* _keyIndex)
+{
+	off_t nodeOffset = fHeader.RootNode();
+
+	for (uint32 level = 0; level < fHeader.MaxNumberOfLevels(); level++) {
+		const bplustree_node* node = cached.SetTo(nodeOffset);
+		if (node == NULL)
+			return NULL;
+
+		// inner nodes have one more child than they have keys
+		uint32 count = node->NumKeys() + (node->IsLeaf() ? 0 : 1);
+		uint32 index = ((uint64)position * count) >> 16;
+		position = (uint64)position * count - ((uint64)index << 16);
+
+		if (node->IsLeaf()) {
+			*_keyIndex = index;
+			return node;
+		}
+
+		if (index < node->NumKeys())
+			nodeOffset = BFS_ENDIAN_TO_HOST_INT64(node->Values()[index]);
+		else
+			nodeOffset = node->OverflowLink();
+	}
+
+	// the tree is deeper than its header claims
+	return NULL;
+}
+
+
 status_t
 BPlusTree::_ValidateChildren(TreeCheck& check, uint32 level, off_t offset,
 	const uint8* largestKey, uint16 largestKeyLength,
@@ -2550,6 +2749,816 @@ BPlusTree::_ValidateChild(TreeCheck& check, CachedNode& cached, uint32 level,
 
 	return _ValidateChildren(check, level + 1, offset, key, keyLength, node);
 }
+
+
+//	#pragma mark - TreeBuilder
+
+
+/*!	Builds a B+tree bottom-up from a stream of sorted keys, as opposed to
+	inserting them one by one. Every node is filled completely, and is
+	written only once.
+
+	The tree must be empty when Start() is called. The new nodes are not
+	linked into the tree before Finish() swaps in the new root, so the
+	transaction can be restarted every now and then: until then, readers
+	only see the empty tree, and a crash only leaves some unused nodes
+	behind. If the tree is no longer empty by then, or the builder is
+	deleted before Finish() succeeded, the new nodes are freed again.
+*/
+TreeBuilder::TreeBuilder(BPlusTree* tree)
+	:
+	fTree(tree),
+	fStatus(B_NO_INIT),
+	fLevelCount(0),
+	fKeyLength(0),
+	fValueCount(0),
+	fLastValue(BPLUSTREE_NULL),
+	fRoot(BPLUSTREE_NULL),
+	fAllocated(NULL),
+	fAllocatedCount(0),
+	fAllocatedCapacity(0),
+	fDuplicate(NULL),
+	fDuplicateOffset(BPLUSTREE_NULL),
+	fFirstDuplicateOffset(BPLUSTREE_NULL),
+	fFragment(NULL),
+	fFragmentOffset(BPLUSTREE_NULL),
+	fFragmentIndex(0),
+	fFragmentChanged(false),
+	fEntries(0),
+	fNodes(0),
+	fWrites(0)
+{
+	for (uint32 i = 0; i < kMaxLevels; i++)
+		fLevels[i].node = NULL;
+}
+
+
+TreeBuilder::~TreeBuilder()
+{
+	if (fTransaction.IsStarted())
+		fTransaction.Done();
+	if (fAllocatedCount > 0)
+		_FreeNodes();
+
+	free(fAllocated);
+	for (uint32 i = 0; i < kMaxLevels; i++)
+		free(fLevels[i].node);
+
+	free(fDuplicate);
+	free(fFragment);
+}
+
+
+status_t
+TreeBuilder::Start()
+{
+	if (fStatus != B_NO_INIT || fTree->fStream == NULL)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	// We can only build the tree if it is empty
+	CachedNode cached(fTree);
+	const bplustree_node* root;
+	status_t status = cached.SetTo(fTree->fHeader.RootNode(), &root);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+	if (fTree->fHeader.MaxNumberOfLevels() != 1 || root->NumKeys() != 0)
+		return B_NOT_ALLOWED;
+
+	fRoot = fTree->fHeader.RootNode();
+	cached.Unset();
+
+	int32 nodeSize = fTree->fNodeSize;
+	fLevels[0].node = (bplustree_node*)malloc(nodeSize);
+	fDuplicate = (bplustree_node*)malloc(nodeSize);
+	fFragment = (bplustree_node*)malloc(nodeSize);
+	if (fLevels[0].node == NULL || fDuplicate == NULL || fFragment == NULL)
+		return B_NO_MEMORY;
+
+	status = _StartTransaction();
+	if (status != B_OK)
+		return status;
+
+	status = _AllocateNode(&fLevels[0].offset);
+	if (status != B_OK)
+		return status;
+
+	fLevels[0].node->Initialize();
+	fLevels[0].child = BPLUSTREE_NULL;
+	fLevelCount = 1;
+
+	fStatus = B_OK;
+	return B_OK;
+}
+
+
+/*!	Adds the \a key/\a value pair to the tree. The pairs must be added in
+	ascending order of their keys, and duplicates of a key in ascending order
+	of their values. Adding the same pair twice is ignored.
+*/
+status_t
+TreeBuilder::Add(const uint8* key, uint16 keyLength, off_t value)
+{
+	if (fStatus != B_OK)
+		return fStatus;
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	if (fValueCount > 0) {
+		int32 compare = fTree->_CompareKeys(key, keyLength, fKey, fKeyLength);
+		if (compare < 0 || (compare == 0 && value < fLastValue))
+			RETURN_ERROR(B_BAD_VALUE);
+
+		if (compare == 0) {
+			if (value == fLastValue)
+				return B_OK;
+			if (!fTree->fAllowDuplicates)
+				return B_NAME_IN_USE;
+
+			fStatus = _AddDuplicate(value);
+			if (fStatus == B_OK) {
+				fLastValue = value;
+				fEntries++;
+			}
+			return fStatus;
+		}
+
+		fStatus = _FlushKey();
+		if (fStatus != B_OK)
+			return fStatus;
+	}
+
+	memcpy(fKey, key, keyLength);
+	fKeyLength = keyLength;
+	fValues[0] = value;
+	fValueCount = 1;
+	fLastValue = value;
+	fEntries++;
+
+	return B_OK;
+}
+
+
+/*!	Writes out the remaining nodes, and makes the new tree visible by
+	updating its header, all in the same transaction. The old root node is
+	freed.
+	Returns \c B_BUSY if the tree has been changed in the meantime; the new
+	tree is then discarded.
+*/
+status_t
+TreeBuilder::Finish()
+{
+	if (fStatus != B_OK)
+		return fStatus;
+
+	if (fValueCount > 0) {
+		fStatus = _FlushKey();
+		if (fStatus != B_OK)
+			return fStatus;
+	}
+
+	// Close the last node of every level from the bottom up; the parent
+	// level may only be created while doing so
+	for (uint32 level = 0; level < fLevelCount; level++) {
+		build_level& current = fLevels[level];
+		if (level > 0) {
+			current.node->overflow_link
+				= HOST_ENDIAN_TO_BFS_INT64(current.child);
+		} else if (fFragmentChanged) {
+			fStatus = _WriteFragment();
+			if (fStatus != B_OK)
+				return fStatus;
+		}
+
+		fStatus = _WriteNode(current.offset, current.node);
+		if (fStatus != B_OK)
+			return fStatus;
+
+		if (level + 1 == fLevelCount)
+			break;
+
+		const uint8* key = current.key;
+		uint16 keyLength = current.keyLength;
+		if (level == 0)
+			key = current.node->KeyAt(current.node->NumKeys() - 1, &keyLength);
+
+		fStatus = _AddChild(level + 1, key, keyLength, current.offset);
+		if (fStatus != B_OK)
+			return fStatus;
+	}
+
+	// The transaction also holds the tree's write lock, so it cannot change
+	// until the new root is in place
+	CachedNode cached(fTree);
+	const bplustree_node* root;
+	fStatus = cached.SetTo(fRoot, &root);
+	if (fStatus != B_OK)
+		return fStatus;
+	if (fTree->fHeader.RootNode() != fRoot
+		|| fTree->fHeader.MaxNumberOfLevels() != 1 || root->NumKeys() != 0) {
+		fStatus = B_BUSY;
+		return fStatus;
+	}
+
+	if (cached.SetToWritable(fTransaction, fRoot, false) == NULL) {
+		fStatus = B_IO_ERROR;
+		return fStatus;
+	}
+	fStatus = cached.Free(fTransaction, fRoot);
+	if (fStatus != B_OK)
+		return fStatus;
+
+	bplustree_header* header = cached.SetToWritableHeader(fTransaction);
+	if (header == NULL) {
+		fStatus = B_IO_ERROR;
+		return fStatus;
+	}
+
+	header->root_node_pointer
+		= HOST_ENDIAN_TO_BFS_INT64(fLevels[fLevelCount - 1].offset);
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(fLevelCount);
+	cached.Unset();
+
+	// the nodes belong to the tree now
+	fAllocatedCount = 0;
+	fStatus = B_NO_INIT;
+	return fTransaction.Done();
+}
+
+
+status_t
+TreeBuilder::_StartTransaction()
+{
+	Inode* stream = fTree->fStream;
+	status_t status = fTransaction.Start(stream->GetVolume(),
+		stream->BlockNumber());
+	if (status != B_OK)
+		return status;
+
+	stream->WriteLockInTransaction(fTransaction);
+	fWrites = 0;
+	return B_OK;
+}
+
+
+status_t
+TreeBuilder::_AllocateNode(off_t* _offset)
+{
+	if (fAllocatedCount == fAllocatedCapacity) {
+		uint32 newCapacity = max_c(fAllocatedCapacity * 2, 256U);
+		off_t* allocated = (off_t*)realloc(fAllocated,
+			newCapacity * sizeof(off_t));
+		if (allocated == NULL)
+			return B_NO_MEMORY;
+
+		fAllocated = allocated;
+		fAllocatedCapacity = newCapacity;
+	}
+
+	CachedNode cached(fTree);
+	bplustree_node* node;
+	status_t status = cached.Allocate(fTransaction, &node, _offset);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	fAllocated[fAllocatedCount++] = *_offset;
+	fNodes++;
+	return B_OK;
+}
+
+
+/*!	Puts all nodes that were allocated for the new tree back into the free
+	list, after the build failed.
+*/
+void
+TreeBuilder::_FreeNodes()
+{
+	Inode* stream = fTree->fStream;
+	Transaction transaction;
+
+	for (uint32 i = 0; i < fAllocatedCount; i++) {
+		if (!transaction.IsStarted()) {
+			if (transaction.Start(stream->GetVolume(), stream->BlockNumber())
+					!= B_OK) {
+				break;
+			}
+			stream->WriteLockInTransaction(transaction);
+		}
+
+		CachedNode cached(fTree);
+		if (cached.SetToWritable(transaction, fAllocated[i], false) == NULL
+			|| cached.Free(transaction, fAllocated[i]) != B_OK) {
+			FATAL(("TreeBuilder: could not free node %" B_PRIdOFF " of tree "
+				"%" B_PRIdINO "\n", fAllocated[i], stream->ID()));
+		}
+		cached.Unset();
+
+		if ((i + 1) % kMaxBuilderTransactionNodes == 0
+			|| transaction.IsTooLarge()) {
+			transaction.Done();
+		}
+	}
+
+	if (transaction.IsStarted())
+		transaction.Done();
+
+	fAllocatedCount = 0;
+}
+
+
+status_t
+TreeBuilder::_WriteNode(off_t offset, const bplustree_node* node)
+{
+	CachedNode cached(fTree);
+	bplustree_node* target = cached.SetToWritable(fTransaction, offset, false);
+	if (target == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	memcpy(target, node, fTree->fNodeSize);
+	cached.Unset();
+
+	// The new nodes are not reachable before Finish(), so they don't have
+	// to be written in a single transaction; just make sure it doesn't get
+	// too large
+	if (++fWrites < kMaxBuilderTransactionNodes && !fTransaction.IsTooLarge())
+		return B_OK;
+
+	status_t status = fTransaction.Done();
+	if (status != B_OK)
+		return status;
+
+	return _StartTransaction();
+}
+
+
+bool
+TreeBuilder::_Fits(const bplustree_node* node, uint16 keyLength) const
+{
+	return int32(key_align(sizeof(bplustree_node) + node->AllKeyLength()
+			+ keyLength)
+		+ (node->NumKeys() + 1) * (sizeof(uint16) + sizeof(off_t)))
+		< fTree->fNodeSize;
+}
+
+
+/*!	Adds the current key with all of its values to the leaf level.
+	A single value is stored directly, up to NUM_FRAGMENT_VALUES go into
+	a fragment shared with other keys, and everything beyond that already
+	lives in a chain of duplicate nodes.
+*/
+status_t
+TreeBuilder::_FlushKey()
+{
+	off_t value;
+	if (fValueCount == 1)
+		value = fValues[0];
+	else if (fValueCount <= NUM_FRAGMENT_VALUES) {
+		status_t status = _AddFragment(&value);
+		if (status != B_OK)
+			return status;
+	} else {
+		status_t status = _WriteNode(fDuplicateOffset, fDuplicate);
+		if (status != B_OK)
+			return status;
+
+		value = bplustree_node::MakeLink(BPLUSTREE_DUPLICATE_NODE,
+			fFirstDuplicateOffset);
+	}
+
+	fValueCount = 0;
+	return _AddLeafKey(fKey, fKeyLength, value);
+}
+
+
+status_t
+TreeBuilder::_AddDuplicate(off_t value)
+{
+	if (fValueCount < NUM_FRAGMENT_VALUES) {
+		fValues[fValueCount++] = value;
+		return B_OK;
+	}
+
+	duplicate_array* array = fDuplicate->DuplicateArray();
+
+	if (fValueCount == NUM_FRAGMENT_VALUES) {
+		// The values no longer fit into a fragment, move them into the
+		// first node of a duplicate chain
+		status_t status = _AllocateNode(&fFirstDuplicateOffset);
+		if (status != B_OK)
+			return status;
+
+		fDuplicateOffset = fFirstDuplicateOffset;
+		fDuplicate->Initialize();
+
+		for (uint32 i = 0; i < fValueCount; i++)
+			array->SetValueAt(i, fValues[i]);
+		array->count = HOST_ENDIAN_TO_BFS_INT64(fValueCount);
+	} else if (array->Count() == NUM_DUPLICATE_VALUES) {
+		// Continue the chain in a new node
+		off_t offset;
+		status_t status = _AllocateNode(&offset);
+		if (status != B_OK)
+			return status;
+
+		fDuplicate->right_link = HOST_ENDIAN_TO_BFS_INT64(offset);
+		status = _WriteNode(fDuplicateOffset, fDuplicate);
+		if (status != B_OK)
+			return status;
+
+		fDuplicate->Initialize();
+		fDuplicate->left_link = HOST_ENDIAN_TO_BFS_INT64(fDuplicateOffset);
+		array->count = 0;
+		fDuplicateOffset = offset;
+	}
+
+	int32 count = array->Count();
+	array->SetValueAt(count, value);
+	array->count = HOST_ENDIAN_TO_BFS_INT64(count + 1);
+	fValueCount++;
+	return B_OK;
+}
+
+
+status_t
+TreeBuilder::_AddFragment(off_t* _link)
+{
+	if (fFragmentOffset == BPLUSTREE_NULL
+		|| fFragmentIndex
+			== bplustree_node::MaxFragments(fTree->fNodeSize)) {
+		if (fFragmentChanged) {
+			status_t status = _WriteFragment();
+			if (status != B_OK)
+				return status;
+		}
+
+		status_t status = _AllocateNode(&fFragmentOffset);
+		if (status != B_OK)
+			return status;
+
+		memset(fFragment, 0, fTree->fNodeSize);
+		fFragmentIndex = 0;
+	}
+
+	duplicate_array* array = fFragment->FragmentAt(fFragmentIndex);
+	for (uint32 i = 0; i < fValueCount; i++)
+		array->SetValueAt(i, fValues[i]);
+	array->count = HOST_ENDIAN_TO_BFS_INT64(fValueCount);
+
+	*_link = bplustree_node::MakeLink(BPLUSTREE_DUPLICATE_FRAGMENT,
+		fFragmentOffset, fFragmentIndex++);
+	fFragmentChanged = true;
+	return B_OK;
+}
+
+
+status_t
+TreeBuilder::_WriteFragment()
+{
+	status_t status = _WriteNode(fFragmentOffset, fFragment);
+	if (status == B_OK)
+		fFragmentChanged = false;
+
+	return status;
+}
+
+
+status_t
+TreeBuilder::_AddLeafKey(const uint8* key, uint16 keyLength, off_t value)
+{
+	build_level& leaf = fLevels[0];
+	if (!_Fits(leaf.node, keyLength)) {
+		uint16 lastLength;
+		uint8* lastKey = leaf.node->KeyAt(leaf.node->NumKeys() - 1,
+			&lastLength);
+
+		status_t status = _FinishNode(0, lastKey, lastLength);
+		if (status != B_OK)
+			return status;
+	}
+
+	fTree->_InsertKey(leaf.node, leaf.node->NumKeys(), (uint8*)key,
+		keyLength, value);
+	return B_OK;
+}
+
+
+/*!	Adds the \a child node with \a key as its largest key to the index node
+	at \a level. The last child of an index node is kept back, as it becomes
+	the node's overflow link once the node is full.
+	Note, if the node gets full just before the last child arrives, this
+	leaves the last node of a level with just an overflow link, which is
+	valid, if not pretty.
+*/
+status_t
+TreeBuilder::_AddChild(uint32 level, const uint8* key, uint16 keyLength,
+	off_t child)
+{
+	if (level == fLevelCount) {
+		if (level == kMaxLevels)
+			RETURN_ERROR(B_BAD_DATA);
+
+		build_level& parent = fLevels[level];
+		if (parent.node == NULL) {
+			parent.node = (bplustree_node*)malloc(fTree->fNodeSize);
+			if (parent.node == NULL)
+				return B_NO_MEMORY;
+		}
+
+		status_t status = _AllocateNode(&parent.offset);
+		if (status != B_OK)
+			return status;
+
+		parent.node->Initialize();
+		parent.child = BPLUSTREE_NULL;
+		fLevelCount++;
+	}
+
+	build_level& current = fLevels[level];
+	if (current.child != BPLUSTREE_NULL) {
+		if (_Fits(current.node, current.keyLength)) {
+			fTree->_InsertKey(current.node, current.node->NumKeys(),
+				current.key, current.keyLength, current.child);
+		} else {
+			current.node->overflow_link
+				= HOST_ENDIAN_TO_BFS_INT64(current.child);
+
+			status_t status = _FinishNode(level, current.key,
+				current.keyLength);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	memcpy(current.key, key, keyLength);
+	current.keyLength = keyLength;
+	current.child = child;
+	return B_OK;
+}
+
+
+/*!	Writes the full node at \a level, whose largest key is \a key, adds it
+	to its parent, and starts a new node to its right.
+*/
+status_t
+TreeBuilder::_FinishNode(uint32 level, const uint8* key, uint16 keyLength)
+{
+	build_level& current = fLevels[level];
+
+	off_t next;
+	status_t status = _AllocateNode(&next);
+	if (status != B_OK)
+		return status;
+
+	// Leaves must not reference duplicate fragments that aren't written yet
+	if (level == 0 && fFragmentChanged) {
+		status = _WriteFragment();
+		if (status != B_OK)
+			return status;
+	}
+
+	current.node->right_link = HOST_ENDIAN_TO_BFS_INT64(next);
+	status = _WriteNode(current.offset, current.node);
+	if (status != B_OK)
+		return status;
+
+	status = _AddChild(level + 1, key, keyLength, current.offset);
+	if (status != B_OK)
+		return status;
+
+	current.node->Initialize();
+	current.node->left_link = HOST_ENDIAN_TO_BFS_INT64(current.offset);
+	current.offset = next;
+	return B_OK;
+}
+
+
+//	#pragma mark - TreeBatch
+
+
+struct TreeBatch::EntryLess {
+	EntryLess(TreeBatch* batch)
+		:
+		fBatch(batch)
+	{
+	}
+
+	bool operator()(uint32 a, uint32 b) const
+	{
+		return fBatch->_Less(a, b);
+	}
+
+	TreeBatch*	fBatch;
+};
+
+
+struct batch_entry {
+	off_t	value;
+	uint16	key_length;
+	uint8	key[0];
+};
+
+
+/*!	Collects key/value pairs for a tree, and adds them in sorted order on
+	Commit(). An empty tree is built with a TreeBuilder, otherwise the pairs
+	are inserted one by one; sorting them still keeps the working set of the
+	tree small.
+	If the collected pairs would take up more than \a maxSize bytes, they are
+	committed early.
+*/
+TreeBatch::TreeBatch(BPlusTree* tree, size_t maxSize)
+	:
+	fTree(tree),
+	fBuffer(NULL),
+	fBufferSize(0),
+	fBufferUsed(0),
+	fEntries(NULL),
+	fCount(0),
+	fCapacity(0),
+	fMaxSize(maxSize),
+	fValidator(NULL),
+	fValidatorCookie(NULL)
+{
+}
+
+
+TreeBatch::~TreeBatch()
+{
+	free(fBuffer);
+	free(fEntries);
+}
+
+
+/*!	Sets a \a hook that is called for every pair on Commit(), before it is
+	added to the tree. Only the pairs the hook returns \c true for are added.
+	This allows to drop pairs that have become stale since they were
+	collected.
+*/
+void
+TreeBatch::SetValidator(validate_hook hook, void* cookie)
+{
+	fValidator = hook;
+	fValidatorCookie = cookie;
+}
+
+
+status_t
+TreeBatch::Add(const uint8* key, uint16 keyLength, off_t value)
+{
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	size_t size = key_align(sizeof(batch_entry) + keyLength);
+	if (fCount > 0 && fBufferUsed + size
+			+ (fCount + 1) * sizeof(uint32) > fMaxSize) {
+		status_t status = Commit();
+		if (status != B_OK)
+			return status;
+	}
+
+	if (fBufferUsed + size > fBufferSize) {
+		size_t newSize = max_c(fBufferSize * 2, 65536);
+		uint8* buffer = (uint8*)realloc(fBuffer, newSize);
+		if (buffer == NULL)
+			return B_NO_MEMORY;
+
+		fBuffer = buffer;
+		fBufferSize = newSize;
+	}
+	if (fCount == fCapacity) {
+		int32 newCapacity = max_c(fCapacity * 2, 4096);
+		uint32* entries = (uint32*)realloc(fEntries,
+			newCapacity * sizeof(uint32));
+		if (entries == NULL)
+			return B_NO_MEMORY;
+
+		fEntries = entries;
+		fCapacity = newCapacity;
+	}
+
+	batch_entry* entry = (batch_entry*)(fBuffer + fBufferUsed);
+	entry->value = value;
+	entry->key_length = keyLength;
+	memcpy(entry->key, key, keyLength);
+
+	fEntries[fCount++] = fBufferUsed;
+	fBufferUsed += size;
+	return B_OK;
+}
+
+
+status_t
+TreeBatch::Commit()
+{
+	if (fValidator != NULL) {
+		// The entries are still in the order they were added in, which is
+		// likely better for the validator than the sorted one
+		int32 count = 0;
+		for (int32 i = 0; i < fCount; i++) {
+			const batch_entry* entry
+				= (const batch_entry*)(fBuffer + fEntries[i]);
+			if (fValidator(fValidatorCookie, entry->key, entry->key_length,
+					entry->value)) {
+				fEntries[count++] = fEntries[i];
+			}
+		}
+		fCount = count;
+	}
+
+	if (fCount == 0) {
+		fBufferUsed = 0;
+		return B_OK;
+	}
+
+	std::sort(fEntries, fEntries + fCount, EntryLess(this));
+
+	// The tree might not be empty, or might have been changed while it was
+	// being built
+	status_t status = _Build();
+	if (status == B_NOT_ALLOWED || status == B_BUSY)
+		status = _InsertSorted();
+
+	fCount = 0;
+	fBufferUsed = 0;
+	return status;
+}
+
+
+bool
+TreeBatch::_Less(uint32 a, uint32 b)
+{
+	const batch_entry* first = (const batch_entry*)(fBuffer + a);
+	const batch_entry* second = (const batch_entry*)(fBuffer + b);
+
+	int32 compare = fTree->_CompareKeys(first->key, first->key_length,
+		second->key, second->key_length);
+	if (compare != 0)
+		return compare < 0;
+
+	return first->value < second->value;
+}
+
+
+status_t
+TreeBatch::_Build()
+{
+	// The builder keeps a key buffer per level, so it is too large to be put
+	// on the kernel stack
+	TreeBuilder* builder = new(std::nothrow) TreeBuilder(fTree);
+	if (builder == NULL)
+		return B_NO_MEMORY;
+
+	ObjectDeleter<TreeBuilder> builderDeleter(builder);
+
+	status_t status = builder->Start();
+	if (status != B_OK)
+		return status;
+
+	for (int32 i = 0; i < fCount; i++) {
+		const batch_entry* entry
+			= (const batch_entry*)(fBuffer + fEntries[i]);
+		status = builder->Add(entry->key, entry->key_length, entry->value);
+		if (status != B_OK)
+			return status;
+	}
+
+	return builder->Finish();
+}
+
+
+status_t
+TreeBatch::_InsertSorted()
+{
+	Inode* stream = fTree->fStream;
+	Transaction transaction;
+
+	for (int32 i = 0; i < fCount; i++) {
+		if (!transaction.IsStarted()) {
+			status_t status = transaction.Start(stream->GetVolume(),
+				stream->BlockNumber());
+			if (status != B_OK)
+				return status;
+
+			stream->WriteLockInTransaction(transaction);
+		}
+
+		const batch_entry* entry
+			= (const batch_entry*)(fBuffer + fEntries[i]);
+		status_t status = fTree->Insert(transaction, entry->key,
+			entry->key_length, entry->value);
+		if (status != B_OK)
+			return status;
+
+		if ((i + 1) % kMaxBuilderTransactionNodes == 0
+			|| transaction.IsTooLarge()) {
+			status = transaction.Done();
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	return transaction.Done();
+}
 #endif // !_BOOT_MODE
 
 
@@ -160,6 +160,8 @@ enum bplustree_traversing {
 
 class BPlusTree;
 struct TreeCheck;
+class TreeBatch;
+class TreeBuilder;
 class TreeIterator;
 
 
@@ -169,6 +171,24 @@ struct node_and_key {
 	off_t	nodeOffset;
 	uint16	keyIndex;
 };
+
+#define BPLUSTREE_HISTOGRAM_KEYS		32
+#define BPLUSTREE_HISTOGRAM_KEY_LENGTH	32
+
+// estimated size and key distribution of a tree, see
+// BPlusTree::GetStatistics()
+struct bplustree_statistics {
+	off_t		nodes;
+	off_t		entries;
+	off_t		keys;
+	uint32		levels;
+	uint32		histogram_count;
+	bigtime_t	sampled;
+	struct {
+		uint16	length;
+		uint8	data[BPLUSTREE_HISTOGRAM_KEY_LENGTH];
+	} histogram[BPLUSTREE_HISTOGRAM_KEYS];
+};
 #endif // !_BOOT_MODE
 
 
@@ -308,6 +328,9 @@ public:
 									off_t* value);
 
 #if !_BOOT_MODE
+			status_t			GetStatistics(
+									bplustree_statistics& statistics);
+
 	static	int32				TypeCodeToKeyType(type_code code);
 	static	int32				ModeToKeyType(mode_t mode);
 
@@ -368,12 +391,19 @@ private:
 									off_t offset, off_t lastOffset,
 									off_t nextOffset, const uint8* key,
 									uint16 keyLength);
+
+			status_t			_SampleStatistics(
+									bplustree_statistics& statistics);
+			const bplustree_node* _SeekPosition(CachedNode& cached,
+									uint32 position, int32* _keyIndex);
 #endif // !_BOOT_MODE
 
 private:
 			friend class TreeIterator;
 			friend class CachedNode;
 			friend struct TreeCheck;
+			friend class TreeBatch;
+			friend class TreeBuilder;
 
 			Inode*				fStream;
 			bplustree_header	fHeader;
@@ -385,6 +415,8 @@ private:
 #if !_BOOT_MODE
 			mutex				fIteratorLock;
 			SinglyLinkedList<TreeIterator> fIterators;
+			bplustree_statistics* fStatistics;
+				// also guarded by fIteratorLock
 #endif
 };
 
@@ -439,6 +471,131 @@ private:
 };
 
 
+#if !_BOOT_MODE
+class TreeBuilder {
+public:
+								TreeBuilder(BPlusTree* tree);
+								~TreeBuilder();
+
+			status_t			Start();
+			status_t			Add(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			Finish();
+
+			off_t				CountEntries() const { return fEntries; }
+			off_t				CountNodes() const { return fNodes; }
+
+private:
+			struct build_level {
+				bplustree_node*	node;
+				off_t			offset;
+				off_t			child;
+				uint16			keyLength;
+				uint8			key[BPLUSTREE_MAX_KEY_LENGTH];
+			};
+
+			status_t			_StartTransaction();
+			status_t			_AllocateNode(off_t* _offset);
+			void				_FreeNodes();
+			status_t			_WriteNode(off_t offset,
+									const bplustree_node* node);
+			bool				_Fits(const bplustree_node* node,
+									uint16 keyLength) const;
+
+			status_t			_FlushKey();
+			status_t			_AddDuplicate(off_t value);
+			status_t			_AddFragment(off_t* _link);
+			status_t			_WriteFragment();
+
+			status_t			_AddLeafKey(const uint8* key,
+									uint16 keyLength, off_t value);
+			status_t			_AddChild(uint32 level, const uint8* key,
+									uint16 keyLength, off_t child);
+			status_t			_FinishNode(uint32 level, const uint8* key,
+									uint16 keyLength);
+
+private:
+	static	const uint32		kMaxLevels = 16;
+
+			BPlusTree*			fTree;
+			Transaction			fTransaction;
+			status_t			fStatus;
+
+			build_level			fLevels[kMaxLevels];
+			uint32				fLevelCount;
+
+			// the key that is currently collecting its values
+			uint8				fKey[BPLUSTREE_MAX_KEY_LENGTH];
+			uint16				fKeyLength;
+			off_t				fValues[NUM_FRAGMENT_VALUES];
+			uint32				fValueCount;
+			off_t				fLastValue;
+
+			// the root of the empty tree, and the nodes of the new one
+			off_t				fRoot;
+			off_t*				fAllocated;
+			uint32				fAllocatedCount;
+			uint32				fAllocatedCapacity;
+
+			bplustree_node*		fDuplicate;
+			off_t				fDuplicateOffset;
+			off_t				fFirstDuplicateOffset;
+
+			bplustree_node*		fFragment;
+			off_t				fFragmentOffset;
+			uint32				fFragmentIndex;
+			bool				fFragmentChanged;
+
+			off_t				fEntries;
+			off_t				fNodes;
+			uint32				fWrites;
+};
+
+
+class TreeBatch {
+public:
+	typedef	bool				(*validate_hook)(void* cookie,
+									const uint8* key, uint16 keyLength,
+									off_t value);
+
+								TreeBatch(BPlusTree* tree,
+									size_t maxSize = kDefaultMaxSize);
+								~TreeBatch();
+
+			void				SetValidator(validate_hook hook,
+									void* cookie);
+
+			status_t			Add(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			Commit();
+
+			int32				CountEntries() const { return fCount; }
+
+private:
+			struct EntryLess;
+			friend struct EntryLess;
+
+			bool				_Less(uint32 a, uint32 b);
+			status_t			_Build();
+			status_t			_InsertSorted();
+
+private:
+	static	const size_t		kDefaultMaxSize = 4 * 1024 * 1024;
+
+			BPlusTree*			fTree;
+			uint8*				fBuffer;
+			size_t				fBufferSize;
+			size_t				fBufferUsed;
+			uint32*				fEntries;
+			int32				fCount;
+			int32				fCapacity;
+			size_t				fMaxSize;
+			validate_hook		fValidator;
+			void*				fValidatorCookie;
+};
+#endif // !_BOOT_MODE
+
+
 //	#pragma mark - BPlusTree's inline functions
 //	(most of them may not be needed)
 
@@ -9,6 +9,7 @@
 
 #include "BlockAllocator.h"
 
+#include "bfs_control.h"
 #include "Debug.h"
 #include "Inode.h"
 #include "Volume.h"
@@ -30,9 +31,16 @@
 // group can span several blocks in the block bitmap, the AllocationBlock
 // class is there to make handling those easier.
 
-// The current implementation is only slightly optimized and could probably
-// be improved a lot. Furthermore, the allocation policies used here should
-// have some real world tests.
+// To avoid scanning the bitmap for every allocation, each allocation group
+// keeps the free ranges in its part of the bitmap in an array sorted by
+// offset, which is built when the volume is mounted, and updated with every
+// change to the bitmap. Groups that are too fragmented to be indexed that way
+// are scanned as before. On top of that, a tree over all allocation groups
+// keeps the size of the largest free range of each group, so that the group
+// closest to the wanted position that can hold an allocation, as well as the
+// largest free range of the volume, can be found in logarithmic time.
+// If a transaction is aborted, the state of the allocation groups it touched
+// is reloaded from the bitmap.
 
 #if BFS_TRACING && !defined(FS_SHELL)
 namespace BFSBlockTracing {
@@ -167,6 +175,20 @@ private:
 #endif
 
 
+static const int32 kMaxGroupExtents = 256;
+	// groups with more free ranges than this are not indexed, but have their
+	// bitmap scanned instead
+static const int32 kMaxChangedGroups = 16;
+
+
+struct free_extent {
+	int32	start;
+	int32	length;
+
+	int32 End() const { return start + length; }
+};
+
+
 class AllocationBlock : public CachedBlock {
 public:
 	AllocationBlock(Volume* volume);
@@ -194,6 +216,7 @@ private:
 class AllocationGroup {
 public:
 	AllocationGroup();
+	~AllocationGroup();
 
 	void AddFreeRange(int32 start, int32 blocks);
 	bool IsFull() const { return fFreeBits == 0; }
@@ -205,9 +228,25 @@ public:
 	uint32 NumBlocks() const { return fNumBlocks; }
 	int32 Start() const { return fStart; }
 
+	void StartIndex();
+	void DropIndex();
+	bool IsIndexed() const { return fIndexed; }
+	int32 CountExtents() const { return fExtentCount; }
+
+	int32 LargestFreeBound() const;
+	void FindExtent(int32 start, int32 length, bool bestFit,
+		int32& _start, int32& _length) const;
+
 private:
 	friend class BlockAllocator;
 
+	int32 _ExtentIndexFor(int32 start) const;
+	bool _InsertExtent(int32 index, int32 start, int32 length);
+	void _RemoveExtent(int32 index);
+	void _IndexAllocated(int32 start, int32 length);
+	void _IndexFreed(int32 start, int32 length);
+	void _UpdateHintsFromIndex();
+
 	uint32	fNumBits;
 	uint32	fNumBlocks;
 	int32	fStart;
@@ -217,6 +256,72 @@ private:
 	int32	fLargestStart;
 	int32	fLargestLength;
 	bool	fLargestValid;
+
+	bool	fIndexed;
+	free_extent* fExtents;
+	int32	fExtentCount;
+	int32	fExtentCapacity;
+};
+
+
+/*!	Remembers the groups a transaction has changed, so that their free range
+	index can be rebuilt from the bitmap if it is aborted. Every transaction,
+	including the separate sub-transactions, gets its own listener, as the
+	block cache only reverts the blocks of the (sub-)transaction it aborts.
+*/
+class AllocationListener : public TransactionListener {
+public:
+	AllocationListener(BlockAllocator* allocator, Transaction* transaction)
+		:
+		fAllocator(allocator),
+		fTransaction(transaction),
+		fNext(NULL),
+		fGroupCount(0)
+	{
+	}
+
+	Transaction* GetTransaction() const { return fTransaction; }
+
+	void AddGroup(int32 groupIndex)
+	{
+		for (int32 i = 0; i < fGroupCount && i < kMaxChangedGroups; i++) {
+			if (fGroups[i] == groupIndex)
+				return;
+		}
+
+		if (fGroupCount < kMaxChangedGroups)
+			fGroups[fGroupCount] = groupIndex;
+		fGroupCount++;
+	}
+
+	bool HasAllGroups() const { return fGroupCount > kMaxChangedGroups; }
+	int32 CountGroups() const { return fGroupCount; }
+	int32 GroupAt(int32 index) const { return fGroups[index]; }
+
+	virtual void TransactionDone(bool success)
+	{
+		fAllocator->_TransactionDone(this, success);
+	}
+
+	virtual void RemovedFromTransaction()
+	{
+		fAllocator->_RemoveListener(this);
+		delete this;
+	}
+
+	virtual void MovedToTransaction(Transaction* transaction)
+	{
+		fTransaction = transaction;
+	}
+
+private:
+	friend class BlockAllocator;
+
+	BlockAllocator*	fAllocator;
+	Transaction*	fTransaction;
+	AllocationListener* fNext;
+	int32			fGroups[kMaxChangedGroups];
+	int32			fGroupCount;
 };
 
 
@@ -345,11 +450,24 @@ AllocationGroup::AllocationGroup()
 	:
 	fFirstFree(-1),
 	fFreeBits(0),
-	fLargestValid(false)
+	fLargestValid(false),
+	fIndexed(false),
+	fExtents(NULL),
+	fExtentCount(0),
+	fExtentCapacity(0)
 {
 }
 
 
+AllocationGroup::~AllocationGroup()
+{
+	free(fExtents);
+}
+
+
+/*!	Adds a free range found while scanning the bitmap of the group. The ranges
+	must be added in ascending order.
+*/
 void
 AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 {
@@ -366,6 +484,9 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 	}
 
 	fFreeBits += blocks;
+
+	if (fIndexed && !_InsertExtent(fExtentCount, start, blocks))
+		DropIndex();
 }
 
 
@@ -410,6 +531,9 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 
 	Volume* volume = transaction.GetVolume();
 
+	if (fIndexed)
+		_IndexAllocated(start, length);
+
 	// calculate block in the block bitmap and position within
 	uint32 bitsPerBlock = volume->BlockSize() << 3;
 	uint32 block = start / bitsPerBlock;
@@ -420,6 +544,7 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 	while (length > 0) {
 		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
 			fLargestValid = false;
+			DropIndex();
 			RETURN_ERROR(B_IO_ERROR);
 		}
 
@@ -471,6 +596,9 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 
 	Volume* volume = transaction.GetVolume();
 
+	if (fIndexed)
+		_IndexFreed(start, length);
+
 	// calculate block in the block bitmap and position within
 	uint32 bitsPerBlock = volume->BlockSize() << 3;
 	uint32 block = start / bitsPerBlock;
@@ -479,8 +607,10 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 	AllocationBlock cached(volume);
 
 	while (length > 0) {
-		if (cached.SetToWritable(transaction, *this, block) < B_OK)
+		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
+			DropIndex();
 			RETURN_ERROR(B_IO_ERROR);
+		}
 
 		T(Block("free-1", block, cached.Block(), volume->BlockSize()));
 		uint16 freeLength = length;
@@ -498,13 +628,227 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 }
 
 
+/*!	Prepares the group for building its free range index; the ranges are then
+	added via AddFreeRange().
+*/
+void
+AllocationGroup::StartIndex()
+{
+	fExtentCount = 0;
+	fIndexed = true;
+}
+
+
+/*!	Stops maintaining the free range index, because the group is too
+	fragmented, or because the index no longer matches the bitmap. The group
+	will be scanned instead, until it is rebuilt.
+*/
+void
+AllocationGroup::DropIndex()
+{
+	free(fExtents);
+	fExtents = NULL;
+	fExtentCount = 0;
+	fExtentCapacity = 0;
+	fIndexed = false;
+}
+
+
+/*!	Returns the length of the largest free range of the group, or an upper
+	bound of it, if it isn't known.
+*/
+int32
+AllocationGroup::LargestFreeBound() const
+{
+	if (fLargestValid)
+		return fLargestLength;
+
+	return fIndexed ? 0 : fFreeBits;
+}
+
+
+/*!	Looks up a free range of at least \a length blocks at or after \a start in
+	the index. If \a bestFit is \c true, the smallest of those ranges is
+	returned, otherwise the first one. If there is no such range, the largest
+	range after \a start is returned instead; \a _length is -1 if there is
+	none at all.
+*/
+void
+AllocationGroup::FindExtent(int32 start, int32 length, bool bestFit,
+	int32& _start, int32& _length) const
+{
+	ASSERT(fIndexed);
+
+	_start = -1;
+	_length = -1;
+	bool found = false;
+
+	for (int32 i = _ExtentIndexFor(start); i < fExtentCount; i++) {
+		const free_extent& extent = fExtents[i];
+		int32 extentStart = max_c(extent.start, start);
+		int32 extentLength = extent.End() - extentStart;
+		if (extentLength <= 0)
+			continue;
+
+		if (extentLength >= length) {
+			if (!found || extentLength < _length) {
+				_start = extentStart;
+				_length = extentLength;
+				found = true;
+			}
+			if (!bestFit || extentLength == length)
+				break;
+		} else if (!found && extentLength > _length) {
+			_start = extentStart;
+			_length = extentLength;
+		}
+	}
+}
+
+
+/*!	Returns the index of the first extent that ends after \a start.
+*/
+int32
+AllocationGroup::_ExtentIndexFor(int32 start) const
+{
+	int32 lower = 0;
+	int32 upper = fExtentCount;
+	while (lower < upper) {
+		int32 middle = (lower + upper) / 2;
+		if (fExtents[middle].End() <= start)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	return lower;
+}
+
+
+bool
+AllocationGroup::_InsertExtent(int32 index, int32 start, int32 length)
+{
+	if (fExtentCount == fExtentCapacity) {
+		if (fExtentCapacity == kMaxGroupExtents)
+			return false;
+
+		int32 capacity = max_c(8, min_c(fExtentCapacity * 2, kMaxGroupExtents));
+		free_extent* extents = (free_extent*)realloc(fExtents,
+			capacity * sizeof(free_extent));
+		if (extents == NULL)
+			return false;
+
+		fExtents = extents;
+		fExtentCapacity = capacity;
+	}
+
+	memmove(&fExtents[index + 1], &fExtents[index],
+		(fExtentCount - index) * sizeof(free_extent));
+	fExtents[index].start = start;
+	fExtents[index].length = length;
+	fExtentCount++;
+	return true;
+}
+
+
+void
+AllocationGroup::_RemoveExtent(int32 index)
+{
+	fExtentCount--;
+	memmove(&fExtents[index], &fExtents[index + 1],
+		(fExtentCount - index) * sizeof(free_extent));
+}
+
+
+void
+AllocationGroup::_IndexAllocated(int32 start, int32 length)
+{
+	int32 index = _ExtentIndexFor(start);
+	if (index == fExtentCount || fExtents[index].start > start
+		|| fExtents[index].End() < start + length) {
+		// the range isn't free according to the index
+		DropIndex();
+		return;
+	}
+
+	free_extent& extent = fExtents[index];
+	int32 end = extent.End();
+	if (extent.start == start) {
+		extent.start += length;
+		extent.length -= length;
+		if (extent.length == 0)
+			_RemoveExtent(index);
+	} else if (end == start + length) {
+		extent.length -= length;
+	} else {
+		// split the extent
+		extent.length = start - extent.start;
+		if (!_InsertExtent(index + 1, start + length, end - start - length)) {
+			DropIndex();
+			return;
+		}
+	}
+
+	_UpdateHintsFromIndex();
+}
+
+
+void
+AllocationGroup::_IndexFreed(int32 start, int32 length)
+{
+	int32 end = start + length;
+	int32 index = _ExtentIndexFor(start);
+	if (index < fExtentCount && fExtents[index].start < end) {
+		// the range is already free according to the index
+		DropIndex();
+		return;
+	}
+
+	bool joinPrevious = index > 0 && fExtents[index - 1].End() == start;
+	bool joinNext = index < fExtentCount && fExtents[index].start == end;
+
+	if (joinPrevious && joinNext) {
+		fExtents[index - 1].length += length + fExtents[index].length;
+		_RemoveExtent(index);
+	} else if (joinPrevious) {
+		fExtents[index - 1].length += length;
+	} else if (joinNext) {
+		fExtents[index].start = start;
+		fExtents[index].length += length;
+	} else if (!_InsertExtent(index, start, length)) {
+		DropIndex();
+		return;
+	}
+
+	_UpdateHintsFromIndex();
+}
+
+
+void
+AllocationGroup::_UpdateHintsFromIndex()
+{
+	fFirstFree = fExtentCount > 0 ? fExtents[0].start : -1;
+	fLargestStart = 0;
+	fLargestLength = 0;
+	for (int32 i = 0; i < fExtentCount; i++) {
+		if (fExtents[i].length > fLargestLength) {
+			fLargestStart = fExtents[i].start;
+			fLargestLength = fExtents[i].length;
+		}
+	}
+	fLargestValid = true;
+}
+
+
 //	#pragma mark -
 
 
 BlockAllocator::BlockAllocator(Volume* volume)
 	:
 	fVolume(volume),
-	fGroups(NULL)
+	fGroups(NULL),
+	fGroupTree(NULL),
+	fGroupTreeLeaves(0),
+	fListeners(NULL)
 	//fCheckBitmap(NULL),
 	//fCheckCookie(NULL)
 {
@@ -516,6 +860,7 @@ BlockAllocator::~BlockAllocator()
 {
 	recursive_lock_destroy(&fLock);
 	delete[] fGroups;
+	delete[] fGroupTree;
 }
 
 
@@ -532,6 +877,15 @@ BlockAllocator::Initialize(bool full)
 	if (fGroups == NULL)
 		return B_NO_MEMORY;
 
+	fGroupTreeLeaves = 1;
+	while (fGroupTreeLeaves < fNumGroups)
+		fGroupTreeLeaves <<= 1;
+
+	fGroupTree = new(std::nothrow) int32[2 * fGroupTreeLeaves];
+	if (fGroupTree == NULL)
+		return B_NO_MEMORY;
+	memset(fGroupTree, 0, 2 * fGroupTreeLeaves * sizeof(int32));
+
 	if (!full)
 		return B_OK;
 
@@ -590,6 +944,9 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 		fGroups[i].fFirstFree = fGroups[i].fLargestStart = 0;
 		fGroups[i].fFreeBits = fGroups[i].fLargestLength = fGroups[i].fNumBits;
 		fGroups[i].fLargestValid = true;
+		fGroups[i].StartIndex();
+		if (!fGroups[i]._InsertExtent(0, 0, fGroups[i].fNumBits))
+			fGroups[i].DropIndex();
 
 		offset += fBlocksPerGroup;
 	}
@@ -611,6 +968,9 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 	fVolume->SuperBlock().used_blocks
 		= HOST_ENDIAN_TO_BFS_INT64(reservedBlocks);
 
+	for (int32 i = 0; i < fNumGroups; i++)
+		_UpdateGroupTree(i);
+
 	return B_OK;
 }
 
@@ -650,6 +1010,7 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 			groups[i].fNumBlocks = blocks;
 		}
 		groups[i].fStart = offset;
+		groups[i].StartIndex();
 
 		// finds all free ranges in this allocation group
 		int32 start = -1, range = 0;
@@ -700,6 +1061,9 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 		}
 	}
 
+	for (int32 i = 0; i < numGroups; i++)
+		allocator->_UpdateGroupTree(i);
+
 	off_t usedBlocks = volume->NumBlocks() - freeBlocks;
 	if (volume->UsedBlocks() != usedBlocks) {
 		// If the disk in a dirty state at mount time, it's
@@ -722,10 +1086,34 @@ BlockAllocator::Uninitialize()
 }
 
 
+/*!	Rebuilds the state of all allocation groups from the block bitmap, after
+	it has been changed directly.
+*/
+status_t
+BlockAllocator::ReloadBitmap()
+{
+	RecursiveLocker lock(fLock);
+
+	status_t status = B_OK;
+	for (int32 i = 0; i < fNumGroups; i++) {
+		status_t groupStatus = _RebuildGroup(i);
+		if (groupStatus != B_OK)
+			status = groupStatus;
+	}
+
+	return status;
+}
+
+
 /*!	Tries to allocate between \a minimum, and \a maximum blocks starting
 	at group \a groupIndex with offset \a start. The resulting allocation
 	is put into \a run.
 
+	The first free range after \a start in the group is used, if it's large
+	enough. Otherwise, the best fitting free range in the following groups is
+	used, and if there is none that can hold \a maximum blocks, the largest
+	free range of the volume.
+
 	The number of allocated blocks is always a multiple of \a minimum which
 	has to be a power of two value.
 */
@@ -740,143 +1128,76 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		", maximum = %" B_PRIu16 ", minimum = %" B_PRIu16 "\n",
 		groupIndex, start, maximum, minimum));
 
-	AllocationBlock cached(fVolume);
 	RecursiveLocker lock(fLock);
 
-	uint32 bitsPerFullBlock = fVolume->BlockSize() << 3;
+	groupIndex = groupIndex % fNumGroups;
 
 	// Find the block_run that can fulfill the request best
 	int32 bestGroup = -1;
 	int32 bestStart = -1;
 	int32 bestLength = -1;
 
-	for (int32 i = 0; i < fNumGroups + 1; i++, groupIndex++, start = 0) {
-		groupIndex = groupIndex % fNumGroups;
-		AllocationGroup& group = fGroups[groupIndex];
-
-		CHECK_ALLOCATION_GROUP(groupIndex);
-
-		if (start >= group.NumBits() || group.IsFull())
-			continue;
-
-		// The wanted maximum is smaller than the largest free block in the
-		// group or already smaller than the minimum
-
-		if (start < group.fFirstFree)
-			start = group.fFirstFree;
-
-		if (group.fLargestValid) {
-			if (group.fLargestLength < bestLength)
-				continue;
+	int32 rangeStart;
+	int32 rangeLength;
+	status_t status = _FindInGroup(groupIndex, start, maximum, false,
+		rangeStart, rangeLength);
+	if (status != B_OK)
+		return status;
 
-			if (group.fLargestStart >= start) {
-				if (group.fLargestLength >= bestLength) {
-					bestGroup = groupIndex;
-					bestStart = group.fLargestStart;
-					bestLength = group.fLargestLength;
+	if (rangeLength > bestLength) {
+		bestGroup = groupIndex;
+		bestStart = rangeStart;
+		bestLength = rangeLength;
+	}
 
-					if (bestLength >= maximum)
-						break;
-				}
+	// Look at the groups that may contain a large enough range, beginning
+	// with the one after the goal group, and ending with the goal group
+	// itself.
+	int32 nextGroup = groupIndex + 1;
+	bool wrapped = false;
+	while (bestLength < maximum) {
+		int32 group = _FindGroup(nextGroup, maximum);
+		if (group < 0 || (wrapped && group > groupIndex)) {
+			if (wrapped)
+				break;
 
-				// We know everything about this group we have to, let's skip
-				// to the next
-				continue;
-			}
+			wrapped = true;
+			nextGroup = 0;
+			continue;
 		}
 
-		// There may be more than one block per allocation group - and
-		// we iterate through it to find a place for the allocation.
-		// (one allocation can't exceed one allocation group)
-
-		uint32 block = start / (fVolume->BlockSize() << 3);
-		int32 currentStart = 0, currentLength = 0;
-		int32 groupLargestStart = -1;
-		int32 groupLargestLength = -1;
-		int32 currentBit = start;
-		bool canFindGroupLargest = start == 0;
-
-		for (; block < group.NumBlocks(); block++) {
-			if (cached.SetTo(group, block) < B_OK)
-				RETURN_ERROR(B_ERROR);
-
-			T(Block("alloc-in", group.Start() + block, cached.Block(),
-				fVolume->BlockSize(), groupIndex, currentStart));
-
-			// find a block large enough to hold the allocation
-			for (uint32 bit = start % bitsPerFullBlock;
-					bit < cached.NumBlockBits(); bit++) {
-				if (!cached.IsUsed(bit)) {
-					if (currentLength == 0) {
-						// start new range
-						currentStart = currentBit;
-					}
-
-					// have we found a range large enough to hold numBlocks?
-					if (++currentLength >= maximum) {
-						bestGroup = groupIndex;
-						bestStart = currentStart;
-						bestLength = currentLength;
-						break;
-					}
-				} else {
-					if (currentLength) {
-						// end of a range
-						if (currentLength > bestLength) {
-							bestGroup = groupIndex;
-							bestStart = currentStart;
-							bestLength = currentLength;
-						}
-						if (currentLength > groupLargestLength) {
-							groupLargestStart = currentStart;
-							groupLargestLength = currentLength;
-						}
-						currentLength = 0;
-					}
-					if ((int32)group.NumBits() - currentBit
-							<= groupLargestLength) {
-						// We can't find a bigger block in this group anymore,
-						// let's skip the rest.
-						block = group.NumBlocks();
-						break;
-					}
-				}
-				currentBit++;
-			}
+		status = _FindInGroup(group, 0, maximum, true, rangeStart,
+			rangeLength);
+		if (status != B_OK)
+			return status;
 
-			T(Block("alloc-out", block, cached.Block(),
-				fVolume->BlockSize(), groupIndex, currentStart));
+		if (rangeLength > bestLength) {
+			bestGroup = group;
+			bestStart = rangeStart;
+			bestLength = rangeLength;
+		}
 
-			if (bestLength >= maximum) {
-				canFindGroupLargest = false;
-				break;
-			}
+		nextGroup = group + 1;
+	}
 
-			// start from the beginning of the next block
-			start = 0;
-		}
+	// If there is no range large enough, take the largest one there is. Since
+	// the sizes of groups that aren't indexed might only be estimated, this
+	// may take a few rounds.
+	for (int32 i = 0; bestLength < maximum && i < fNumGroups; i++) {
+		if (fGroupTree[1] <= bestLength)
+			break;
 
-		if (currentBit == (int32)group.NumBits()) {
-			if (currentLength > bestLength) {
-				bestGroup = groupIndex;
-				bestStart = currentStart;
-				bestLength = currentLength;
-			}
-			if (canFindGroupLargest && currentLength > groupLargestLength) {
-				groupLargestStart = currentStart;
-				groupLargestLength = currentLength;
-			}
-		}
+		int32 group = _LargestGroup();
+		status = _FindInGroup(group, 0, maximum, false, rangeStart,
+			rangeLength);
+		if (status != B_OK)
+			return status;
 
-		if (canFindGroupLargest && !group.fLargestValid
-			&& groupLargestLength >= 0) {
-			group.fLargestStart = groupLargestStart;
-			group.fLargestLength = groupLargestLength;
-			group.fLargestValid = true;
+		if (rangeLength > bestLength) {
+			bestGroup = group;
+			bestStart = rangeStart;
+			bestLength = rangeLength;
 		}
-
-		if (bestLength >= maximum)
-			break;
 	}
 
 	// If we found a suitable range, mark the blocks as in use, and
@@ -891,7 +1212,9 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		bestLength = round_down(bestLength, minimum);
 	}
 
-	if (fGroups[bestGroup].Allocate(transaction, bestStart, bestLength) != B_OK)
+	status = fGroups[bestGroup].Allocate(transaction, bestStart, bestLength);
+	_GroupChanged(transaction, bestGroup);
+	if (status != B_OK)
 		RETURN_ERROR(B_IO_ERROR);
 
 	CHECK_ALLOCATION_GROUP(bestGroup);
@@ -1039,7 +1362,9 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 
 	CHECK_ALLOCATION_GROUP(group);
 
-	if (fGroups[group].Free(transaction, start, length) != B_OK)
+	status_t status = fGroups[group].Free(transaction, start, length);
+	_GroupChanged(transaction, group);
+	if (status != B_OK)
 		RETURN_ERROR(B_IO_ERROR);
 
 	CHECK_ALLOCATION_GROUP(group);
@@ -1083,6 +1408,8 @@ BlockAllocator::Fragment()
 
 			transaction.Done();
 		}
+
+		_RebuildGroup(i);
 	}
 }
 #endif	// DEBUG_FRAGMENTER
@@ -1331,6 +1658,56 @@ BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
 }
 
 
+status_t
+BlockAllocator::GetStatistics(bfs_allocator_stats& stats)
+{
+	RecursiveLocker lock(fLock);
+
+	memset(&stats, 0, sizeof(bfs_allocator_stats));
+	stats.allocation_groups = fNumGroups;
+
+	AllocationBlock cached(fVolume);
+
+	for (int32 i = 0; i < fNumGroups; i++) {
+		AllocationGroup& group = fGroups[i];
+		stats.free_blocks += group.fFreeBits;
+
+		if (group.IsIndexed()) {
+			stats.indexed_groups++;
+			stats.free_ranges += group.CountExtents();
+			if (group.fLargestValid
+				&& (uint64)group.fLargestLength > stats.largest_free_range) {
+				stats.largest_free_range = group.fLargestLength;
+			}
+			continue;
+		}
+
+		// count the ranges in the bitmap
+		uint64 range = 0;
+		for (uint32 block = 0; block < group.NumBlocks(); block++) {
+			if (cached.SetTo(group, block) != B_OK)
+				RETURN_ERROR(B_IO_ERROR);
+
+			for (uint32 bit = 0; bit < cached.NumBlockBits(); bit++) {
+				if (!cached.IsUsed(bit)) {
+					if (range++ == 0)
+						stats.free_ranges++;
+					continue;
+				}
+
+				if (range > stats.largest_free_range)
+					stats.largest_free_range = range;
+				range = 0;
+			}
+		}
+		if (range > stats.largest_free_range)
+			stats.largest_free_range = range;
+	}
+
+	return B_OK;
+}
+
+
 bool
 BlockAllocator::_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 	uint64 offset, uint64 size)
@@ -1380,6 +1757,319 @@ BlockAllocator::_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
 }
 
 
+/*!	Finds a free range of at least \a maximum blocks at or after \a start in
+	the given group, or the largest one if there is none. \a _length is -1 if
+	the group has no free blocks after \a start.
+*/
+status_t
+BlockAllocator::_FindInGroup(int32 groupIndex, uint16 start, uint16 maximum,
+	bool bestFit, int32& _start, int32& _length)
+{
+	AllocationGroup& group = fGroups[groupIndex];
+
+	CHECK_ALLOCATION_GROUP(groupIndex);
+
+	_start = -1;
+	_length = -1;
+	if (start >= group.NumBits() || group.IsFull())
+		return B_OK;
+
+	if (group.IsIndexed()) {
+		group.FindExtent(start, maximum, bestFit, _start, _length);
+		return B_OK;
+	}
+
+	status_t status = _ScanGroup(groupIndex, start, maximum, _start, _length);
+
+	// the scan may have found out about the group's largest range
+	_UpdateGroupTree(groupIndex);
+	return status;
+}
+
+
+/*!	Searches the bitmap of a group that isn't indexed for the first free
+	range of at least \a maximum blocks at or after \a start, or the largest
+	one if there is none.
+*/
+status_t
+BlockAllocator::_ScanGroup(int32 groupIndex, uint16 start, uint16 maximum,
+	int32& _start, int32& _length)
+{
+	AllocationGroup& group = fGroups[groupIndex];
+	AllocationBlock cached(fVolume);
+	uint32 bitsPerFullBlock = fVolume->BlockSize() << 3;
+
+	if (start < group.fFirstFree)
+		start = group.fFirstFree;
+
+	if (group.fLargestValid && group.fLargestStart >= start) {
+		// We know everything about this group we have to
+		_start = group.fLargestStart;
+		_length = group.fLargestLength;
+		return B_OK;
+	}
+
+	// There may be more than one block per allocation group - and
+	// we iterate through it to find a place for the allocation.
+	// (one allocation can't exceed one allocation group)
+
+	uint32 block = start / bitsPerFullBlock;
+	int32 currentStart = 0, currentLength = 0;
+	int32 groupLargestStart = -1;
+	int32 groupLargestLength = -1;
+	int32 currentBit = start;
+	bool canFindGroupLargest = start == 0;
+
+	for (; block < group.NumBlocks(); block++) {
+		if (cached.SetTo(group, block) < B_OK)
+			RETURN_ERROR(B_ERROR);
+
+		T(Block("alloc-in", group.Start() + block, cached.Block(),
+			fVolume->BlockSize(), groupIndex, currentStart));
+
+		// find a block large enough to hold the allocation
+		for (uint32 bit = start % bitsPerFullBlock;
+				bit < cached.NumBlockBits(); bit++) {
+			if (!cached.IsUsed(bit)) {
+				if (currentLength == 0) {
+					// start new range
+					currentStart = currentBit;
+				}
+
+				// have we found a range large enough to hold numBlocks?
+				if (++currentLength >= maximum) {
+					_start = currentStart;
+					_length = currentLength;
+					break;
+				}
+			} else {
+				if (currentLength) {
+					// end of a range
+					if (currentLength > _length) {
+						_start = currentStart;
+						_length = currentLength;
+					}
+					if (currentLength > groupLargestLength) {
+						groupLargestStart = currentStart;
+						groupLargestLength = currentLength;
+					}
+					currentLength = 0;
+				}
+				if ((int32)group.NumBits() - currentBit
+						<= groupLargestLength) {
+					// We can't find a bigger block in this group anymore,
+					// let's skip the rest.
+					block = group.NumBlocks();
+					break;
+				}
+			}
+			currentBit++;
+		}
+
+		T(Block("alloc-out", block, cached.Block(),
+			fVolume->BlockSize(), groupIndex, currentStart));
+
+		if (_length >= maximum) {
+			canFindGroupLargest = false;
+			break;
+		}
+
+		// start from the beginning of the next block
+		start = 0;
+	}
+
+	if (currentBit == (int32)group.NumBits()) {
+		if (currentLength > _length) {
+			_start = currentStart;
+			_length = currentLength;
+		}
+		if (canFindGroupLargest && currentLength > groupLargestLength) {
+			groupLargestStart = currentStart;
+			groupLargestLength = currentLength;
+		}
+	}
+
+	if (canFindGroupLargest && !group.fLargestValid) {
+		if (groupLargestLength < 0) {
+			groupLargestStart = 0;
+			groupLargestLength = 0;
+		}
+		group.fLargestStart = groupLargestStart;
+		group.fLargestLength = groupLargestLength;
+		group.fLargestValid = true;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Reloads the state of the group, and its free range index, from the block
+	bitmap.
+*/
+status_t
+BlockAllocator::_RebuildGroup(int32 groupIndex)
+{
+	AllocationGroup& group = fGroups[groupIndex];
+	AllocationBlock cached(fVolume);
+
+	group.fFirstFree = -1;
+	group.fFreeBits = 0;
+	group.fLargestValid = false;
+	group.StartIndex();
+
+	int32 start = -1;
+	int32 range = 0;
+	int32 bit = 0;
+
+	for (uint32 block = 0; block < group.NumBlocks(); block++) {
+		if (cached.SetTo(group, block) != B_OK) {
+			group.DropIndex();
+			_UpdateGroupTree(groupIndex);
+			RETURN_ERROR(B_IO_ERROR);
+		}
+
+		for (uint32 i = 0; i < cached.NumBlockBits(); i++, bit++) {
+			if (cached.IsUsed(i)) {
+				if (range > 0) {
+					group.AddFreeRange(start, range);
+					range = 0;
+				}
+			} else if (range++ == 0)
+				start = bit;
+		}
+	}
+	if (range > 0)
+		group.AddFreeRange(start, range);
+
+	if (group.IsIndexed())
+		group._UpdateHintsFromIndex();
+
+	_UpdateGroupTree(groupIndex);
+	return B_OK;
+}
+
+
+/*!	Must be called after the bitmap of a group has been changed in the given
+	transaction. If the transaction is aborted, the group will be reloaded.
+*/
+void
+BlockAllocator::_GroupChanged(Transaction& transaction, int32 groupIndex)
+{
+	_UpdateGroupTree(groupIndex);
+
+	AllocationListener* listener = fListeners;
+	while (listener != NULL && listener->GetTransaction() != &transaction)
+		listener = listener->fNext;
+
+	if (listener == NULL) {
+		listener = new(std::nothrow) AllocationListener(this, &transaction);
+		if (listener == NULL) {
+			// The index could not be reverted, so stop trusting it; the
+			// group is scanned in the bitmap until it is rebuilt.
+			fGroups[groupIndex].DropIndex();
+			_UpdateGroupTree(groupIndex);
+			return;
+		}
+
+		listener->fNext = fListeners;
+		fListeners = listener;
+		transaction.AddListener(listener);
+	}
+
+	listener->AddGroup(groupIndex);
+}
+
+
+void
+BlockAllocator::_TransactionDone(AllocationListener* listener, bool success)
+{
+	if (success)
+		return;
+
+	RecursiveLocker lock(fLock);
+
+	if (listener->HasAllGroups()) {
+		for (int32 i = 0; i < fNumGroups; i++)
+			_RebuildGroup(i);
+	} else {
+		for (int32 i = 0; i < listener->CountGroups(); i++)
+			_RebuildGroup(listener->GroupAt(i));
+	}
+}
+
+
+void
+BlockAllocator::_RemoveListener(AllocationListener* listener)
+{
+	RecursiveLocker lock(fLock);
+
+	AllocationListener** link = &fListeners;
+	while (*link != NULL && *link != listener)
+		link = &(*link)->fNext;
+
+	if (*link == listener)
+		*link = listener->fNext;
+}
+
+
+void
+BlockAllocator::_UpdateGroupTree(int32 groupIndex)
+{
+	int32 node = fGroupTreeLeaves + groupIndex;
+	fGroupTree[node] = fGroups[groupIndex].LargestFreeBound();
+
+	for (node /= 2; node > 0; node /= 2)
+		fGroupTree[node] = max_c(fGroupTree[2 * node], fGroupTree[2 * node + 1]);
+}
+
+
+/*!	Returns the first group at or after \a from that may have a free range of
+	at least \a length blocks, or -1 if there is none.
+*/
+int32
+BlockAllocator::_FindGroup(int32 from, int32 length) const
+{
+	if (from >= fNumGroups)
+		return -1;
+
+	return _FindGroup(from, length, 1, 0, fGroupTreeLeaves);
+}
+
+
+int32
+BlockAllocator::_FindGroup(int32 from, int32 length, int32 node, int32 low,
+	int32 high) const
+{
+	if (high <= from || fGroupTree[node] < length)
+		return -1;
+	if (high - low == 1)
+		return low;
+
+	int32 middle = (low + high) / 2;
+	int32 group = _FindGroup(from, length, 2 * node, low, middle);
+	if (group >= 0)
+		return group;
+
+	return _FindGroup(from, length, 2 * node + 1, middle, high);
+}
+
+
+/*!	Returns the group that may have the largest free range.
+*/
+int32
+BlockAllocator::_LargestGroup() const
+{
+	int32 node = 1;
+	while (node < fGroupTreeLeaves) {
+		node *= 2;
+		if (fGroupTree[node] < fGroupTree[node + 1])
+			node++;
+	}
+
+	return node - fGroupTreeLeaves;
+}
+
+
 //	#pragma mark - debugger commands
 
 
@@ -1406,6 +2096,11 @@ BlockAllocator::Dump(int32 index)
 			group.fLargestValid ? "" : "  (invalid)");
 		kprintf("      largest length: %" B_PRId32 "\n", group.fLargestLength);
 		kprintf("      free bits:      %" B_PRId32 "\n", group.fFreeBits);
+		if (group.IsIndexed()) {
+			kprintf("      free ranges:    %" B_PRId32 "\n",
+				group.CountExtents());
+		} else
+			kprintf("      free ranges:    (not indexed)\n");
 	}
 }
 
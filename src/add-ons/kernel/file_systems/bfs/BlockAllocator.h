@@ -10,11 +10,13 @@
 
 
 class AllocationGroup;
+class AllocationListener;
 class Inode;
 class Transaction;
 class Volume;
 struct disk_super_block;
 struct block_run;
+struct bfs_allocator_stats;
 
 
 //#define DEBUG_ALLOCATION_GROUPS
@@ -28,6 +30,7 @@ public:
 
 			status_t		Initialize(bool full = true);
 			status_t		InitializeAndClearBitmap(Transaction& transaction);
+			status_t		ReloadBitmap();
 
 			void			Uninitialize();
 
@@ -55,6 +58,8 @@ public:
 			bool			IsValidBlockRun(block_run run,
 								const char* type = NULL);
 
+			status_t		GetStatistics(bfs_allocator_stats& stats);
+
 			recursive_lock&	Lock() { return fLock; }
 
 #ifdef BFS_DEBUGGER_COMMANDS
@@ -65,9 +70,30 @@ public:
 #endif
 
 private:
+	friend class AllocationListener;
+
 #ifdef DEBUG_ALLOCATION_GROUPS
 			void			_CheckGroup(int32 group) const;
 #endif
+			status_t		_FindInGroup(int32 groupIndex, uint16 start,
+								uint16 maximum, bool bestFit,
+								int32& _start, int32& _length);
+			status_t		_ScanGroup(int32 groupIndex, uint16 start,
+								uint16 maximum, int32& _start,
+								int32& _length);
+			status_t		_RebuildGroup(int32 groupIndex);
+			void			_GroupChanged(Transaction& transaction,
+								int32 groupIndex);
+			void			_TransactionDone(AllocationListener* listener,
+								bool success);
+			void			_RemoveListener(AllocationListener* listener);
+
+			void			_UpdateGroupTree(int32 groupIndex);
+			int32			_FindGroup(int32 from, int32 length) const;
+			int32			_FindGroup(int32 from, int32 length, int32 node,
+								int32 low, int32 high) const;
+			int32			_LargestGroup() const;
+
 			bool			_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size);
 			status_t		_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
@@ -83,6 +109,10 @@ private:
 			int32			fNumGroups;
 			uint32			fBlocksPerGroup;
 			uint32			fNumBlocks;
+
+			int32*			fGroupTree;
+			int32			fGroupTreeLeaves;
+			AllocationListener* fListeners;
 };
 
 #ifdef BFS_DEBUGGER_COMMANDS
@@ -19,16 +19,60 @@
 struct check_index {
 	check_index()
 		:
-		inode(NULL)
+		inode(NULL),
+		batch(NULL)
 	{
 	}
 
 	char				name[B_FILE_NAME_LENGTH];
 	block_run			run;
 	Inode*				inode;
+	TreeBatch*			batch;
 };
 
 
+/*!	Retrieves the key \a inode has in the index \a indexName. The \a key
+	buffer must be at least BPLUSTREE_MAX_KEY_LENGTH bytes large.
+	Returns \c B_ENTRY_NOT_FOUND if the inode doesn't belong into the index.
+*/
+static status_t
+get_index_key(const char* indexName, Inode* inode, uint8* key,
+	size_t* _keyLength)
+{
+	if (!strcmp(indexName, "name")) {
+		if (!inode->InNameIndex())
+			return B_ENTRY_NOT_FOUND;
+
+		if (inode->GetName((char*)key, B_FILE_NAME_LENGTH) != B_OK)
+			return B_ERROR;
+
+		*_keyLength = strlen((char*)key);
+	} else if (!strcmp(indexName, "last_modified")) {
+		if (!inode->InLastModifiedIndex())
+			return B_ENTRY_NOT_FOUND;
+
+		int64 modified = inode->OldLastModified();
+		memcpy(key, &modified, sizeof(int64));
+		*_keyLength = sizeof(int64);
+	} else if (!strcmp(indexName, "size")) {
+		if (!inode->InSizeIndex())
+			return B_ENTRY_NOT_FOUND;
+
+		int64 size = inode->Size();
+		memcpy(key, &size, sizeof(int64));
+		*_keyLength = sizeof(int64);
+	} else {
+		*_keyLength = MAX_INDEX_KEY_LENGTH;
+		if (inode->ReadAttribute(indexName, B_ANY_TYPE, 0, key, _keyLength)
+				!= B_OK) {
+			return B_ENTRY_NOT_FOUND;
+		}
+	}
+
+	return B_OK;
+}
+
+
 CheckVisitor::CheckVisitor(Volume* volume)
 	:
 	FileSystemVisitor(volume),
@@ -153,6 +197,9 @@ CheckVisitor::WriteBackCheckBitmap()
 			}
 			transaction.Done();
 		}
+
+		// the allocation groups need to learn about the new bitmap
+		GetVolume()->Allocator().ReloadBitmap();
 	}
 
 	return B_OK;
@@ -190,6 +237,12 @@ CheckVisitor::StopChecking()
 	if (Control().status != B_ENTRY_NOT_FOUND)
 		FATAL(("CheckVisitor didn't run through\n"));
 
+	status_t status = _CommitIndices();
+	if (status != B_OK) {
+		FATAL(("check: Could not rebuild indices: %s\n", strerror(status)));
+		Control().status = status;
+	}
+
 	_FreeIndices();
 
 	recursive_lock_unlock(&GetVolume()->Allocator().Lock());
@@ -699,6 +752,14 @@ CheckVisitor::_PrepareIndices()
 		if (status != B_OK)
 			return status;
 
+		// The entries are collected first, so that the index can be built
+		// from the sorted list in one go
+		index->batch = new(std::nothrow) TreeBatch(tree);
+		if (index->batch == NULL)
+			return B_NO_MEMORY;
+
+		index->batch->SetValidator(&_ValidateIndexEntry, index);
+
 		index->inode = inode;
 		vnode.Keep();
 		count++;
@@ -717,6 +778,7 @@ CheckVisitor::_FreeIndices()
 			put_vnode(GetVolume()->FSVolume(),
 				GetVolume()->ToVnode(index->inode->BlockRun()));
 		}
+		delete index->batch;
 		delete index;
 	}
 	Indices().MakeEmpty();
@@ -724,51 +786,67 @@ CheckVisitor::_FreeIndices()
 
 
 status_t
-CheckVisitor::_AddInodeToIndex(Inode* inode)
+CheckVisitor::_CommitIndices()
 {
-	Transaction transaction(GetVolume(), inode->BlockNumber());
-
 	for (int32 i = 0; i < Indices().CountItems(); i++) {
 		check_index* index = Indices().Array()[i];
-		if (index->inode == NULL)
+		if (index->batch == NULL)
 			continue;
 
-		index->inode->WriteLockInTransaction(transaction);
-
-		BPlusTree* tree = index->inode->Tree();
-		if (tree == NULL)
-			return B_ERROR;
+		status_t status = index->batch->Commit();
+		if (status != B_OK)
+			return status;
+	}
 
-		status_t status = B_OK;
+	return B_OK;
+}
 
-		if (!strcmp(index->name, "name")) {
-			if (inode->InNameIndex()) {
-				char name[B_FILE_NAME_LENGTH];
-				if (inode->GetName(name, B_FILE_NAME_LENGTH) != B_OK)
-					return B_ERROR;
 
-				status = tree->Insert(transaction, name, inode->ID());
-			}
-		} else if (!strcmp(index->name, "last_modified")) {
-			if (inode->InLastModifiedIndex()) {
-				status = tree->Insert(transaction, inode->OldLastModified(),
-					inode->ID());
-			}
-		} else if (!strcmp(index->name, "size")) {
-			if (inode->InSizeIndex())
-				status = tree->Insert(transaction, inode->Size(), inode->ID());
-		} else {
-			uint8 key[MAX_INDEX_KEY_LENGTH];
-			size_t keyLength = sizeof(key);
-			if (inode->ReadAttribute(index->name, B_ANY_TYPE, 0, key,
-					&keyLength) == B_OK) {
-				status = tree->Insert(transaction, key, keyLength, inode->ID());
-			}
-		}
+status_t
+CheckVisitor::_AddInodeToIndex(Inode* inode)
+{
+	for (int32 i = 0; i < Indices().CountItems(); i++) {
+		check_index* index = Indices().Array()[i];
+		if (index->inode == NULL || index->batch == NULL)
+			continue;
 
+		uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
+		size_t keyLength;
+		status_t status = get_index_key(index->name, inode, key, &keyLength);
+		if (status == B_ENTRY_NOT_FOUND)
+			continue;
+		if (status == B_OK)
+			status = index->batch->Add(key, keyLength, inode->ID());
 		if (status != B_OK)
 			return status;
 	}
 
-	return transaction.Done();
+	return B_OK;
+}
+
+
+/*!	Called for every entry of a rebuilt index before it is written. The
+	entries are only added to the index after all inodes have been visited,
+	so the inode is looked up again, and the entry is dropped, if it no
+	longer matches what the inode has now.
+*/
+/*static*/ bool
+CheckVisitor::_ValidateIndexEntry(void* cookie, const uint8* key,
+	uint16 keyLength, off_t value)
+{
+	check_index* index = (check_index*)cookie;
+
+	Vnode vnode(index->inode->GetVolume(), (ino_t)value);
+	Inode* inode;
+	if (vnode.Get(&inode) != B_OK)
+		return false;
+
+	InodeReadLocker locker(inode);
+
+	uint8 currentKey[BPLUSTREE_MAX_KEY_LENGTH];
+	size_t currentLength;
+	return get_index_key(index->name, inode, currentKey, &currentLength)
+			== B_OK
+		&& currentLength == keyLength
+		&& memcmp(currentKey, key, keyLength) == 0;
 }
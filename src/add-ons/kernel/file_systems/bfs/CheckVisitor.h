@@ -63,7 +63,11 @@ private:
 
 			status_t			_PrepareIndices();
 			void				_FreeIndices();
+			status_t			_CommitIndices();
 			status_t			_AddInodeToIndex(Inode* inode);
+	static	bool				_ValidateIndexEntry(void* cookie,
+									const uint8* key, uint16 keyLength,
+									off_t value);
 
 private:
 			check_control		control;
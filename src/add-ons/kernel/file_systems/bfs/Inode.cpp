@@ -344,7 +344,9 @@ Inode::Inode(Volume* volume, ino_t id)
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fDelayedSize(0),
+	fReservedBlocks(0)
 {
 	PRINT(("Inode::Inode(volume = %p, id = %" B_PRIdINO ") @ %p\n",
 		volume, id, this));
@@ -378,7 +380,9 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fDelayedSize(0),
+	fReservedBlocks(0)
 {
 	PRINT(("Inode::Inode(volume = %p, transaction = %p, id = %" B_PRIdINO
 		") @ %p\n", volume, &transaction, id, this));
@@ -420,6 +424,9 @@ Inode::~Inode()
 {
 	PRINT(("Inode::~Inode() @ %p\n", this));
 
+	if (fReservedBlocks != 0)
+		fVolume->UnreserveBlocks(fReservedBlocks);
+
 	file_cache_delete(FileCache());
 	file_map_delete(Map());
 	delete fTree;
@@ -1601,47 +1608,61 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 
 	locker.Unlock();
 
-	// the transaction doesn't have to be started already
-	if (changeSize && !transaction.IsStarted())
-		transaction.Start(fVolume, BlockNumber());
+	off_t oldSize = -1;
 
-	WriteLocker writeLocker(fLock);
+	if (changeSize && !transaction.IsStarted() && IsFile()
+		&& fVolume->CanDelayAllocation()) {
+		// Only reserve the space for now; the blocks are allocated when the
+		// file cache writes the data back, and we know how much it is
+		WriteLocker writeLocker(fLock);
 
-	// Work around possible race condition: Someone might have shrunken the file
-	// while we had no lock.
-	if (!transaction.IsStarted()
-		&& (uint64)pos + (uint64)length > (uint64)Size()) {
-		writeLocker.Unlock();
-		transaction.Start(fVolume, BlockNumber());
-		writeLocker.Lock();
+		off_t size = Size();
+		if ((uint64)pos + (uint64)length <= (uint64)size
+			|| _DelayAllocation(pos + length) == B_OK)
+			oldSize = size;
 	}
 
-	off_t oldSize = Size();
+	if (oldSize < 0) {
+		// the transaction doesn't have to be started already
+		if (changeSize && !transaction.IsStarted())
+			transaction.Start(fVolume, BlockNumber());
 
-	if ((uint64)pos + (uint64)length > (uint64)oldSize) {
-		// let's grow the data stream to the size needed
-		status_t status = SetFileSize(transaction, pos + length);
-		if (status != B_OK) {
-			*_length = 0;
-			WriteLockInTransaction(transaction);
-			RETURN_ERROR(status);
+		WriteLocker writeLocker(fLock);
+
+		// Work around possible race condition: Someone might have shrunken the
+		// file while we had no lock.
+		if (!transaction.IsStarted()
+			&& (uint64)pos + (uint64)length > (uint64)Size()) {
+			writeLocker.Unlock();
+			transaction.Start(fVolume, BlockNumber());
+			writeLocker.Lock();
 		}
-		// TODO: In theory we would need to update the file size
-		// index here as part of the current transaction - this might just
-		// be a bit too expensive, but worth a try.
 
-		// we need to write back the inode here because it has to
-		// go into this transaction (we cannot wait until the file
-		// is closed)
-		status = WriteBack(transaction);
-		if (status != B_OK) {
-			WriteLockInTransaction(transaction);
-			return status;
+		oldSize = Size();
+
+		if ((uint64)pos + (uint64)length > (uint64)oldSize) {
+			// let's grow the data stream to the size needed
+			status_t status = SetFileSize(transaction, pos + length);
+			if (status != B_OK) {
+				*_length = 0;
+				WriteLockInTransaction(transaction);
+				RETURN_ERROR(status);
+			}
+			// TODO: In theory we would need to update the file size
+			// index here as part of the current transaction - this might
+			// just be a bit too expensive, but worth a try.
+
+			// we need to write back the inode here because it has to
+			// go into this transaction (we cannot wait until the file
+			// is closed)
+			status = WriteBack(transaction);
+			if (status != B_OK) {
+				WriteLockInTransaction(transaction);
+				return status;
+			}
 		}
 	}
 
-	writeLocker.Unlock();
-
 	if (oldSize < pos)
 		FillGapWithZeros(oldSize, pos);
 
@@ -1752,10 +1773,11 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 			minimum = data->double_indirect.Length();
 	}
 
-	// do we have enough free blocks on the disk?
+	// do we have enough free blocks on the disk? (the blocks reserved for
+	// our own delayed allocation can be used, of course)
 	off_t blocksNeeded = (bytes + fVolume->BlockSize() - 1)
 		>> fVolume->BlockShift();
-	if (blocksNeeded > fVolume->FreeBlocks())
+	if (blocksNeeded > fVolume->AvailableBlocks() + fReservedBlocks)
 		return B_DEVICE_FULL;
 
 	off_t blocksRequested = blocksNeeded;
@@ -1769,7 +1791,7 @@ Inode::_GrowStream(Transaction& transaction, off_t size)
 	// counterproductive.
 	// Also, if free disk space is tight, don't preallocate.
 	if (!IsAttribute() && !IsAttributeDirectory() && !IsSymLink()
-		&& fVolume->FreeBlocks() > 128) {
+		&& fVolume->AvailableBlocks() > 128) {
 		off_t roundTo = 0;
 		if (IsFile()) {
 			// Request preallocated blocks depending on the file size and growth
@@ -2272,6 +2294,18 @@ Inode::SetFileSize(Transaction& transaction, off_t size)
 	if (size < 0)
 		return B_BAD_VALUE;
 
+	if (HasDelayedAllocation()) {
+		// Either throw away the data that has not been allocated yet, or
+		// allocate it now, so that the data stream can be resized as usual
+		if (size <= Node().data.Size())
+			_CancelDelayedAllocation();
+		else {
+			status_t status = _AllocateDelayedBlocks(transaction);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
 	off_t oldSize = Size();
 
 	if (size == oldSize)
@@ -2319,7 +2353,9 @@ Inode::NeedsTrimming() const
 	// possible. There are only few indices anyway, so this doesn't hurt.
 	// Also, if an inode is already in deleted state, we don't bother trimming
 	// it.
-	if (IsIndex() || IsDeleted()
+	// The preallocated blocks of a file with a delayed allocation will be
+	// used soon, and its reservation assumes that they are still there.
+	if (IsIndex() || IsDeleted() || HasDelayedAllocation()
 		|| (IsSymLink() && (Flags() & INODE_LONG_SYMLINK) == 0))
 		return false;
 
@@ -2334,6 +2370,10 @@ Inode::NeedsTrimming() const
 status_t
 Inode::TrimPreallocation(Transaction& transaction)
 {
+	// a delayed allocation might have been started since NeedsTrimming()
+	if (HasDelayedAllocation())
+		return B_OK;
+
 	T(Resize(this, max_c(Node().data.MaxDirectRange(),
 		Node().data.MaxIndirectRange()), Size(), true));
 
@@ -2345,6 +2385,114 @@ Inode::TrimPreallocation(Transaction& transaction)
 }
 
 
+/*!	Allocates the blocks for the data that has only been reserved so far,
+	and writes back the inode. If \a canWait is \c false, and the journal is
+	currently in use, \c B_WOULD_BLOCK is returned instead; this is what the
+	page writer must do, as the owner of a running transaction might wait
+	for the very pages it is about to write. The page writer keeps the pages
+	modified, and retries later.
+*/
+status_t
+Inode::AllocateDelayedBlocks(bool canWait)
+{
+	// there is no need to write back the data of deleted files
+	if (!HasDelayedAllocation() || IsDeleted())
+		return B_OK;
+
+	Transaction transaction;
+	status_t status = transaction.Start(fVolume, BlockNumber(), canWait);
+	if (status != B_OK)
+		return status;
+
+	WriteLockInTransaction(transaction);
+
+	status = _AllocateDelayedBlocks(transaction);
+	if (status == B_OK)
+		status = transaction.Done();
+
+	return status;
+}
+
+
+/*!	Remembers \a size as the new file size, but only reserves the blocks
+	needed to store it. Must be called with the inode write locked.
+*/
+status_t
+Inode::_DelayAllocation(off_t size)
+{
+	// preallocated blocks can be used without a reservation
+	const data_stream& data = Node().data;
+	off_t allocatedSize = max_c(data.MaxDirectRange(),
+		max_c(data.MaxIndirectRange(), data.MaxDoubleIndirectRange()));
+
+	off_t blocks = 0;
+	if (size > allocatedSize) {
+		blocks = (size - allocatedSize + fVolume->BlockSize() - 1)
+			>> fVolume->BlockShift();
+
+		// leave some room for the block arrays of the data stream
+		blocks += blocks / (fVolume->BlockSize() / sizeof(block_run))
+			+ NUM_ARRAY_BLOCKS;
+	}
+
+	if (blocks > fReservedBlocks) {
+		status_t status = fVolume->ReserveBlocks(blocks - fReservedBlocks);
+		if (status != B_OK)
+			return status;
+
+		fReservedBlocks = blocks;
+	}
+
+	fDelayedSize = size;
+	file_cache_set_size(FileCache(), size);
+		// the file map stays as is, it only covers allocated blocks
+	return B_OK;
+}
+
+
+/*!	Grows the data stream to the delayed file size. The reservation is only
+	released once the transaction succeeded, see TransactionDone().
+*/
+status_t
+Inode::_AllocateDelayedBlocks(Transaction& transaction)
+{
+	if (!HasDelayedAllocation())
+		return B_OK;
+
+	off_t oldSize = Node().data.Size();
+	off_t size = fDelayedSize;
+
+	T(Resize(this, oldSize, size, false));
+
+	status_t status = _GrowStream(transaction, size);
+	if (status != B_OK) {
+		FATAL(("Could not allocate delayed blocks: inode %" B_PRIdINO
+			", %" B_PRIdOFF " bytes: %s\n", ID(), size - oldSize,
+			strerror(status)));
+		_ShrinkStream(transaction, oldSize);
+		return status;
+	}
+
+	file_map_set_size(Map(), size);
+
+	return WriteBack(transaction);
+}
+
+
+/*!	Drops the data that has not been allocated yet, and the blocks reserved
+	for it. Must be called with the inode write locked.
+*/
+void
+Inode::_CancelDelayedAllocation()
+{
+	fVolume->UnreserveBlocks(fReservedBlocks);
+	fReservedBlocks = 0;
+	fDelayedSize = 0;
+
+	file_cache_set_size(FileCache(), Node().data.Size());
+}
+
+
 //!	Frees the file's data stream and removes all attributes
 status_t
 Inode::Free(Transaction& transaction)
@@ -2386,8 +2534,15 @@ Inode::Free(Transaction& transaction)
 status_t
 Inode::Sync()
 {
-	if (FileCache())
+	if (FileCache()) {
+		// allocate the blocks first, so that writing back the pages doesn't
+		// have to do it
+		status_t status = AllocateDelayedBlocks();
+		if (status != B_OK)
+			return status;
+
 		return file_cache_sync(FileCache());
+	}
 
 	// We may also want to flush the attribute's data stream to
 	// disk here... (do we?)
@@ -2494,6 +2649,11 @@ Inode::TransactionDone(bool success)
 		// Revert any changes made to the cached bfs_inode
 		// TODO: return code gets eaten
 		UpdateNodeFromDisk();
+	} else if (fDelayedSize != 0 && !HasDelayedAllocation()) {
+		// the delayed allocation is now on disk
+		fVolume->UnreserveBlocks(fReservedBlocks);
+		fReservedBlocks = 0;
+		fDelayedSize = 0;
 	}
 }
 
@@ -91,7 +91,9 @@ public:
 			uint32				Type() const { return fNode.Type(); }
 			int32				Flags() const { return fNode.Flags(); }
 
-			off_t				Size() const { return fNode.data.Size(); }
+			off_t				Size() const
+									{ return HasDelayedAllocation()
+										? fDelayedSize : fNode.data.Size(); }
 			off_t				AllocatedSize() const;
 			off_t				LastModified() const
 									{ return fNode.LastModifiedTime(); }
@@ -156,6 +158,11 @@ public:
 			status_t			TrimPreallocation(Transaction& transaction);
 			bool				NeedsTrimming() const;
 
+			bool				HasDelayedAllocation() const
+									{ return fDelayedSize
+										> fNode.data.Size(); }
+			status_t			AllocateDelayedBlocks(bool canWait = true);
+
 			status_t			Free(Transaction& transaction);
 			status_t			Sync();
 
@@ -254,6 +261,11 @@ private:
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
 
+			status_t			_DelayAllocation(off_t size);
+			status_t			_AllocateDelayedBlocks(
+									Transaction& transaction);
+			void				_CancelDelayedAllocation();
+
 private:
 			rw_lock				fLock;
 			Volume*				fVolume;
@@ -269,6 +281,11 @@ private:
 				// we need those values to ensure we will remove
 				// the correct keys from the indices
 
+			off_t				fDelayedSize;
+			off_t				fReservedBlocks;
+				// the file size including data that has not been
+				// allocated yet, and the blocks reserved for it
+
 			mutable recursive_lock fSmallDataLock;
 			SinglyLinkedList<AttributeIterator> fIterators;
 };
@@ -407,10 +407,14 @@ Journal::Journal(Volume* volume)
 	fUsed(0),
 	fUnwrittenTransactions(0),
 	fHasSubtransaction(false),
-	fSeparateSubTransactions(false)
+	fSeparateSubTransactions(false),
+	fFlushRequests(0),
+	fFlushedRequests(0),
+	fFlushStatus(B_OK)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
+	mutex_init(&fFlushLock, "bfs journal flush");
 
 	fLogFlusherSem = create_sem(0, "bfs log flusher");
 	fLogFlusher = spawn_kernel_thread(&Journal::_LogFlusher, "bfs log flusher",
@@ -426,6 +430,7 @@ Journal::~Journal()
 
 	recursive_lock_destroy(&fLock);
 	mutex_destroy(&fEntriesLock);
+	mutex_destroy(&fFlushLock);
 
 	sem_id logFlusher = fLogFlusherSem;
 	fLogFlusherSem = -1;
@@ -924,7 +929,9 @@ Journal::_WriteTransactionToLog()
 
 
 /*!	Flushes the current log entry to disk. If \a flushBlocks is \c true it will
-	also write back all dirty blocks for this volume.
+	also write back all dirty blocks for this volume; that happens without
+	holding the journal lock, so that new transactions don't have to wait for
+	it.
 */
 status_t
 Journal::_FlushLog(bool canWait, bool flushBlocks)
@@ -948,14 +955,38 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 			FATAL(("writing current log entry failed: %s\n", strerror(status)));
 	}
 
+	recursive_lock_unlock(&fLock);
+
 	if (flushBlocks)
-		status = fVolume->FlushDevice();
+		status = _FlushDevice();
 
-	recursive_lock_unlock(&fLock);
 	return status;
 }
 
 
+/*!	Writes back all dirty blocks of the volume. Concurrent callers are
+	batched: if another thread started a flush after this one asked for it,
+	that flush covers this request as well, and its result is returned
+	instead of writing back the blocks once more.
+*/
+status_t
+Journal::_FlushDevice()
+{
+	int32 request = atomic_add(&fFlushRequests, 1) + 1;
+
+	MutexLocker locker(fFlushLock);
+
+	if ((int32)((uint32)fFlushedRequests - (uint32)request) >= 0) {
+		// someone else did the work for us in the mean time
+		return fFlushStatus;
+	}
+
+	fFlushedRequests = atomic_get(&fFlushRequests);
+	fFlushStatus = fVolume->FlushDevice();
+	return fFlushStatus;
+}
+
+
 /*!	Flushes the current log entry to disk, and also writes back all dirty
 	blocks for this volume (completing all open transactions).
 */
@@ -967,9 +998,10 @@ Journal::FlushLogAndBlocks()
 
 
 status_t
-Journal::Lock(Transaction* owner, bool separateSubTransactions)
+Journal::Lock(Transaction* owner, bool separateSubTransactions, bool canWait)
 {
-	status_t status = recursive_lock_lock(&fLock);
+	status_t status = canWait ? recursive_lock_lock(&fLock)
+		: recursive_lock_trylock(&fLock);
 	if (status != B_OK)
 		return status;
 
@@ -1164,22 +1196,35 @@ TransactionListener::~TransactionListener()
 }
 
 
+/*!	Called when the transaction the listener has been added to was nested
+	in \a transaction, and has been merged into it.
+*/
+void
+TransactionListener::MovedToTransaction(Transaction* transaction)
+{
+}
+
+
 //	#pragma mark - Transaction
 
 
 status_t
-Transaction::Start(Volume* volume, off_t refBlock)
+Transaction::Start(Volume* volume, off_t refBlock, bool canWait)
 {
 	// has it already been started?
 	if (fJournal != NULL)
 		return B_OK;
 
+	status_t status = B_ERROR;
 	fJournal = volume->GetJournal(refBlock);
-	if (fJournal != NULL && fJournal->Lock(this, false) == B_OK)
-		return B_OK;
+	if (fJournal != NULL) {
+		status = fJournal->Lock(this, false, canWait);
+		if (status == B_OK)
+			return B_OK;
+	}
 
 	fJournal = NULL;
-	return B_ERROR;
+	return status == B_WOULD_BLOCK ? B_WOULD_BLOCK : B_ERROR;
 }
 
 
@@ -1222,5 +1267,6 @@ Transaction::MoveListenersTo(Transaction* transaction)
 {
 	while (TransactionListener* listener = fListeners.RemoveHead()) {
 		transaction->fListeners.Add(listener);
+		listener->MovedToTransaction(transaction);
 	}
 }
@@ -26,7 +26,8 @@ public:
 			status_t		InitCheck();
 
 			status_t		Lock(Transaction* owner,
-								bool separateSubTransactions);
+								bool separateSubTransactions,
+								bool canWait = true);
 			status_t		Unlock(Transaction* owner, bool success);
 
 			status_t		ReplayLog();
@@ -50,6 +51,7 @@ private:
 								{ return fHasSubtransaction; }
 
 			status_t		_FlushLog(bool canWait, bool flushBlocks);
+			status_t		_FlushDevice();
 			uint32			_TransactionSize() const;
 			status_t		_WriteTransactionToLog();
 			status_t		_CheckRunArray(const run_array* array);
@@ -79,6 +81,11 @@ private:
 
 			thread_id		fLogFlusher;
 			sem_id			fLogFlusherSem;
+
+			mutex			fFlushLock;
+			int32			fFlushRequests;
+			int32			fFlushedRequests;
+			status_t		fFlushStatus;
 };
 
 
@@ -99,6 +106,7 @@ public:
 
 	virtual void				TransactionDone(bool success) = 0;
 	virtual void				RemovedFromTransaction() = 0;
+	virtual void				MovedToTransaction(Transaction* transaction);
 };
 
 typedef DoublyLinkedList<TransactionListener> TransactionListeners;
@@ -135,7 +143,7 @@ public:
 			fJournal->Unlock(this, false);
 	}
 
-	status_t Start(Volume* volume, off_t refBlock);
+	status_t Start(Volume* volume, off_t refBlock, bool canWait = true);
 	bool IsStarted() const { return fJournal != NULL; }
 
 	status_t Done()
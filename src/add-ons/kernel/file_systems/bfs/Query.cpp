@@ -13,8 +13,13 @@
 */
 
 
+// This needs to be the first include because of the fs shell API wrapper
+#include <algorithm>
+
 #include "Query.h"
 
+#include <stdarg.h>
+
 #include <file_systems/QueryParserUtils.h>
 #include <query_private.h>
 
@@ -70,6 +75,42 @@ union value {
 };
 
 
+// The query planner estimates the cost of a term in units of index keys that
+// have to be read; every candidate that passes the index has to be loaded to
+// be matched against the rest of the query, which is much more expensive.
+static const off_t kKeyCost = 1;
+static const off_t kInodeCost = 32;
+
+// the maximum number of entries an index may contribute to an intersection
+static const int32 kMaxIntersectionEntries = 16384;
+
+// number of entries assumed when the "name" index cannot be sampled
+static const off_t kDefaultEntries = 10000;
+
+
+class PlanWriter;
+
+
+/*!	A sorted set of inode IDs, used to intersect the entries of an index with
+	those of the index that is scanned without having to load any inodes.
+*/
+class InodeIDSet {
+public:
+								InodeIDSet();
+								~InodeIDSet();
+
+			status_t			Add(ino_t id);
+			void				Sort();
+			bool				Contains(ino_t id) const;
+			int32				CountIDs() const { return fCount; }
+
+private:
+			ino_t*				fIDs;
+			int32				fCount;
+			int32				fSize;
+};
+
+
 /*!	Abstract base class for the operator/equation classes.
 */
 class Term {
@@ -88,8 +129,19 @@ public:
 									size_t size = 0) = 0;
 	virtual	void				Complement() = 0;
 
-	virtual	void				CalculateScore(Index& index) = 0;
-	virtual	int32				Score() const = 0;
+	virtual	void				CalculateCost(Index& index,
+									off_t totalEntries,
+									bool queryNonIndexed) = 0;
+	virtual	off_t				Cost() const = 0;
+									// to retrieve all entries via this term
+	virtual	off_t				Rows() const = 0;
+									// estimated number of matching entries
+	virtual	bool				HasIndex() const = 0;
+									// if the entries can be retrieved via
+									// an index
+
+	virtual	void				Explain(PlanWriter& writer, int32 level,
+									bool scanned) const = 0;
 
 	virtual	status_t			InitCheck() = 0;
 
@@ -108,7 +160,7 @@ protected:
 	Although an Equation object is quite independent from the volume on which
 	the query is run, there are some dependencies that are produced while
 	querying:
-	The type/size of the value, the score, and if it has an index or not.
+	The type/size of the value, the cost, and if it has an index or not.
 	So you could run more than one query on the same volume, but it might return
 	wrong values when it runs concurrently on another volume.
 	That's not an issue right now, because we run single-threaded and don't use
@@ -132,10 +184,23 @@ public:
 									bool queryNonIndexed);
 			status_t			GetNextMatching(Volume* volume,
 									TreeIterator* iterator,
-									struct dirent* dirent, size_t bufferSize);
+									struct dirent* dirent, size_t bufferSize,
+									const InodeIDSet* filter);
+			status_t			CollectMatching(Volume* volume,
+									InodeIDSet& set);
 
-	virtual	void				CalculateScore(Index &index);
-	virtual	int32				Score() const { return fScore; }
+	virtual	void				CalculateCost(Index& index,
+									off_t totalEntries,
+									bool queryNonIndexed);
+	virtual	off_t				Cost() const { return fCost; }
+	virtual	off_t				Rows() const { return fRows; }
+	virtual	bool				HasIndex() const { return fHasIndex; }
+
+			void				PlanIntersection(off_t totalEntries);
+			Equation*			Intersection() const { return fIntersection; }
+
+	virtual	void				Explain(PlanWriter& writer, int32 level,
+									bool scanned) const;
 
 #ifdef DEBUG
 	virtual	void				PrintToStream();
@@ -153,6 +218,11 @@ private:
 			status_t			_ConvertValue(type_code type);
 			bool				_CompareTo(const uint8* value, uint16 size);
 			uint8*				_Value() const { return (uint8*)&fValue; }
+			status_t			_GetNextCandidate(TreeIterator* iterator,
+									off_t* _offset);
+			uint32				_KeyPosition(
+									const bplustree_statistics& statistics,
+									const uint8* key, uint16 size) const;
 
 private:
 			char*				fAttribute;
@@ -163,8 +233,14 @@ private:
 			bool				fIsPattern;
 			bool				fIsSpecialTime;
 
-			int32				fScore;
 			bool				fHasIndex;
+			off_t				fIndexEntries;
+			off_t				fIndexKeys;
+			off_t				fScanned;
+			off_t				fRows;
+			off_t				fCost;
+			Equation*			fIntersection;
+			off_t				fIntersectedCost;
 };
 
 
@@ -178,6 +254,7 @@ public:
 
 			Term*				Left() const { return fLeft; }
 			Term*				Right() const { return fRight; }
+			Term*				Driver() const;
 
 	virtual	status_t			Match(Inode* inode,
 									const char* attribute = NULL,
@@ -185,8 +262,15 @@ public:
 									size_t size = 0);
 	virtual	void				Complement();
 
-	virtual	void				CalculateScore(Index& index);
-	virtual	int32				Score() const;
+	virtual	void				CalculateCost(Index& index,
+									off_t totalEntries,
+									bool queryNonIndexed);
+	virtual	off_t				Cost() const { return fCost; }
+	virtual	off_t				Rows() const { return fRows; }
+	virtual	bool				HasIndex() const;
+
+	virtual	void				Explain(PlanWriter& writer, int32 level,
+									bool scanned) const;
 
 	virtual	status_t			InitCheck();
 
@@ -202,9 +286,147 @@ private:
 private:
 			Term*				fLeft;
 			Term*				fRight;
+			off_t				fCost;
+			off_t				fRows;
+			bool				fQueryNonIndexed;
 };
 
 
+/*!	Writes the indented lines of a query plan into a fixed size buffer,
+	silently truncating it when it gets too long.
+*/
+class PlanWriter {
+public:
+								PlanWriter(char* buffer, size_t size);
+
+			void				Print(int32 level, const char* format, ...);
+			bool				IsTruncated() const { return fTruncated; }
+
+private:
+			char*				fBuffer;
+			size_t				fSize;
+			size_t				fLength;
+			bool				fTruncated;
+};
+
+
+static const char*
+equation_symbol(int8 op)
+{
+	switch (op) {
+		case OP_EQUAL:
+			return "==";
+		case OP_UNEQUAL:
+			return "!=";
+		case OP_GREATER_THAN:
+			return ">";
+		case OP_GREATER_THAN_OR_EQUAL:
+			return ">=";
+		case OP_LESS_THAN:
+			return "<";
+		case OP_LESS_THAN_OR_EQUAL:
+			return "<=";
+	}
+	return "???";
+}
+
+
+//	#pragma mark -
+
+
+InodeIDSet::InodeIDSet()
+	:
+	fIDs(NULL),
+	fCount(0),
+	fSize(0)
+{
+}
+
+
+InodeIDSet::~InodeIDSet()
+{
+	free(fIDs);
+}
+
+
+status_t
+InodeIDSet::Add(ino_t id)
+{
+	if (fCount == fSize) {
+		if (fSize >= kMaxIntersectionEntries)
+			return B_BUFFER_OVERFLOW;
+
+		int32 size = fSize == 0 ? 256 : fSize * 2;
+		ino_t* ids = (ino_t*)realloc(fIDs, size * sizeof(ino_t));
+		if (ids == NULL)
+			return B_NO_MEMORY;
+
+		fIDs = ids;
+		fSize = size;
+	}
+
+	fIDs[fCount++] = id;
+	return B_OK;
+}
+
+
+void
+InodeIDSet::Sort()
+{
+	std::sort(fIDs, fIDs + fCount);
+}
+
+
+bool
+InodeIDSet::Contains(ino_t id) const
+{
+	return std::binary_search(fIDs, fIDs + fCount, id);
+}
+
+
+//	#pragma mark -
+
+
+PlanWriter::PlanWriter(char* buffer, size_t size)
+	:
+	fBuffer(buffer),
+	fSize(size),
+	fLength(0),
+	fTruncated(false)
+{
+	if (fSize > 0)
+		fBuffer[0] = '\0';
+}
+
+
+void
+PlanWriter::Print(int32 level, const char* format, ...)
+{
+	if (fTruncated || fLength + 2 * level + 2 > fSize) {
+		fTruncated = true;
+		return;
+	}
+
+	memset(fBuffer + fLength, ' ', 2 * level);
+	fLength += 2 * level;
+
+	va_list args;
+	va_start(args, format);
+	size_t length = vsnprintf(fBuffer + fLength, fSize - fLength - 1, format,
+		args);
+	va_end(args);
+
+	if (fLength + length + 2 > fSize) {
+		fTruncated = true;
+		length = fSize - fLength - 2;
+	}
+
+	fLength += length;
+	fBuffer[fLength++] = '\n';
+	fBuffer[fLength] = '\0';
+}
+
+
 //	#pragma mark -
 
 
@@ -214,7 +436,15 @@ Equation::Equation(char** _expression)
 	fAttribute(NULL),
 	fString(NULL),
 	fType(0),
-	fIsPattern(false)
+	fIsPattern(false),
+	fHasIndex(false),
+	fIndexEntries(0),
+	fIndexKeys(0),
+	fScanned(0),
+	fRows(0),
+	fCost(0),
+	fIntersection(NULL),
+	fIntersectedCost(0)
 {
 	char* string = *_expression;
 	char* start = string;
@@ -578,36 +808,17 @@ Equation::PrepareQuery(Volume* /*volume*/, Index& index,
 
 status_t
 Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
-	struct dirent* dirent, size_t bufferSize)
+	struct dirent* dirent, size_t bufferSize, const InodeIDSet* filter)
 {
 	while (true) {
-		union value indexValue;
-		uint16 keyLength;
-		uint16 duplicate;
 		off_t offset;
-
-		status_t status = iterator->GetNextEntry(&indexValue, &keyLength,
-			(uint16)sizeof(indexValue), &offset, &duplicate);
+		status_t status = _GetNextCandidate(iterator, &offset);
 		if (status != B_OK)
 			return status;
 
-		// only compare against the index entry when this is the correct
-		// index for the equation
-		if (fHasIndex && duplicate < 2
-			&& !_CompareTo((uint8*)&indexValue, keyLength)) {
-			// They aren't equal? Let the operation decide what to do. Since
-			// we always start at the beginning of the index (or the correct
-			// position), only some needs to be stopped if the entry doesn't
-			// fit.
-			if (fOp == OP_LESS_THAN
-				|| fOp == OP_LESS_THAN_OR_EQUAL
-				|| (fOp == OP_EQUAL && !fIsPattern))
-				return B_ENTRY_NOT_FOUND;
-
-			if (duplicate > 0)
-				iterator->SkipDuplicates();
+		// skip entries that cannot match the intersected index anyway
+		if (filter != NULL && !filter->Contains(offset))
 			continue;
-		}
 
 		Vnode vnode(volume, offset);
 		Inode* inode;
@@ -684,37 +895,219 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 }
 
 
+/*!	Collects the IDs of all entries of the equation's index that match the
+	equation into \a set, without loading their inodes.
+	Fails if the equation cannot be evaluated via its index, or if there are
+	too many matching entries.
+*/
+status_t
+Equation::CollectMatching(Volume* volume, InodeIDSet& set)
+{
+	if (fOp == OP_UNEQUAL)
+		return B_BAD_VALUE;
+
+	Index index(volume);
+	TreeIterator* iterator = NULL;
+	status_t status = PrepareQuery(volume, index, &iterator, false);
+	if (iterator == NULL || !fHasIndex) {
+		delete iterator;
+		return status != B_OK ? status : B_BAD_VALUE;
+	}
+	if (status != B_OK && status != B_ENTRY_NOT_FOUND) {
+		delete iterator;
+		return status;
+	}
+
+	while (true) {
+		off_t offset;
+		status = _GetNextCandidate(iterator, &offset);
+		if (status != B_OK)
+			break;
+
+		status = set.Add(offset);
+		if (status != B_OK) {
+			delete iterator;
+			return status;
+		}
+	}
+
+	delete iterator;
+
+	if (status != B_ENTRY_NOT_FOUND)
+		return status;
+
+	set.Sort();
+	return B_OK;
+}
+
+
+/*!	Estimates the number of entries that match the equation, and the cost
+	to retrieve them when the query is driven by this equation, based on
+	the statistics of its index.
+*/
+void
+Equation::CalculateCost(Index& index, off_t totalEntries,
+	bool queryNonIndexed)
+{
+	bplustree_statistics statistics;
+	fHasIndex = fOp != OP_UNEQUAL && index.SetTo(fAttribute) == B_OK
+		&& index.Node()->Tree() != NULL
+		&& index.Node()->Tree()->GetStatistics(statistics) == B_OK
+		&& _ConvertValue(index.Type()) == B_OK;
+
+	if (!fHasIndex) {
+		// We have to go through the whole "name" index, and need to load
+		// every single inode to match it
+		fIndexEntries = 0;
+		fIndexKeys = 0;
+		fScanned = totalEntries;
+		fCost = totalEntries * (kKeyCost + kInodeCost) + 1;
+
+		switch (fOp) {
+			case OP_EQUAL:
+				fRows = totalEntries / (fIsPattern ? 8 : 16);
+				break;
+			case OP_UNEQUAL:
+				fRows = totalEntries / 2;
+				break;
+			default:
+				fRows = totalEntries / 3;
+				break;
+		}
+		return;
+	}
+
+	fIndexEntries = statistics.entries;
+	fIndexKeys = statistics.keys;
+
+	// the entries sharing the same key
+	off_t duplicates = fIndexKeys > 0 ? max_c(1, fIndexEntries / fIndexKeys)
+		: 0;
+
+	uint8* value = _Value();
+	off_t shiftedTime;
+	if (fIsSpecialTime) {
+		// the index contains shifted values
+		shiftedTime = fValue.Int64 << INODE_TIME_SHIFT;
+		value = (uint8*)&shiftedTime;
+	}
+
+	if (fIsPattern) {
+		int32 prefixLength = getFirstPatternSymbol(fString);
+		if (prefixLength > 0) {
+			// Only the keys starting with the prefix need to be scanned
+			uint8 upper[MAX_INDEX_KEY_LENGTH + 1];
+			memcpy(upper, fValue.String, prefixLength);
+			upper[prefixLength] = 0xff;
+
+			uint32 first = _KeyPosition(statistics, value, prefixLength);
+			uint32 last = _KeyPosition(statistics, upper, prefixLength + 1);
+			fScanned = max_c(duplicates,
+				(fIndexEntries * (last - first)) >> 16);
+			fRows = fScanned;
+		} else {
+			// The pattern does not help positioning in the index, but
+			// the keys can still be matched without loading the inodes
+			fScanned = fIndexEntries;
+			fRows = fIndexEntries / 8;
+		}
+	} else {
+		uint32 position = _KeyPosition(statistics, value, fSize);
+
+		switch (fOp) {
+			case OP_EQUAL:
+				fScanned = duplicates;
+				break;
+			case OP_GREATER_THAN:
+			case OP_GREATER_THAN_OR_EQUAL:
+				fScanned = (fIndexEntries * (65536 - position)) >> 16;
+				break;
+			default:
+				fScanned = (fIndexEntries * position) >> 16;
+				break;
+		}
+		fScanned = max_c(fScanned, duplicates);
+		fRows = fScanned;
+	}
+
+	fCost = fScanned * kKeyCost + fRows * kInodeCost;
+}
+
+
+/*!	Chooses another indexed equation this equation can be intersected with,
+	when it is used to drive the query: all terms that are combined with it
+	via && must match, too, so entries that are not part of their index can
+	be skipped before their inode is loaded.
+	Only the indices that contain every entry that could match are used:
+	the "size" and "last_modified" indices don't contain directories and
+	symlinks, but Match() evaluates them from the inode of any entry.
+	The intersection is only used if building it is cheaper than the inodes
+	it is expected to save.
+*/
 void
-Equation::CalculateScore(Index &index)
+Equation::PlanIntersection(off_t totalEntries)
 {
-	// As always, these values could be tuned and refined.
-	// And the code could also need some real world testing :-)
+	fIntersection = NULL;
+	fIntersectedCost = fCost;
 
-	// do we have to operate on a "foreign" index?
-	if (fOp == OP_UNEQUAL || index.SetTo(fAttribute) < B_OK) {
-		fScore = 0;
+	if (totalEntries <= 0)
 		return;
+
+	for (Term* term = this; term->Parent() != NULL; term = term->Parent()) {
+		Operator* parent = (Operator*)term->Parent();
+		if (parent->Op() != OP_AND)
+			continue;
+
+		Term* other = parent->Left() == term ? parent->Right() : parent->Left();
+		if (other->Op() <= OP_EQUATION)
+			continue;
+
+		Equation* equation = (Equation*)other;
+		if (!equation->fHasIndex || equation->fRows > kMaxIntersectionEntries
+			|| !strcmp(equation->fAttribute, "size")
+			|| !strcmp(equation->fAttribute, "last_modified")) {
+			continue;
+		}
+
+		// The inodes we don't have to load anymore, minus the index keys we
+		// have to read in addition
+		off_t rows = min_c(totalEntries, equation->fRows);
+		off_t candidates = fRows * rows / totalEntries;
+		off_t cost = fScanned * kKeyCost + equation->fScanned * kKeyCost
+			+ candidates * kInodeCost;
+
+		if (cost < fIntersectedCost) {
+			fIntersection = equation;
+			fIntersectedCost = cost;
+		}
 	}
+}
+
 
-	// if we have a pattern, how much does it help our search?
-	if (fIsPattern)
-		fScore = getFirstPatternSymbol(fString) << 3;
-	else {
-		// Score by operator
-		if (fOp == OP_EQUAL)
-			// higher than pattern="255 chars+*"
-			fScore = 2048;
-		else
-			// the pattern search is regarded cheaper when you have at
-			// least one character to set your index to
-			fScore = 5;
+void
+Equation::Explain(PlanWriter& writer, int32 level, bool scanned) const
+{
+	writer.Print(level, "%s \"%s\" %s \"%s\": %" B_PRIdOFF " entries",
+		scanned ? "scan" : "match", fAttribute, equation_symbol(fOp), fString,
+		fRows);
+
+	if (!scanned)
+		return;
+
+	if (fHasIndex) {
+		writer.Print(level + 1, "index \"%s\": %" B_PRIdOFF " entries, %"
+			B_PRIdOFF " keys, reads %" B_PRIdOFF " keys, cost %" B_PRIdOFF,
+			fAttribute, fIndexEntries, fIndexKeys, fScanned, fCost);
+	} else {
+		writer.Print(level + 1, "no index, reads all %" B_PRIdOFF " entries "
+			"of \"name\", cost %" B_PRIdOFF, fScanned, fCost);
 	}
 
-	// take index size into account (1024 is the current node size
-	// in our B+trees)
-	// 2048 * 2048 == 4194304 is the maximum score (for an empty
-	// tree, since the header + 1 node are already 2048 bytes)
-	fScore = fScore * ((2048 * 1024LL) / index.Node()->Size());
+	if (fIntersection != NULL) {
+		writer.Print(level + 1, "intersect with index \"%s\": %" B_PRIdOFF
+			" entries, cost %" B_PRIdOFF, fIntersection->fAttribute,
+			fIntersection->fRows, fIntersectedCost);
+	}
 }
 
 
@@ -845,6 +1238,72 @@ Equation::_ConvertValue(type_code type)
 }
 
 
+/*!	Returns the relative position of \a key within the keys of the index,
+	from 0 to 65536, based on the histogram in \a statistics.
+	A key falling between two histogram keys is assumed to lie in the middle
+	between them.
+*/
+uint32
+Equation::_KeyPosition(const bplustree_statistics& statistics,
+	const uint8* key, uint16 size) const
+{
+	uint32 count = statistics.histogram_count;
+	uint32 below = 0;
+	uint32 equal = 0;
+
+	for (uint32 i = 0; i < count; i++) {
+		int32 compare = compareKeys(fType, statistics.histogram[i].data,
+			statistics.histogram[i].length, key, size);
+		if (compare < 0)
+			below++;
+		else if (compare == 0)
+			equal++;
+	}
+
+	return ((2 * below + equal + 1) << 16) / (2 * (count + 1));
+}
+
+
+/*!	Returns the offset of the next entry of the index that passes the
+	equation, as far as this can be decided by its key alone.
+	Returns B_ENTRY_NOT_FOUND when there are no more such entries.
+*/
+status_t
+Equation::_GetNextCandidate(TreeIterator* iterator, off_t* _offset)
+{
+	while (true) {
+		union value indexValue;
+		uint16 keyLength;
+		uint16 duplicate;
+
+		status_t status = iterator->GetNextEntry(&indexValue, &keyLength,
+			(uint16)sizeof(indexValue), _offset, &duplicate);
+		if (status != B_OK)
+			return status;
+
+		// only compare against the index entry when this is the correct
+		// index for the equation
+		if (fHasIndex && duplicate < 2
+			&& !_CompareTo((uint8*)&indexValue, keyLength)) {
+			// They aren't equal? Let the operation decide what to do. Since
+			// we always start at the beginning of the index (or the correct
+			// position), only some needs to be stopped if the entry doesn't
+			// fit.
+			if (fOp == OP_LESS_THAN
+				|| fOp == OP_LESS_THAN_OR_EQUAL
+				|| (fOp == OP_EQUAL && !fIsPattern))
+				return B_ENTRY_NOT_FOUND;
+
+			if (duplicate > 0)
+				iterator->SkipDuplicates();
+			continue;
+		}
+
+		return B_OK;
+	}
+}
+
+
 /*!	Returns true when the key matches the equation. You have to
 	call ConvertValue() before this one.
 */
@@ -895,7 +1354,10 @@ Operator::Operator(Term* left, int8 op, Term* right)
 	:
 	Term(op),
 	fLeft(left),
-	fRight(right)
+	fRight(right),
+	fCost(0),
+	fRows(0),
+	fQueryNonIndexed(false)
 {
 	if (left)
 		left->SetParent(this);
@@ -922,15 +1384,15 @@ Operator::Match(Inode* inode, const char* attribute, int32 type,
 
 		return fRight->Match(inode, attribute, type, key, size);
 	} else {
-		// choose the term with the better score for OP_OR
+		// for OP_OR, start with the term that is more likely to match
 		Term* first;
 		Term* second;
-		if (fRight->Score() > fLeft->Score()) {
-			first = fLeft;
-			second = fRight;
-		} else {
+		if (fRight->Rows() > fLeft->Rows()) {
 			first = fRight;
 			second = fLeft;
+		} else {
+			first = fLeft;
+			second = fRight;
 		}
 
 		status_t status = first->Match(inode, attribute, type, key, size);
@@ -955,30 +1417,68 @@ Operator::Complement()
 }
 
 
-void
-Operator::CalculateScore(Index &index)
+/*!	Returns the term that is used to retrieve the entries of an OP_AND
+	operator; the other term is only matched against them.
+	Unless non-indexed queries are allowed, a term without an index would
+	not retrieve anything, so the other term is used, whatever the costs
+	say; they are only estimates, after all.
+*/
+Term*
+Operator::Driver() const
+{
+	if (!fQueryNonIndexed && fLeft->HasIndex() != fRight->HasIndex())
+		return fLeft->HasIndex() ? fLeft : fRight;
+
+	if (fRight->Cost() < fLeft->Cost())
+		return fRight;
+
+	return fLeft;
+}
+
+
+bool
+Operator::HasIndex() const
 {
-	fLeft->CalculateScore(index);
-	fRight->CalculateScore(index);
+	if (fOp == OP_AND)
+		return fLeft->HasIndex() || fRight->HasIndex();
+
+	return fLeft->HasIndex() && fRight->HasIndex();
 }
 
 
-int32
-Operator::Score() const
+void
+Operator::CalculateCost(Index& index, off_t totalEntries,
+	bool queryNonIndexed)
 {
-	if (fOp == OP_AND) {
-		// return the one with the better score
-		if (fRight->Score() > fLeft->Score())
-			return fRight->Score();
+	fQueryNonIndexed = queryNonIndexed;
+	fLeft->CalculateCost(index, totalEntries, queryNonIndexed);
+	fRight->CalculateCost(index, totalEntries, queryNonIndexed);
 
-		return fLeft->Score();
+	if (fOp == OP_AND) {
+		// only the cheaper term needs to be retrieved, and we assume the
+		// terms to be independent from each other
+		fCost = Driver()->Cost();
+		fRows = totalEntries > 0
+			? fLeft->Rows() * fRight->Rows() / totalEntries : 0;
+	} else {
+		// for OP_OR, both terms have to be retrieved
+		fCost = fLeft->Cost() + fRight->Cost();
+		fRows = min_c(totalEntries, fLeft->Rows() + fRight->Rows());
 	}
+}
 
-	// for OP_OR, be honest, and return the one with the worse score
-	if (fRight->Score() < fLeft->Score())
-		return fRight->Score();
 
-	return fLeft->Score();
+void
+Operator::Explain(PlanWriter& writer, int32 level, bool scanned) const
+{
+	writer.Print(level, "%s: %" B_PRIdOFF " entries, cost %" B_PRIdOFF,
+		fOp == OP_AND ? "and" : "or", fRows, fCost);
+
+	Term* driver = fOp == OP_AND ? Driver() : NULL;
+	fLeft->Explain(writer, level + 1,
+		scanned && (driver == NULL || driver == fLeft));
+	fRight->Explain(writer, level + 1,
+		scanned && (driver == NULL || driver == fRight));
 }
 
 
@@ -1060,16 +1560,7 @@ Operator::PrintToStream()
 void
 Equation::PrintToStream()
 {
-	const char* symbol = "???";
-	switch (fOp) {
-		case OP_EQUAL: symbol = "=="; break;
-		case OP_UNEQUAL: symbol = "!="; break;
-		case OP_GREATER_THAN: symbol = ">"; break;
-		case OP_GREATER_THAN_OR_EQUAL: symbol = ">="; break;
-		case OP_LESS_THAN: symbol = "<"; break;
-		case OP_LESS_THAN_OR_EQUAL: symbol = "<="; break;
-	}
-	__out("[\"%s\" %s \"%s\"]", fAttribute, symbol, fString);
+	__out("[\"%s\" %s \"%s\"]", fAttribute, equation_symbol(fOp), fString);
 }
 
 #endif	// DEBUG
@@ -1235,6 +1726,8 @@ Query::Query(Volume* volume, Expression* expression, uint32 flags)
 	fCurrent(NULL),
 	fIterator(NULL),
 	fIndex(volume),
+	fFilter(NULL),
+	fTotalEntries(0),
 	fFlags(flags),
 	fPort(-1)
 {
@@ -1244,8 +1737,16 @@ Query::Query(Volume* volume, Expression* expression, uint32 flags)
 	if (volume == NULL || expression == NULL || expression->Root() == NULL)
 		return;
 
-	// create index on the stack and delete it afterwards
-	fExpression->Root()->CalculateScore(fIndex);
+	// every entry has a name, so the "name" index knows how many there are
+	bplustree_statistics statistics;
+	if (fIndex.SetTo("name") == B_OK && fIndex.Node()->Tree() != NULL
+		&& fIndex.Node()->Tree()->GetStatistics(statistics) == B_OK)
+		fTotalEntries = statistics.entries;
+	else
+		fTotalEntries = kDefaultEntries;
+
+	fExpression->Root()->CalculateCost(fIndex, fTotalEntries,
+		(fFlags & B_QUERY_NON_INDEXED) != 0);
 	fIndex.Unset();
 
 	Rewind();
@@ -1259,6 +1760,9 @@ Query::~Query()
 {
 	if ((fFlags & B_LIVE_QUERY) != 0)
 		fVolume->RemoveQuery(this);
+
+	delete fIterator;
+	delete fFilter;
 }
 
 
@@ -1273,6 +1777,9 @@ Query::Rewind()
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	delete fFilter;
+	fFilter = NULL;
+
 	// put the whole expression on the stack
 
 	Stack<Term*> stack;
@@ -1287,16 +1794,15 @@ Query::Rewind()
 				stack.Push(op->Left());
 				stack.Push(op->Right());
 			} else {
-				// For OP_AND, we can use the scoring system to decide which
-				// path to add
-				if (op->Right()->Score() > op->Left()->Score())
-					stack.Push(op->Right());
-				else
-					stack.Push(op->Left());
+				// For OP_AND, we only need to retrieve the cheaper path,
+				// the other one is matched against its entries
+				stack.Push(op->Driver());
 			}
 		} else if (term->Op() == OP_EQUATION
-			|| fStack.Push((Equation*)term) != B_OK)
+			|| fStack.Push((Equation*)term) != B_OK) {
 			FATAL(("Unknown term on stack or stack error"));
+		} else
+			((Equation*)term)->PlanIntersection(fTotalEntries);
 	}
 
 	return B_OK;
@@ -1323,16 +1829,31 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 
 			if (status != B_OK)
 				return status;
+
+			Equation* intersection = fCurrent->Intersection();
+			if (intersection != NULL) {
+				// this is only an optimization, so it's okay if it fails
+				fFilter = new(std::nothrow) InodeIDSet;
+				if (fFilter != NULL
+					&& intersection->CollectMatching(fVolume, *fFilter)
+						!= B_OK) {
+					delete fFilter;
+					fFilter = NULL;
+				}
+			}
 		}
 		if (fCurrent == NULL)
 			RETURN_ERROR(B_ERROR);
 
 		status_t status = fCurrent->GetNextMatching(fVolume, fIterator, dirent,
-			size);
+			size, fFilter);
 		if (status != B_OK) {
 			delete fIterator;
 			fIterator = NULL;
 			fCurrent = NULL;
+
+			delete fFilter;
+			fFilter = NULL;
 		} else {
 			// only return if we have another entry
 			return B_OK;
@@ -1341,6 +1862,25 @@ Query::GetNextEntry(struct dirent* dirent, size_t size)
 }
 
 
+/*!	Writes a textual description of how the query is executed to \a buffer:
+	which terms are retrieved via which index, which are only matched
+	against their entries, and the estimates the plan is based on.
+*/
+status_t
+Query::Explain(char* buffer, size_t size)
+{
+	if (fExpression == NULL || fExpression->Root() == NULL)
+		return B_NO_INIT;
+
+	PlanWriter writer(buffer, size);
+	writer.Print(0, "%" B_PRIdOFF " entries on volume, cost %" B_PRIdOFF,
+		fTotalEntries, fExpression->Root()->Cost());
+	fExpression->Root()->Explain(writer, 1, true);
+
+	return writer.IsTruncated() ? B_BUFFER_OVERFLOW : B_OK;
+}
+
+
 void
 Query::SetLiveMode(port_id port, int32 token)
 {
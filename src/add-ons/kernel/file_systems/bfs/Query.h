@@ -13,6 +13,7 @@
 class Volume;
 class Term;
 class Equation;
+class InodeIDSet;
 class TreeIterator;
 class Query;
 
@@ -51,6 +52,8 @@ public:
 			status_t		Rewind();
 			status_t		GetNextEntry(struct dirent* , size_t size);
 
+			status_t		Explain(char* buffer, size_t size);
+
 			void			SetLiveMode(port_id port, int32 token);
 			void			LiveUpdate(Inode* inode, const char* attribute,
 								int32 type, const uint8* oldKey,
@@ -70,6 +73,8 @@ private:
 			TreeIterator*	fIterator;
 			Index			fIndex;
 			Stack<Equation*> fStack;
+			InodeIDSet*		fFilter;
+			off_t			fTotalEntries;
 
 			uint32			fFlags;
 			port_id			fPort;
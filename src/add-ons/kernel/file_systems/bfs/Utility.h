@@ -133,4 +133,17 @@ is_directory(int mode)
 }
 
 
+/*!	Returns the next number of a xorshift32 pseudo random sequence, for
+	tests that need to be reproducible. \a state must not be 0.
+*/
+inline uint32
+xorshift32(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+
 #endif	// UTILITY_H
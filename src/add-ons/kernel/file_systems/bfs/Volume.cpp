@@ -16,6 +16,10 @@
 #include "Query.h"
 #include "Volume.h"
 
+#ifndef FS_SHELL
+#	include <low_resource_manager.h>
+#endif
+
 
 static const int32 kDesiredAllocationGroups = 56;
 	// This is the number of allocation groups that will be tried
@@ -124,6 +128,7 @@ Volume::Volume(fs_volume* volume)
 	fRootNode(NULL),
 	fIndicesNode(NULL),
 	fDirtyCachedBlocks(0),
+	fReservedBlocks(0),
 	fFlags(0),
 	fCheckingThread(-1),
 	fCheckVisitor(NULL)
@@ -395,6 +400,50 @@ Volume::AllocateForInode(Transaction& transaction, const Inode* parent,
 }
 
 
+/*!	Reserves \a numBlocks blocks for a delayed allocation. The blocks stay
+	free on disk, but AvailableBlocks() no longer counts them.
+*/
+status_t
+Volume::ReserveBlocks(off_t numBlocks)
+{
+	MutexLocker locker(fLock);
+
+	if (numBlocks > AvailableBlocks())
+		return B_DEVICE_FULL;
+
+	fReservedBlocks += numBlocks;
+	return B_OK;
+}
+
+
+void
+Volume::UnreserveBlocks(off_t numBlocks)
+{
+	MutexLocker locker(fLock);
+
+	ASSERT(numBlocks <= fReservedBlocks);
+	fReservedBlocks -= numBlocks;
+}
+
+
+/*!	Returns whether or not file writes may reserve their blocks, and leave the
+	actual allocation to the time the file cache writes the data back.
+*/
+bool
+Volume::CanDelayAllocation() const
+{
+#ifdef FS_SHELL
+	// the file cache of the fs_shell writes everything through right away
+	return false;
+#else
+	// When memory gets tight, the file cache writes through as well, and
+	// we would no longer profit from it
+	return !IsReadOnly()
+		&& low_resource_state(B_KERNEL_RESOURCE_PAGES) == B_NO_LOW_RESOURCE;
+#endif
+}
+
+
 status_t
 Volume::WriteSuperBlock()
 {
@@ -66,6 +66,10 @@ public:
 								{ return fSuperBlock.UsedBlocks(); }
 			off_t			FreeBlocks() const
 								{ return NumBlocks() - UsedBlocks(); }
+			off_t			AvailableBlocks() const
+								{ return FreeBlocks() - fReservedBlocks; }
+								// free blocks minus those reserved for
+								// delayed allocations
 			off_t			NumBitmapBlocks() const
 								{ return (NumBlocks() + fBlockSize * 8 - 1)
 									/ (fBlockSize * 8); }
@@ -114,6 +118,9 @@ public:
 								off_t numBlocks, block_run& run,
 								uint16 minimum = 1);
 			status_t		Free(Transaction& transaction, block_run run);
+			status_t		ReserveBlocks(off_t numBlocks);
+			void			UnreserveBlocks(off_t numBlocks);
+			bool			CanDelayAllocation() const;
 			void			SetCheckingThread(thread_id thread)
 								{ fCheckingThread = thread; }
 			bool			IsCheckingThread() const
@@ -171,6 +178,8 @@ protected:
 			Inode*			fIndicesNode;
 
 			vint32			fDirtyCachedBlocks;
+			off_t			fReservedBlocks;
+				// guarded by fLock
 
 			mutex			fQueryLock;
 			SinglyLinkedList<Query> fQueries;
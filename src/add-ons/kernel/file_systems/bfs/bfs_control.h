@@ -103,5 +103,61 @@ struct check_control {
  */
 #define BFS_IOCTL_RESIZE		14205
 
+/* Returns statistics about the free space of the volume, to measure its
+ * fragmentation. The parameter is a struct bfs_allocator_stats.
+ */
+#define BFS_IOCTL_ALLOCATOR_STATS	14206
+
+struct bfs_allocator_stats {
+	uint64		free_blocks;
+	uint64		free_ranges;
+	uint64		largest_free_range;
+	uint32		allocation_groups;
+	uint32		indexed_groups;
+};
+
+/* Describes how BFS would execute a query, and the estimates its choice is
+ * based on. The plan is returned as text, one term per line. The parameter
+ * is a struct bfs_explain_query.
+ */
+#define BFS_IOCTL_EXPLAIN_QUERY		14207
+
+struct bfs_explain_query {
+	const char*	query;
+	uint32		query_length;
+	uint32		flags;
+		/* B_QUERY_NON_INDEXED, if non-indexed attributes should be
+		 * considered */
+	char*		plan;
+	uint32		plan_size;
+};
+
+
+/* Adds the same random keys to two temporary B+trees, once one by one, and
+ * once sorted in a batch, for testing with bfs_shell. It is only supported
+ * there, and by debug builds of BFS. The parameter is a struct
+ * bfs_tree_benchmark.
+ */
+#define BFS_IOCTL_BENCHMARK_TREE	14208
+
+struct bfs_tree_benchmark_result {
+	bigtime_t	time;
+	uint64		nodes;
+	uint32		levels;
+	uint32		leaf_fill;
+		/* in percent of the leaf nodes' size */
+	uint32		valid;
+};
+
+struct bfs_tree_benchmark {
+	uint32		count;
+	uint32		distinct_keys;
+	uint32		key_length;
+		/* between 8 and 256 */
+	uint32		seed;
+	struct bfs_tree_benchmark_result insert;
+	struct bfs_tree_benchmark_result batch;
+};
+
 
 #endif	/* BFS_CONTROL_H */
@@ -226,7 +226,7 @@ bfs_read_fs_stat(fs_volume* _volume, struct fs_info* info)
 
 	info->block_size = volume->BlockSize();
 	info->total_blocks = volume->NumBlocks();
-	info->free_blocks = volume->FreeBlocks();
+	info->free_blocks = volume->AvailableBlocks();
 
 	// Volume name
 	strlcpy(info->volume_name, volume->Name(), sizeof(info->volume_name));
@@ -462,12 +462,16 @@ bfs_write_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	if (inode->FileCache() == NULL)
 		RETURN_ERROR(B_BAD_VALUE);
 
+	// the data to write back might not have any blocks yet
+	status_t status = inode->AllocateDelayedBlocks();
+	if (status != B_OK)
+		return status;
+
 	InodeReadLocker _(inode);
 
 	uint32 vecIndex = 0;
 	size_t vecOffset = 0;
 	size_t bytesLeft = *_numBytes;
-	status_t status;
 
 	while (true) {
 		file_io_vec fileVecs[8];
@@ -519,6 +523,20 @@ bfs_io(fs_volume* _volume, fs_vnode* _node, void* _cookie, io_request* request)
 		RETURN_ERROR(B_BAD_VALUE);
 	}
 
+#ifndef FS_SHELL
+	if (io_request_is_write(request)) {
+		// The data to write back might not have any blocks yet. Only the
+		// page writer must not wait for the journal; anyone else writing
+		// synchronously would just see the write fail.
+		status_t status = inode->AllocateDelayedBlocks(
+			!io_request_is_vip(request));
+		if (status != B_OK) {
+			notify_io_request(request, status);
+			return status;
+		}
+	}
+#endif
+
 	// We lock the node here and will unlock it in the "finished" hook.
 	rw_lock_read_lock(&inode->Lock());
 
@@ -550,15 +568,17 @@ bfs_get_file_map(fs_volume* _volume, fs_vnode* _node, off_t offset, size_t size,
 		vecs[index].length = ((uint32)run.Length() << blockShift)
 			- offset + fileOffset;
 
-		// are we already done?
+		// are we already done? (data that has not been allocated yet is
+		// not part of the map)
+		off_t fileSize = inode->Node().data.Size();
 		if ((uint64)size <= (uint64)vecs[index].length
 			|| (uint64)offset + (uint64)vecs[index].length
-				>= (uint64)inode->Size()) {
+				>= (uint64)fileSize) {
 			if ((uint64)offset + (uint64)vecs[index].length
-					> (uint64)inode->Size()) {
+					> (uint64)fileSize) {
 				// make sure the extent ends with the last official file
 				// block (without taking any preallocations into account)
-				vecs[index].length = round_up(inode->Size() - offset,
+				vecs[index].length = round_up(fileSize - offset,
 					volume->BlockSize());
 			}
 			*_count = index + 1;
@@ -581,6 +601,215 @@ bfs_get_file_map(fs_volume* _volume, fs_vnode* _node, off_t offset, size_t size,
 }
 
 
+#if defined(DEBUG) || defined(FS_SHELL)
+//	#pragma mark - B+tree benchmark
+
+
+static void
+benchmark_key(uint32& state, const bfs_tree_benchmark& benchmark, uint8* key)
+{
+	char number[9];
+	snprintf(number, sizeof(number), "%08" B_PRIx32,
+		xorshift32(state) % benchmark.distinct_keys);
+
+	// pad the keys to the requested length
+	memset(key, 'k', benchmark.key_length - 8);
+	memcpy(key + benchmark.key_length - 8, number, 8);
+}
+
+
+static off_t
+benchmark_value(Volume* volume, uint32 index)
+{
+	// the values only need to look like valid inode blocks
+	off_t first = volume->SuperBlock().LogEnd() + 1;
+	return first + index % (volume->NumBlocks() - first);
+}
+
+
+static status_t
+create_benchmark_tree(Volume* volume, Inode** _inode)
+{
+	Transaction transaction(volume, volume->ToBlock(volume->Root()));
+
+	status_t status = Inode::Create(transaction, NULL, NULL,
+		S_INDEX_DIR | S_STR_INDEX | S_DIRECTORY | 0700, 0, 0, NULL, NULL,
+		_inode);
+	if (status != B_OK)
+		return status;
+
+	return transaction.Done();
+}
+
+
+static void
+delete_benchmark_tree(Volume* volume, Inode* inode)
+{
+	Transaction transaction(volume, inode->BlockNumber());
+	inode->WriteLockInTransaction(transaction);
+
+	if (remove_vnode(volume->FSVolume(), inode->ID()) == B_OK) {
+		inode->Node().flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_DELETED);
+		inode->Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_IN_USE);
+		if (inode->WriteBack(transaction) == B_OK)
+			transaction.Done();
+	}
+
+	put_vnode(volume->FSVolume(), inode->ID());
+}
+
+
+static status_t
+measure_benchmark_tree(BPlusTree* tree, bfs_tree_benchmark_result& result)
+{
+	CachedNode cached(tree);
+	const bplustree_header* header = cached.SetToHeader();
+	if (header == NULL)
+		return B_IO_ERROR;
+
+	result.nodes = header->MaximumSize() / tree->NodeSize() - 1;
+	result.levels = header->MaxNumberOfLevels();
+	off_t offset = header->RootNode();
+
+	// find the leftmost leaf
+	const bplustree_node* node;
+	while ((node = cached.SetTo(offset)) != NULL && !node->IsLeaf()) {
+		offset = node->NumKeys() > 0
+			? BFS_ENDIAN_TO_HOST_INT64(node->Values()[0])
+			: node->OverflowLink();
+	}
+	if (node == NULL)
+		return B_IO_ERROR;
+
+	uint64 leaves = 0;
+	uint64 used = 0;
+	while (true) {
+		leaves++;
+		used += node->Used();
+
+		offset = node->RightLink();
+		if (offset == BPLUSTREE_NULL)
+			break;
+
+		node = cached.SetTo(offset);
+		if (node == NULL)
+			return B_IO_ERROR;
+	}
+
+	result.leaf_fill = used * 100 / (leaves * tree->NodeSize());
+
+	bool errorsFound = false;
+	status_t status = tree->Validate(false, errorsFound);
+	result.valid = status == B_OK && !errorsFound;
+	return status;
+}
+
+
+static status_t
+benchmark_inserts(Volume* volume, Inode* inode,
+	const bfs_tree_benchmark& benchmark)
+{
+	BPlusTree* tree = inode->Tree();
+	Transaction transaction;
+	uint32 state = benchmark.seed;
+
+	for (uint32 i = 0; i < benchmark.count; i++) {
+		if (!transaction.IsStarted()) {
+			status_t status = transaction.Start(volume, inode->BlockNumber());
+			if (status != B_OK)
+				return status;
+
+			inode->WriteLockInTransaction(transaction);
+		}
+
+		uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
+		benchmark_key(state, benchmark, key);
+
+		status_t status = tree->Insert(transaction, key,
+			benchmark.key_length, benchmark_value(volume, i));
+		if (status != B_OK)
+			return status;
+
+		if ((i + 1) % 1024 == 0 || transaction.IsTooLarge()) {
+			status = transaction.Done();
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	return transaction.Done();
+}
+
+
+static status_t
+benchmark_batch(Volume* volume, Inode* inode,
+	const bfs_tree_benchmark& benchmark)
+{
+	TreeBatch batch(inode->Tree());
+	uint32 state = benchmark.seed;
+
+	for (uint32 i = 0; i < benchmark.count; i++) {
+		uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
+		benchmark_key(state, benchmark, key);
+
+		status_t status = batch.Add(key, benchmark.key_length,
+			benchmark_value(volume, i));
+		if (status != B_OK)
+			return status;
+	}
+
+	return batch.Commit();
+}
+
+
+/*!	Adds the same random keys to two temporary trees, once one by one, and
+	once through a TreeBatch, and measures how long that takes, and how well
+	the resulting trees are filled.
+*/
+static status_t
+benchmark_trees(Volume* volume, bfs_tree_benchmark& benchmark)
+{
+	if (benchmark.count == 0 || benchmark.distinct_keys == 0
+		|| benchmark.seed == 0 || benchmark.key_length < 8
+		|| benchmark.key_length > BPLUSTREE_MAX_KEY_LENGTH)
+		return B_BAD_VALUE;
+
+	Inode* insertInode;
+	status_t status = create_benchmark_tree(volume, &insertInode);
+	if (status != B_OK)
+		return status;
+
+	Inode* batchInode;
+	status = create_benchmark_tree(volume, &batchInode);
+	if (status != B_OK) {
+		delete_benchmark_tree(volume, insertInode);
+		return status;
+	}
+
+	bigtime_t start = system_time();
+	status = benchmark_inserts(volume, insertInode, benchmark);
+	benchmark.insert.time = system_time() - start;
+
+	if (status == B_OK) {
+		start = system_time();
+		status = benchmark_batch(volume, batchInode, benchmark);
+		benchmark.batch.time = system_time() - start;
+	}
+
+	if (status == B_OK) {
+		status = measure_benchmark_tree(insertInode->Tree(),
+			benchmark.insert);
+	}
+	if (status == B_OK)
+		status = measure_benchmark_tree(batchInode->Tree(), benchmark.batch);
+
+	delete_benchmark_tree(volume, insertInode);
+	delete_benchmark_tree(volume, batchInode);
+	return status;
+}
+#endif	// DEBUG || FS_SHELL
+
+
 //	#pragma mark -
 
 
@@ -786,6 +1015,84 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			ResizeVisitor resizer(volume);
 			return resizer.Resize(size, -1);
 		}
+		case BFS_IOCTL_ALLOCATOR_STATS:
+		{
+			if (bufferLength != sizeof(bfs_allocator_stats))
+				return B_BAD_VALUE;
+
+			bfs_allocator_stats stats;
+			status_t status = volume->Allocator().GetStatistics(stats);
+			if (status != B_OK)
+				return status;
+
+			return user_memcpy(buffer, &stats, sizeof(bfs_allocator_stats));
+		}
+		case BFS_IOCTL_EXPLAIN_QUERY:
+		{
+			if (bufferLength != sizeof(bfs_explain_query))
+				return B_BAD_VALUE;
+
+			bfs_explain_query explain;
+			if (user_memcpy(&explain, buffer, sizeof(bfs_explain_query))
+					!= B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			if (explain.query == NULL || explain.query_length == 0
+				|| explain.query_length >= 65536 || explain.plan == NULL
+				|| explain.plan_size == 0) {
+				return B_BAD_VALUE;
+			}
+
+			uint32 planSize = min_c(explain.plan_size, 65536);
+			char* queryString = (char*)malloc(explain.query_length + 1);
+			char* plan = (char*)malloc(planSize);
+			MemoryDeleter queryDeleter(queryString);
+			MemoryDeleter planDeleter(plan);
+			if (queryString == NULL || plan == NULL)
+				return B_NO_MEMORY;
+
+			if (user_strlcpy(queryString, explain.query,
+					explain.query_length + 1) < B_OK) {
+				return B_BAD_ADDRESS;
+			}
+
+			Expression expression(queryString);
+			if (expression.InitCheck() != B_OK)
+				return B_BAD_VALUE;
+
+			Query query(volume, &expression,
+				explain.flags & B_QUERY_NON_INDEXED);
+			status_t status = query.Explain(plan, planSize);
+			if (status != B_OK && status != B_BUFFER_OVERFLOW)
+				return status;
+
+			if (user_memcpy(explain.plan, plan, strlen(plan) + 1) != B_OK)
+				return B_BAD_ADDRESS;
+
+			return status;
+		}
+
+#if defined(DEBUG) || defined(FS_SHELL)
+		case BFS_IOCTL_BENCHMARK_TREE:
+		{
+			if (bufferLength != sizeof(bfs_tree_benchmark))
+				return B_BAD_VALUE;
+			if (volume->IsReadOnly())
+				return B_READ_ONLY_DEVICE;
+
+			bfs_tree_benchmark benchmark;
+			if (user_memcpy(&benchmark, buffer, sizeof(bfs_tree_benchmark))
+					!= B_OK) {
+				return B_BAD_ADDRESS;
+			}
+
+			status_t status = benchmark_trees(volume, benchmark);
+			if (status != B_OK)
+				return status;
+
+			return user_memcpy(buffer, &benchmark, sizeof(bfs_tree_benchmark));
+		}
+#endif
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
@@ -22,6 +22,7 @@
 
 #include "AttributeCookie.h"
 #include "AttributeDirectoryCookie.h"
+#include "CachedDataReader.h"
 #include "DebugSupport.h"
 #include "Directory.h"
 #include "Query.h"
@@ -1086,9 +1087,23 @@ packagefs_std_ops(int32 op, ...)
 					0, /* magazine capacity, count */ 2, 1, 0, NULL,
 					NULL, NULL, NULL);
 
+			error = CachedDataReader::GlobalInit();
+			if (error != B_OK) {
+				ERROR("Failed to init CachedDataReader\n");
+				delete_object_cache((object_cache*)
+					PackageFileHeapAccessorBase::sChunkCache);
+				StringConstants::Cleanup();
+				StringPool::Cleanup();
+				exit_debugging();
+				return error;
+			}
+
 			error = PackageFSRoot::GlobalInit();
 			if (error != B_OK) {
 				ERROR("Failed to init PackageFSRoot\n");
+				CachedDataReader::GlobalUninit();
+				delete_object_cache((object_cache*)
+					PackageFileHeapAccessorBase::sChunkCache);
 				StringConstants::Cleanup();
 				StringPool::Cleanup();
 				exit_debugging();
@@ -1102,6 +1117,7 @@ packagefs_std_ops(int32 op, ...)
 		{
 			PRINT("package_std_ops(): B_MODULE_UNINIT\n");
 			PackageFSRoot::GlobalUninit();
+			CachedDataReader::GlobalUninit();
 			delete_object_cache((object_cache*)
 				PackageFileHeapAccessorBase::sChunkCache);
 			StringConstants::Cleanup();
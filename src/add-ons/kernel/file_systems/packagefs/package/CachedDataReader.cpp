@@ -6,10 +6,14 @@
 
 #include "CachedDataReader.h"
 
+#include <string.h>
+
 #include <algorithm>
 
 #include <DataIO.h>
 
+#include <debug.h>
+#include <low_resource_manager.h>
 #include <util/AutoLock.h>
 #include <vm/VMCache.h>
 #include <vm/vm_page.h>
@@ -78,19 +82,36 @@ private:
 // #pragma mark - CachedDataReader
 
 
+static const bigtime_t kNoteIdleTime = 5 * 60 * 1000000;
+static const bigtime_t kWarningIdleTime = 30 * 1000000;
+	// readers that haven't been accessed for at least that long lose their
+	// cached pages at the respective low resource level
+
+
+mutex CachedDataReader::sReadersLock;
+CachedDataReader::ReaderList CachedDataReader::sReaders;
+
+
 CachedDataReader::CachedDataReader()
 	:
 	fReader(NULL),
 	fCache(NULL),
-	fCacheLineLockers()
+	fCacheLineLockers(),
+	fCacheLineSize(0),
+	fLastAccessTime(0)
 {
 	mutex_init(&fLock, "packagefs cached reader");
+	memset(&fStatistics, 0, sizeof(fStatistics));
 }
 
 
 CachedDataReader::~CachedDataReader()
 {
 	if (fCache != NULL) {
+		MutexLocker readersLocker(sReadersLock);
+		sReaders.Remove(this);
+		readersLocker.Unlock();
+
 		fCache->Lock();
 		fCache->ReleaseRefAndUnlock();
 	}
@@ -100,9 +121,18 @@ CachedDataReader::~CachedDataReader()
 
 
 status_t
-CachedDataReader::Init(BAbstractBufferedDataReader* reader, off_t size)
+CachedDataReader::Init(BAbstractBufferedDataReader* reader, off_t size,
+	size_t cacheLineSize)
 {
+	// The cache lines correspond to the chunks of the underlying reader, so
+	// that reading a cache line never decompresses more than one chunk.
+	if (cacheLineSize == 0 || cacheLineSize % B_PAGE_SIZE != 0
+		|| cacheLineSize > kMaxCacheLineSize) {
+		RETURN_ERROR(B_BAD_VALUE);
+	}
+
 	fReader = reader;
+	fCacheLineSize = cacheLineSize;
 
 	status_t error = fCacheLineLockers.Init();
 	if (error != B_OK)
@@ -113,6 +143,10 @@ CachedDataReader::Init(BAbstractBufferedDataReader* reader, off_t size)
 	if (error != B_OK)
 		RETURN_ERROR(error);
 
+	MutexLocker readersLocker(sReadersLock);
+	sReaders.Add(this);
+	readersLocker.Unlock();
+
 	AutoLocker<VMCache> locker(fCache);
 
 	error = fCache->Resize(size, VM_PRIORITY_SYSTEM);
@@ -135,12 +169,15 @@ CachedDataReader::ReadDataToOutput(off_t offset, size_t size,
 	if (size == 0)
 		return B_OK;
 
+	atomic_set64(&fLastAccessTime, system_time());
+	atomic_add64(&fStatistics.bytesServed, size);
+
 	while (size > 0) {
 		// the start of the current cache line
-		off_t lineOffset = (offset / kCacheLineSize) * kCacheLineSize;
+		off_t lineOffset = (offset / fCacheLineSize) * fCacheLineSize;
 
 		// intersection of request and cache line
-		off_t cacheLineEnd = std::min(lineOffset + (off_t)kCacheLineSize,
+		off_t cacheLineEnd = std::min(lineOffset + (off_t)fCacheLineSize,
 			fCache->virtual_end);
 		size_t requestLineLength
 			= std::min(cacheLineEnd - offset, (off_t)size);
@@ -159,6 +196,50 @@ CachedDataReader::ReadDataToOutput(off_t offset, size_t size,
 }
 
 
+void
+CachedDataReader::GetStatistics(Statistics& _statistics) const
+{
+	_statistics.bytesServed = atomic_get64((int64*)&fStatistics.bytesServed);
+	_statistics.bytesDecompressed
+		= atomic_get64((int64*)&fStatistics.bytesDecompressed);
+	_statistics.hits = atomic_get64((int64*)&fStatistics.hits);
+	_statistics.misses = atomic_get64((int64*)&fStatistics.misses);
+	_statistics.evictedPages
+		= atomic_get64((int64*)&fStatistics.evictedPages);
+}
+
+
+/*static*/ status_t
+CachedDataReader::GlobalInit()
+{
+	mutex_init(&sReadersLock, "packagefs cached readers");
+
+	status_t error = register_low_resource_handler(&_LowResourceHandler, NULL,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+	if (error != B_OK) {
+		mutex_destroy(&sReadersLock);
+		return error;
+	}
+
+	add_debugger_command_etc("packagefs_cache", &_DumpStatistics,
+		"Print the statistics of the packagefs heap caches",
+		"[ -v ]\n"
+		"Prints the summed up statistics of all packagefs heap caches.\n"
+		"  -v  - Also print the statistics of each individual cache.\n", 0);
+
+	return B_OK;
+}
+
+
+/*static*/ void
+CachedDataReader::GlobalUninit()
+{
+	remove_debugger_command("packagefs_cache", &_DumpStatistics);
+	unregister_low_resource_handler(&_LowResourceHandler, NULL);
+	mutex_destroy(&sReadersLock);
+}
+
+
 status_t
 CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 	off_t requestOffset, size_t requestLength, BDataIO* output)
@@ -172,78 +253,93 @@ CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 	// check whether there are pages of the cache line and the mark them used
 	page_num_t firstPageOffset = lineOffset / B_PAGE_SIZE;
 	page_num_t linePageCount = (lineSize + B_PAGE_SIZE - 1) / B_PAGE_SIZE;
-	vm_page* pages[kPagesPerCacheLine] = {};
+	vm_page* pages[kMaxPagesPerCacheLine] = {};
 
 	AutoLocker<VMCache> cacheLocker(fCache);
 
-	page_num_t firstMissing = 0;
-	page_num_t lastMissing = 0;
-	page_num_t missingPages = 0;
 	page_num_t pageOffset = firstPageOffset;
 
 	VMCachePagesTree::Iterator it = fCache->pages.GetIterator(pageOffset, true,
 		true);
 	while (pageOffset < firstPageOffset + linePageCount) {
 		vm_page* page = it.Next();
-		page_num_t currentPageOffset;
 		if (page == NULL
 			|| page->cache_offset >= firstPageOffset + linePageCount) {
-			page = NULL;
-			currentPageOffset = firstPageOffset + linePageCount;
-		} else
-			currentPageOffset = page->cache_offset;
-
-		if (pageOffset < currentPageOffset) {
-			// pages are missing
-			if (missingPages == 0)
-				firstMissing = pageOffset;
-			lastMissing = currentPageOffset - 1;
-			missingPages += currentPageOffset - pageOffset;
-
-			for (; pageOffset < currentPageOffset; pageOffset++)
-				pages[pageOffset - firstPageOffset] = NULL;
+			break;
 		}
 
-		if (page != NULL) {
-			pages[pageOffset++ - firstPageOffset] = page;
-			DEBUG_PAGE_ACCESS_START(page);
-			vm_page_set_state(page, PAGE_STATE_UNUSED);
-			DEBUG_PAGE_ACCESS_END(page);
-		}
+		pageOffset = page->cache_offset;
+		pages[pageOffset++ - firstPageOffset] = page;
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_set_state(page, PAGE_STATE_UNUSED);
+		DEBUG_PAGE_ACCESS_END(page);
 	}
 
 	cacheLocker.Unlock();
 
-	if (missingPages > 0) {
-// TODO: If the missing pages range doesn't intersect with the request, just
-// satisfy the request and don't read anything at all.
-		// There are pages of the cache line missing. We have to allocate fresh
-		// ones.
+	// If all pages the request touches are there, we don't need to read
+	// anything, even if other pages of the line are missing.
+	size_t firstRequestPage = (requestOffset - lineOffset) / B_PAGE_SIZE;
+	size_t endRequestPage = (requestOffset - lineOffset + requestLength
+		+ B_PAGE_SIZE - 1) / B_PAGE_SIZE;
+
+	bool requestComplete = true;
+	for (size_t i = firstRequestPage; i < endRequestPage; i++) {
+		if (pages[i] == NULL) {
+			requestComplete = false;
+			break;
+		}
+	}
+
+	if (requestComplete) {
+		atomic_add64(&fStatistics.hits, 1);
+	} else {
+		atomic_add64(&fStatistics.misses, 1);
+
+		// Reading any part of the line decompresses the whole chunk, so we
+		// fill in all missing pages of the line and keep them. Only when
+		// memory is getting tight, we confine ourselves to the requested
+		// pages.
+		size_t firstPage = 0;
+		size_t endPage = linePageCount;
+		if (low_resource_state(B_KERNEL_RESOURCE_PAGES
+				| B_KERNEL_RESOURCE_MEMORY) >= B_LOW_RESOURCE_WARNING) {
+			firstPage = firstRequestPage;
+			endPage = endRequestPage;
+		}
+
+		size_t firstMissing = endPage;
+		size_t lastMissing = 0;
+		size_t missingPages = 0;
+		for (size_t i = firstPage; i < endPage; i++) {
+			if (pages[i] == NULL) {
+				firstMissing = std::min(firstMissing, i);
+				lastMissing = i;
+				missingPages++;
+			}
+		}
 
 		// reserve
 		vm_page_reservation reservation;
 		if (!vm_page_try_reserve_pages(&reservation, missingPages,
 				VM_PRIORITY_SYSTEM)) {
-			_DiscardPages(pages, firstMissing - firstPageOffset, missingPages);
+			_CachePages(pages, 0, linePageCount);
 
 			// fall back to uncached transfer
-			return fReader->ReadDataToOutput(requestOffset, requestLength,
-				output);
+			return _ReadUncached(requestOffset, requestLength, output);
 		}
 
 		// Allocate the missing pages and remove the already existing pages in
 		// the range from the cache. We're going to read/write the whole range
 		// anyway.
-		for (pageOffset = firstMissing; pageOffset <= lastMissing;
-				pageOffset++) {
-			page_num_t index = pageOffset - firstPageOffset;
-			if (pages[index] == NULL) {
-				pages[index] = vm_page_allocate_page(&reservation,
+		for (size_t i = firstMissing; i <= lastMissing; i++) {
+			if (pages[i] == NULL) {
+				pages[i] = vm_page_allocate_page(&reservation,
 					PAGE_STATE_UNUSED);
-				DEBUG_PAGE_ACCESS_END(pages[index]);
+				DEBUG_PAGE_ACCESS_END(pages[i]);
 			} else {
 				cacheLocker.Lock();
-				fCache->RemovePage(pages[index]);
+				fCache->RemovePage(pages[i]);
 				cacheLocker.Unlock();
 			}
 		}
@@ -253,30 +349,28 @@ CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 		// add the pages to the cache
 		cacheLocker.Lock();
 
-		for (pageOffset = firstMissing; pageOffset <= lastMissing;
-				pageOffset++) {
-			page_num_t index = pageOffset - firstPageOffset;
-			fCache->InsertPage(pages[index], (off_t)pageOffset * B_PAGE_SIZE);
+		for (size_t i = firstMissing; i <= lastMissing; i++) {
+			fCache->InsertPage(pages[i],
+				(off_t)(firstPageOffset + i) * B_PAGE_SIZE);
 		}
 
 		cacheLocker.Unlock();
 
 		// read in the missing pages
-		status_t error = _ReadIntoPages(pages, firstMissing - firstPageOffset,
-			missingPages);
+		status_t error = _ReadIntoPages(pages, firstMissing, missingPages);
 		if (error != B_OK) {
 			ERROR("CachedDataReader::_ReadCacheLine(): Failed to read into "
 				"cache (offset: %" B_PRIdOFF ", length: %" B_PRIuSIZE "), "
 				"trying uncached read (offset: %" B_PRIdOFF ", length: %"
-				B_PRIuSIZE ")\n", (off_t)firstMissing * B_PAGE_SIZE,
-				(size_t)missingPages * B_PAGE_SIZE, requestOffset,
-				requestLength);
+				B_PRIuSIZE ")\n",
+				(off_t)(firstPageOffset + firstMissing) * B_PAGE_SIZE,
+				missingPages * B_PAGE_SIZE, requestOffset, requestLength);
 
-			_DiscardPages(pages, firstMissing - firstPageOffset, missingPages);
+			_DiscardPages(pages, firstMissing, missingPages);
+			_CachePages(pages, 0, linePageCount);
 
 			// Try again using an uncached transfer
-			return fReader->ReadDataToOutput(requestOffset, requestLength,
-				output);
+			return _ReadUncached(requestOffset, requestLength, output);
 		}
 	}
 
@@ -291,7 +385,7 @@ CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 /*!	Frees all pages in given range of the \a pages array.
 	\c NULL entries in the range are OK. All non \c NULL entries must refer
 	to pages with \c PAGE_STATE_UNUSED. The pages may belong to \c fCache or
-	may not have a cache.
+	may not have a cache. The freed pages' entries are set to \c NULL.
 	\c fCache must not be locked.
 */
 void
@@ -317,13 +411,14 @@ CachedDataReader::_DiscardPages(vm_page** pages, size_t firstPage,
 			fCache->RemovePage(page);
 
 		vm_page_free(NULL, page);
+		pages[i] = NULL;
 	}
 }
 
 
 /*!	Marks all pages in the given range of the \a pages array cached.
-	There must not be any \c NULL entries in the given array range. All pages
-	must belong to \c cache and have state \c PAGE_STATE_UNUSED.
+	\c NULL entries in the range are OK. All non \c NULL entries must belong
+	to \c fCache and have state \c PAGE_STATE_UNUSED.
 	\c fCache must not be locked.
 */
 void
@@ -337,7 +432,9 @@ CachedDataReader::_CachePages(vm_page** pages, size_t firstPage,
 
 	for (size_t i = firstPage; i < firstPage + pageCount; i++) {
 		vm_page* page = pages[i];
-		ASSERT(page != NULL);
+		if (page == NULL)
+			continue;
+
 		ASSERT_PRINT(page->State() == PAGE_STATE_UNUSED
 				&& page->Cache() == fCache,
 			"page: %p @! page -m %p", page, page);
@@ -411,10 +508,148 @@ CachedDataReader::_ReadIntoPages(vm_page** pages, size_t firstPage,
 			fCache->virtual_end)
 		- firstPageOffset;
 
+	_AccountDecompressed(firstPageOffset, requestLength);
 	return fReader->ReadDataToOutput(firstPageOffset, requestLength, &output);
 }
 
 
+status_t
+CachedDataReader::_ReadUncached(off_t offset, size_t size, BDataIO* output)
+{
+	_AccountDecompressed(offset, size);
+	return fReader->ReadDataToOutput(offset, size, output);
+}
+
+
+/*!	Adds the size of the chunks the underlying reader has to decompress to
+	read the given range to the statistics.
+*/
+void
+CachedDataReader::_AccountDecompressed(off_t offset, size_t size)
+{
+	off_t lineSize = fCacheLineSize;
+	off_t start = offset / lineSize * lineSize;
+	off_t end = std::min((offset + (off_t)size + lineSize - 1) / lineSize
+		* lineSize, fCache->virtual_end);
+	atomic_add64(&fStatistics.bytesDecompressed, end - start);
+}
+
+
+/*!	Frees all cached pages of the reader that aren't currently in use.
+	\c fCache must not be locked.
+	\return The number of freed pages.
+*/
+size_t
+CachedDataReader::_EvictPages()
+{
+	AutoLocker<VMCache> cacheLocker(fCache);
+
+	size_t freedPages = 0;
+	for (VMCachePagesTree::Iterator it = fCache->pages.GetIterator();
+			vm_page* page = it.Next();) {
+		// pages of lines that are being read are marked unused
+		if (page->busy || page->State() != PAGE_STATE_CACHED)
+			continue;
+
+		DEBUG_PAGE_ACCESS_START(page);
+		fCache->RemovePage(page);
+		vm_page_free(NULL, page);
+		freedPages++;
+	}
+
+	atomic_add64(&fStatistics.evictedPages, freedPages);
+	return freedPages;
+}
+
+
+/*!	Complements the page daemon, which evicts cached pages one by one: when
+	memory gets low, the caches of packages that haven't been used for a while
+	are dropped as a whole, and all of them when the situation is critical.
+*/
+/*static*/ void
+CachedDataReader::_LowResourceHandler(void* data, uint32 resources,
+	int32 level)
+{
+	bigtime_t idleTime;
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			return;
+		case B_LOW_RESOURCE_NOTE:
+			idleTime = kNoteIdleTime;
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			idleTime = kWarningIdleTime;
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+		default:
+			idleTime = 0;
+			break;
+	}
+
+	bigtime_t now = system_time();
+	size_t freedPages = 0;
+
+	MutexLocker readersLocker(sReadersLock);
+
+	for (ReaderList::Iterator it = sReaders.GetIterator();
+			CachedDataReader* reader = it.Next();) {
+		if (now - atomic_get64(&reader->fLastAccessTime) >= idleTime)
+			freedPages += reader->_EvictPages();
+	}
+
+	PRINT("CachedDataReader::_LowResourceHandler(): level %" B_PRId32
+		", freed %" B_PRIuSIZE " pages\n", level, freedPages);
+}
+
+
+/*static*/ int
+CachedDataReader::_DumpStatistics(int argc, char** argv)
+{
+	bool verbose = false;
+	if (argc == 2 && strcmp(argv[1], "-v") == 0)
+		verbose = true;
+	else if (argc != 1) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	Statistics total = {};
+	int32 readerCount = 0;
+	uint64 pageCount = 0;
+
+	for (ReaderList::Iterator it = sReaders.GetIterator();
+			CachedDataReader* reader = it.Next();) {
+		const Statistics& statistics = reader->fStatistics;
+		if (verbose) {
+			kprintf("%p: %" B_PRIu32 " pages, served %" B_PRId64 ", "
+				"decompressed %" B_PRId64 ", hits %" B_PRId64 ", misses %"
+				B_PRId64 ", evicted %" B_PRId64 "\n", reader,
+				reader->fCache->page_count, statistics.bytesServed,
+				statistics.bytesDecompressed, statistics.hits,
+				statistics.misses, statistics.evictedPages);
+		}
+
+		total.bytesServed += statistics.bytesServed;
+		total.bytesDecompressed += statistics.bytesDecompressed;
+		total.hits += statistics.hits;
+		total.misses += statistics.misses;
+		total.evictedPages += statistics.evictedPages;
+		pageCount += reader->fCache->page_count;
+		readerCount++;
+	}
+
+	kprintf("readers:            %" B_PRId32 "\n", readerCount);
+	kprintf("cached pages:       %" B_PRIu64 "\n", pageCount);
+	kprintf("bytes served:       %" B_PRId64 "\n", total.bytesServed);
+	kprintf("bytes decompressed: %" B_PRId64 "\n", total.bytesDecompressed);
+	kprintf("line hits:          %" B_PRId64 "\n", total.hits);
+	kprintf("line misses:        %" B_PRId64 "\n", total.misses);
+	kprintf("evicted pages:      %" B_PRId64 "\n", total.evictedPages);
+
+	return 0;
+}
+
+
 void
 CachedDataReader::_LockCacheLine(CacheLineLocker* lineLocker)
 {
@@ -19,16 +19,32 @@ using BPackageKit::BHPKG::BDataReader;
 
 
 class CachedDataReader : public BAbstractBufferedDataReader {
+public:
+			struct Statistics {
+				int64			bytesServed;
+				int64			bytesDecompressed;
+				int64			hits;
+				int64			misses;
+				int64			evictedPages;
+			};
+
 public:
 								CachedDataReader();
 	virtual						~CachedDataReader();
 
 			status_t			Init(BAbstractBufferedDataReader* reader,
-									off_t size);
+									off_t size, size_t cacheLineSize);
+									// cacheLineSize should be the chunk size
+									// of the underlying reader
 
 	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
 									BDataIO* output);
 
+			void				GetStatistics(Statistics& _statistics) const;
+
+	static	status_t			GlobalInit();
+	static	void				GlobalUninit();
+
 private:
 			class CacheLineLocker
 				: public DoublyLinkedListLinkImpl<CacheLineLocker> {
@@ -92,7 +108,7 @@ private:
 
 				size_t HashKey(off_t key) const
 				{
-					return size_t(key / kCacheLineSize);
+					return size_t(key / B_PAGE_SIZE);
 				}
 
 				size_t Hash(const CacheLineLocker* value) const
@@ -129,20 +145,41 @@ private:
 									size_t requestLength, BDataIO* output);
 			status_t			_ReadIntoPages(vm_page** pages,
 									size_t firstPage, size_t pageCount);
+			status_t			_ReadUncached(off_t offset, size_t size,
+									BDataIO* output);
+			void				_AccountDecompressed(off_t offset,
+									size_t size);
+
+			size_t				_EvictPages();
+	static	void				_LowResourceHandler(void* data,
+									uint32 resources, int32 level);
+	static	int					_DumpStatistics(int argc, char** argv);
 
 			void				_LockCacheLine(CacheLineLocker* lineLocker);
 			void				_UnlockCacheLine(CacheLineLocker* lineLocker);
 
 private:
-			static const size_t kCacheLineSize = 64 * 1024;
-			static const size_t kPagesPerCacheLine
-				= kCacheLineSize / B_PAGE_SIZE;
+			static const size_t kMaxCacheLineSize = 256 * 1024;
+			static const size_t kMaxPagesPerCacheLine
+				= kMaxCacheLineSize / B_PAGE_SIZE;
 
 private:
 			mutex				fLock;
 			BAbstractBufferedDataReader* fReader;
 			VMCache*			fCache;
 			LockerTable			fCacheLineLockers;
+			size_t				fCacheLineSize;
+			bigtime_t			fLastAccessTime;
+			Statistics			fStatistics;
+			DoublyLinkedListLink<CachedDataReader> fListLink;
+
+private:
+			typedef DoublyLinkedList<CachedDataReader,
+				DoublyLinkedListMemberGetLink<CachedDataReader,
+					&CachedDataReader::fListLink> > ReaderList;
+
+	static	mutex				sReadersLock;
+	static	ReaderList			sReaders;
 };
 
 
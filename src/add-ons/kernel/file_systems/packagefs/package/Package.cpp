@@ -25,6 +25,7 @@
 
 #include "CachedDataReader.h"
 #include "DebugSupport.h"
+#include "MountIndex.h"
 #include "PackageDirectory.h"
 #include "PackageFile.h"
 #include "PackagesDirectory.h"
@@ -418,7 +419,7 @@ public:
 		fHeapReader->SetFile(this);
 
 		status_t error = CachedDataReader::Init(fHeapReader,
-			fHeapReader->UncompressedHeapSize());
+			fHeapReader->UncompressedHeapSize(), fHeapReader->ChunkSize());
 		if (error != B_OK)
 			return error;
 
@@ -540,16 +541,7 @@ Package::~Package()
 {
 	delete fHeapReader;
 
-	while (PackageNode* node = fNodes.RemoveHead())
-		node->ReleaseReference();
-
-	while (Resolvable* resolvable = fResolvables.RemoveHead())
-		delete resolvable;
-
-	while (Dependency* dependency = fDependencies.RemoveHead())
-		delete dependency;
-
-	delete fVersion;
+	_UnloadContent();
 
 	fPackagesDirectory->ReleaseReference();
 
@@ -568,9 +560,9 @@ Package::Init(const char* fileName)
 
 
 status_t
-Package::Load(const PackageSettings& settings)
+Package::Load(const PackageSettings& settings, MountIndex* mountIndex)
 {
-	status_t error = _Load(settings);
+	status_t error = _Load(settings, mountIndex);
 	if (error != B_OK)
 		return error;
 
@@ -701,19 +693,37 @@ Package::Close()
 }
 
 
+/*!	The package must be open.
+*/
 status_t
 Package::CreateDataReader(const PackageData& data,
 	BAbstractBufferedDataReader*& _reader)
 {
-	if (fHeapReader == NULL)
-		return B_BAD_VALUE;
+	// inline data doesn't need the heap
+	if (data.IsEncodedInline()) {
+		return BPackageKit::BHPKG::BPackageDataReaderFactory()
+			.CreatePackageDataReader(NULL, data.DataV2(), _reader);
+	}
+
+	MutexLocker locker(fLock);
+
+	if (fHeapReader == NULL) {
+		if (fFD < 0)
+			return B_BAD_VALUE;
+
+		status_t error = _InitHeapReader();
+		if (error != B_OK)
+			return error;
+	}
+
+	locker.Unlock();
 
 	return fHeapReader->CreateDataReader(data, _reader);
 }
 
 
 status_t
-Package::_Load(const PackageSettings& settings)
+Package::_Load(const PackageSettings& settings, MountIndex* mountIndex)
 {
 	// open package file
 	int fd = Open();
@@ -721,6 +731,32 @@ Package::_Load(const PackageSettings& settings)
 		RETURN_ERROR(fd);
 	PackageCloser packageCloser(this);
 
+	// If the package is in the mount index, we don't need to parse it. The heap
+	// reader will be created when needed.
+	struct stat st;
+	if (mountIndex != NULL && fstat(fd, &st) != 0)
+		mountIndex = NULL;
+
+	if (mountIndex != NULL) {
+		LoaderContentHandler handler(this, settings);
+		status_t error = handler.Init();
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		error = mountIndex->ReplayPackage(fFileName, st, &handler);
+		if (error == B_OK)
+			return B_OK;
+
+		// The index has already dropped the package's record, if replaying
+		// it failed. Throw away what has been built so far, and parse the
+		// package instead.
+		if (error != B_ENTRY_NOT_FOUND) {
+			ERROR("Failed to replay package \"%s\" from the mount index: "
+				"%s\n", fFileName.Data(), strerror(error));
+			_UnloadContent();
+		}
+	}
+
 	// initialize package reader
 	LoaderErrorOutput errorOutput(this);
 
@@ -736,10 +772,23 @@ Package::_Load(const PackageSettings& settings)
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
-			error = packageReader.ParseContent(&handler);
+			// record the content for the mount index while parsing it
+			MountIndex::Recorder recorder(&handler);
+			if (mountIndex != NULL)
+				error = packageReader.ParseContent(&recorder);
+			else
+				error = packageReader.ParseContent(&handler);
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
+			if (mountIndex != NULL) {
+				error = mountIndex->AddPackage(fFileName, st, recorder);
+				if (error != B_OK) {
+					ERROR("Failed to add package \"%s\" to the mount index: "
+						"%s\n", fFileName.Data(), strerror(error));
+				}
+			}
+
 			// get the heap reader
 			fHeapReader = packageReader.DetachCachedHeapReader();
 			return B_OK;
@@ -754,6 +803,48 @@ Package::_Load(const PackageSettings& settings)
 }
 
 
+/*!	fLock must be held and the package must be open.
+*/
+/*!	Deletes everything the content handler added to the package, i.e. its
+	nodes, resolvables, dependencies, and package attributes.
+*/
+void
+Package::_UnloadContent()
+{
+	while (PackageNode* node = fNodes.RemoveHead())
+		node->ReleaseReference();
+
+	while (Resolvable* resolvable = fResolvables.RemoveHead())
+		delete resolvable;
+
+	while (Dependency* dependency = fDependencies.RemoveHead())
+		delete dependency;
+
+	delete fVersion;
+	fVersion = NULL;
+
+	fName = String();
+	fInstallPath = String();
+	fFlags = 0;
+	fArchitecture = B_PACKAGE_ARCHITECTURE_ENUM_COUNT;
+}
+
+
+status_t
+Package::_InitHeapReader()
+{
+	LoaderErrorOutput errorOutput(this);
+	CachingPackageReader packageReader(&errorOutput);
+	status_t error = packageReader.Init(fFD, false,
+		BHPKG::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fHeapReader = packageReader.DetachCachedHeapReader();
+	return B_OK;
+}
+
+
 bool
 Package::_InitVersionedName()
 {
@@ -28,6 +28,7 @@ using BPackageKit::BPackageArchitecture;
 using BPackageKit::BHPKG::BAbstractBufferedDataReader;
 
 
+class MountIndex;
 class PackageLinkDirectory;
 class PackagesDirectory;
 class PackageSettings;
@@ -44,7 +45,8 @@ public:
 								~Package();
 
 			status_t			Init(const char* fileName);
-			status_t			Load(const PackageSettings& settings);
+			status_t			Load(const PackageSettings& settings,
+									MountIndex* mountIndex = NULL);
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -117,7 +119,10 @@ private:
 			struct CachingPackageReader;
 
 private:
-			status_t			_Load(const PackageSettings& settings);
+			status_t			_Load(const PackageSettings& settings,
+									MountIndex* mountIndex);
+			void				_UnloadContent();
+			status_t			_InitHeapReader();
 			bool				_InitVersionedName();
 
 private:
@@ -135,6 +140,8 @@ private:
 			int					fFD;
 			uint32				fOpenCount;
 			HeapReader*			fHeapReader;
+									// created lazily, if the package has been
+									// loaded from the mount index
 			Package*			fFileNameHashTableNext;
 			ino_t				fNodeID;
 			dev_t				fDeviceID;
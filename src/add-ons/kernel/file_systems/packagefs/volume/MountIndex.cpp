@@ -0,0 +1,980 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "MountIndex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <package/hpkg/PackageData.h>
+#include <package/hpkg/PackageEntry.h>
+#include <package/hpkg/PackageEntryAttribute.h>
+#include <package/hpkg/PackageInfoAttributeValue.h>
+
+#include <AutoDeleter.h>
+#include <syscalls.h>
+#include <util/AutoLock.h>
+
+#include <zlib.h>
+
+#include "DebugSupport.h"
+
+
+using namespace BPackageKit;
+
+
+static const uint32 kMountIndexMagic = 'PfIx';
+static const uint16 kMountIndexVersion = 1;
+
+// sanity limit for the index file size
+static const size_t kMaxMountIndexSize = 64 * 1024 * 1024;
+
+// sanity limit for the depth of the replayed entry hierarchy
+static const int32 kMaxEntryDepth = 64;
+
+static const uint16 kNullStringLength = 0xffff;
+
+
+enum {
+	RECORD_ENTRY				= 1,
+	RECORD_ENTRY_ATTRIBUTE		= 2,
+	RECORD_ENTRY_DONE			= 3,
+	RECORD_PACKAGE_ATTRIBUTE	= 4
+};
+
+
+struct mount_index_header {
+	uint32	magic;
+	uint16	version;
+	uint16	header_size;
+	uint32	package_count;
+	uint32	checksum;
+		// CRC32 of everything following the header
+	uint64	size;
+		// of the whole file
+};
+
+
+struct mount_index_package {
+	uint32	size;
+		// of the whole record, including file name, data, and padding
+	uint16	name_length;
+		// including the terminating null
+	uint16	reserved;
+	int64	node;
+	int64	file_size;
+	int64	modified_time;
+	int32	modified_time_nsec;
+	uint32	data_size;
+};
+
+
+static inline size_t
+package_record_size(size_t nameLength, size_t dataSize)
+{
+	return (sizeof(mount_index_package) + nameLength + dataSize + 7) / 8 * 8;
+}
+
+
+// #pragma mark - PackageRecord
+
+
+struct MountIndex::PackageRecord {
+	const char*		fileName;
+	ino_t			node;
+	off_t			fileSize;
+	timespec		modifiedTime;
+	const uint8*	data;
+	size_t			dataSize;
+	char*			ownedFileName;
+	uint8*			ownedData;
+	bool			used;
+	PackageRecord*	hashNext;
+
+	PackageRecord()
+		:
+		ownedFileName(NULL),
+		ownedData(NULL),
+		used(false)
+	{
+	}
+
+	~PackageRecord()
+	{
+		free(ownedFileName);
+		free(ownedData);
+	}
+
+	bool Matches(const struct stat& st) const
+	{
+		return node == st.st_ino && fileSize == st.st_size
+			&& modifiedTime.tv_sec == st.st_mtim.tv_sec
+			&& modifiedTime.tv_nsec == st.st_mtim.tv_nsec;
+	}
+};
+
+
+struct MountIndex::PackageRecordHashDefinition {
+	typedef const char*		KeyType;
+	typedef	PackageRecord	ValueType;
+
+	size_t HashKey(const char* key) const
+	{
+		return hash_hash_string(key);
+	}
+
+	size_t Hash(const PackageRecord* value) const
+	{
+		return HashKey(value->fileName);
+	}
+
+	bool Compare(const char* key, const PackageRecord* value) const
+	{
+		return strcmp(value->fileName, key) == 0;
+	}
+
+	PackageRecord*& GetLink(PackageRecord* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+// #pragma mark - Reader
+
+
+struct MountIndex::Reader {
+	Reader(const uint8* data, size_t size)
+		:
+		fData(data),
+		fEnd(data + size)
+	{
+	}
+
+	bool IsAtEnd() const
+	{
+		return fData == fEnd;
+	}
+
+	template<typename Value>
+	bool Read(Value& _value)
+	{
+		if ((size_t)(fEnd - fData) < sizeof(Value))
+			return false;
+
+		memcpy(&_value, fData, sizeof(Value));
+		fData += sizeof(Value);
+		return true;
+	}
+
+	bool ReadString(const char*& _string)
+	{
+		uint16 length;
+		if (!Read(length))
+			return false;
+
+		if (length == kNullStringLength) {
+			_string = NULL;
+			return true;
+		}
+
+		if ((size_t)(fEnd - fData) < (size_t)length + 1
+			|| fData[length] != '\0') {
+			return false;
+		}
+
+		_string = (const char*)fData;
+		fData += length + 1;
+		return true;
+	}
+
+	bool ReadData(BPackageData& data)
+	{
+		uint8 isInline;
+		if (!Read(isInline))
+			return false;
+
+		if (isInline != 0) {
+			uint8 size;
+			if (!Read(size) || size > BHPKG::B_HPKG_MAX_INLINE_DATA_SIZE
+				|| (size_t)(fEnd - fData) < size) {
+				return false;
+			}
+
+			data.SetData(size, fData);
+			fData += size;
+			return true;
+		}
+
+		uint64 size;
+		uint64 offset;
+		if (!Read(size) || !Read(offset))
+			return false;
+
+		data.SetData(size, offset);
+		return true;
+	}
+
+	bool ReadVersion(BPackageVersionData& version)
+	{
+		return ReadString(version.major) && ReadString(version.minor)
+			&& ReadString(version.micro) && ReadString(version.preRelease)
+			&& Read(version.revision);
+	}
+
+private:
+	const uint8*	fData;
+	const uint8*	fEnd;
+};
+
+
+// #pragma mark - Recorder
+
+
+MountIndex::Recorder::Recorder(BPackageContentHandler* target)
+	:
+	fTarget(target),
+	fData(NULL),
+	fSize(0),
+	fCapacity(0),
+	fError(B_OK)
+{
+}
+
+
+MountIndex::Recorder::~Recorder()
+{
+	free(fData);
+}
+
+
+status_t
+MountIndex::Recorder::HandleEntry(BPackageEntry* entry)
+{
+	_WriteUInt8(RECORD_ENTRY);
+	_WriteString(entry->Name());
+	_WriteUInt32(entry->Mode());
+	_WriteUInt32(entry->ModifiedTime().tv_sec);
+	_WriteUInt32(entry->ModifiedTime().tv_nsec);
+	_WriteData(entry->Data());
+	_WriteString(entry->SymlinkPath());
+
+	return fTarget->HandleEntry(entry);
+}
+
+
+status_t
+MountIndex::Recorder::HandleEntryAttribute(BPackageEntry* entry,
+	BPackageEntryAttribute* attribute)
+{
+	_WriteUInt8(RECORD_ENTRY_ATTRIBUTE);
+	_WriteString(attribute->Name());
+	_WriteUInt32(attribute->Type());
+	_WriteData(attribute->Data());
+
+	return fTarget->HandleEntryAttribute(entry, attribute);
+}
+
+
+status_t
+MountIndex::Recorder::HandleEntryDone(BPackageEntry* entry)
+{
+	_WriteUInt8(RECORD_ENTRY_DONE);
+
+	return fTarget->HandleEntryDone(entry);
+}
+
+
+/*!	Only the package attributes packagefs makes use of are recorded.
+*/
+status_t
+MountIndex::Recorder::HandlePackageAttribute(
+	const BPackageInfoAttributeValue& value)
+{
+	switch (value.attributeID) {
+		case B_PACKAGE_INFO_NAME:
+		case B_PACKAGE_INFO_INSTALL_PATH:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteString(value.string);
+			break;
+
+		case B_PACKAGE_INFO_VERSION:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteVersion(value.version);
+			break;
+
+		case B_PACKAGE_INFO_FLAGS:
+		case B_PACKAGE_INFO_ARCHITECTURE:
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteUInt64(value.unsignedInt);
+			break;
+
+		case B_PACKAGE_INFO_PROVIDES:
+		{
+			const BHPKG::BPackageResolvableData& resolvable = value.resolvable;
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteString(resolvable.name);
+			_WriteUInt8(resolvable.haveVersion);
+			if (resolvable.haveVersion)
+				_WriteVersion(resolvable.version);
+			_WriteUInt8(resolvable.haveCompatibleVersion);
+			if (resolvable.haveCompatibleVersion)
+				_WriteVersion(resolvable.compatibleVersion);
+			break;
+		}
+
+		case B_PACKAGE_INFO_REQUIRES:
+		{
+			const BHPKG::BPackageResolvableExpressionData& expression
+				= value.resolvableExpression;
+			_WriteUInt8(RECORD_PACKAGE_ATTRIBUTE);
+			_WriteUInt8(value.attributeID);
+			_WriteString(expression.name);
+			_WriteUInt8(expression.haveOpAndVersion);
+			if (expression.haveOpAndVersion) {
+				_WriteUInt32(expression.op);
+				_WriteVersion(expression.version);
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return fTarget->HandlePackageAttribute(value);
+}
+
+
+void
+MountIndex::Recorder::HandleErrorOccurred()
+{
+	fError = B_ERROR;
+	fTarget->HandleErrorOccurred();
+}
+
+
+uint8*
+MountIndex::Recorder::DetachData(size_t& _size)
+{
+	uint8* data = fData;
+	_size = fSize;
+
+	fData = NULL;
+	fSize = 0;
+	fCapacity = 0;
+	return data;
+}
+
+
+void
+MountIndex::Recorder::_Write(const void* buffer, size_t size)
+{
+	if (fError != B_OK)
+		return;
+
+	if (fSize + size > fCapacity) {
+		size_t capacity = std::max(fCapacity * 2, (size_t)4096);
+		while (capacity < fSize + size)
+			capacity *= 2;
+
+		uint8* data = (uint8*)realloc(fData, capacity);
+		if (data == NULL) {
+			fError = B_NO_MEMORY;
+			return;
+		}
+
+		fData = data;
+		fCapacity = capacity;
+	}
+
+	memcpy(fData + fSize, buffer, size);
+	fSize += size;
+}
+
+
+void
+MountIndex::Recorder::_WriteString(const char* string)
+{
+	if (string == NULL) {
+		uint16 length = kNullStringLength;
+		_Write(&length, sizeof(length));
+		return;
+	}
+
+	size_t length = strlen(string);
+	if (length >= kNullStringLength) {
+		fError = B_NAME_TOO_LONG;
+		return;
+	}
+
+	uint16 length16 = length;
+	_Write(&length16, sizeof(length16));
+	_Write(string, length + 1);
+}
+
+
+void
+MountIndex::Recorder::_WriteData(const BPackageData& data)
+{
+	if (data.IsEncodedInline()) {
+		_WriteUInt8(1);
+		_WriteUInt8(data.Size());
+		_Write(data.InlineData(), data.Size());
+	} else {
+		_WriteUInt8(0);
+		_WriteUInt64(data.Size());
+		_WriteUInt64(data.Offset());
+	}
+}
+
+
+void
+MountIndex::Recorder::_WriteVersion(const BPackageVersionData& version)
+{
+	_WriteString(version.major);
+	_WriteString(version.minor);
+	_WriteString(version.micro);
+	_WriteString(version.preRelease);
+	_WriteUInt32(version.revision);
+}
+
+
+// #pragma mark - MountIndex
+
+
+MountIndex::MountIndex()
+	:
+	fRecords(NULL),
+	fFileBuffer(NULL),
+	fReplayedPackages(0),
+	fRecordedPackages(0)
+{
+	mutex_init(&fLock, "packagefs mount index");
+}
+
+
+MountIndex::~MountIndex()
+{
+	_Unload();
+	delete fRecords;
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+MountIndex::Init()
+{
+	fRecords = new(std::nothrow) PackageRecordTable;
+	if (fRecords == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	return fRecords->Init();
+}
+
+
+/*!	Reads the index file at \a path relative to \a directoryFD.
+	If the file doesn't exist or is invalid, the index remains empty.
+*/
+status_t
+MountIndex::Load(int directoryFD, const char* path)
+{
+	_Unload();
+
+	FileDescriptorCloser fd(openat(directoryFD, path, O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		RETURN_ERROR(errno);
+
+	if (st.st_size < (off_t)sizeof(mount_index_header)
+		|| st.st_size > (off_t)kMaxMountIndexSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	size_t fileSize = st.st_size;
+	uint8* buffer = (uint8*)malloc(fileSize);
+	if (buffer == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter bufferDeleter(buffer);
+
+	ssize_t bytesRead = read(fd.Get(), buffer, fileSize);
+	if (bytesRead < 0)
+		RETURN_ERROR(errno);
+	if ((size_t)bytesRead != fileSize)
+		RETURN_ERROR(B_BAD_DATA);
+
+	// check the header
+	mount_index_header header;
+	memcpy(&header, buffer, sizeof(header));
+	if (header.magic != kMountIndexMagic
+		|| header.version != kMountIndexVersion
+		|| header.header_size != sizeof(mount_index_header)
+		|| header.size != fileSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	uint32 checksum = crc32(0, buffer + sizeof(header),
+		fileSize - sizeof(header));
+	if (checksum != header.checksum)
+		RETURN_ERROR(B_BAD_DATA);
+
+	// create the package records
+	status_t error = B_OK;
+	size_t offset = sizeof(header);
+	for (uint32 i = 0; i < header.package_count; i++) {
+		mount_index_package package;
+		if (fileSize - offset < sizeof(package)) {
+			error = B_BAD_DATA;
+			break;
+		}
+
+		memcpy(&package, buffer + offset, sizeof(package));
+		if (package.size > fileSize - offset || package.name_length == 0
+			|| package.size < package_record_size(package.name_length,
+				package.data_size)) {
+			error = B_BAD_DATA;
+			break;
+		}
+
+		const char* fileName
+			= (const char*)buffer + offset + sizeof(package);
+		if (fileName[package.name_length - 1] != '\0') {
+			error = B_BAD_DATA;
+			break;
+		}
+
+		PackageRecord* record = new(std::nothrow) PackageRecord;
+		if (record == NULL) {
+			error = B_NO_MEMORY;
+			break;
+		}
+
+		record->fileName = fileName;
+		record->node = package.node;
+		record->fileSize = package.file_size;
+		record->modifiedTime.tv_sec = package.modified_time;
+		record->modifiedTime.tv_nsec = package.modified_time_nsec;
+		record->data = (const uint8*)fileName + package.name_length;
+		record->dataSize = package.data_size;
+
+		if (fRecords->Lookup(fileName) != NULL) {
+			delete record;
+			error = B_BAD_DATA;
+			break;
+		}
+		fRecords->Insert(record);
+
+		offset += package.size;
+	}
+
+	if (error == B_OK && offset != fileSize)
+		error = B_BAD_DATA;
+
+	if (error != B_OK) {
+		_Unload();
+		RETURN_ERROR(error);
+	}
+
+	fFileBuffer = (uint8*)bufferDeleter.Detach();
+	return B_OK;
+}
+
+
+/*!	Writes the index file at \a path relative to \a directoryFD.
+	Only the records of the given packages that have been replayed or added
+	since the index was loaded are written, i.e. the index is pruned to the
+	packages currently in use. If nothing has changed, the file is left alone.
+*/
+status_t
+MountIndex::Store(int directoryFD, const char* path,
+	const PackageFileNameHashTable& packages)
+{
+	MutexLocker locker(fLock);
+
+	// collect the records to write
+	uint32 packageCount = 0;
+	size_t size = sizeof(mount_index_header);
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		PackageRecord* record = fRecords->Lookup(package->FileName());
+		if (record == NULL || !record->used)
+			continue;
+
+		packageCount++;
+		size += package_record_size(strlen(record->fileName) + 1,
+			record->dataSize);
+	}
+
+	if (fRecordedPackages == 0 && packageCount == fRecords->CountElements())
+		return B_OK;
+
+	if (size > kMaxMountIndexSize)
+		RETURN_ERROR(B_BUFFER_OVERFLOW);
+
+	uint8* buffer = (uint8*)calloc(1, size);
+	if (buffer == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter bufferDeleter(buffer);
+
+	size_t offset = sizeof(mount_index_header);
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		PackageRecord* record = fRecords->Lookup(package->FileName());
+		if (record == NULL || !record->used)
+			continue;
+
+		size_t nameLength = strlen(record->fileName) + 1;
+
+		mount_index_package packageHeader;
+		memset(&packageHeader, 0, sizeof(packageHeader));
+		packageHeader.size = package_record_size(nameLength,
+			record->dataSize);
+		packageHeader.name_length = nameLength;
+		packageHeader.node = record->node;
+		packageHeader.file_size = record->fileSize;
+		packageHeader.modified_time = record->modifiedTime.tv_sec;
+		packageHeader.modified_time_nsec = record->modifiedTime.tv_nsec;
+		packageHeader.data_size = record->dataSize;
+
+		memcpy(buffer + offset, &packageHeader, sizeof(packageHeader));
+		memcpy(buffer + offset + sizeof(packageHeader), record->fileName,
+			nameLength);
+		memcpy(buffer + offset + sizeof(packageHeader) + nameLength,
+			record->data, record->dataSize);
+		offset += packageHeader.size;
+	}
+
+	mount_index_header header;
+	header.magic = kMountIndexMagic;
+	header.version = kMountIndexVersion;
+	header.header_size = sizeof(mount_index_header);
+	header.package_count = packageCount;
+	header.checksum = crc32(0, buffer + sizeof(header), size - sizeof(header));
+	header.size = size;
+	memcpy(buffer, &header, sizeof(header));
+
+	locker.Unlock();
+
+	// Write to a temporary file first and move it into place, so that a
+	// crash won't leave a truncated index behind.
+	char tempPath[B_PATH_NAME_LENGTH];
+	if (snprintf(tempPath, sizeof(tempPath), "%s.new", path)
+			>= (int)sizeof(tempPath)) {
+		RETURN_ERROR(B_NAME_TOO_LONG);
+	}
+
+	FileDescriptorCloser fd(openat(directoryFD, tempPath,
+		O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+	if (!fd.IsSet())
+		RETURN_ERROR(errno);
+
+	status_t error = B_OK;
+	ssize_t bytesWritten = write(fd.Get(), buffer, size);
+	if (bytesWritten < 0)
+		error = errno;
+	else if ((size_t)bytesWritten != size)
+		error = B_IO_ERROR;
+	else if (fsync(fd.Get()) != 0)
+		error = errno;
+
+	fd.Unset();
+
+	if (error != B_OK) {
+		unlinkat(directoryFD, tempPath, 0);
+		RETURN_ERROR(error);
+	}
+
+	error = _kern_rename(directoryFD, tempPath, directoryFD, path);
+	if (error != B_OK) {
+		unlinkat(directoryFD, tempPath, 0);
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Replays the recorded content of the given package to \a handler.
+	Returns \c B_ENTRY_NOT_FOUND, if the package isn't known, or if the
+	package file doesn't match \a st anymore. In this case the handler has not
+	been invoked.
+	If replaying fails for any other reason, the package's record is removed
+	from the index, so that it will be recorded anew by the caller.
+*/
+status_t
+MountIndex::ReplayPackage(const char* fileName, const struct stat& st,
+	BPackageContentHandler* handler)
+{
+	MutexLocker locker(fLock);
+
+	PackageRecord* record = fRecords->Lookup(fileName);
+	if (record == NULL || !record->Matches(st))
+		return B_ENTRY_NOT_FOUND;
+
+	const uint8* data = record->data;
+	size_t dataSize = record->dataSize;
+
+	locker.Unlock();
+
+	Reader reader(data, dataSize);
+	status_t error = B_OK;
+	while (error == B_OK && !reader.IsAtEnd()) {
+		uint8 type;
+		if (!reader.Read(type)) {
+			error = B_BAD_DATA;
+			break;
+		}
+
+		switch (type) {
+			case RECORD_PACKAGE_ATTRIBUTE:
+				error = _ReplayPackageAttribute(reader, handler);
+				break;
+			case RECORD_ENTRY:
+				error = _ReplayEntry(reader, NULL, handler, 0);
+				break;
+			default:
+				error = B_BAD_DATA;
+				break;
+		}
+	}
+
+	if (error != B_OK) {
+		handler->HandleErrorOccurred();
+
+		locker.Lock();
+		if (fRecords->Lookup(fileName) == record) {
+			fRecords->Remove(record);
+			delete record;
+		}
+		RETURN_ERROR(error);
+	}
+
+	locker.Lock();
+	record->used = true;
+	fReplayedPackages++;
+
+	return B_OK;
+}
+
+
+/*!	Adds the data recorded by \a recorder for the given package to the index,
+	replacing any previous record for the package.
+*/
+status_t
+MountIndex::AddPackage(const char* fileName, const struct stat& st,
+	Recorder& recorder)
+{
+	if (recorder.Error() != B_OK)
+		return recorder.Error();
+
+	PackageRecord* record = new(std::nothrow) PackageRecord;
+	if (record == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	ObjectDeleter<PackageRecord> recordDeleter(record);
+
+	record->ownedFileName = strdup(fileName);
+	if (record->ownedFileName == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	record->ownedData = recorder.DetachData(record->dataSize);
+	record->fileName = record->ownedFileName;
+	record->data = record->ownedData;
+	record->node = st.st_ino;
+	record->fileSize = st.st_size;
+	record->modifiedTime = st.st_mtim;
+	record->used = true;
+
+	MutexLocker locker(fLock);
+
+	if (PackageRecord* oldRecord = fRecords->Lookup(fileName)) {
+		fRecords->Remove(oldRecord);
+		delete oldRecord;
+	}
+
+	fRecords->Insert(recordDeleter.Detach());
+	fRecordedPackages++;
+
+	return B_OK;
+}
+
+
+status_t
+MountIndex::_ReplayEntry(Reader& reader, BPackageEntry* parent,
+	BPackageContentHandler* handler, int32 depth)
+{
+	if (depth >= kMaxEntryDepth)
+		RETURN_ERROR(B_BAD_DATA);
+
+	const char* name;
+	uint32 mode;
+	uint32 modifiedTime;
+	uint32 modifiedTimeNanos;
+	BPackageData data;
+	const char* symlinkPath;
+	if (!reader.ReadString(name) || name == NULL || !reader.Read(mode)
+		|| !reader.Read(modifiedTime) || !reader.Read(modifiedTimeNanos)
+		|| !reader.ReadData(data) || !reader.ReadString(symlinkPath)) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	BPackageEntry entry(parent, name);
+	entry.SetType(mode);
+	entry.SetPermissions(mode);
+	entry.SetModifiedTime(modifiedTime);
+	entry.SetModifiedTimeNanos(modifiedTimeNanos);
+	entry.Data() = data;
+	entry.SetSymlinkPath(symlinkPath);
+
+	status_t error = handler->HandleEntry(&entry);
+	if (error != B_OK)
+		return error;
+
+	for (;;) {
+		uint8 type;
+		if (!reader.Read(type))
+			RETURN_ERROR(B_BAD_DATA);
+
+		switch (type) {
+			case RECORD_ENTRY_ATTRIBUTE:
+			{
+				const char* attributeName;
+				uint32 attributeType;
+				BPackageData attributeData;
+				if (!reader.ReadString(attributeName) || attributeName == NULL
+					|| !reader.Read(attributeType)
+					|| !reader.ReadData(attributeData)) {
+					RETURN_ERROR(B_BAD_DATA);
+				}
+
+				BPackageEntryAttribute attribute(attributeName);
+				attribute.SetType(attributeType);
+				attribute.Data() = attributeData;
+
+				error = handler->HandleEntryAttribute(&entry, &attribute);
+				break;
+			}
+
+			case RECORD_ENTRY:
+				error = _ReplayEntry(reader, &entry, handler, depth + 1);
+				break;
+
+			case RECORD_ENTRY_DONE:
+				return handler->HandleEntryDone(&entry);
+
+			default:
+				RETURN_ERROR(B_BAD_DATA);
+		}
+
+		if (error != B_OK)
+			return error;
+	}
+}
+
+
+status_t
+MountIndex::_ReplayPackageAttribute(Reader& reader,
+	BPackageContentHandler* handler)
+{
+	uint8 id;
+	if (!reader.Read(id))
+		RETURN_ERROR(B_BAD_DATA);
+
+	BPackageInfoAttributeValue value;
+	value.attributeID = (BPackageInfoAttributeID)id;
+
+	bool success;
+	switch (id) {
+		case B_PACKAGE_INFO_NAME:
+		case B_PACKAGE_INFO_INSTALL_PATH:
+			success = reader.ReadString(value.string);
+			break;
+
+		case B_PACKAGE_INFO_VERSION:
+			success = reader.ReadVersion(value.version);
+			break;
+
+		case B_PACKAGE_INFO_FLAGS:
+		case B_PACKAGE_INFO_ARCHITECTURE:
+			success = reader.Read(value.unsignedInt);
+			break;
+
+		case B_PACKAGE_INFO_PROVIDES:
+		{
+			BHPKG::BPackageResolvableData& resolvable = value.resolvable;
+			uint8 haveVersion;
+			uint8 haveCompatibleVersion;
+			success = reader.ReadString(resolvable.name)
+				&& reader.Read(haveVersion)
+				&& (haveVersion == 0 || reader.ReadVersion(resolvable.version))
+				&& reader.Read(haveCompatibleVersion)
+				&& (haveCompatibleVersion == 0
+					|| reader.ReadVersion(resolvable.compatibleVersion));
+			if (success) {
+				resolvable.haveVersion = haveVersion != 0;
+				resolvable.haveCompatibleVersion = haveCompatibleVersion != 0;
+			}
+			break;
+		}
+
+		case B_PACKAGE_INFO_REQUIRES:
+		{
+			BHPKG::BPackageResolvableExpressionData& expression
+				= value.resolvableExpression;
+			uint8 haveOpAndVersion;
+			uint32 op = 0;
+			success = reader.ReadString(expression.name)
+				&& reader.Read(haveOpAndVersion)
+				&& (haveOpAndVersion == 0
+					|| (reader.Read(op)
+						&& reader.ReadVersion(expression.version)));
+			if (success) {
+				expression.haveOpAndVersion = haveOpAndVersion != 0;
+				expression.op = (BPackageResolvableOperator)op;
+			}
+			break;
+		}
+
+		default:
+			success = false;
+			break;
+	}
+
+	if (!success)
+		RETURN_ERROR(B_BAD_DATA);
+
+	return handler->HandlePackageAttribute(value);
+}
+
+
+void
+MountIndex::_Unload()
+{
+	if (fRecords != NULL) {
+		PackageRecord* record = fRecords->Clear(true);
+		while (record != NULL) {
+			PackageRecord* next = record->hashNext;
+			delete record;
+			record = next;
+		}
+	}
+
+	free(fFileBuffer);
+	fFileBuffer = NULL;
+}
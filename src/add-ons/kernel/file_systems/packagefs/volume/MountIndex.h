@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MOUNT_INDEX_H
+#define MOUNT_INDEX_H
+
+
+#include <sys/stat.h>
+
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageInfoAttributeValue.h>
+
+#include <lock.h>
+#include <util/OpenHashTable.h>
+
+#include "Package.h"
+
+
+using BPackageKit::BHPKG::BPackageContentHandler;
+using BPackageKit::BHPKG::BPackageData;
+using BPackageKit::BHPKG::BPackageEntry;
+using BPackageKit::BHPKG::BPackageEntryAttribute;
+using BPackageKit::BHPKG::BPackageInfoAttributeValue;
+using BPackageKit::BHPKG::BPackageVersionData;
+
+
+/*!	A persistent snapshot of the parsed content of a volume's packages.
+
+	For each package the content handler callbacks the package reader issued
+	while parsing the package attributes and the TOC are recorded. On the next
+	mount they are replayed from the snapshot instead -- provided the package
+	file's node ID, size, and modification time still match -- which saves
+	reading and decompressing the TOCs. Since the callbacks are recorded before
+	any package settings are applied, changed settings don't invalidate the
+	snapshot.
+*/
+class MountIndex {
+public:
+			class Recorder;
+
+public:
+								MountIndex();
+								~MountIndex();
+
+			status_t			Init();
+
+			status_t			Load(int directoryFD, const char* path);
+			status_t			Store(int directoryFD, const char* path,
+									const PackageFileNameHashTable& packages);
+
+			status_t			ReplayPackage(const char* fileName,
+									const struct stat& st,
+									BPackageContentHandler* handler);
+									// B_ENTRY_NOT_FOUND, if the package isn't
+									// in the index or has changed
+			status_t			AddPackage(const char* fileName,
+									const struct stat& st,
+									Recorder& recorder);
+
+			int32				ReplayedPackages() const
+									{ return fReplayedPackages; }
+			int32				RecordedPackages() const
+									{ return fRecordedPackages; }
+
+private:
+			struct PackageRecord;
+			struct PackageRecordHashDefinition;
+			struct Reader;
+
+			typedef BOpenHashTable<PackageRecordHashDefinition>
+				PackageRecordTable;
+
+private:
+			status_t			_ReplayEntry(Reader& reader,
+									BPackageEntry* parent,
+									BPackageContentHandler* handler,
+									int32 depth);
+			status_t			_ReplayPackageAttribute(Reader& reader,
+									BPackageContentHandler* handler);
+
+			void				_Unload();
+
+private:
+			mutex				fLock;
+			PackageRecordTable*	fRecords;
+			uint8*				fFileBuffer;
+			int32				fReplayedPackages;
+			int32				fRecordedPackages;
+};
+
+
+class MountIndex::Recorder : public BPackageContentHandler {
+public:
+								Recorder(BPackageContentHandler* target);
+	virtual						~Recorder();
+
+	virtual	status_t			HandleEntry(BPackageEntry* entry);
+	virtual	status_t			HandleEntryAttribute(BPackageEntry* entry,
+									BPackageEntryAttribute* attribute);
+	virtual	status_t			HandleEntryDone(BPackageEntry* entry);
+
+	virtual	status_t			HandlePackageAttribute(
+									const BPackageInfoAttributeValue& value);
+
+	virtual	void				HandleErrorOccurred();
+
+			status_t			Error() const	{ return fError; }
+
+			uint8*				DetachData(size_t& _size);
+
+private:
+			void				_Write(const void* buffer, size_t size);
+			void				_WriteUInt8(uint8 value)
+									{ _Write(&value, sizeof(value)); }
+			void				_WriteUInt32(uint32 value)
+									{ _Write(&value, sizeof(value)); }
+			void				_WriteUInt64(uint64 value)
+									{ _Write(&value, sizeof(value)); }
+			void				_WriteString(const char* string);
+			void				_WriteData(const BPackageData& data);
+			void				_WriteVersion(
+									const BPackageVersionData& version);
+
+private:
+			BPackageContentHandler* fTarget;
+			uint8*				fData;
+			size_t				fSize;
+			size_t				fCapacity;
+			status_t			fError;
+};
+
+
+#endif	// MOUNT_INDEX_H
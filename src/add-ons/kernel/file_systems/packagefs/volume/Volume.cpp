@@ -13,6 +13,7 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <new>
 
 #include <AppDefs.h>
@@ -26,6 +27,8 @@
 #include <AutoDeleterDrivers.h>
 #include <PackagesDirectoryDefs.h>
 
+#include <smp.h>
+#include <util/Vector.h>
 #include <vfs.h>
 
 #include "AttributeIndex.h"
@@ -63,6 +66,9 @@ const size_t kMaxActivationRequestSize = 10 * 1024 * 1024;
 // sanity limit for activation file size
 const size_t kMaxActivationFileSize = 10 * 1024 * 1024;
 
+// maximum number of threads loading packages in parallel
+const int32 kMaxPackageLoaderThreads = 8;
+
 static const char* const kAdministrativeDirectoryName
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY;
 static const char* const kActivationFileName
@@ -70,6 +76,11 @@ static const char* const kActivationFileName
 static const char* const kActivationFilePath
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/"
 		PACKAGES_DIRECTORY_ACTIVATION_FILE;
+static const char* const kMountIndexFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/"
+		PACKAGES_DIRECTORY_MOUNT_INDEX_FILE;
+
+static const char* const kSettingsFileName = "packagefs";
 
 
 // #pragma mark - ShineThroughDirectory
@@ -161,6 +172,89 @@ private:
 };
 
 
+// #pragma mark - PackageLoader
+
+
+/*!	Loads a set of packages using several threads. Parsing the package TOCs
+	doesn't touch any volume state, so the packages can be loaded
+	independently; only adding them to the volume has to be serialized.
+*/
+struct Volume::PackageLoader {
+	PackageLoader(Volume* volume, PackagesDirectory* packagesDirectory,
+		const char* const* names, int32 count, BReference<Package>* packages,
+		status_t* errors)
+		:
+		fVolume(volume),
+		fPackagesDirectory(packagesDirectory),
+		fNames(names),
+		fCount(count),
+		fNextIndex(0),
+		fPackages(packages),
+		fErrors(errors)
+	{
+	}
+
+	int32 Run()
+	{
+		int32 threadCount = std::min(std::min(fCount, smp_get_num_cpus()),
+			kMaxPackageLoaderThreads);
+
+		// The current thread does its share of the work, too.
+		thread_id threads[kMaxPackageLoaderThreads];
+		int32 spawnedCount = 0;
+		for (int32 i = 1; i < threadCount; i++) {
+			thread_id thread = spawn_kernel_thread(&_LoaderThread,
+				"packagefs loader", B_NORMAL_PRIORITY, this);
+			if (thread < 0)
+				break;
+
+			threads[spawnedCount++] = thread;
+			resume_thread(thread);
+		}
+
+		_Load();
+
+		for (int32 i = 0; i < spawnedCount; i++) {
+			status_t result;
+			wait_for_thread(threads[i], &result);
+		}
+
+		return spawnedCount + 1;
+	}
+
+private:
+	static status_t _LoaderThread(void* data)
+	{
+		((PackageLoader*)data)->_Load();
+		return B_OK;
+	}
+
+	void _Load()
+	{
+		for (;;) {
+			int32 index = atomic_add(&fNextIndex, 1);
+			if (index >= fCount)
+				break;
+
+			Package* package;
+			fErrors[index] = fVolume->_LoadPackage(fPackagesDirectory,
+				fNames[index], package);
+			if (fErrors[index] == B_OK)
+				fPackages[index].SetTo(package, true);
+		}
+	}
+
+private:
+	Volume*				fVolume;
+	PackagesDirectory*	fPackagesDirectory;
+	const char* const*	fNames;
+	int32				fCount;
+	int32				fNextIndex;
+	BReference<Package>* fPackages;
+	status_t*			fErrors;
+};
+
+
 // #pragma mark - Volume
 
 
@@ -173,6 +267,9 @@ Volume::Volume(fs_volume* fsVolume)
 	fPackagesDirectories(),
 	fPackagesDirectoriesByNodeRef(),
 	fPackageSettings(),
+	fMountIndex(NULL),
+	fUseMountIndex(true),
+	fMeasureMount(false),
 	fNextNodeID(kRootDirectoryID + 1)
 {
 	rw_lock_init(&fLock, "packagefs volume");
@@ -350,6 +447,8 @@ Volume::Mount(const char* parameterString)
 	if (error != B_OK)
 		RETURN_ERROR(error);
 
+	_LoadSettings();
+
 	// load package settings
 	error = fPackageSettings.Load(fMountPoint.deviceID, fMountPoint.nodeID,
 		fMountType);
@@ -742,8 +841,107 @@ Volume::_LoadOldPackagesStates(const char* packagesState)
 }
 
 
+/*!	Reads the packagefs driver settings, which allow to turn off the mount
+	index ("mount_index false"), and to have the time it takes to add the
+	initial packages printed ("measure_mount true").
+*/
+void
+Volume::_LoadSettings()
+{
+	DriverSettingsUnloader settingsHandle(
+		load_driver_settings(kSettingsFileName));
+	if (!settingsHandle.IsSet())
+		return;
+
+	fUseMountIndex = get_driver_boolean_parameter(settingsHandle.Get(),
+		"mount_index", true, true);
+	fMeasureMount = get_driver_boolean_parameter(settingsHandle.Get(),
+		"measure_mount", false, true);
+}
+
+
 status_t
 Volume::_AddInitialPackages()
+{
+	bigtime_t startTime = system_time();
+
+	// Load the mount index. Packages that are found in it don't need to be
+	// parsed.
+	ObjectDeleter<MountIndex> mountIndexDeleter;
+	if (fUseMountIndex) {
+		fMountIndex = new(std::nothrow) MountIndex;
+		if (fMountIndex == NULL || fMountIndex->Init() != B_OK) {
+			delete fMountIndex;
+			fMountIndex = NULL;
+		} else {
+			mountIndexDeleter.SetTo(fMountIndex);
+
+			status_t error = fMountIndex->Load(
+				fPackagesDirectory->DirectoryFD(), kMountIndexFilePath);
+			if (error != B_OK && error != B_ENTRY_NOT_FOUND) {
+				INFORM("Failed to load the mount index: %s\n",
+					strerror(error));
+			}
+		}
+	}
+
+	status_t error = _LoadInitialPackages();
+	fMountIndex = NULL;
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	bigtime_t loadTime = system_time();
+
+	// add the packages to the node tree
+	{
+		VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
+		VolumeWriteLocker volumeLocker(this);
+		for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
+			Package* package = it.Next();) {
+			error = _AddPackageContent(package, false);
+			if (error != B_OK) {
+				for (it.Rewind(); Package* activePackage = it.Next();) {
+					if (activePackage == package)
+						break;
+					_RemovePackageContent(activePackage, NULL, false);
+				}
+				RETURN_ERROR(error);
+			}
+		}
+	}
+
+	bigtime_t addTime = system_time();
+
+	// Update the mount index for the next time. Failing to do so isn't an
+	// error, we'll just have to parse the packages again.
+	MountIndex* mountIndex = mountIndexDeleter.Get();
+	if (mountIndex != NULL) {
+		error = mountIndex->Store(fPackagesDirectory->DirectoryFD(),
+			kMountIndexFilePath, fPackages);
+		if (error != B_OK && error != B_ENTRY_NOT_FOUND
+			&& error != B_READ_ONLY_DEVICE) {
+			INFORM("Failed to store the mount index: %s\n", strerror(error));
+		}
+	}
+
+	if (fMeasureMount) {
+		int32 packageCount = fPackages.CountElements();
+		int32 replayedCount = mountIndex != NULL
+			? mountIndex->ReplayedPackages() : 0;
+		INFORM("Added %" B_PRId32 " packages (%" B_PRId32 " from the mount "
+			"index) from \"%s\" in %" B_PRIdBIGTIME " us: loading %"
+			B_PRIdBIGTIME " us, adding %" B_PRIdBIGTIME " us, updating the "
+			"mount index %" B_PRIdBIGTIME " us\n", packageCount, replayedCount,
+			fPackagesDirectory->Path(), system_time() - startTime,
+			loadTime - startTime, addTime - loadTime, system_time() - addTime);
+	}
+
+	return B_OK;
+}
+
+
+status_t
+Volume::_LoadInitialPackages()
 {
 	PackagesDirectory* packagesDirectory = fPackagesDirectories.Last();
 	INFORM("Adding packages from \"%s\"\n", packagesDirectory->Path());
@@ -787,22 +985,6 @@ Volume::_AddInitialPackages()
 			RETURN_ERROR(error);
 	}
 
-	// add the packages to the node tree
-	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
-	VolumeWriteLocker volumeLocker(this);
-	for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
-		Package* package = it.Next();) {
-		error = _AddPackageContent(package, false);
-		if (error != B_OK) {
-			for (it.Rewind(); Package* activePackage = it.Next();) {
-				if (activePackage == package)
-					break;
-				_RemovePackageContent(activePackage, NULL, false);
-			}
-			RETURN_ERROR(error);
-		}
-	}
-
 	return B_OK;
 }
 
@@ -854,8 +1036,20 @@ Volume::_AddInitialPackagesFromActivationFile(
 	// null-terminate to simplify parsing
 	fileContent[st.st_size] = '\0';
 
-	// parse the file and add the respective packages
-	const char* packageName = fileContent;
+	// parse the file and collect the package names
+	int32 maxPackageCount = 1;
+	for (off_t i = 0; i < st.st_size; i++) {
+		if (fileContent[i] == '\n')
+			maxPackageCount++;
+	}
+
+	const char** packageNames = new(std::nothrow) const char*[maxPackageCount];
+	if (packageNames == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	ArrayDeleter<const char*> packageNamesDeleter(packageNames);
+	int32 packageCount = 0;
+
+	char* packageName = fileContent;
 	char* const fileContentEnd = fileContent + st.st_size;
 	while (packageName < fileContentEnd) {
 		char* packageNameEnd = strchr(packageName, '\n');
@@ -874,15 +1068,13 @@ Volume::_AddInitialPackagesFromActivationFile(
 			RETURN_ERROR(B_BAD_DATA);
 		}
 
-		status_t error = _LoadAndAddInitialPackage(packagesDirectory,
-			packageName);
-		if (error != B_OK)
-			RETURN_ERROR(error);
-
+		packageNames[packageCount++] = packageName;
 		packageName = packageNameEnd + 1;
 	}
 
-	return B_OK;
+	// load and add the packages
+	return _LoadAndAddInitialPackages(packagesDirectory, packageNames,
+		packageCount, false);
 }
 
 
@@ -903,6 +1095,8 @@ Volume::_AddInitialPackagesFromDirectory()
 		RETURN_ERROR(errno);
 	}
 
+	// collect the package names
+	Vector<String> packageNames;
 	while (dirent* entry = readdir(dir.Get())) {
 		// skip "." and ".."
 		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
@@ -915,28 +1109,62 @@ Volume::_AddInitialPackagesFromDirectory()
 			continue;
 		}
 
-		_LoadAndAddInitialPackage(fPackagesDirectory, entry->d_name);
+		String name;
+		if (!name.SetTo(entry->d_name) || packageNames.PushBack(name) != B_OK)
+			RETURN_ERROR(B_NO_MEMORY);
 	}
 
-	return B_OK;
+	// load and add the packages -- ignore the ones that fail to load
+	int32 packageCount = packageNames.Count();
+	const char** names = new(std::nothrow) const char*[packageCount];
+	if (names == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	ArrayDeleter<const char*> namesDeleter(names);
+
+	for (int32 i = 0; i < packageCount; i++)
+		names[i] = packageNames.ElementAt(i);
+
+	return _LoadAndAddInitialPackages(fPackagesDirectory, names, packageCount,
+		true);
 }
 
 
 status_t
-Volume::_LoadAndAddInitialPackage(PackagesDirectory* packagesDirectory,
-	const char* name)
+Volume::_LoadAndAddInitialPackages(PackagesDirectory* packagesDirectory,
+	const char* const* names, int32 count, bool ignoreErrors)
 {
-	Package* package;
-	status_t error = _LoadPackage(packagesDirectory, name, package);
-	if (error != B_OK) {
-		ERROR("Failed to load package \"%s\": %s\n", name, strerror(error));
-		RETURN_ERROR(error);
+	if (count == 0)
+		return B_OK;
+
+	BReference<Package>* packages
+		= new(std::nothrow) BReference<Package>[count];
+	if (packages == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	ArrayDeleter<BReference<Package> > packagesDeleter(packages);
+
+	status_t* errors = new(std::nothrow) status_t[count];
+	if (errors == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	ArrayDeleter<status_t> errorsDeleter(errors);
+
+	_LoadPackages(packagesDirectory, names, count, packages, errors);
+
+	for (int32 i = 0; i < count; i++) {
+		if (errors[i] != B_OK) {
+			ERROR("Failed to load package \"%s\": %s\n", names[i],
+				strerror(errors[i]));
+			if (!ignoreErrors)
+				RETURN_ERROR(errors[i]);
+		}
 	}
-	BReference<Package> packageReference(package, true);
 
+	// add the packages in the original order
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
-	_AddPackage(package);
+	for (int32 i = 0; i < count; i++) {
+		if (packages[i].IsSet())
+			_AddPackage(packages[i].Get());
+	}
 
 	return B_OK;
 }
@@ -1487,7 +1715,7 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 	if (error != B_OK)
 		return error;
 
-	error = package->Load(fPackageSettings);
+	error = package->Load(fPackageSettings, fMountIndex);
 	if (error != B_OK)
 		return error;
 
@@ -1496,6 +1724,29 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 }
 
 
+/*!	Loads the given packages in parallel. For each name the respective
+	elements of \a packages and \a errors are set. The packages are not added
+	to the volume.
+*/
+void
+Volume::_LoadPackages(PackagesDirectory* packagesDirectory,
+	const char* const* names, int32 count, BReference<Package>* packages,
+	status_t* errors)
+{
+	if (count == 0)
+		return;
+
+	bigtime_t startTime = system_time();
+
+	PackageLoader loader(this, packagesDirectory, names, count, packages,
+		errors);
+	int32 threadCount = loader.Run();
+
+	INFORM("Loaded %" B_PRId32 " packages using %" B_PRId32 " threads in %"
+		B_PRIdBIGTIME " us\n", count, threadCount, system_time() - startTime);
+}
+
+
 status_t
 Volume::_ChangeActivation(ActivationChangeRequest& request)
 {
@@ -1567,24 +1818,34 @@ Volume::_ChangeActivation(ActivationChangeRequest& request)
 			oldPackageReferences);
 
 	// load all new packages
+	const char** newPackageNames
+		= new(std::nothrow) const char*[newPackageCount];
+	status_t* newPackageErrors = new(std::nothrow) status_t[newPackageCount];
+	ArrayDeleter<const char*> newPackageNamesDeleter(newPackageNames);
+	ArrayDeleter<status_t> newPackageErrorsDeleter(newPackageErrors);
+	if (newPackageNames == NULL || newPackageErrors == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
 	int32 newPackageIndex = 0;
 	for (uint32 i = 0; i < itemCount; i++) {
 		PackageFSActivationChangeItem* item = request.ItemAt(i);
-
-		if (item->type != PACKAGE_FS_ACTIVATE_PACKAGE
-			&& item->type != PACKAGE_FS_REACTIVATE_PACKAGE) {
-			continue;
+		if (item->type == PACKAGE_FS_ACTIVATE_PACKAGE
+			|| item->type == PACKAGE_FS_REACTIVATE_PACKAGE) {
+			newPackageNames[newPackageIndex++] = item->name;
 		}
+	}
+
+	_LoadPackages(fPackagesDirectory, newPackageNames, newPackageCount,
+		newPackageReferences, newPackageErrors);
 
-		Package* package;
-		status_t error = _LoadPackage(fPackagesDirectory, item->name, package);
+	for (newPackageIndex = 0; newPackageIndex < newPackageCount;
+			newPackageIndex++) {
+		status_t error = newPackageErrors[newPackageIndex];
 		if (error != B_OK) {
 			ERROR("Volume::_ChangeActivation(): failed to load package "
-				"\"%s\"\n", item->name);
+				"\"%s\"\n", newPackageNames[newPackageIndex]);
 			RETURN_ERROR(error);
 		}
-
-		newPackageReferences[newPackageIndex++].SetTo(package, true);
 	}
 
 	// apply the changes
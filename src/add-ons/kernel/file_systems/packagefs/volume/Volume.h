@@ -17,6 +17,7 @@
 #include <packagefs.h>
 
 #include "Index.h"
+#include "MountIndex.h"
 #include "Node.h"
 #include "NodeListener.h"
 #include "Package.h"
@@ -108,18 +109,23 @@ private:
 private:
 			struct ShineThroughDirectory;
 			struct ActivationChangeRequest;
+			struct PackageLoader;
 
 private:
 			status_t			_LoadOldPackagesStates(
 									const char* packagesState);
 
+			void				_LoadSettings();
+
 			status_t			_AddInitialPackages();
+			status_t			_LoadInitialPackages();
 			status_t			_AddInitialPackagesFromActivationFile(
 									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromDirectory();
-			status_t			_LoadAndAddInitialPackage(
+			status_t			_LoadAndAddInitialPackages(
 									PackagesDirectory* packagesDirectory,
-									const char* name);
+									const char* const* names, int32 count,
+									bool ignoreErrors);
 
 	inline	void				_AddPackage(Package* package);
 	inline	void				_RemovePackage(Package* package);
@@ -155,6 +161,11 @@ private:
 			status_t			_LoadPackage(
 									PackagesDirectory* packagesDirectory,
 									const char* name, Package*& _package);
+			void				_LoadPackages(
+									PackagesDirectory* packagesDirectory,
+									const char* const* names, int32 count,
+									BReference<Package>* packages,
+									status_t* errors);
 
 			status_t			_ChangeActivation(
 									ActivationChangeRequest& request);
@@ -189,6 +200,10 @@ private:
 			PackagesDirectoryList fPackagesDirectories;
 			PackagesDirectoryHashTable fPackagesDirectoriesByNodeRef;
 			PackageSettings		fPackageSettings;
+			MountIndex*			fMountIndex;
+									// only while mounting
+			bool				fUseMountIndex;
+			bool				fMeasureMount;
 
 			struct {
 				dev_t			deviceID;
@@ -53,6 +53,9 @@
 #define DATA_NODE_READ_ONLY		0x1
 #define DATA_NODE_STORED_HEADER	0x2
 
+#define MAX_EXTERNAL_NODE_SIZE	(32 * 1024)
+	// must fit into data_node::used
+
 struct header_space {
 	uint16	size;
 	uint16	free;
@@ -70,6 +73,8 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	net_buffer_external* external;
+		// the memory the nodes of this header refer to, if not NULL
 };
 
 struct data_node {
@@ -159,6 +164,8 @@ static status_t append_data(net_buffer* buffer, const void* data, size_t size);
 static status_t trim_data(net_buffer* _buffer, size_t newSize);
 static status_t remove_header(net_buffer* _buffer, size_t bytes);
 static status_t remove_trailer(net_buffer* _buffer, size_t bytes);
+static status_t append_external_data(net_buffer* _buffer, const void* data,
+	size_t size, net_buffer_external* external);
 static status_t append_cloned_data(net_buffer* _buffer, net_buffer* _source,
 					uint32 offset, size_t bytes);
 static status_t read_data(net_buffer* _buffer, size_t offset, void* data,
@@ -813,6 +820,7 @@ create_data_header(size_t headerSpace)
 	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
 		- headerSpace;
 	header->first_free = NULL;
+	header->external = NULL;
 
 	TRACE(("%d:   create new data header %p\n", find_thread(NULL), header));
 	T2(CreateDataHeader(header));
@@ -829,6 +837,11 @@ release_data_header(data_header* header)
 		return;
 
 	TRACE(("%d:   free header %p\n", find_thread(NULL), header));
+
+	net_buffer_external* external = header->external;
+	if (external != NULL && atomic_add(&external->ref_count, -1) == 1)
+		external->free(external);
+
 	free_data_header(header);
 }
 
@@ -2008,6 +2021,68 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 }
 
 
+/*!	Appends \a size bytes of \a data without copying them. The memory must
+	not be changed as long as any buffer refers to it, which is ensured by
+	a reference to \a external each such buffer holds.
+	The data is read-only as far as the buffer is concerned.
+*/
+static status_t
+append_external_data(net_buffer* _buffer, const void* data, size_t size,
+	net_buffer_external* external)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+	TRACE(("%d: append_external_data(buffer %p, data %p, size %ld)\n",
+		find_thread(NULL), buffer, data, size));
+
+	if (size == 0)
+		return B_OK;
+	if (IS_USER_ADDRESS(data) || external == NULL)
+		return B_BAD_VALUE;
+
+	ParanoiaChecker _(buffer);
+
+	// The external data gets a header of its own, which doesn't contain any
+	// data, but keeps the external memory alive as long as any node refers
+	// to it.
+	data_header* header = create_data_header(0);
+	if (header == NULL)
+		return B_NO_MEMORY;
+
+	header->tail_space = 0;
+	header->external = external;
+	atomic_add(&external->ref_count, 1);
+
+	size_t sizeAppended = 0;
+	while (sizeAppended < size) {
+		data_node* node = add_data_node(buffer, header);
+		if (node == NULL) {
+			remove_trailer(buffer, sizeAppended);
+			release_data_header(header);
+			return ENOBUFS;
+		}
+
+		node->offset = buffer->size;
+		node->start = (uint8*)data + sizeAppended;
+		node->used = min_c(size - sizeAppended, (size_t)MAX_EXTERNAL_NODE_SIZE);
+		node->flags = DATA_NODE_READ_ONLY;
+
+		list_add_item(&buffer->buffers, node);
+
+		buffer->size += node->used;
+		sizeAppended += node->used;
+	}
+
+	// the nodes hold their own references now
+	release_data_header(header);
+
+	CHECK_BUFFER(buffer);
+	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
+		sizeof(buffer->size));
+
+	return B_OK;
+}
+
+
 void
 set_ancillary_data(net_buffer* buffer, ancillary_data_container* container)
 {
@@ -2402,5 +2477,7 @@ net_buffer_module_info gNetBufferModule = {
 	swap_addresses,
 
 	dump_buffer,	// dump
+
+	append_external_data,
 };
 
@@ -1488,6 +1488,72 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+/*!	Sends \a length bytes of kernel memory at \a data over the connected
+	\a socket without copying them, referring to them via \a external.
+	Only protocols that pass the buffers down the stack support this, for
+	all others \c B_NOT_SUPPORTED is returned and the caller has to fall back
+	to socket_send().
+*/
+ssize_t
+socket_send_external(net_socket* socket, const void* data, size_t length,
+	int flags, net_buffer_external* external)
+{
+	if (length > SSIZE_MAX)
+		return B_BAD_VALUE;
+
+	if (socket->first_info->send_data_no_buffer != NULL
+		|| (socket->first_info->flags & NET_PROTOCOL_ATOMIC_MESSAGES) != 0) {
+		return B_NOT_SUPPORTED;
+	}
+
+	if (socket->peer.ss_len == 0)
+		return ENOTCONN;
+
+	const sockaddr* address = (const sockaddr*)&socket->peer;
+	socklen_t addressLength = socket->peer.ss_len;
+
+	size_t bytesLeft = length;
+	ssize_t bytesSent = 0;
+
+	while (bytesLeft > 0) {
+		net_buffer* buffer = gNetBufferModule.create(256);
+		if (buffer == NULL)
+			return bytesSent > 0 ? bytesSent : ENOBUFS;
+
+		size_t bytes = min_c(bytesLeft, socket->send.buffer_size);
+		if (gNetBufferModule.append_external(buffer,
+				(const uint8*)data + bytesSent, bytes, external) != B_OK) {
+			gNetBufferModule.free(buffer);
+			return bytesSent > 0 ? bytesSent : ENOBUFS;
+		}
+
+		buffer->flags = flags;
+		memcpy(buffer->source, &socket->address, socket->address.ss_len);
+		memcpy(buffer->destination, address, addressLength);
+		buffer->destination->sa_len = addressLength;
+
+		status_t status = socket->first_info->send_data(socket->first_protocol,
+			buffer);
+		if (status != B_OK) {
+			size_t sizeAfterSend = buffer->size;
+			gNetBufferModule.free(buffer);
+
+			if ((sizeAfterSend != bytes || bytesSent > 0)
+				&& (status == B_INTERRUPTED || status == B_WOULD_BLOCK)) {
+				// this appears to be a partial write
+				return bytesSent + (bytes - sizeAfterSend);
+			}
+			return status;
+		}
+
+		bytesLeft -= bytes;
+		bytesSent += bytes;
+	}
+
+	return bytesSent;
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1774,6 +1840,8 @@ net_socket_module_info gNetSocketModule = {
 	socket_send,
 	socket_setsockopt,
 	socket_shutdown,
-	socket_socketpair
+	socket_socketpair,
+
+	socket_send_external
 };
 
@@ -28,6 +28,18 @@ main(int argc, char **argv)
 
 	_kern_generic_syscall(LAUNCH_SPEEDUP_SYSCALLS, LAUNCH_SPEEDUP_STOP_SESSION,
 		(void *)"system boot", strlen("system boot"));
+
+	if (argc > 1 && !strcmp(argv[1], "--stats")) {
+		launch_speedup_stats stats;
+		if (_kern_generic_syscall(LAUNCH_SPEEDUP_SYSCALLS,
+				LAUNCH_SPEEDUP_GET_STATS, &stats, sizeof(stats)) == B_OK) {
+			printf("boot took %" B_PRIdBIGTIME " ms\n", stats.boot_time / 1000);
+			printf("%" B_PRIu32 " sessions prefetched %" B_PRIu64 " KB (%"
+				B_PRIu64 " KB read), %" B_PRIu64 " KB were used\n",
+				stats.sessions, stats.profile_bytes / 1024,
+				stats.read_bytes / 1024, stats.used_bytes / 1024);
+		}
+	}
 	return 0;
 }
 
@@ -139,7 +139,8 @@ struct VersionPolicyV2 {
 	{
 		return packageReader.Init(fileName,
 			BPackageKit::BHPKG
-				::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
+				::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE
+			| BPackageKit::BHPKG::B_HPKG_READER_CACHE_CHUNKS);
 	}
 
 	static status_t GetHeapReader(PackageReader& packageReader,
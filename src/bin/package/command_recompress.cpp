@@ -45,6 +45,7 @@ command_recompress(int argc, const char* const* argv)
 	bool quiet = false;
 	bool verbose = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
+	int32 threadCount = 1;
 	int32 compression = parse_compression_argument(NULL);
 
 	while (true) {
@@ -56,7 +57,7 @@ command_recompress(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+0123456789:hz:qv",
+		int c = getopt_long(argc, (char**)argv, "+0123456789:hj:z:qv",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -79,6 +80,10 @@ command_recompress(int argc, const char* const* argv)
 				print_usage_and_exit(false);
 				break;
 
+			case 'j':
+				threadCount = parse_thread_count_argument(optarg);
+				break;
+
 			case 'z':
 				compression = parse_compression_argument(optarg);
 				break;
@@ -127,6 +132,7 @@ command_recompress(int argc, const char* const* argv)
 		compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE;
 	writerParameters.SetCompression(compression);
 	writerParameters.SetCompressionLevel(compressionLevel);
+	writerParameters.SetCompressionThreadCount(threadCount);
 
 	PackageWriterListener listener(verbose, quiet);
 	BPackageWriter packageWriter(&listener);
@@ -37,6 +37,8 @@ static const char* kUsage =
 	"    -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                 \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
 	"                 existing.\n"
+	"    -j <count> - Compress using <count> threads. 0 means one per CPU.\n"
+	"                 Defaults to 1.\n"
 	"    -q         - Be quiet (don't show any output except for errors).\n"
 	"    -v         - Be verbose (show more info about created package).\n"
 	"\n"
@@ -63,6 +65,8 @@ static const char* kUsage =
 	"                 an option only for use in package building. It will cause\n"
 	"                 the package .self link to point to <path>, which is useful\n"
 	"                 to redirect a \"make install\". Only allowed with -b.\n"
+	"    -j <count> - Compress using <count> threads. 0 means one per CPU.\n"
+	"                 Defaults to 1.\n"
 	"    -z <type>  - Specify compression method to use.\n"
 	"    -q         - Be quiet (don't show any output except for errors).\n"
 	"    -v         - Be verbose (show more info about created package).\n"
@@ -109,6 +113,8 @@ static const char* kUsage =
 	"\n"
 	"    -0 ... -9  - Use compression level 0 ... 9. 0 means no, 9 best compression.\n"
 	"                 Defaults to 9.\n"
+	"    -j <count> - Compress using <count> threads. 0 means one per CPU.\n"
+	"                 Defaults to 1.\n"
 	"    -z <type>  - Specify compression method to use.\n"
 	"    -q         - Be quiet (don't show any output except for errors).\n"
 	"    -v         - Be verbose (show more info about created package).\n"
@@ -149,6 +155,20 @@ parse_compression_argument(const char* arg)
 }
 
 
+int32
+parse_thread_count_argument(const char* arg)
+{
+	char* end;
+	long count = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || count < 0 || count > 1024) {
+		fprintf(stderr, "error: invalid thread count '%s'\n", arg);
+		exit(1);
+	}
+
+	return (int32)count;
+}
+
+
 int
 main(int argc, const char* const* argv)
 {
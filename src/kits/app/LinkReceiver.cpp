@@ -52,9 +52,10 @@ namespace BPrivate {
 
 LinkReceiver::LinkReceiver(port_id port)
 	:
-	fReceivePort(port), fRecvBuffer(NULL), fRecvPosition(0), fRecvStart(0),
-	fRecvBufferSize(0), fDataSize(0),
-	fReplySize(0), fReadError(B_OK)
+	fReceivePort(port), fRecvBuffer(NULL), fData(NULL), fRecvPosition(0),
+	fRecvStart(0), fRecvBufferSize(0), fDataSize(0),
+	fReplySize(0), fReadError(B_OK),
+	fRing(NULL), fRingSize(0), fRingSegmentEnd(0), fReadingRing(false)
 {
 }
 
@@ -87,11 +88,11 @@ LinkReceiver::GetNextMessage(int32 &code, bigtime_t timeout)
 		if (err < B_OK)
 			return err;
 		remaining = fDataSize;
-		header = (message_header *)fRecvBuffer;
+		header = (message_header *)fData;
 	} else {
 		fRecvStart += fReplySize;	// start of the next message
 		fRecvPosition = fRecvStart;
-		header = (message_header *)(fRecvBuffer + fRecvStart);
+		header = (message_header *)(fData + fRecvStart);
 	}
 
 	// check we have a well-formed message
@@ -127,13 +128,23 @@ LinkReceiver::HasMessages() const
 }
 
 
+/*!	Returns whether there are more messages that can be read without waiting
+	for the port, as they were received together with the current one.
+*/
+bool
+LinkReceiver::HasBufferedMessages() const
+{
+	return fDataSize - (fRecvStart + fReplySize) > 0;
+}
+
+
 bool
 LinkReceiver::NeedsReply() const
 {
 	if (fReplySize == 0)
 		return false;
 
-	message_header *header = (message_header *)(fRecvBuffer + fRecvStart);
+	message_header *header = (message_header *)(fData + fRecvStart);
 	return (header->flags & kNeedsReply) != 0;
 }
 
@@ -144,7 +155,7 @@ LinkReceiver::Code() const
 	if (fReplySize == 0)
 		return B_ERROR;
 
-	message_header *header = (message_header *)(fRecvBuffer + fRecvStart);
+	message_header *header = (message_header *)(fData + fRecvStart);
 	return header->code;
 }
 
@@ -152,6 +163,13 @@ LinkReceiver::Code() const
 void
 LinkReceiver::ResetBuffer()
 {
+	if (fReadingRing) {
+		// let the sender reuse the segment
+		link_ring_header* header = (link_ring_header*)fRing;
+		atomic_set((int32*)&header->consumed, (int32)fRingSegmentEnd);
+		fReadingRing = false;
+	}
+
 	fRecvPosition = 0;
 	fRecvStart = 0;
 	fDataSize = 0;
@@ -247,6 +265,25 @@ LinkReceiver::ReadFromPort(bigtime_t timeout)
 
 		// we just ignore incorrect messages, and don't bother our caller
 
+		if (code == kLinkRingCode && fRing != NULL
+			&& bytesRead == (ssize_t)sizeof(link_ring_segment)) {
+			link_ring_segment segment;
+			memcpy(&segment, fRecvBuffer, sizeof(segment));
+
+			if (segment.offset > fRingSize
+				|| segment.size > fRingSize - segment.offset) {
+				STRACE(("invalid ring segment received.\n"));
+				continue;
+			}
+
+			// the messages are read from the ring directly
+			fData = fRing + sizeof(link_ring_header) + segment.offset;
+			fDataSize = segment.size;
+			fRingSegmentEnd = segment.end;
+			fReadingRing = true;
+			return B_OK;
+		}
+
 		if (code != kLinkCode) {
 			STRACE(("wrong port message %lx received.\n", code));
 			continue;
@@ -256,11 +293,29 @@ LinkReceiver::ReadFromPort(bigtime_t timeout)
 		break;
 	}
 
+	fData = fRecvBuffer;
 	fDataSize = bytesRead;
 	return B_OK;
 }
 
 
+/*!	Sets the ring buffer in memory shared with the sender that it may pass
+	messages through, see LinkSender::SetRing(). It must not be called while
+	messages from a previous ring are read, as the buffered messages are kept.
+*/
+void
+LinkReceiver::SetRing(void* memory, size_t size)
+{
+	fRing = (char*)memory;
+	fRingSize = 0;
+
+	if (memory != NULL) {
+		memset(memory, 0, sizeof(link_ring_header));
+		fRingSize = size - sizeof(link_ring_header);
+	}
+}
+
+
 status_t
 LinkReceiver::Read(void *data, ssize_t passedSize)
 {
@@ -292,7 +347,7 @@ LinkReceiver::Read(void *data, ssize_t passedSize)
 
 	if (useArea) {
 		area_id sourceArea;
-		memcpy((void*)&sourceArea, fRecvBuffer + fRecvPosition, size);
+		memcpy((void*)&sourceArea, fData + fRecvPosition, size);
 
 		area_info areaInfo;
 		if (get_area_info(sourceArea, &areaInfo) < B_OK)
@@ -307,7 +362,7 @@ LinkReceiver::Read(void *data, ssize_t passedSize)
 			}
 		}
 	} else {
-		memcpy(data, fRecvBuffer + fRecvPosition, size);
+		memcpy(data, fData + fRecvPosition, size);
 	}
 	fRecvPosition += size;
 	return fReadError;
@@ -29,8 +29,11 @@
 #endif
 
 static const size_t kMaxStringSize = 4096;
-static const size_t kWatermark = kInitialBufferSize - 24;
-	// if a message is started after this mark, the buffer is flushed automatically
+static const size_t kWatermarkOffset = 24;
+	// if a message is started less than this before the end of the minimum
+	// buffer size, the buffer is flushed automatically
+static const size_t kMaxRingBufferSize = 16384;
+	// buffer size to collect messages in before they are written to a ring
 
 namespace BPrivate {
 
@@ -43,7 +46,14 @@ LinkSender::LinkSender(port_id port)
 
 	fCurrentEnd(0),
 	fCurrentStart(0),
-	fCurrentStatus(B_OK)
+	fCurrentStatus(B_OK),
+
+	fMinBufferSize(kInitialBufferSize),
+
+	fRing(NULL),
+	fRingSize(0),
+	fRingWritten(0),
+	fRingOffset(0)
 {
 }
 
@@ -78,7 +88,8 @@ LinkSender::StartMessage(int32 code, size_t minSize)
 	// Eventually flush buffer to make space for the new message.
 	// Note, we do not take the actual buffer size into account to not
 	// delay the time between buffer flushes too much.
-	if (fBufferSize > 0 && (minSize > SpaceLeft() || fCurrentStart >= kWatermark)) {
+	if (fBufferSize > 0 && (minSize > SpaceLeft()
+			|| fCurrentStart >= fMinBufferSize - kWatermarkOffset)) {
 		status_t status = Flush();
 		if (status < B_OK)
 			return status;
@@ -231,11 +242,11 @@ status_t
 LinkSender::AdjustBuffer(size_t newSize, char **_oldBuffer)
 {
 	// make sure the new size is within bounds
-	if (newSize <= kInitialBufferSize)
-		newSize = kInitialBufferSize;
+	if (newSize <= fMinBufferSize)
+		newSize = fMinBufferSize;
 	else if (newSize > kMaxBufferSize)
 		return B_BUFFER_OVERFLOW;
-	else if (newSize > kInitialBufferSize)
+	else
 		newSize = (newSize + B_PAGE_SIZE - 1) & ~(B_PAGE_SIZE - 1);
 
 	if (newSize == fBufferSize) {
@@ -305,15 +316,33 @@ LinkSender::Flush(bigtime_t timeout, bool needsReply)
 	STRACE(("info: LinkSender Flush() waiting to send messages of %ld bytes on port %ld.\n",
 		fCurrentEnd, fPort));
 
+	int32 code = kLinkCode;
+	const void* data = fBuffer;
+	size_t size = fCurrentEnd;
+
+	// If there is room in the ring buffer, only tell the receiver where
+	// to find the messages; otherwise they go through the port as usual.
+	link_ring_segment segment;
+	if (fRing != NULL
+		&& ReserveRingSegment(fCurrentEnd, segment.offset, segment.end)) {
+		segment.size = fCurrentEnd;
+		memcpy(fRing + sizeof(link_ring_header) + segment.offset, fBuffer,
+			fCurrentEnd);
+
+		code = kLinkRingCode;
+		data = &segment;
+		size = sizeof(segment);
+	}
+
 	status_t err;
 	if (timeout != B_INFINITE_TIMEOUT) {
 		do {
-			err = write_port_etc(fPort, kLinkCode, fBuffer,
-				fCurrentEnd, B_RELATIVE_TIMEOUT, timeout);
+			err = write_port_etc(fPort, code, data, size, B_RELATIVE_TIMEOUT,
+				timeout);
 		} while (err == B_INTERRUPTED);
 	} else {
 		do {
-			err = write_port(fPort, kLinkCode, fBuffer, fCurrentEnd);
+			err = write_port(fPort, code, data, size);
 		} while (err == B_INTERRUPTED);
 	}
 
@@ -326,10 +355,73 @@ LinkSender::Flush(bigtime_t timeout, bool needsReply)
 	STRACE(("info: LinkSender Flush() messages total of %ld bytes on port %ld.\n",
 		fCurrentEnd, fPort));
 
+	if (code == kLinkRingCode) {
+		fRingWritten = segment.end;
+		fRingOffset = segment.offset + segment.size;
+	}
+
 	fCurrentEnd = 0;
 	fCurrentStart = 0;
 
 	return B_OK;
 }
 
+
+/*!	Lets Flush() pass the messages through a ring buffer in \a memory, which
+	the receiving side must have been given via LinkReceiver::SetRing() as
+	well. Messages are still collected in the local buffer, but it is allowed
+	to grow larger, since sending it no longer copies it through the kernel.
+	Passing \c NULL goes back to sending everything through the port.
+*/
+status_t
+LinkSender::SetRing(void* memory, size_t size)
+{
+	status_t status = Flush();
+	if (status != B_OK && memory != NULL)
+		return status;
+
+	if (memory != NULL && size <= sizeof(link_ring_header) + kInitialBufferSize)
+		return B_BAD_VALUE;
+
+	fRing = (char*)memory;
+	fRingSize = memory != NULL ? size - sizeof(link_ring_header) : 0;
+	fRingWritten = 0;
+	fRingOffset = 0;
+
+	fMinBufferSize = kInitialBufferSize;
+	if (memory != NULL) {
+		fMinBufferSize = max_c(kInitialBufferSize,
+			min_c(fRingSize / 4, kMaxRingBufferSize));
+	}
+
+	return AdjustBuffer(fMinBufferSize);
+}
+
+
+/*!	Finds \a size contiguous bytes in the ring buffer that the receiver is
+	done with. The space is only taken once the segment has been announced,
+	which Flush() does.
+*/
+bool
+LinkSender::ReserveRingSegment(size_t size, uint32& _offset, uint32& _end)
+{
+	link_ring_header* header = (link_ring_header*)fRing;
+	uint32 used = fRingWritten - (uint32)atomic_get((int32*)&header->consumed);
+
+	// a segment cannot wrap around, the rest of the ring is skipped instead
+	uint32 offset = fRingOffset;
+	uint32 skipped = 0;
+	if (offset + size > fRingSize) {
+		skipped = fRingSize - offset;
+		offset = 0;
+	}
+
+	if (used + skipped + size > fRingSize)
+		return false;
+
+	_offset = offset;
+	_end = fRingWritten + skipped + size;
+	return true;
+}
+
 }	// namespace BPrivate
@@ -13,6 +13,9 @@
 
 
 static const int32 kLinkCode = '_PTL';
+static const int32 kLinkRingCode = '_PTR';
+	// the messages have been written to the shared ring buffer, the port
+	// message only contains a link_ring_segment
 
 static const size_t kInitialBufferSize = 2048;
 static const size_t kMaxBufferSize = 65536;
@@ -26,4 +29,19 @@ struct message_header {
 
 static const uint32 kNeedsReply = 0x01;
 
+// A ring buffer in memory shared by both sides of a link; the header is
+// followed by the ring data.
+struct link_ring_header {
+	uint32	consumed;
+		// the end of the last segment the receiver has finished with
+	uint32	_reserved[15];
+		// keeps the data off the cache line the receiver writes to
+};
+
+struct link_ring_segment {
+	uint32	offset;		// within the ring data
+	uint32	size;
+	uint32	end;		// value for link_ring_header::consumed when done
+};
+
 #endif	/* _LINK_MESSAGE_H_ */
@@ -42,6 +42,7 @@
 #include <Roster.h>
 #include <RosterPrivate.h>
 #include <Screen.h>
+#include <ServerMemoryAllocator.h>
 #include <ServerProtocol.h>
 #include <String.h>
 #include <TextView.h>
@@ -212,6 +213,49 @@ static value_info sWindowValueInfo[] = {
 };
 
 
+/*!	Asks the server for a ring buffer in shared memory that the window's
+	drawing commands can be passed through, instead of copying them through
+	the port. If that fails, the link just keeps using the port.
+	The caller must hold the application's server link lock.
+*/
+static void
+create_command_ring(BPrivate::PortLink& link)
+{
+	link.StartMessage(AS_CREATE_COMMAND_RING);
+
+	int32 code;
+	if (link.FlushWithReply(code) != B_OK || code != B_OK)
+		return;
+
+	uint8 allocationFlags;
+	area_id serverArea;
+	int32 offset;
+	int32 size;
+	link.Read<uint8>(&allocationFlags);
+	link.Read<area_id>(&serverArea);
+	link.Read<int32>(&offset);
+	if (link.Read<int32>(&size) != B_OK)
+		return;
+
+	BPrivate::ServerMemoryAllocator* allocator
+		= BApplication::Private::ServerAllocator();
+
+	area_id area;
+	uint8* base;
+	status_t status;
+	if ((allocationFlags & kNewAllocatorArea) != 0)
+		status = allocator->AddArea(serverArea, area, base, size);
+	else {
+		status = allocator->AreaAndBaseFor(serverArea, area, base);
+		if (status == B_OK)
+			base += offset;
+	}
+
+	if (status == B_OK)
+		link.Sender().SetRing(base, size);
+}
+
+
 void
 _set_menu_sem_(BWindow* window, sem_id sem)
 {
@@ -768,8 +812,12 @@ BWindow::MessageReceived(BMessage* message)
 			} else
 				sendPort = -1;
 
-			// Redirect our link to the new window connection
+			// Redirect our link to the new window connection; the ring
+			// buffer died with the old server
+			fLink->Sender().SetRing(NULL, 0);
 			fLink->SetSenderPort(sendPort);
+			if (sendPort >= 0)
+				create_command_ring(*fLink);
 
 			// connect all views to the server again
 			fTopView->_CreateSelf();
@@ -2882,6 +2930,9 @@ BWindow::_InitData(BRect frame, const char* title, window_look look,
 		// Redirect our link to the new window connection
 		fLink->SetSenderPort(sendPort);
 		STRACE(("Server says that our send port is %ld\n", sendPort));
+
+		if (sendPort >= 0)
+			create_command_ring(*fLink);
 	}
 
 	STRACE(("Window locked?: %s\n", IsLocked() ? "True" : "False"));
@@ -2993,6 +3044,11 @@ BWindow::task_looper()
 				// No more messages: Unlock the looper and terminate the
 				// dispatch loop.
 				dispatchNextMessage = false;
+
+				// Send what has been drawn outside of an update, since
+				// the link buffers a lot more when it has a command ring.
+				if (!fInTransaction)
+					fLink->Flush();
 			} else {
 				// Get the target handler
 				BMessage::Private messagePrivate(fLastMessage);
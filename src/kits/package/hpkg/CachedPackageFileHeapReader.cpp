@@ -0,0 +1,510 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/hpkg/CachedPackageFileHeapReader.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include <DataIO.h>
+
+#include <AutoDeleter.h>
+#include <package/hpkg/PackageFileHeapReader.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+static const size_t kChunkSize = PackageFileHeapAccessorBase::kChunkSize;
+
+// number of chunks per read-ahead thread to decompress in advance
+static const int32 kReadAheadChunksPerThread = 2;
+
+
+/*!	A chunk is in exactly one of these states:
+	- queued for read-ahead (status B_NO_INIT, in fReadAheadQueue),
+	- being loaded (status B_BUSY, referenced by the loading thread),
+	- in use (referenced), or
+	- unused (not referenced, in fUnusedChunks, where it may be evicted).
+	A chunk whose loading failed is deleted when its last reference is put.
+*/
+struct CachedPackageFileHeapReader::Chunk
+	: DoublyLinkedListLinkImpl<CachedPackageFileHeapReader::Chunk> {
+	size_t		index;
+	void*		data;
+	size_t		size;
+	Chunk*		hashNext;
+	int32		referenceCount;
+	status_t	status;
+	bool		readAhead;
+		// loaded in advance and not accessed yet
+};
+
+
+struct CachedPackageFileHeapReader::ChunkHashDefinition {
+	typedef size_t	KeyType;
+	typedef	Chunk	ValueType;
+
+	size_t HashKey(size_t key) const
+	{
+		return key;
+	}
+
+	size_t Hash(const Chunk* value) const
+	{
+		return value->index;
+	}
+
+	bool Compare(size_t key, const Chunk* value) const
+	{
+		return value->index == key;
+	}
+
+	Chunk*& GetLink(Chunk* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+CachedPackageFileHeapReader::CachedPackageFileHeapReader(
+	PackageFileHeapReader* heapReader)
+	:
+	fHeapReader(heapReader),
+	fChunkCount(0),
+	fChunks(NULL),
+	fUnusedChunks(),
+	fReadAheadQueue(),
+	fThreads(NULL),
+	fThreadCount(0),
+	fReadAheadWindow(0),
+	fLastChunkIndex((size_t)-1),
+	fMemoryUsage(0),
+	fMemoryBudget(0),
+	fTerminating(false)
+{
+	pthread_mutex_init(&fLock, NULL);
+	pthread_mutex_init(&fFileLock, NULL);
+	pthread_cond_init(&fChunkLoadedCondition, NULL);
+	pthread_cond_init(&fReadAheadCondition, NULL);
+
+	memset(&fStatistics, 0, sizeof(fStatistics));
+}
+
+
+CachedPackageFileHeapReader::~CachedPackageFileHeapReader()
+{
+	pthread_mutex_lock(&fLock);
+	fTerminating = true;
+	pthread_cond_broadcast(&fReadAheadCondition);
+	pthread_mutex_unlock(&fLock);
+
+	for (int32 i = 0; i < fThreadCount; i++)
+		pthread_join(fThreads[i], NULL);
+	delete[] fThreads;
+
+	if (fChunks != NULL) {
+		Chunk* chunk = fChunks->Clear(true);
+		while (chunk != NULL) {
+			Chunk* next = chunk->hashNext;
+			free(chunk->data);
+			delete chunk;
+			chunk = next;
+		}
+		delete fChunks;
+	}
+
+	pthread_cond_destroy(&fReadAheadCondition);
+	pthread_cond_destroy(&fChunkLoadedCondition);
+	pthread_mutex_destroy(&fFileLock);
+	pthread_mutex_destroy(&fLock);
+}
+
+
+/*!	Initializes the cache to use up to \a memoryBudget bytes for decompressed
+	chunks. If \a readAheadThreadCount is greater than 0, as many threads are
+	started to decompress the chunks following a sequential access in advance.
+
+	The heap reader's file must stay valid as long as this object exists.
+	Reads from the file are serialized, decompression is not.
+*/
+status_t
+CachedPackageFileHeapReader::Init(size_t memoryBudget,
+	int32 readAheadThreadCount)
+{
+	fChunkCount = (fHeapReader->UncompressedHeapSize() + kChunkSize - 1)
+		/ kChunkSize;
+
+	fChunks = new(std::nothrow) ChunkTable;
+	if (fChunks == NULL || fChunks->Init() != B_OK)
+		return B_NO_MEMORY;
+
+	if (readAheadThreadCount > 0) {
+		fThreads = new(std::nothrow) pthread_t[readAheadThreadCount];
+		if (fThreads == NULL)
+			return B_NO_MEMORY;
+
+		// If we fail to create some of the threads, we just live with fewer.
+		for (; fThreadCount < readAheadThreadCount; fThreadCount++) {
+			if (pthread_create(&fThreads[fThreadCount], NULL,
+					&_ReadAheadThreadEntry, this) != 0) {
+				break;
+			}
+		}
+	}
+
+	SetMemoryBudget(memoryBudget);
+	return B_OK;
+}
+
+
+void
+CachedPackageFileHeapReader::SetMemoryBudget(size_t memoryBudget)
+{
+	pthread_mutex_lock(&fLock);
+
+	fMemoryBudget = std::max(memoryBudget, kChunkSize);
+
+	// Don't let read-ahead take up more than half of the cache.
+	fReadAheadWindow = (int32)std::min(
+		(size_t)fThreadCount * kReadAheadChunksPerThread,
+		fMemoryBudget / kChunkSize / 2);
+
+	_EvictChunks(0);
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+void
+CachedPackageFileHeapReader::GetStatistics(ChunkCacheStatistics& _statistics)
+{
+	pthread_mutex_lock(&fLock);
+
+	_statistics = fStatistics;
+	_statistics.cachedChunks = fChunks != NULL ? fChunks->CountElements() : 0;
+	_statistics.memoryUsage = fMemoryUsage;
+	_statistics.memoryBudget = fMemoryBudget;
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+status_t
+CachedPackageFileHeapReader::ReadDataToOutput(off_t offset, size_t size,
+	BDataIO* output)
+{
+	if (size == 0)
+		return B_OK;
+
+	uint64 heapSize = fHeapReader->UncompressedHeapSize();
+	if (offset < 0 || (uint64)offset > heapSize || size > heapSize - offset)
+		return B_BAD_VALUE;
+
+	// buffer to read compressed chunks into on a cache miss
+	void* compressedBuffer = malloc(kChunkSize);
+	if (compressedBuffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter compressedBufferDeleter(compressedBuffer);
+
+	size_t chunkIndex = size_t(offset / kChunkSize);
+	size_t inChunkOffset = (uint64)offset - (uint64)chunkIndex * kChunkSize;
+	size_t remainingBytes = size;
+
+	// We always read ahead the chunks of the request itself. If the request
+	// continues where the previous one ended, we also read ahead beyond its
+	// end.
+	size_t readAheadEnd = size_t((offset + size - 1) / kChunkSize) + 1;
+	pthread_mutex_lock(&fLock);
+	if (chunkIndex == fLastChunkIndex || chunkIndex == fLastChunkIndex + 1)
+		readAheadEnd = fChunkCount;
+	pthread_mutex_unlock(&fLock);
+
+	while (remainingBytes > 0) {
+		pthread_mutex_lock(&fLock);
+
+		Chunk* chunk;
+		status_t error = _GetChunk(chunkIndex, compressedBuffer, chunk);
+		if (error == B_OK)
+			_ReadAhead(chunkIndex, readAheadEnd);
+		fLastChunkIndex = chunkIndex;
+
+		pthread_mutex_unlock(&fLock);
+
+		if (error != B_OK)
+			return error;
+
+		size_t toWrite = std::min(chunk->size - inChunkOffset,
+			remainingBytes);
+		error = output->WriteExactly((uint8*)chunk->data + inChunkOffset,
+			toWrite);
+
+		pthread_mutex_lock(&fLock);
+		_PutChunk(chunk);
+		pthread_mutex_unlock(&fLock);
+
+		if (error != B_OK)
+			return error;
+
+		remainingBytes -= toWrite;
+		chunkIndex++;
+		inChunkOffset = 0;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Returns a reference to the given chunk, loading it, if necessary.
+	The lock must be held. It is temporarily released while loading.
+*/
+status_t
+CachedPackageFileHeapReader::_GetChunk(size_t chunkIndex,
+	void* compressedBuffer, Chunk*& _chunk)
+{
+	Chunk* chunk = fChunks->Lookup(chunkIndex);
+	if (chunk != NULL && chunk->status != B_NO_INIT) {
+		if (chunk->referenceCount == 0 && chunk->status == B_OK)
+			fUnusedChunks.Remove(chunk);
+		chunk->referenceCount++;
+
+		if (chunk->status == B_BUSY) {
+			fStatistics.readAheadWaits++;
+			while (chunk->status == B_BUSY)
+				pthread_cond_wait(&fChunkLoadedCondition, &fLock);
+		} else
+			fStatistics.hits++;
+
+		if (chunk->readAhead) {
+			fStatistics.readAheadHits++;
+			chunk->readAhead = false;
+		}
+
+		status_t error = chunk->status;
+		if (error != B_OK) {
+			_PutChunk(chunk);
+			return error;
+		}
+
+		_chunk = chunk;
+		return B_OK;
+	}
+
+	fStatistics.misses++;
+
+	if (chunk != NULL) {
+		// The chunk is still waiting for a read-ahead thread. Load it
+		// ourselves.
+		fReadAheadQueue.Remove(chunk);
+		chunk->readAhead = false;
+	} else {
+		_EvictChunks(kChunkSize);
+		chunk = _CreateChunk(chunkIndex);
+		if (chunk == NULL)
+			return B_NO_MEMORY;
+	}
+
+	chunk->status = B_BUSY;
+	chunk->referenceCount++;
+
+	pthread_mutex_unlock(&fLock);
+	status_t error = _LoadChunk(chunk, compressedBuffer);
+	pthread_mutex_lock(&fLock);
+
+	chunk->status = error;
+	pthread_cond_broadcast(&fChunkLoadedCondition);
+
+	if (error != B_OK) {
+		_PutChunk(chunk);
+		return error;
+	}
+
+	_chunk = chunk;
+	return B_OK;
+}
+
+
+void
+CachedPackageFileHeapReader::_PutChunk(Chunk* chunk)
+{
+	if (--chunk->referenceCount > 0)
+		return;
+
+	if (chunk->status != B_OK) {
+		_DeleteChunk(chunk);
+		return;
+	}
+
+	fUnusedChunks.Add(chunk);
+	_EvictChunks(0);
+}
+
+
+CachedPackageFileHeapReader::Chunk*
+CachedPackageFileHeapReader::_CreateChunk(size_t chunkIndex)
+{
+	Chunk* chunk = new(std::nothrow) Chunk;
+	if (chunk == NULL)
+		return NULL;
+
+	chunk->data = malloc(kChunkSize);
+	if (chunk->data == NULL) {
+		delete chunk;
+		return NULL;
+	}
+
+	uint64 offset;
+	size_t compressedSize;
+	fHeapReader->_GetChunkLocation(chunkIndex, offset, compressedSize,
+		chunk->size);
+
+	chunk->index = chunkIndex;
+	chunk->referenceCount = 0;
+	chunk->status = B_NO_INIT;
+	chunk->readAhead = false;
+
+	fChunks->InsertUnchecked(chunk);
+	fMemoryUsage += kChunkSize;
+
+	return chunk;
+}
+
+
+void
+CachedPackageFileHeapReader::_DeleteChunk(Chunk* chunk)
+{
+	fChunks->RemoveUnchecked(chunk);
+	fMemoryUsage -= kChunkSize;
+
+	free(chunk->data);
+	delete chunk;
+}
+
+
+/*!	Queues the chunks following \a chunkIndex up to \a endIndex that aren't
+	cached yet for the read-ahead threads, as long as the window and the
+	memory budget permit.
+*/
+void
+CachedPackageFileHeapReader::_ReadAhead(size_t chunkIndex, size_t endIndex)
+{
+	endIndex = std::min(endIndex, chunkIndex + 1 + fReadAheadWindow);
+	for (size_t index = chunkIndex + 1; index < endIndex; index++) {
+		if (fChunks->Lookup(index) != NULL)
+			continue;
+
+		_EvictChunks(kChunkSize);
+		if (fMemoryUsage + kChunkSize > fMemoryBudget)
+			break;
+
+		Chunk* chunk = _CreateChunk(index);
+		if (chunk == NULL)
+			break;
+
+		chunk->readAhead = true;
+		fReadAheadQueue.Add(chunk);
+		fStatistics.readAheadChunks++;
+		pthread_cond_signal(&fReadAheadCondition);
+	}
+}
+
+
+/*!	Evicts the least recently used unreferenced chunks, until
+	\a requiredMemory more bytes fit into the memory budget, or no more chunks
+	can be evicted.
+*/
+void
+CachedPackageFileHeapReader::_EvictChunks(size_t requiredMemory)
+{
+	while (fMemoryUsage + requiredMemory > fMemoryBudget) {
+		Chunk* chunk = fUnusedChunks.RemoveHead();
+		if (chunk == NULL)
+			break;
+
+		_DeleteChunk(chunk);
+		fStatistics.evictions++;
+	}
+}
+
+
+status_t
+CachedPackageFileHeapReader::_LoadChunk(Chunk* chunk, void* compressedBuffer)
+{
+	uint64 offset;
+	size_t compressedSize;
+	size_t uncompressedSize;
+	fHeapReader->_GetChunkLocation(chunk->index, offset, compressedSize,
+		uncompressedSize);
+
+	// if uncompressed, read directly into the chunk's buffer
+	bool isCompressed = compressedSize != uncompressedSize;
+
+	pthread_mutex_lock(&fFileLock);
+	status_t error = fHeapReader->ReadFileData(offset,
+		isCompressed ? compressedBuffer : chunk->data, compressedSize);
+	pthread_mutex_unlock(&fFileLock);
+
+	if (error != B_OK || !isCompressed)
+		return error;
+
+	return fHeapReader->DecompressChunkData(compressedBuffer, compressedSize,
+		chunk->data, uncompressedSize);
+}
+
+
+/*static*/ void*
+CachedPackageFileHeapReader::_ReadAheadThreadEntry(void* data)
+{
+	((CachedPackageFileHeapReader*)data)->_ReadAheadThread();
+	return NULL;
+}
+
+
+void
+CachedPackageFileHeapReader::_ReadAheadThread()
+{
+	void* compressedBuffer = malloc(kChunkSize);
+	if (compressedBuffer == NULL)
+		return;
+	MemoryDeleter compressedBufferDeleter(compressedBuffer);
+
+	pthread_mutex_lock(&fLock);
+
+	while (!fTerminating) {
+		Chunk* chunk = fReadAheadQueue.RemoveHead();
+		if (chunk == NULL) {
+			pthread_cond_wait(&fReadAheadCondition, &fLock);
+			continue;
+		}
+
+		chunk->status = B_BUSY;
+		chunk->referenceCount++;
+
+		pthread_mutex_unlock(&fLock);
+		status_t error = _LoadChunk(chunk, compressedBuffer);
+		pthread_mutex_lock(&fLock);
+
+		chunk->status = error;
+		pthread_cond_broadcast(&fChunkLoadedCondition);
+		_PutChunk(chunk);
+	}
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
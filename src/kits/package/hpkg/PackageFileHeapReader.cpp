@@ -154,19 +154,31 @@ PackageFileHeapReader::Clone() const
 status_t
 PackageFileHeapReader::ReadAndDecompressChunk(size_t chunkIndex,
 	void* compressedDataBuffer, void* uncompressedDataBuffer)
+{
+	uint64 offset;
+	size_t compressedSize;
+	size_t uncompressedSize;
+	_GetChunkLocation(chunkIndex, offset, compressedSize, uncompressedSize);
+
+	return ReadAndDecompressChunkData(offset, compressedSize, uncompressedSize,
+		compressedDataBuffer, uncompressedDataBuffer);
+}
+
+
+void
+PackageFileHeapReader::_GetChunkLocation(size_t chunkIndex, uint64& _offset,
+	size_t& _compressedSize, size_t& _uncompressedSize) const
 {
 	uint64 offset = fOffsets[chunkIndex];
 	bool isLastChunk
 		= ((uint64)chunkIndex + 1) * kChunkSize >= fUncompressedHeapSize;
-	size_t compressedSize = isLastChunk
+	_offset = offset;
+	_compressedSize = isLastChunk
 		? fCompressedHeapSize - offset
 		: fOffsets[chunkIndex + 1] - offset;
-	size_t uncompressedSize = isLastChunk
+	_uncompressedSize = isLastChunk
 		? fUncompressedHeapSize - (uint64)chunkIndex * kChunkSize
 		: kChunkSize;
-
-	return ReadAndDecompressChunkData(offset, compressedSize, uncompressedSize,
-		compressedDataBuffer, uncompressedDataBuffer);
 }
 
 
@@ -6,6 +6,9 @@
 
 #include <package/hpkg/PackageFileHeapWriter.h>
 
+#include <pthread.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <new>
 
@@ -24,6 +27,9 @@
 // minimum length of data we require before trying to compress them
 static const size_t kCompressionSizeThreshold = 64;
 
+// number of chunks per compression thread that may be in flight at a time
+static const int32 kJobsPerCompressionThread = 2;
+
 
 namespace BPackageKit {
 
@@ -32,6 +38,39 @@ namespace BHPKG {
 namespace BPrivate {
 
 
+/*!	Compresses \a size bytes of \a data into \a compressedBuffer, which must
+	be at least \a size bytes large. If the data shall rather be stored
+	uncompressed -- because they are too small, no compression algorithm is
+	given, or compressing them wouldn't save any space -- \c B_OK is returned
+	and \a _compressedSize is set to \a size.
+	The function is safe to be called concurrently for the same algorithm.
+*/
+static status_t
+compress_chunk_data(CompressionAlgorithmOwner* compressionAlgorithm,
+	const void* data, size_t size, void* compressedBuffer,
+	size_t& _compressedSize)
+{
+	_compressedSize = size;
+
+	// Try to use compression only for data large enough.
+	if (compressionAlgorithm == NULL || size < kCompressionSizeThreshold)
+		return B_OK;
+
+	size_t compressedSize;
+	status_t error = compressionAlgorithm->algorithm->CompressBuffer(data,
+		size, compressedBuffer, size, compressedSize,
+		compressionAlgorithm->parameters);
+	if (error != B_OK)
+		return error == B_BUFFER_OVERFLOW ? B_OK : error;
+
+	// only use compressed data when we've actually saved space
+	if (compressedSize < size)
+		_compressedSize = compressedSize;
+
+	return B_OK;
+}
+
+
 struct PackageFileHeapWriter::Chunk {
 	uint64	offset;
 	uint32	compressedSize;
@@ -194,6 +233,193 @@ private:
 };
 
 
+struct PackageFileHeapWriter::CompressionJob {
+	void*		uncompressedData;
+	void*		compressedData;
+	size_t		uncompressedSize;
+	size_t		compressedSize;
+		// equals uncompressedSize, if the data shall be stored uncompressed
+	status_t	status;
+	bool		done;
+};
+
+
+/*!	A pool of threads compressing full chunks of the heap in parallel.
+
+	The writer hands over its pending data buffer for each chunk (getting an
+	unused buffer in exchange), and writes the compressed chunks back in the
+	order they have been submitted, so that the resulting heap is identical to
+	the one produced by compressing on the writer's thread. Only the writer's
+	thread submits and retires jobs; the worker threads only ever touch jobs
+	between those two points.
+*/
+struct PackageFileHeapWriter::CompressionPipeline {
+	CompressionPipeline(CompressionAlgorithmOwner* compressionAlgorithm)
+		:
+		fCompressionAlgorithm(compressionAlgorithm),
+		fJobs(NULL),
+		fJobCount(0),
+		fThreads(NULL),
+		fThreadCount(0),
+		fSubmittedJobs(0),
+		fStartedJobs(0),
+		fRetiredJobs(0),
+		fTerminating(false)
+	{
+		pthread_mutex_init(&fLock, NULL);
+		pthread_cond_init(&fJobSubmittedCondition, NULL);
+		pthread_cond_init(&fJobDoneCondition, NULL);
+	}
+
+	~CompressionPipeline()
+	{
+		pthread_mutex_lock(&fLock);
+		fTerminating = true;
+		pthread_cond_broadcast(&fJobSubmittedCondition);
+		pthread_mutex_unlock(&fLock);
+
+		for (int32 i = 0; i < fThreadCount; i++)
+			pthread_join(fThreads[i], NULL);
+		delete[] fThreads;
+
+		for (int32 i = 0; i < fJobCount; i++) {
+			free(fJobs[i].uncompressedData);
+			free(fJobs[i].compressedData);
+		}
+		delete[] fJobs;
+
+		pthread_cond_destroy(&fJobDoneCondition);
+		pthread_cond_destroy(&fJobSubmittedCondition);
+		pthread_mutex_destroy(&fLock);
+	}
+
+	void Init(int32 threadCount, size_t chunkSize)
+	{
+		fJobs = new CompressionJob[threadCount * kJobsPerCompressionThread];
+		for (; fJobCount < threadCount * kJobsPerCompressionThread;
+				fJobCount++) {
+			CompressionJob& job = fJobs[fJobCount];
+			job.uncompressedData = malloc(chunkSize);
+			job.compressedData = malloc(chunkSize);
+			job.done = false;
+			if (job.uncompressedData == NULL || job.compressedData == NULL) {
+				fJobCount++;
+				throw std::bad_alloc();
+			}
+		}
+
+		// If we fail to create some of the threads, we just live with fewer.
+		fThreads = new pthread_t[threadCount];
+		for (; fThreadCount < threadCount; fThreadCount++) {
+			if (pthread_create(&fThreads[fThreadCount], NULL, &_WorkerEntry,
+					this) != 0) {
+				break;
+			}
+		}
+	}
+
+	int32 ThreadCount() const
+	{
+		return fThreadCount;
+	}
+
+	bool IsEmpty() const
+	{
+		return fRetiredJobs == fSubmittedJobs;
+	}
+
+	bool IsFull() const
+	{
+		return fSubmittedJobs - fRetiredJobs == (uint64)fJobCount;
+	}
+
+	/*!	Queues \a size bytes of the chunk data in \a buffer for compression.
+		\a buffer is replaced by another one of the same size. The pipeline
+		must not be full.
+	*/
+	void Submit(void*& buffer, size_t size)
+	{
+		CompressionJob& job = fJobs[fSubmittedJobs % fJobCount];
+		std::swap(buffer, job.uncompressedData);
+		job.uncompressedSize = size;
+		job.done = false;
+
+		pthread_mutex_lock(&fLock);
+		fSubmittedJobs++;
+		pthread_cond_signal(&fJobSubmittedCondition);
+		pthread_mutex_unlock(&fLock);
+	}
+
+	/*!	Returns the oldest job that hasn't been retired yet, or \c NULL, if it
+		isn't done yet and \a wait is \c false. The pipeline must not be
+		empty.
+	*/
+	CompressionJob* OldestJob(bool wait)
+	{
+		CompressionJob& job = fJobs[fRetiredJobs % fJobCount];
+
+		pthread_mutex_lock(&fLock);
+		while (wait && !job.done)
+			pthread_cond_wait(&fJobDoneCondition, &fLock);
+		bool done = job.done;
+		pthread_mutex_unlock(&fLock);
+
+		return done ? &job : NULL;
+	}
+
+	void RetireOldestJob()
+	{
+		fRetiredJobs++;
+	}
+
+private:
+	static void* _WorkerEntry(void* data)
+	{
+		((CompressionPipeline*)data)->_Worker();
+		return NULL;
+	}
+
+	void _Worker()
+	{
+		pthread_mutex_lock(&fLock);
+
+		while (true) {
+			while (fStartedJobs == fSubmittedJobs && !fTerminating)
+				pthread_cond_wait(&fJobSubmittedCondition, &fLock);
+			if (fTerminating)
+				break;
+
+			CompressionJob& job = fJobs[fStartedJobs++ % fJobCount];
+			pthread_mutex_unlock(&fLock);
+
+			job.status = compress_chunk_data(fCompressionAlgorithm,
+				job.uncompressedData, job.uncompressedSize, job.compressedData,
+				job.compressedSize);
+
+			pthread_mutex_lock(&fLock);
+			job.done = true;
+			pthread_cond_signal(&fJobDoneCondition);
+		}
+
+		pthread_mutex_unlock(&fLock);
+	}
+
+private:
+	CompressionAlgorithmOwner*	fCompressionAlgorithm;
+	CompressionJob*				fJobs;
+	int32						fJobCount;
+	pthread_t*					fThreads;
+	int32						fThreadCount;
+	pthread_mutex_t				fLock;
+	pthread_cond_t				fJobSubmittedCondition;
+	pthread_cond_t				fJobDoneCondition;
+	uint64						fSubmittedJobs;
+	uint64						fStartedJobs;
+	uint64						fRetiredJobs;
+	bool						fTerminating;
+};
+
+
 PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	BPositionIO* file, off_t heapOffset,
 	CompressionAlgorithmOwner* compressionAlgorithm,
@@ -205,7 +431,9 @@ PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	fCompressedDataBuffer(NULL),
 	fPendingDataSize(0),
 	fOffsets(),
-	fCompressionAlgorithm(compressionAlgorithm)
+	fCompressionAlgorithm(compressionAlgorithm),
+	fPipeline(NULL),
+	fPipelineEnabled(true)
 {
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->AcquireReference();
@@ -221,14 +449,32 @@ PackageFileHeapWriter::~PackageFileHeapWriter()
 }
 
 
+/*!	Allocates the data buffers. If \a compressionThreadCount is greater than
+	1, full chunks will be compressed by as many threads in parallel; if it is
+	0 or less, one thread per online CPU is used.
+*/
 void
-PackageFileHeapWriter::Init()
+PackageFileHeapWriter::Init(int32 compressionThreadCount)
 {
 	// allocate data buffers
 	fPendingDataBuffer = malloc(kChunkSize);
 	fCompressedDataBuffer = malloc(kChunkSize);
 	if (fPendingDataBuffer == NULL || fCompressedDataBuffer == NULL)
 		throw std::bad_alloc();
+
+	if (compressionThreadCount <= 0)
+		compressionThreadCount = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+
+	// start the compression threads
+	if (compressionThreadCount > 1 && fCompressionAlgorithm != NULL) {
+		fPipeline = new CompressionPipeline(fCompressionAlgorithm);
+		fPipeline->Init(compressionThreadCount, kChunkSize);
+
+		if (fPipeline->ThreadCount() == 0) {
+			delete fPipeline;
+			fPipeline = NULL;
+		}
+	}
 }
 
 
@@ -318,9 +564,15 @@ PackageFileHeapWriter::RemoveDataRanges(
 	// Before we begin flush any pending data, so we don't need any special
 	// handling and also can use the pending data buffer.
 	status_t status = _FlushPendingData();
+	if (status == B_OK)
+		status = _DrainPipeline();
 	if (status != B_OK)
 		throw status_t(status);
 
+	// The algorithm below relies on fCompressedHeapSize being up to date
+	// after each chunk, so we don't compress in parallel while moving data.
+	fPipelineEnabled = false;
+
 	// We potentially have to recompress all data from the first affected chunk
 	// to the end (minus the removed ranges, of course). As a basic algorithm we
 	// can use our usual data writing strategy, i.e. read a chunk, decompress it
@@ -432,14 +684,18 @@ PackageFileHeapWriter::RemoveDataRanges(
 	// buffer.
 	if (chunkBuffer.IsEmpty())
 		_UnwriteLastPartialChunk();
+
+	fPipelineEnabled = true;
 }
 
 
 status_t
 PackageFileHeapWriter::Finish()
 {
-	// flush pending data, if any
+	// flush pending data, if any, and wait for all chunks to be written
 	status_t error = _FlushPendingData();
+	if (error == B_OK)
+		error = _DrainPipeline();
 	if (error != B_OK)
 		return error;
 
@@ -490,6 +746,13 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 		return B_OK;
 	}
 
+	if (chunkIndex >= (size_t)fOffsets.Count()) {
+		// The chunk is still being compressed.
+		status_t error = _DrainPipeline();
+		if (error != B_OK)
+			return error;
+	}
+
 	uint64 offset = fOffsets[chunkIndex];
 	size_t compressedSize = chunkIndex + 1 == (size_t)fOffsets.Count()
 		? fCompressedHeapSize - offset
@@ -503,6 +766,9 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 void
 PackageFileHeapWriter::_Uninit()
 {
+	delete fPipeline;
+	fPipeline = NULL;
+
 	free(fPendingDataBuffer);
 	free(fCompressedDataBuffer);
 	fPendingDataBuffer = NULL;
@@ -516,7 +782,28 @@ PackageFileHeapWriter::_FlushPendingData()
 	if (fPendingDataSize == 0)
 		return B_OK;
 
-	status_t error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
+	if (fPipeline != NULL && fPipelineEnabled
+		&& fPendingDataSize >= kCompressionSizeThreshold) {
+		// Hand the chunk over to the compression threads, making room first,
+		// if necessary, and write back what they have finished meanwhile.
+		if (fPipeline->IsFull()) {
+			status_t error = _WriteCompressedChunks(true);
+			if (error != B_OK)
+				return error;
+		}
+
+		fPipeline->Submit(fPendingDataBuffer, fPendingDataSize);
+		fPendingDataSize = 0;
+
+		return _WriteCompressedChunks(false);
+	}
+
+	// chunks have to be written in order
+	status_t error = _DrainPipeline();
+	if (error != B_OK)
+		return error;
+
+	error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
 	if (error == B_OK)
 		fPendingDataSize = 0;
 
@@ -527,6 +814,25 @@ PackageFileHeapWriter::_FlushPendingData()
 status_t
 PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
 	bool mayCompress)
+{
+	size_t compressedSize = size;
+	if (mayCompress) {
+		status_t error = compress_chunk_data(fCompressionAlgorithm, data, size,
+			fCompressedDataBuffer, compressedSize);
+		if (error != B_OK) {
+			fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
+				strerror(error));
+			return error;
+		}
+	}
+
+	return _AppendChunk(compressedSize < size ? fCompressedDataBuffer : data,
+		compressedSize);
+}
+
+
+status_t
+PackageFileHeapWriter::_AppendChunk(const void* data, size_t size)
 {
 	// add offset
 	if (!fOffsets.Add(fCompressedHeapSize)) {
@@ -534,66 +840,68 @@ PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
 		return B_NO_MEMORY;
 	}
 
-	// Try to use compression only for data large enough.
-	bool compress = mayCompress && size >= (off_t)kCompressionSizeThreshold;
-	if (compress) {
-		status_t error = _WriteDataCompressed(data, size);
-		if (error != B_OK) {
-			if (error != B_BUFFER_OVERFLOW)
-				return error;
-			compress = false;
-		}
-	}
+	return _WriteDataUncompressed(data, size);
+}
 
-	// Write uncompressed, if necessary.
-	if (!compress) {
-		status_t error = _WriteDataUncompressed(data, size);
-		if (error != B_OK)
-			return error;
+
+status_t
+PackageFileHeapWriter::_WriteDataUncompressed(const void* data, size_t size)
+{
+	status_t error = fFile->WriteAtExactly(
+		fHeapOffset + (off_t)fCompressedHeapSize, data, size);
+	if (error != B_OK) {
+		fErrorOutput->PrintError("Failed to write data: %s\n", strerror(error));
+		return error;
 	}
 
+	fCompressedHeapSize += size;
+
 	return B_OK;
 }
 
 
+/*!	Writes back the chunks the compression threads have finished, in the order
+	they were submitted. If \a wait is \c true, waits for at least the oldest
+	one.
+*/
 status_t
-PackageFileHeapWriter::_WriteDataCompressed(const void* data, size_t size)
+PackageFileHeapWriter::_WriteCompressedChunks(bool wait)
 {
-	if (fCompressionAlgorithm == NULL)
-		return B_BUFFER_OVERFLOW;
+	while (fPipeline != NULL && !fPipeline->IsEmpty()) {
+		CompressionJob* job = fPipeline->OldestJob(wait);
+		if (job == NULL)
+			break;
 
-	size_t compressedSize;
-	status_t error = fCompressionAlgorithm->algorithm->CompressBuffer(data,
-		size, fCompressedDataBuffer, size, compressedSize,
-		fCompressionAlgorithm->parameters);
-	if (error != B_OK) {
-		if (error != B_BUFFER_OVERFLOW) {
+		wait = false;
+		fPipeline->RetireOldestJob();
+
+		if (job->status != B_OK) {
 			fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
-				strerror(error));
+				strerror(job->status));
+			return job->status;
 		}
-		return error;
-	}
 
-	// only use compressed data when we've actually saved space
-	if (compressedSize == size)
-		return B_BUFFER_OVERFLOW;
+		status_t error = _AppendChunk(
+			job->compressedSize < job->uncompressedSize
+				? job->compressedData : job->uncompressedData,
+			job->compressedSize);
+		if (error != B_OK)
+			return error;
+	}
 
-	return _WriteDataUncompressed(fCompressedDataBuffer, compressedSize);
+	return B_OK;
 }
 
 
 status_t
-PackageFileHeapWriter::_WriteDataUncompressed(const void* data, size_t size)
+PackageFileHeapWriter::_DrainPipeline()
 {
-	status_t error = fFile->WriteAtExactly(
-		fHeapOffset + (off_t)fCompressedHeapSize, data, size);
-	if (error != B_OK) {
-		fErrorOutput->PrintError("Failed to write data: %s\n", strerror(error));
-		return error;
+	while (fPipeline != NULL && !fPipeline->IsEmpty()) {
+		status_t error = _WriteCompressedChunks(true);
+		if (error != B_OK)
+			return error;
 	}
 
-	fCompressedHeapSize += size;
-
 	return B_OK;
 }
 
@@ -6,6 +6,7 @@
 
 #include <package/hpkg/PackageWriter.h>
 
+#include <algorithm>
 #include <new>
 
 #include <package/hpkg/PackageWriterImpl.h>
@@ -19,6 +20,15 @@ namespace BHPKG {
 // #pragma mark - BPackageWriterParameters
 
 
+/*!	The compression thread count is kept in the upper bits of fFlags, so that
+	the size of the class doesn't change. A value of 0 stands for the default
+	of a single thread, kCompressionThreadsPerCPU for one thread per CPU.
+*/
+static const uint32 kCompressionThreadCountShift = 16;
+static const uint32 kCompressionThreadCountMask = 0xffff0000;
+static const uint32 kCompressionThreadsPerCPU = 0xffff;
+
+
 BPackageWriterParameters::BPackageWriterParameters()
 	:
 	fFlags(0),
@@ -36,14 +46,15 @@ BPackageWriterParameters::~BPackageWriterParameters()
 uint32
 BPackageWriterParameters::Flags() const
 {
-	return fFlags;
+	return fFlags & ~kCompressionThreadCountMask;
 }
 
 
 void
 BPackageWriterParameters::SetFlags(uint32 flags)
 {
-	fFlags = flags;
+	fFlags = (fFlags & kCompressionThreadCountMask)
+		| (flags & ~kCompressionThreadCountMask);
 }
 
 
@@ -75,6 +86,35 @@ BPackageWriterParameters::SetCompressionLevel(int32 compressionLevel)
 }
 
 
+int32
+BPackageWriterParameters::CompressionThreadCount() const
+{
+	uint32 threadCount = (fFlags & kCompressionThreadCountMask)
+		>> kCompressionThreadCountShift;
+	if (threadCount == 0)
+		return 1;
+	if (threadCount == kCompressionThreadsPerCPU)
+		return 0;
+	return threadCount;
+}
+
+
+void
+BPackageWriterParameters::SetCompressionThreadCount(int32 threadCount)
+{
+	uint32 value;
+	if (threadCount <= 0)
+		value = kCompressionThreadsPerCPU;
+	else if (threadCount == 1)
+		value = 0;
+	else
+		value = std::min((uint32)threadCount, kCompressionThreadsPerCPU - 1);
+
+	fFlags = (fFlags & ~kCompressionThreadCountMask)
+		| (value << kCompressionThreadCountShift);
+}
+
+
 // #pragma mark - BPackageWriter
 
 
@@ -24,6 +24,9 @@
 
 #include <package/hpkg/HPKGDefsPrivate.h>
 #include <package/hpkg/PackageFileHeapReader.h>
+#if !defined(_KERNEL_MODE) && !defined(_BOOT_MODE)
+#	include <package/hpkg/CachedPackageFileHeapReader.h>
+#endif
 
 
 namespace BPackageKit {
@@ -813,7 +816,7 @@ ReaderImplBase::DetachHeapReader(PackageFileHeapReader*& _rawHeapReader)
 
 status_t
 ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
-	off_t offset, uint64 compressedSize, uint64 uncompressedSize)
+	off_t offset, uint64 compressedSize, uint64 uncompressedSize, uint32 flags)
 {
 	DecompressionAlgorithmOwner* decompressionAlgorithm = NULL;
 	BReference<DecompressionAlgorithmOwner> decompressionAlgorithmReference;
@@ -866,6 +869,26 @@ ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
 		fHeapReader = fRawHeapReader;
 	}
 
+#if !defined(_KERNEL_MODE) && !defined(_BOOT_MODE)
+	// Unless the subclass provides its own cache, use a chunk cache, if
+	// requested.
+	if (fHeapReader == fRawHeapReader
+		&& (flags & B_HPKG_READER_CACHE_CHUNKS) != 0) {
+		CachedPackageFileHeapReader* cachedReader
+			= new(std::nothrow) CachedPackageFileHeapReader(fRawHeapReader);
+		if (cachedReader == NULL)
+			return B_NO_MEMORY;
+
+		error = cachedReader->Init();
+		if (error != B_OK) {
+			delete cachedReader;
+			return error;
+		}
+
+		fHeapReader = cachedReader;
+	}
+#endif
+
 	return B_OK;
 }
 
@@ -358,7 +358,7 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 	// create heap writer
 	fHeapWriter = new PackageFileHeapWriter(fErrorOutput, fFile, headerSize,
 		compressionAlgorithm, decompressionAlgorithm);
-	fHeapWriter->Init();
+	fHeapWriter->Init(fParameters.CompressionThreadCount());
 
 	return B_OK;
 }
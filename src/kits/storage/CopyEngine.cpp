@@ -23,12 +23,17 @@
 #include <SymLink.h>
 #include <TypeConstants.h>
 
+#ifdef HAIKU_TARGET_PLATFORM_HAIKU
+#	include <syscalls.h>
+#endif
+
 
 namespace BPrivate {
 
 
 static const size_t kDefaultBufferSize = 1024 * 1024;
 static const size_t kSmallBufferSize = 64 * 1024;
+static const size_t kCopyFileRangeChunkSize = 4 * 1024 * 1024;
 
 
 // #pragma mark - BCopyEngine
@@ -339,6 +344,49 @@ BCopyEngine::_CopyFileData(const char* sourcePath, BFile& source,
 	const char* destPath, BFile& destination)
 {
 	off_t offset = 0;
+
+#ifdef HAIKU_TARGET_PLATFORM_HAIKU
+	// Let the kernel copy the data from one file cache to the other, which
+	// saves the round trip through our buffer. If it can't do that for these
+	// files, fall back to copying them ourselves.
+	int sourceFD = source.Dup();
+	int destFD = destination.Dup();
+	if (sourceFD >= 0 && destFD >= 0) {
+		while (true) {
+			off_t destOffset = offset;
+			ssize_t bytesCopied = _kern_copy_file_range(sourceFD, &offset,
+				destFD, &destOffset, kCopyFileRangeChunkSize, 0);
+			if (bytesCopied == 0)
+				break;
+
+			if (bytesCopied < 0) {
+				if (offset == 0 && (bytesCopied == B_NOT_SUPPORTED
+						|| bytesCopied == B_BAD_VALUE)) {
+					break;
+				}
+
+				_NotifyError(bytesCopied,
+					"Failed to copy data from file \"%s\" to \"%s\": %s\n",
+					sourcePath, destPath, strerror(bytesCopied));
+				close(sourceFD);
+				close(destFD);
+				return bytesCopied;
+			}
+
+			if (fController != NULL
+				&& !fController->FileDataCopied(sourcePath, offset)) {
+				close(sourceFD);
+				close(destFD);
+				return B_CANCELED;
+			}
+		}
+	}
+	if (sourceFD >= 0)
+		close(sourceFD);
+	if (destFD >= 0)
+		close(destFD);
+#endif
+
 	while (true) {
 		// read
 		ssize_t bytesRead = source.ReadAt(offset, fBuffer, fBufferSize);
@@ -366,6 +414,11 @@ BCopyEngine::_CopyFileData(const char* sourcePath, BFile& source,
 		}
 
 		offset += bytesRead;
+
+		if (fController != NULL
+			&& !fController->FileDataCopied(sourcePath, offset)) {
+			return B_CANCELED;
+		}
 	}
 }
 
@@ -562,6 +615,13 @@ BCopyEngine::BController::AttributeFinished(const char* path,
 }
 
 
+bool
+BCopyEngine::BController::FileDataCopied(const char* path, off_t size)
+{
+	return true;
+}
+
+
 void
 BCopyEngine::BController::ErrorOccurred(const char* message, status_t error)
 {
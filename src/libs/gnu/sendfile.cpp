@@ -0,0 +1,29 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+#include <errno.h>
+
+#include <syscall_utils.h>
+#include <syscalls.h>
+
+
+ssize_t
+sendfile(int outFD, int inFD, off_t* offset, size_t count)
+{
+	RETURN_AND_SET_ERRNO(_kern_send_file(outFD, inFD, offset, count));
+}
+
+
+ssize_t
+copy_file_range(int inFD, off_t* inOffset, int outFD, off_t* outOffset,
+	size_t length, unsigned int flags)
+{
+	RETURN_AND_SET_ERRNO(_kern_copy_file_range(inFD, inOffset, outFD,
+		outOffset, length, flags));
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BackingStore.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <Autolock.h>
+#include <Locker.h>
+#include <OS.h>
+
+#include "DrawingEngine.h"
+#include "ServerBitmap.h"
+
+
+typedef DoublyLinkedList<BackingStore> BackingStoreList;
+
+struct expose_statistics {
+	int64		count;
+	bigtime_t	total;
+	bigtime_t	max;
+};
+
+static const size_t kMaxDefaultBudget = 64 * 1024 * 1024;
+static const bigtime_t kMemoryCheckInterval = 1000000;
+
+static pthread_once_t sInitOnce = PTHREAD_ONCE_INIT;
+static BLocker sLock("backing stores");
+
+// least recently used first
+static BackingStoreList sStores;
+static size_t sBudget = 0;
+static size_t sTotalSize = 0;
+
+static bigtime_t sLastMemoryCheck = 0;
+static bool sLowOnMemory = false;
+
+static int64 sEvictions = 0;
+static int64 sLowMemoryEvictions = 0;
+static expose_statistics sRestoredExposes;
+static expose_statistics sClientExposes;
+
+
+static void
+print_expose_statistics(const char* name, const expose_statistics& statistics)
+{
+	bigtime_t average = statistics.count > 0
+		? statistics.total / statistics.count : 0;
+
+	debug_printf("  %s: %" B_PRId64 " exposes, %" B_PRId64 " us average, %"
+		B_PRId64 " us max\n", name, statistics.count, average,
+		statistics.max);
+}
+
+
+//	#pragma mark -
+
+
+BackingStore::BackingStore(::Desktop* desktop)
+	:
+	fDesktop(desktop),
+	fEngine(B_RGB32),
+	fSize(0)
+{
+	BAutolock _(sLock);
+	sStores.Add(this);
+}
+
+
+BackingStore::~BackingStore()
+{
+	BAutolock _(sLock);
+	_Free();
+	sStores.Remove(this);
+}
+
+
+/*!	Returns whether windows should retain their contents. The memory that all
+	backing stores may use together can be set in MB with the
+	APP_SERVER_BACKING_STORE_BUDGET environment variable; 0 turns them off.
+*/
+/*static*/ bool
+BackingStore::IsEnabled()
+{
+	pthread_once(&sInitOnce, &_Init);
+	return sBudget > 0;
+}
+
+
+/*!	Called whenever the clipping of the window changes. Captures the parts of
+	\a previouslyVisible that are no longer visible from the screen, where the
+	window was at \a origin, unless they are \a dirty. The parts that become
+	visible again are put back by the next Restore().
+	\a width and \a height are the size of the window frame.
+*/
+void
+BackingStore::Update(DrawingEngine* engine, BPoint origin, int32 width,
+	int32 height, const BRegion& previouslyVisible, const BRegion& visible,
+	const BRegion& dirty)
+{
+	BRegion hidden(previouslyVisible);
+	hidden.Exclude(&visible);
+
+	// What was exposed but covered again before it could be restored is
+	// still in the bitmap, but not on screen.
+	BRegion stillPending(fPendingRestore);
+	stillPending.IntersectWith(&hidden);
+	fValid.Include(&stillPending);
+	fPendingRestore.Exclude(&hidden);
+
+	BRegion capture(hidden);
+	capture.Exclude(&dirty);
+	capture.Exclude(&stillPending);
+
+	if (capture.CountRects() > 0) {
+		BAutolock _(sLock);
+
+		if (_LowOnMemory()) {
+			BackingStore* store = sStores.Head();
+			for (; store != NULL; store = sStores.GetNext(store)) {
+				if (store->fDesktop != fDesktop || store->fSize == 0)
+					continue;
+
+				store->_Free();
+				sLowMemoryEvictions++;
+			}
+		} else if (_Allocate(width, height)) {
+			capture.OffsetBy(origin);
+			if (engine->ReadRegion(fEngine.Bitmap(), capture, origin) == B_OK) {
+				capture.OffsetBy(-origin);
+				fValid.Include(&capture);
+
+				sStores.Remove(this);
+				sStores.Add(this);
+			}
+		}
+	}
+
+	BRegion exposed(fValid);
+	exposed.IntersectWith(&visible);
+	fPendingRestore.Include(&exposed);
+	fValid.Exclude(&visible);
+}
+
+
+/*!	Puts the exposed parts that are in \a dirty back on screen, and returns
+	them in \a restored. Both regions are in screen coordinates, the window
+	is at \a origin.
+	Exposed parts that are not dirty have been taken care of otherwise, and
+	are forgotten.
+*/
+void
+BackingStore::Restore(DrawingEngine* engine, BPoint origin,
+	const BRegion& dirty, BRegion& restored)
+{
+	restored = fPendingRestore;
+	fPendingRestore.MakeEmpty();
+
+	restored.OffsetBy(origin);
+	restored.IntersectWith(&dirty);
+	if (restored.CountRects() == 0)
+		return;
+
+	if (fEngine.Bitmap() == NULL
+		|| engine->WriteRegion(fEngine.Bitmap(), restored, origin) != B_OK) {
+		restored.MakeEmpty();
+		return;
+	}
+
+	BAutolock _(sLock);
+	sStores.Remove(this);
+	sStores.Add(this);
+}
+
+
+void
+BackingStore::Invalidate(const BRegion& region)
+{
+	fValid.Exclude(&region);
+	fPendingRestore.Exclude(&region);
+}
+
+
+void
+BackingStore::MakeEmpty()
+{
+	fValid.MakeEmpty();
+	fPendingRestore.MakeEmpty();
+}
+
+
+/*!	Records how long it took to repaint an exposed part of a window, either
+	from its backing store, or by its client.
+*/
+/*static*/ void
+BackingStore::AddExposeTime(bigtime_t time, bool restored)
+{
+	BAutolock _(sLock);
+
+	expose_statistics& statistics = restored
+		? sRestoredExposes : sClientExposes;
+	statistics.count++;
+	statistics.total += time;
+	if (time > statistics.max)
+		statistics.max = time;
+}
+
+
+/*static*/ void
+BackingStore::DumpStatistics()
+{
+	pthread_once(&sInitOnce, &_Init);
+
+	BAutolock _(sLock);
+
+	debug_printf("backing stores: %" B_PRId32 " windows, %" B_PRIuSIZE
+		" of %" B_PRIuSIZE " KB used\n", sStores.Count(), sTotalSize / 1024,
+		sBudget / 1024);
+	debug_printf("  %" B_PRId64 " evictions, %" B_PRId64 " on low memory\n",
+		sEvictions, sLowMemoryEvictions);
+	print_expose_statistics("restored", sRestoredExposes);
+	print_expose_statistics("client", sClientExposes);
+}
+
+
+//	#pragma mark - private
+
+
+/*!	Makes sure the bitmap can hold a window of the given size, evicting the
+	least recently used backing stores of the same desktop to stay within
+	the budget. The lock must be held.
+*/
+bool
+BackingStore::_Allocate(int32 width, int32 height)
+{
+	UtilityBitmap* bitmap = fEngine.Bitmap();
+	if (bitmap != NULL && bitmap->Width() >= width
+		&& bitmap->Height() >= height) {
+		return true;
+	}
+
+	// the contents cannot be kept across a size change anyway
+	_Free();
+
+	size_t needed = (size_t)width * height * 4;
+	if (needed > sBudget)
+		return false;
+
+	if (sTotalSize + needed > sBudget)
+		_EvictLocked(needed);
+	if (sTotalSize + needed > sBudget)
+		return false;
+
+	if (fEngine.SetSize(width, height) != B_OK) {
+		fEngine.SetSize(0, 0);
+		return false;
+	}
+
+	fSize = fEngine.Bitmap()->BitsLength();
+	sTotalSize += fSize;
+	return true;
+}
+
+
+void
+BackingStore::_Free()
+{
+	MakeEmpty();
+
+	if (fSize == 0)
+		return;
+
+	fEngine.SetSize(0, 0);
+	sTotalSize -= fSize;
+	fSize = 0;
+}
+
+
+void
+BackingStore::_EvictLocked(size_t needed)
+{
+	BackingStore* store = sStores.Head();
+	while (store != NULL && sTotalSize + needed > sBudget) {
+		BackingStore* next = sStores.GetNext(store);
+		if (store != this && store->fDesktop == fDesktop && store->fSize > 0) {
+			store->_Free();
+			sEvictions++;
+		}
+		store = next;
+	}
+}
+
+
+/*!	There is no low memory notification for userland, so this polls the
+	system memory instead, but not more often than once a second.
+	The lock must be held.
+*/
+/*static*/ bool
+BackingStore::_LowOnMemory()
+{
+	bigtime_t now = system_time();
+	if (now - sLastMemoryCheck < kMemoryCheckInterval)
+		return sLowOnMemory;
+
+	sLastMemoryCheck = now;
+
+	system_info info;
+	if (get_system_info(&info) == B_OK)
+		sLowOnMemory = info.free_memory < info.max_pages * B_PAGE_SIZE / 16;
+
+	return sLowOnMemory;
+}
+
+
+/*static*/ void
+BackingStore::_Init()
+{
+	const char* budget = getenv("APP_SERVER_BACKING_STORE_BUDGET");
+	if (budget != NULL) {
+		int32 megabytes = atoi(budget);
+		if (megabytes > 0)
+			sBudget = (size_t)megabytes * 1024 * 1024;
+		return;
+	}
+
+	system_info info;
+	if (get_system_info(&info) != B_OK)
+		return;
+
+	sBudget = min_c(kMaxDefaultBudget,
+		(size_t)(info.max_pages * B_PAGE_SIZE / 32));
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BACKING_STORE_H
+#define BACKING_STORE_H
+
+
+#include <Region.h>
+
+#include <util/DoublyLinkedList.h>
+
+#include "BitmapDrawingEngine.h"
+
+
+class Desktop;
+class DrawingEngine;
+
+
+/*!	Retains the contents of the parts of a window that were covered, so that
+	they can be put back on screen right away once they are exposed again,
+	instead of waiting for the client to redraw them.
+
+	All regions are relative to the left top corner of the window frame.
+	The contents are captured and restored by the window, with the window
+	lock of its desktop held; they are only ever evicted with that lock
+	held in write mode.
+*/
+class BackingStore : public DoublyLinkedListLinkImpl<BackingStore> {
+public:
+								BackingStore(::Desktop* desktop);
+								~BackingStore();
+
+	static	bool				IsEnabled();
+
+			bool				HasContents() const
+									{ return fValid.CountRects() > 0
+										|| fPendingRestore.CountRects() > 0; }
+
+			void				Update(DrawingEngine* engine, BPoint origin,
+									int32 width, int32 height,
+									const BRegion& previouslyVisible,
+									const BRegion& visible,
+									const BRegion& dirty);
+			void				Restore(DrawingEngine* engine, BPoint origin,
+									const BRegion& dirty, BRegion& restored);
+			void				Invalidate(const BRegion& region);
+			void				MakeEmpty();
+
+	static	void				AddExposeTime(bigtime_t time, bool restored);
+	static	void				DumpStatistics();
+
+private:
+			bool				_Allocate(int32 width, int32 height);
+			void				_Free();
+			void				_EvictLocked(size_t needed);
+
+	static	bool				_LowOnMemory();
+	static	void				_Init();
+
+private:
+			::Desktop*			fDesktop;
+			BitmapDrawingEngine	fEngine;
+			size_t				fSize;
+
+			// hidden parts whose contents are in the bitmap
+			BRegion				fValid;
+			// exposed parts that have not been put back on screen yet
+			BRegion				fPendingRestore;
+};
+
+
+#endif	// BACKING_STORE_H
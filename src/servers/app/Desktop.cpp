@@ -42,6 +42,7 @@
 #include <WindowInfo.h>
 
 #include "AppServer.h"
+#include "BackingStore.h"
 #include "ClickTarget.h"
 #include "DecorManager.h"
 #include "DesktopSettingsPrivate.h"
@@ -2744,6 +2745,17 @@ Desktop::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
+		case AS_DUMP_FRAME_TIMES:
+		{
+			// the statistics are not per team
+			team_id team;
+			if (link.Read(&team) != B_OK)
+				break;
+
+			BackingStore::DumpStatistics();
+			break;
+		}
+
 		case AS_EVENT_STREAM_CLOSED:
 			_LaunchInputServer();
 			break;
@@ -3599,6 +3611,12 @@ Desktop::_ScreenChanged(Screen* screen)
 	// operating on an all new buffer in memory
 	BRegion dirty(screen->Frame());
 
+	for (Window* window = fAllWindows.FirstWindow(); window != NULL;
+			window = window->NextWindow(kAllWindowList)) {
+		if (window->Screen() == screen)
+			window->ScreenContentsLost();
+	}
+
 	// update our cached screen region
 	fScreenRegion.Set(screen->Frame());
 	gInputManager->UpdateScreenBounds(screen->Frame());
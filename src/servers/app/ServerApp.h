@@ -98,6 +98,8 @@ public:
 
 			void				NotifyDeleteClientArea(area_id serverArea);
 			AppFontManager*		FontManager() { return fAppFontManager; }
+			ClientMemoryAllocator* MemoryAllocator() const
+									{ return fMemoryAllocator.Get(); }
 
 private:
 	virtual	void				_GetLooperName(char* name, size_t size);
@@ -60,6 +60,7 @@
 #include "AutoDeleter.h"
 #include "BBitmapBuffer.h"
 #include "BitmapManager.h"
+#include "ClientMemoryAllocator.h"
 #include "Desktop.h"
 #include "DirectWindowInfo.h"
 #include "DrawingEngine.h"
@@ -132,6 +133,10 @@ static profile sRedrawProcessingTime;
 #endif
 
 
+// Size of the ring buffer the client passes its drawing commands through
+static const size_t kCommandRingSize = 64 * 1024;
+
+
 //	#pragma mark -
 
 
@@ -844,6 +849,29 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
+		case AS_CREATE_COMMAND_RING:
+		{
+			DTRACE(("ServerWindow %s: Message AS_CREATE_COMMAND_RING\n",
+				Title()));
+
+			bool newArea = false;
+			status_t status = _CreateCommandRing(newArea);
+
+			fLink.StartMessage(status);
+			if (status == B_OK) {
+				uint8 allocationFlags = kAllocator;
+				if (newArea)
+					allocationFlags |= kNewAllocatorArea;
+
+				fLink.Attach<uint8>(allocationFlags);
+				fLink.Attach<area_id>(fCommandRing->Area());
+				fLink.Attach<int32>(fCommandRing->AreaOffset());
+				fLink.Attach<int32>(kCommandRingSize);
+			}
+			fLink.Flush();
+			break;
+		}
+
 		case AS_GET_WORKSPACES:
 		{
 			DTRACE(("ServerWindow %s: Message AS_GET_WORKSPACES\n", Title()));
@@ -2482,6 +2510,10 @@ void
 ServerWindow::_DispatchViewDrawingMessage(int32 code,
 	BPrivate::LinkReceiver &link)
 {
+	// even if it is not visible right now, the view is going to look
+	// different once it is
+	fWindow->ViewContentsChanging(fCurrentView);
+
 	if (!fCurrentView->IsVisible() || !fWindow->IsVisible()) {
 		if (link.NeedsReply()) {
 			debug_printf("ServerWindow::DispatchViewDrawingMessage() got "
@@ -4270,8 +4302,12 @@ ServerWindow::_MessageLooper()
 				fDesktop->UnlockAllWindows();
 
 			// Only process up to 70 waiting messages at once (we have the
-			// Desktop locked), but don't hold the lock longer than 10 ms
-			if (!receiver.HasMessages() || ++messagesProcessed > 70
+			// Desktop locked), but don't hold the lock longer than 10 ms.
+			// A batch from the command ring may be larger, but it is only
+			// cut short when it takes too long.
+			if (!receiver.HasMessages()
+				|| (++messagesProcessed > 70
+					&& !receiver.HasBufferedMessages())
 				|| system_time() - processingStart > 10000) {
 				if (lockedDesktopSingleWindow)
 					fDesktop->UnlockSingleWindow();
@@ -4518,6 +4554,38 @@ ServerWindow::_EnableDirectWindowMode()
 }
 
 
+/*!	Allocates the ring buffer through which the client passes its drawing
+	commands, in memory shared with the client application.
+*/
+status_t
+ServerWindow::_CreateCommandRing(bool& newArea)
+{
+	if (fCommandRing.IsSet()) {
+		// the client already maps it
+		newArea = false;
+		return B_OK;
+	}
+
+	ClientMemoryAllocator* allocator = App()->MemoryAllocator();
+	if (allocator == NULL)
+		return B_NO_MEMORY;
+
+	fCommandRing.SetTo(new(std::nothrow) ClientMemory);
+	if (!fCommandRing.IsSet())
+		return B_NO_MEMORY;
+
+	void* memory = fCommandRing->Allocate(allocator, kCommandRingSize,
+		newArea);
+	if (memory == NULL) {
+		fCommandRing.Unset();
+		return B_NO_MEMORY;
+	}
+
+	fLink.Receiver().SetRing(memory, kCommandRingSize);
+	return B_OK;
+}
+
+
 void
 ServerWindow::_DirectWindowSetFullScreen(bool enable)
 {
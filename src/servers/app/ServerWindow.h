@@ -35,6 +35,7 @@ class BMessenger;
 class BPoint;
 class BMessage;
 
+class ClientMemory;
 class Desktop;
 class ServerApp;
 class Decorator;
@@ -139,6 +140,7 @@ private:
 
 			void				_ResizeToFullScreen();
 			status_t			_EnableDirectWindowMode();
+			status_t			_CreateCommandRing(bool& newArea);
 			void				_DirectWindowSetFullScreen(bool set);
 
 			void				_SetCurrentView(View* view);
@@ -178,6 +180,9 @@ private:
 			ObjectDeleter<DirectWindowInfo>
 								fDirectWindowInfo;
 			bool				fIsDirectlyAccessing;
+
+			ObjectDeleter<ClientMemory>
+								fCommandRing;
 };
 
 #endif	// SERVER_WINDOW_H
@@ -27,6 +27,7 @@
 #include <ViewPrivate.h>
 #include <WindowPrivate.h>
 
+#include "BackingStore.h"
 #include "ClickTarget.h"
 #include "Decorator.h"
 #include "DecorManager.h"
@@ -118,7 +119,11 @@ Window::Window(const BRect& frame, const char *name,
 	fMinHeight(1),
 	fMaxHeight(32768),
 
-	fWorkspacesViewCount(0)
+	fWorkspacesViewCount(0),
+
+	fRetainedFrame(frame),
+	fExposeTime(0),
+	fClientExposeTime(0)
 {
 	_InitWindowStack();
 
@@ -201,6 +206,8 @@ Window::SetClipping(BRegion* stillAvailableOnScreen)
 
 	fVisibleContentRegionValid = false;
 	fEffectiveDrawingRegionValid = false;
+
+	_RetainContents(true);
 }
 
 
@@ -445,6 +452,7 @@ Window::ScrollViewBy(View* view, int32 dx, int32 dy)
 		return;
 
 	view->ScrollBy(dx, dy, dirty);
+	_InvalidateRetainedView(view);
 
 //fDrawingEngine->FillRegion(*dirty, (rgb_color){ 255, 0, 255, 255 });
 //snooze(20000);
@@ -467,6 +475,13 @@ Window::CopyContents(BRegion* region, int32 xOffset, int32 yOffset)
 		return;
 
 	BRegion* newDirty = fRegionPool.GetRegion(*region);
+	if (newDirty == NULL)
+		return;
+
+	// the destination gets new contents where it is hidden, too
+	newDirty->OffsetBy(xOffset, yOffset);
+	_InvalidateRetainedContents(*newDirty);
+	newDirty->OffsetBy(-xOffset, -yOffset);
 
 	// clip the region to the visible contents at the
 	// source and destination location (note that VisibleContentRegion()
@@ -760,6 +775,9 @@ Window::ProcessDirtyRegion(const BRegion& dirtyRegion, const BRegion& exposeRegi
 		ServerWindow()->RequestRedraw();
 	}
 
+	if (fExposeTime == 0 && exposeRegion.CountRects() > 0)
+		fExposeTime = system_time();
+
 	fDirtyRegion.Include(&dirtyRegion);
 	fExposeRegion.Include(&exposeRegion);
 }
@@ -771,6 +789,7 @@ Window::RedrawDirtyRegion()
 	if (TopLayerStackWindow() != this) {
 		fDirtyRegion.MakeEmpty();
 		fExposeRegion.MakeEmpty();
+		fExposeTime = 0;
 		return;
 	}
 
@@ -783,10 +802,39 @@ Window::RedrawDirtyRegion()
 		dirtyContentRegion->IntersectWith(&fDirtyRegion);
 		exposeContentRegion->IntersectWith(&fExposeRegion);
 
+		// put back what the backing store has of the exposed parts, the
+		// client only needs to redraw the rest
+		BRegion* restoredRegion = fRegionPool.GetRegion();
+		if (fBackingStore.IsSet() && restoredRegion != NULL
+			&& fDrawingEngine->LockParallelAccess()) {
+			bool copyToFrontEnabled = fDrawingEngine->CopyToFrontEnabled();
+			fDrawingEngine->SetCopyToFrontEnabled(true);
+			fBackingStore->Restore(fDrawingEngine.Get(), fFrame.LeftTop(),
+				*dirtyContentRegion, *restoredRegion);
+			fDrawingEngine->SetCopyToFrontEnabled(copyToFrontEnabled);
+			fDrawingEngine->UnlockParallelAccess();
+
+			dirtyContentRegion->Exclude(restoredRegion);
+			exposeContentRegion->Exclude(restoredRegion);
+		}
+
+		if (fExposeTime != 0) {
+			if (exposeContentRegion->CountRects() > 0) {
+				if (fClientExposeTime == 0)
+					fClientExposeTime = fExposeTime;
+			} else if (restoredRegion != NULL
+				&& restoredRegion->CountRects() > 0) {
+				BackingStore::AddExposeTime(system_time() - fExposeTime,
+					true);
+			}
+		}
+
 		_TriggerContentRedraw(*dirtyContentRegion, *exposeContentRegion);
 
 		fRegionPool.Recycle(dirtyContentRegion);
 		fRegionPool.Recycle(exposeContentRegion);
+		if (restoredRegion != NULL)
+			fRegionPool.Recycle(restoredRegion);
 	}
 
 	// reset the dirty region, since
@@ -798,6 +846,7 @@ Window::RedrawDirtyRegion()
 	// the read lock for the whole time.
 	fDirtyRegion.MakeEmpty();
 	fExposeRegion.MakeEmpty();
+	fExposeTime = 0;
 }
 
 
@@ -820,6 +869,8 @@ Window::MarkContentDirty(BRegion& dirtyRegion, BRegion& exposeRegion)
 	// since this won't affect other windows, read locking
 	// is sufficient. If there was no dirty region before,
 	// an update message is triggered
+	_InvalidateRetainedContents(dirtyRegion);
+
 	if (fHidden || IsOffscreenWindow())
 		return;
 
@@ -833,6 +884,8 @@ void
 Window::MarkContentDirtyAsync(BRegion& dirtyRegion)
 {
 	// NOTE: see comments in ProcessDirtyRegion()
+	_InvalidateRetainedContents(dirtyRegion);
+
 	if (fHidden || IsOffscreenWindow())
 		return;
 
@@ -849,11 +902,16 @@ Window::MarkContentDirtyAsync(BRegion& dirtyRegion)
 void
 Window::InvalidateView(View* view, BRegion& viewRegion)
 {
-	if (view && IsVisible() && view->IsVisible()) {
+	if (view == NULL)
+		return;
+
+	view->LocalToScreenTransform().Apply(&viewRegion);
+	_InvalidateRetainedContents(viewRegion);
+
+	if (IsVisible() && view->IsVisible()) {
 		if (!fContentRegionValid)
 			_UpdateContentRegion();
 
-		view->LocalToScreenTransform().Apply(&viewRegion);
 		viewRegion.IntersectWith(&VisibleContentRegion());
 		if (viewRegion.CountRects() > 0) {
 			viewRegion.IntersectWith(
@@ -866,6 +924,27 @@ Window::InvalidateView(View* view, BRegion& viewRegion)
 	}
 }
 
+
+/*!	Drawing outside of an update means that the view shows something new,
+	so what the backing store retained of it is outdated.
+*/
+void
+Window::ViewContentsChanging(View* view)
+{
+	if (!fInUpdate)
+		_InvalidateRetainedView(view);
+}
+
+
+/*!	Called by the Desktop when the frame buffer has been replaced, before the
+	clipping is rebuilt; nothing that was visible can be captured anymore.
+*/
+void
+Window::ScreenContentsLost()
+{
+	fRetainedVisible.MakeEmpty();
+}
+
 // DisableUpdateRequests
 void
 Window::DisableUpdateRequests()
@@ -1107,6 +1186,9 @@ Window::SetHidden(bool hidden)
 {
 	// the desktop takes care of dirty regions
 	if (fHidden != hidden) {
+		if (hidden && IsVisible())
+			_RetainContents(false);
+
 		fHidden = hidden;
 
 		fTopView->SetHidden(hidden);
@@ -1136,6 +1218,17 @@ Window::SetMinimized(bool minimized)
 }
 
 
+void
+Window::SetCurrentWorkspace(int32 index)
+{
+	// the window is still on screen when it leaves the current workspace
+	if (index < 0 && IsVisible())
+		_RetainContents(false);
+
+	fCurrentWorkspace = index;
+}
+
+
 bool
 Window::IsVisible() const
 {
@@ -2000,6 +2093,12 @@ Window::EndUpdate()
 		_SendUpdateMessage();
 	} else {
 		fUpdateRequested = false;
+
+		if (fClientExposeTime != 0) {
+			BackingStore::AddExposeTime(system_time() - fClientExposeTime,
+				false);
+			fClientExposeTime = 0;
+		}
 	}
 }
 
@@ -2018,6 +2117,124 @@ Window::_UpdateContentRegion()
 }
 
 
+/*!	Keeps the contents of the window content that is no longer visible since
+	the clipping was last changed, and prepares putting back what became
+	visible again. Only called from the Desktop thread, with the clipping
+	write locked, and before anything else is drawn on screen.
+*/
+void
+Window::_RetainContents(bool visible)
+{
+	if (!fBackingStore.IsSet()) {
+		if (!visible || IsOffscreenWindow()
+			|| (fFlags & kWindowScreenFlag) != 0
+			|| !BackingStore::IsEnabled()) {
+			return;
+		}
+
+		fBackingStore.SetTo(new(std::nothrow) BackingStore(fDesktop));
+		if (!fBackingStore.IsSet())
+			return;
+	}
+
+	// The contents cannot be kept across size changes, nor when the client
+	// draws on the frame buffer directly; only the top window of a stack is
+	// drawn at all.
+	if (fRetainedFrame.Width() != fFrame.Width()
+		|| fRetainedFrame.Height() != fFrame.Height()) {
+		fBackingStore->MakeEmpty();
+		fRetainedVisible.MakeEmpty();
+	}
+	if (fWindow->IsDirectlyAccessing() || TopLayerStackWindow() != this) {
+		fBackingStore->MakeEmpty();
+		fRetainedVisible.MakeEmpty();
+		visible = false;
+	}
+
+	BRegion* visibleContent = fRegionPool.GetRegion();
+	BRegion* dirty = fRegionPool.GetRegion(fDirtyRegion);
+	if (visibleContent == NULL || dirty == NULL) {
+		fBackingStore->MakeEmpty();
+		fRetainedVisible.MakeEmpty();
+		if (visibleContent != NULL)
+			fRegionPool.Recycle(visibleContent);
+		if (dirty != NULL)
+			fRegionPool.Recycle(dirty);
+		return;
+	}
+
+	if (visible) {
+		*visibleContent = VisibleContentRegion();
+		visibleContent->OffsetBy(-(int32)fFrame.left, -(int32)fFrame.top);
+	}
+
+	// everything that still needs to be drawn has nothing to retain
+	if (fCurrentUpdateSession->IsUsed())
+		dirty->Include(&fCurrentUpdateSession->DirtyRegion());
+	if (fPendingUpdateSession->IsUsed())
+		dirty->Include(&fPendingUpdateSession->DirtyRegion());
+	dirty->OffsetBy(-(int32)fFrame.left, -(int32)fFrame.top);
+
+	if (fDrawingEngine->LockParallelAccess()) {
+		fBackingStore->Update(fDrawingEngine.Get(), fRetainedFrame.LeftTop(),
+			fFrame.IntegerWidth() + 1, fFrame.IntegerHeight() + 1,
+			fRetainedVisible, *visibleContent, *dirty);
+		fDrawingEngine->UnlockParallelAccess();
+	} else
+		fBackingStore->MakeEmpty();
+
+	fRetainedVisible = *visibleContent;
+	fRetainedFrame = fFrame;
+
+	fRegionPool.Recycle(visibleContent);
+	fRegionPool.Recycle(dirty);
+}
+
+
+/*!	Forgets what the backing store retained of the given region, as the
+	client is going to draw something else there.
+*/
+void
+Window::_InvalidateRetainedContents(const BRegion& regionOnScreen)
+{
+	if (!fBackingStore.IsSet() || !fBackingStore->HasContents())
+		return;
+
+	BRegion* region = fRegionPool.GetRegion(regionOnScreen);
+	if (region == NULL) {
+		fBackingStore->MakeEmpty();
+		return;
+	}
+
+	region->OffsetBy(-(int32)fFrame.left, -(int32)fFrame.top);
+	fBackingStore->Invalidate(*region);
+	fRegionPool.Recycle(region);
+}
+
+
+void
+Window::_InvalidateRetainedView(View* view)
+{
+	if (!fBackingStore.IsSet() || !fBackingStore->HasContents())
+		return;
+
+	IntRect bounds = view->Bounds();
+	view->ConvertToVisibleInTopView(&bounds);
+	if (!bounds.IsValid())
+		return;
+
+	BRegion* region = fRegionPool.GetRegion();
+	if (region == NULL) {
+		fBackingStore->MakeEmpty();
+		return;
+	}
+
+	region->Set((clipping_rect)bounds);
+	_InvalidateRetainedContents(*region);
+	fRegionPool.Recycle(region);
+}
+
+
 void
 Window::_ObeySizeLimits()
 {
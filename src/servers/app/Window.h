@@ -68,6 +68,7 @@ namespace BPrivate {
 	class PortLink;
 };
 
+class BackingStore;
 class ClickTarget;
 class ClientLooper;
 class Decorator;
@@ -159,6 +160,10 @@ public:
 			void				MarkContentDirtyAsync(BRegion& dirtyRegion);
 			// shortcut for invalidating just one view
 			void				InvalidateView(View* view, BRegion& viewRegion);
+			// the client is about to draw into the view
+			void				ViewContentsChanging(View* view);
+			// the screen buffer is no longer what it was
+			void				ScreenContentsLost();
 
 			void				DisableUpdateRequests();
 			void				EnableUpdateRequests();
@@ -221,8 +226,7 @@ public:
 			void				SetMinimized(bool minimized);
 	inline	bool				IsMinimized() const { return fMinimized; }
 
-			void				SetCurrentWorkspace(int32 index)
-									{ fCurrentWorkspace = index; }
+			void				SetCurrentWorkspace(int32 index);
 			int32				CurrentWorkspace() const
 									{ return fCurrentWorkspace; }
 			bool				IsVisible() const;
@@ -332,6 +336,12 @@ protected:
 
 			void				_UpdateContentRegion();
 
+			// retaining the contents of hidden parts
+			void				_RetainContents(bool visible);
+			void				_InvalidateRetainedContents(
+									const BRegion& regionOnScreen);
+			void				_InvalidateRetainedView(View* view);
+
 			void				_ObeySizeLimits();
 			void				_PropagatePosition();
 
@@ -432,6 +442,17 @@ protected:
 
 			int32				fWorkspacesViewCount;
 
+			// the contents of the hidden parts of the window, and what of
+			// the window content was visible when the clipping last changed
+			ObjectDeleter<BackingStore>
+								fBackingStore;
+			BRegion				fRetainedVisible;
+			BRect				fRetainedFrame;
+
+			// when the oldest expose that has not been redrawn yet happened
+			bigtime_t			fExposeTime;
+			bigtime_t			fClientExposeTime;
+
 		friend class DecorManager;
 
 private:
@@ -55,8 +55,10 @@ BitmapDrawingEngine::SetSize(int32 newWidth, int32 newHeight)
 		fHWInterface.Unset();
 	}
 
-	if (newWidth <= 0 || newHeight <= 0)
+	if (newWidth <= 0 || newHeight <= 0) {
+		fBitmap.Unset();
 		return B_OK;
+	}
 
 	fBitmap.SetTo(new(std::nothrow) UtilityBitmap(BRect(0, 0, newWidth - 1,
 		newHeight - 1), fColorSpace, 0));
@@ -24,6 +24,8 @@ virtual							~BitmapDrawingEngine();
 			status_t			SetSize(int32 newWidth, int32 newHeight);
 			UtilityBitmap*		ExportToBitmap(int32 width, int32 height,
 									color_space space);
+			UtilityBitmap*		Bitmap() const
+									{ return fBitmap.Get(); }
 
 private:
 			color_space			fColorSpace;
@@ -1530,6 +1530,38 @@ DrawingEngine::ReadBitmap(ServerBitmap* bitmap, bool drawCursor, BRect bounds)
 }
 
 
+/*!	Copies the pixels of \a region from the drawing buffer into \a bitmap,
+	whose top left corner is at \a bitmapOrigin on screen.
+*/
+status_t
+DrawingEngine::ReadRegion(ServerBitmap* bitmap, const BRegion& region,
+	BPoint bitmapOrigin)
+{
+	ASSERT_PARALLEL_LOCKED();
+
+	BRegion read(region);
+	return _TransferRegion(bitmap, read, bitmapOrigin, false);
+}
+
+
+/*!	The opposite of ReadRegion(): copies the pixels of \a region from
+	\a bitmap back into the drawing buffer.
+*/
+status_t
+DrawingEngine::WriteRegion(ServerBitmap* bitmap, const BRegion& region,
+	BPoint bitmapOrigin)
+{
+	ASSERT_PARALLEL_LOCKED();
+
+	BRegion written(region);
+	status_t status = _TransferRegion(bitmap, written, bitmapOrigin, true);
+	if (status == B_OK && fCopyToFront)
+		fGraphicsCard->InvalidateRegion(written);
+
+	return status;
+}
+
+
 // #pragma mark -
 
 
@@ -1574,6 +1606,66 @@ DrawingEngine::CopyRect(BRect src, int32 xOffset, int32 yOffset) const
 }
 
 
+/*!	Copies \a region between the drawing buffer and \a bitmap, in the
+	direction given by \a toScreen. On return, \a region is clipped to the
+	part that was actually copied.
+*/
+status_t
+DrawingEngine::_TransferRegion(ServerBitmap* bitmap, BRegion& region,
+	BPoint bitmapOrigin, bool toScreen) const
+{
+	RenderingBuffer* buffer = fGraphicsCard->DrawingBuffer();
+	if (buffer == NULL)
+		return B_ERROR;
+
+	// both sides are copied row by row without any conversion
+	if ((buffer->ColorSpace() != B_RGB32 && buffer->ColorSpace() != B_RGBA32)
+		|| (bitmap->ColorSpace() != B_RGB32
+			&& bitmap->ColorSpace() != B_RGBA32)) {
+		return B_NOT_SUPPORTED;
+	}
+
+	BRegion clip(BRect(0, 0, buffer->Width() - 1, buffer->Height() - 1));
+	region.IntersectWith(&clip);
+	BRect bitmapBounds = bitmap->Bounds();
+	bitmapBounds.OffsetBy(bitmapOrigin);
+	clip.Set(bitmapBounds);
+	region.IntersectWith(&clip);
+
+	if (region.CountRects() == 0)
+		return B_OK;
+
+	AutoFloatingOverlaysHider _(fGraphicsCard, region.Frame());
+
+	const int32 originX = (int32)bitmapOrigin.x;
+	const int32 originY = (int32)bitmapOrigin.y;
+	const uint32 bufferBPR = buffer->BytesPerRow();
+	const uint32 bitmapBPR = bitmap->BytesPerRow();
+
+	int32 count = region.CountRects();
+	for (int32 i = 0; i < count; i++) {
+		clipping_rect rect = region.RectAtInt(i);
+		const size_t bytes = (rect.right - rect.left + 1) * 4;
+
+		uint8* screen = (uint8*)buffer->Bits() + (ssize_t)rect.top * bufferBPR
+			+ (ssize_t)rect.left * 4;
+		uint8* bits = bitmap->Bits() + (ssize_t)(rect.top - originY) * bitmapBPR
+			+ (ssize_t)(rect.left - originX) * 4;
+
+		for (int32 y = rect.top; y <= rect.bottom; y++) {
+			if (toScreen)
+				memcpy(screen, bits, bytes);
+			else
+				memcpy(bits, screen, bytes);
+			screen += bufferBPR;
+			bits += bitmapBPR;
+		}
+	}
+
+	return B_OK;
+}
+
+
 void
 DrawingEngine::SetRendererOffset(int32 offsetX, int32 offsetY)
 {
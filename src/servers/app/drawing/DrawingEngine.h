@@ -66,6 +66,12 @@ public:
 	virtual	status_t		ReadBitmap(ServerBitmap *bitmap, bool drawCursor,
 								BRect bounds);
 
+	// for retained window contents
+			status_t		ReadRegion(ServerBitmap* bitmap,
+								const BRegion& region, BPoint bitmapOrigin);
+			status_t		WriteRegion(ServerBitmap* bitmap,
+								const BRegion& region, BPoint bitmapOrigin);
+
 	// clipping for all drawing functions, passing a NULL region
 	// will remove any clipping (drawing allowed everywhere)
 	virtual	void			ConstrainClippingRegion(const BRegion* region);
@@ -206,6 +212,9 @@ private:
 			void			_CopyRect(bool isGraphicsMemory, uint8* bits,
 								uint32 width, uint32 height, uint32 bytesPerRow,
 								int32 xOffset, int32 yOffset) const;
+			status_t		_TransferRegion(ServerBitmap* bitmap,
+								BRegion& region, BPoint bitmapOrigin,
+								bool toScreen) const;
 
 			ObjectDeleter<Painter>
 							fPainter;
@@ -61,6 +61,7 @@
 #include "ServerBitmap.h"
 #include "ServerFont.h"
 #include "SystemPalette.h"
+#include "WorkerPool.h"
 
 #include "AppServer.h"
 
@@ -162,6 +163,8 @@ detect_simd()
 				cpuSIMD |= APPSERVER_SIMD_MMX;
 			if (edx & (1 << 25))
 				cpuSIMD |= APPSERVER_SIMD_SSE;
+			if (edx & (1 << 26))
+				cpuSIMD |= APPSERVER_SIMD_SSE2;
 		} else {
 			// no flags can be identified
 			cpuSIMD = 0;
@@ -169,7 +172,40 @@ detect_simd()
 		systemSIMD &= cpuSIMD;
 	}
 	return systemSIMD;
-#else	// !__i386__
+#elif defined(__x86_64__)
+	// SSE2 is part of the architecture. MMX and SSE are only used by the
+	// x86 versions of the drawing code, so they are not reported here. All
+	// CPUs are expected to share the same feature set, so looking at the
+	// current one is good enough.
+	uint32 systemSIMD = APPSERVER_SIMD_SSE2;
+
+	cpuid_info cpuInfo;
+	get_cpuid(&cpuInfo, 0, 0);
+	if (cpuInfo.regs.eax < 7)
+		return systemSIMD;
+
+	// AVX2 also needs the OS to save the YMM registers on context switches
+	get_cpuid(&cpuInfo, 1, 0);
+	const uint32 kOSXSAVE = 1 << 27;
+	const uint32 kAVX = 1 << 28;
+	if ((cpuInfo.regs.ecx & (kOSXSAVE | kAVX)) != (kOSXSAVE | kAVX))
+		return systemSIMD;
+
+	uint32 low;
+	uint32 high;
+	__asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+	if ((low & 0x6) != 0x6)
+		return systemSIMD;
+
+	get_cpuid(&cpuInfo, 7, 0);
+	if ((cpuInfo.regs.ebx & (1 << 5)) != 0)
+		systemSIMD |= APPSERVER_SIMD_AVX2;
+
+	return systemSIMD;
+#elif defined(__aarch64__)
+	// Advanced SIMD is mandatory on arm64
+	return APPSERVER_SIMD_NEON;
+#else
 	return 0;
 #endif
 }
@@ -199,6 +235,195 @@ private:
 };
 
 
+// #pragma mark - band rendering
+
+
+/*!	Iterates over an agg::path_storage without using its own iterator, so
+	that several threads can rasterize the same path at once.
+*/
+class PathStorageReader {
+public:
+	PathStorageReader(const agg::path_storage& vertices)
+		:
+		fVertices(vertices),
+		fIndex(0)
+	{
+	}
+
+	void rewind(unsigned)
+	{
+		fIndex = 0;
+	}
+
+	unsigned vertex(double* x, double* y)
+	{
+		if (fIndex >= fVertices.total_vertices())
+			return agg::path_cmd_stop;
+
+		return fVertices.vertex(fIndex++, x, y);
+	}
+
+private:
+	const agg::path_storage&	fVertices;
+	unsigned					fIndex;
+};
+
+
+/*!	Renders a path in horizontal bands from the threads of the WorkerPool.
+	Every band rasterizes the whole path with the same clipping as the
+	serial code does, so that the coverage of each pixel is exactly the
+	same, but only renders the scanlines that fall into it.
+*/
+class RasterizeBandsJob : public WorkerPool::Job {
+public:
+	RasterizeBandsJob(const agg::path_storage& vertices,
+		const renderer_base& baseRenderer, const clipping_rect& clipBox,
+		agg::filling_rule_e fillingRule, const BRect& bounds, int32 bandCount)
+		:
+		fVertices(vertices),
+		fRendererBase(baseRenderer),
+		fClipBox(clipBox),
+		fFillingRule(fillingRule),
+		fTop((int32)floorf(bounds.top)),
+		fBottom((int32)ceilf(bounds.bottom)),
+		fBandCount(bandCount)
+	{
+	}
+
+	virtual void Execute(int32 index)
+	{
+		rasterizer_type rasterizer;
+#if ALIASED_DRAWING
+		rasterizer.gamma(agg::gamma_threshold(0.5));
+#endif
+		rasterizer.clip_box(fClipBox.left, fClipBox.top, fClipBox.right + 1,
+			fClipBox.bottom + 1);
+		rasterizer.filling_rule(fFillingRule);
+
+		PathStorageReader reader(fVertices);
+		rasterizer.add_path(reader);
+		if (!rasterizer.rewind_scanlines())
+			return;
+
+		// The first and last band also take whatever the rasterizer
+		// produced outside of the bounds.
+		const int32 height = fBottom - fTop + 1;
+		int32 top = fTop + height * index / fBandCount;
+		int32 bottom = fTop + height * (index + 1) / fBandCount - 1;
+		if (index == 0)
+			top = min_c(top, rasterizer.min_y());
+		if (index == fBandCount - 1)
+			bottom = max_c(bottom, rasterizer.max_y());
+
+		top = max_c(top, rasterizer.min_y());
+		if (top > bottom || !rasterizer.navigate_scanline(top))
+			return;
+
+		// The renderer keeps the current clipping rect, it cannot be shared
+		renderer_base baseRenderer(fRendererBase);
+		RenderBand(baseRenderer, rasterizer, bottom);
+	}
+
+protected:
+	virtual void RenderBand(renderer_base& baseRenderer,
+		rasterizer_type& rasterizer, int32 bottom) = 0;
+
+	template<class Scanline, class Renderer>
+	static void SweepBand(rasterizer_type& rasterizer, Scanline& scanline,
+		Renderer& renderer, int32 bottom)
+	{
+		scanline.reset(rasterizer.min_x(), rasterizer.max_x());
+		renderer.prepare();
+		while (rasterizer.sweep_scanline(scanline) && scanline.y() <= bottom)
+			renderer.render(scanline);
+	}
+
+private:
+	const agg::path_storage&	fVertices;
+	const renderer_base&		fRendererBase;
+	clipping_rect				fClipBox;
+	agg::filling_rule_e			fFillingRule;
+	int32						fTop;
+	int32						fBottom;
+	int32						fBandCount;
+};
+
+
+class SolidBandsJob : public RasterizeBandsJob {
+public:
+	SolidBandsJob(const agg::path_storage& vertices,
+		const renderer_base& baseRenderer, const clipping_rect& clipBox,
+		agg::filling_rule_e fillingRule, const BRect& bounds, int32 bandCount,
+		const renderer_type::color_type& color)
+		:
+		RasterizeBandsJob(vertices, baseRenderer, clipBox, fillingRule, bounds,
+			bandCount),
+		fColor(color)
+	{
+	}
+
+protected:
+	virtual void RenderBand(renderer_base& baseRenderer,
+		rasterizer_type& rasterizer, int32 bottom)
+	{
+		renderer_type renderer(baseRenderer);
+		renderer.color(fColor);
+		scanline_packed_type scanline;
+		SweepBand(rasterizer, scanline, renderer, bottom);
+	}
+
+private:
+	renderer_type::color_type	fColor;
+};
+
+
+template<class GradientFunction, class ColorArray>
+class GradientBandsJob : public RasterizeBandsJob {
+public:
+	GradientBandsJob(const agg::path_storage& vertices,
+		const renderer_base& baseRenderer, const clipping_rect& clipBox,
+		agg::filling_rule_e fillingRule, const BRect& bounds, int32 bandCount,
+		const GradientFunction& function, agg::trans_affine& transform,
+		const ColorArray& colors, int gradientStop)
+		:
+		RasterizeBandsJob(vertices, baseRenderer, clipBox, fillingRule, bounds,
+			bandCount),
+		fFunction(function),
+		fTransform(transform),
+		fColors(colors),
+		fGradientStop(gradientStop)
+	{
+	}
+
+protected:
+	virtual void RenderBand(renderer_base& baseRenderer,
+		rasterizer_type& rasterizer, int32 bottom)
+	{
+		typedef agg::span_interpolator_linear<> interpolator_type;
+		typedef agg::span_allocator<agg::rgba8> span_allocator_type;
+		typedef agg::span_gradient<agg::rgba8, interpolator_type,
+					GradientFunction, ColorArray> span_gradient_type;
+		typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
+					span_gradient_type> renderer_gradient_type;
+
+		interpolator_type spanInterpolator(fTransform);
+		span_allocator_type spanAllocator;
+		span_gradient_type spanGradient(spanInterpolator, fFunction,
+			fColors, 0, fGradientStop);
+		renderer_gradient_type renderer(baseRenderer, spanAllocator,
+			spanGradient);
+		scanline_unpacked_type scanline;
+		SweepBand(rasterizer, scanline, renderer, bottom);
+	}
+
+private:
+	const GradientFunction&		fFunction;
+	agg::trans_affine&			fTransform;
+	const ColorArray&			fColors;
+	int							fGradientStop;
+};
+
+
 // #pragma mark -
 
 
@@ -216,6 +441,7 @@ Painter::Painter()
 	fLineCapMode(B_BUTT_CAP),
 	fLineJoinMode(B_MITER_JOIN),
 	fMiterLimit(B_DEFAULT_MITER_LIMIT),
+	fFillRule(agg::fill_non_zero),
 
 	fPatternHandler(),
 	fTextRenderer(fSubpixRenderer, fRenderer, fRendererBin, fUnpackedScanline,
@@ -453,6 +679,7 @@ Painter::SetFillRule(int32 fillRule)
 	agg::filling_rule_e aggFillRule = fillRule == B_EVEN_ODD
 		? agg::fill_even_odd : agg::fill_non_zero;
 
+	fFillRule = aggFillRule;
 	fRasterizer.filling_rule(aggFillRule);
 	fSubpixRasterizer.filling_rule(aggFillRule);
 }
@@ -1568,6 +1795,25 @@ Painter::_Clipped(const BRect& rect) const
 }
 
 
+/*!	Returns into how many bands the area covered by a path with the given
+	(clipped) bounds is split for rendering it in parallel, see
+	RasterizeBandsJob; 1 means it is rendered by the calling thread alone.
+*/
+int32
+Painter::_CountBands(const BRect& bounds) const
+{
+	// Alpha masks and subpixel antialiasing have their own scanlines and
+	// rasterizers, which are not covered by the band renderers.
+	if (!bounds.IsValid() || fMaskedUnpackedScanline != NULL
+		|| gSubpixelAntialiasing) {
+		return 1;
+	}
+
+	return WorkerPool::CountBands(bounds.IntegerWidth() + 1,
+		bounds.IntegerHeight() + 1);
+}
+
+
 // _UpdateDrawingMode
 void
 Painter::_UpdateDrawingMode()
@@ -1862,9 +2108,23 @@ Painter::_RasterizePath(VertexSource& path) const
 		agg::render_scanlines(fSubpixRasterizer,
 			fSubpixPackedScanline, fSubpixRenderer);
 	} else {
+		BRect bounds = _Clipped(_BoundingBox(path));
+		int32 bandCount = _CountBands(bounds);
+		if (bandCount > 1) {
+			agg::path_storage vertices;
+			vertices.concat_path(path);
+
+			SolidBandsJob job(vertices, fBaseRenderer,
+				fClippingRegion->FrameInt(), fFillRule, bounds, bandCount,
+				fRenderer.color());
+			WorkerPool::Default()->Run(job, bandCount);
+			return bounds;
+		}
+
 		fRasterizer.reset();
 		fRasterizer.add_path(path);
 		agg::render_scanlines(fRasterizer, fPackedScanline, fRenderer);
+		return bounds;
 	}
 
 	return _Clipped(_BoundingBox(path));
@@ -2126,6 +2386,22 @@ Painter::_RasterizePath(VertexSource& path, const BGradient& gradient,
 	span_gradient_type spanGradient(spanInterpolator, function, colorArray,
 		0, gradientStop);
 
+	if (fMaskedUnpackedScanline == NULL) {
+		BRect bounds = _Clipped(_BoundingBox(path));
+		int32 bandCount = _CountBands(bounds);
+		if (bandCount > 1) {
+			agg::path_storage vertices;
+			vertices.concat_path(path);
+
+			GradientBandsJob<GradientFunction, color_array_type> job(vertices,
+				fBaseRenderer, fClippingRegion->FrameInt(), fFillRule, bounds,
+				bandCount, function, gradientTransform, colorArray,
+				gradientStop);
+			WorkerPool::Default()->Run(job, bandCount);
+			return;
+		}
+	}
+
 	renderer_gradient_type gradientRenderer(fBaseRenderer, spanAllocator,
 		spanGradient);
 
@@ -46,6 +46,9 @@ class ServerFont;
 // Defines for SIMD support.
 #define APPSERVER_SIMD_MMX	(1 << 0)
 #define APPSERVER_SIMD_SSE	(1 << 1)
+#define APPSERVER_SIMD_SSE2	(1 << 2)
+#define APPSERVER_SIMD_AVX2	(1 << 3)
+#define APPSERVER_SIMD_NEON	(1 << 4)
 
 
 class Painter {
@@ -262,6 +265,7 @@ private:
 			BPoint				_Align(const BPoint& point,
 									bool centerOffset = true) const;
 			BRect				_Clipped(const BRect& rect) const;
+			int32				_CountBands(const BRect& bounds) const;
 
 			void				_UpdateFont() const;
 			void				_UpdateLineWidth();
@@ -346,6 +350,7 @@ private:
 			cap_mode			fLineCapMode;
 			join_mode			fLineJoinMode;
 			float				fMiterLimit;
+			agg::filling_rule_e	fFillRule;
 
 			PatternHandler		fPatternHandler;
 
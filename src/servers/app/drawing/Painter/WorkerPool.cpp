@@ -0,0 +1,211 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "WorkerPool.h"
+
+#include <new>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <SupportDefs.h>
+
+
+// Splitting smaller areas costs more in thread handoffs than it gains.
+static const int64 kMinParallelPixels = 512 * 256;
+static const int32 kMinBandHeight = 32;
+
+static pthread_once_t sDefaultInitOnce = PTHREAD_ONCE_INIT;
+
+WorkerPool* WorkerPool::sDefault = NULL;
+
+
+WorkerPool::Job::~Job()
+{
+}
+
+
+// #pragma mark -
+
+
+WorkerPool::WorkerPool(int32 threadCount)
+	:
+	fLock("rendering workers"),
+	fStartSem(-1),
+	fDoneSem(-1),
+	fJob(NULL),
+	fCount(0),
+	fNextIndex(0),
+	fThreadCount(0)
+{
+	if (threadCount > kMaxThreads)
+		threadCount = kMaxThreads;
+
+	for (int32 i = 0; i < threadCount; i++)
+		fThreads[i] = -1;
+	fThreadCount = threadCount;
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	delete_sem(fStartSem);
+	delete_sem(fDoneSem);
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		if (fThreads[i] >= 0) {
+			status_t result;
+			wait_for_thread(fThreads[i], &result);
+		}
+	}
+}
+
+
+/*!	Returns the pool shared by all Painters, or \c NULL if there is only one
+	CPU. The number of threads, including the one calling Run(), can be
+	overridden with the APP_SERVER_RENDERING_THREADS environment variable;
+	a value of 1 turns off parallel rendering.
+*/
+/*static*/ WorkerPool*
+WorkerPool::Default()
+{
+	pthread_once(&sDefaultInitOnce, &_InitDefault);
+	return sDefault;
+}
+
+
+/*!	Returns into how many horizontal bands an area of the given size should
+	be split for rendering, 1 if it is not worth to render it in parallel.
+*/
+/*static*/ int32
+WorkerPool::CountBands(int32 width, int32 height)
+{
+	if ((int64)width * height < kMinParallelPixels)
+		return 1;
+
+	WorkerPool* pool = Default();
+	if (pool == NULL)
+		return 1;
+
+	// Use more bands than threads, so that bands which take longer than the
+	// others (an ellipse is widest in the middle) keep no one waiting.
+	int32 count = min_c(2 * pool->CountThreads(), height / kMinBandHeight);
+	return max_c(count, 1);
+}
+
+
+/*!	Calls Job::Execute() for the indices 0 to \a count - 1, and returns when
+	all of them have finished. If the pool is already busy with the job of
+	another thread, the indices are all executed by the calling thread.
+*/
+void
+WorkerPool::Run(Job& job, int32 count)
+{
+	if (count < 2 || fLock.LockWithTimeout(0) != B_OK) {
+		for (int32 i = 0; i < count; i++)
+			job.Execute(i);
+		return;
+	}
+
+	fJob = &job;
+	fCount = count;
+	fNextIndex = 0;
+
+	int32 helperCount = min_c(fThreadCount, count - 1);
+	release_sem_etc(fStartSem, helperCount, 0);
+
+	_Work();
+
+	while (acquire_sem_etc(fDoneSem, helperCount, 0, 0) == B_INTERRUPTED)
+		;
+
+	fJob = NULL;
+	fLock.Unlock();
+}
+
+
+status_t
+WorkerPool::_Init()
+{
+	if (fLock.InitCheck() < B_OK)
+		return fLock.InitCheck();
+
+	fStartSem = create_sem(0, "rendering workers start");
+	if (fStartSem < 0)
+		return fStartSem;
+	fDoneSem = create_sem(0, "rendering workers done");
+	if (fDoneSem < 0)
+		return fDoneSem;
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		fThreads[i] = spawn_thread(&_WorkerThread, "rendering worker",
+			B_DISPLAY_PRIORITY, this);
+		if (fThreads[i] < 0)
+			return fThreads[i];
+
+		resume_thread(fThreads[i]);
+	}
+
+	return B_OK;
+}
+
+
+void
+WorkerPool::_Work()
+{
+	while (true) {
+		int32 index = atomic_add(&fNextIndex, 1);
+		if (index >= fCount)
+			break;
+
+		fJob->Execute(index);
+	}
+}
+
+
+/*static*/ status_t
+WorkerPool::_WorkerThread(void* data)
+{
+	WorkerPool* pool = (WorkerPool*)data;
+
+	while (true) {
+		status_t status = acquire_sem(pool->fStartSem);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status != B_OK)
+			break;
+
+		pool->_Work();
+		release_sem(pool->fDoneSem);
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+WorkerPool::_InitDefault()
+{
+	system_info info;
+	if (get_system_info(&info) != B_OK)
+		return;
+
+	int32 threadCount = info.cpu_count;
+
+	const char* threads = getenv("APP_SERVER_RENDERING_THREADS");
+	if (threads != NULL)
+		threadCount = atoi(threads);
+
+	if (threadCount <= 1)
+		return;
+
+	WorkerPool* pool = new(std::nothrow) WorkerPool(threadCount - 1);
+	if (pool != NULL && pool->_Init() != B_OK) {
+		delete pool;
+		pool = NULL;
+	}
+
+	sDefault = pool;
+}
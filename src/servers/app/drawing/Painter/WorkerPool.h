@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+
+#include <Locker.h>
+#include <OS.h>
+
+
+/*!	A small pool of rendering threads shared by all Painters. A job is split
+	into a number of independent parts which are handed out to the pool
+	threads and the calling thread alike; Run() returns when all of them
+	are done.
+*/
+class WorkerPool {
+public:
+	class Job {
+	public:
+		virtual					~Job();
+
+		// Called concurrently from several threads, each index exactly once.
+		virtual	void			Execute(int32 index) = 0;
+	};
+
+	enum {
+		kMaxThreads = 16,
+		kMaxBands = 2 * (kMaxThreads + 1)
+	};
+
+	static	WorkerPool*			Default();
+
+			int32				CountThreads() const
+									{ return fThreadCount + 1; }
+
+	static	int32				CountBands(int32 width, int32 height);
+
+			void				Run(Job& job, int32 count);
+
+private:
+								WorkerPool(int32 threadCount);
+								~WorkerPool();
+
+			status_t			_Init();
+			void				_Work();
+
+	static	status_t			_WorkerThread(void* data);
+	static	void				_InitDefault();
+
+private:
+			BLocker				fLock;
+			sem_id				fStartSem;
+			sem_id				fDoneSem;
+
+			Job*				fJob;
+			int32				fCount;
+			int32				fNextIndex;
+
+			int32				fThreadCount;
+			thread_id			fThreads[kMaxThreads];
+
+	static	WorkerPool*			sDefault;
+};
+
+
+#endif	// WORKER_POOL_H
@@ -43,6 +43,20 @@ namespace agg
 		{
 		}
 
+		//--------------------------------------------------------------------
+		// Renders to the same pixel format with the same clipping region and
+		// offset, but keeps its own current clipping box, so that the copy
+		// can be used by another thread.
+		renderer_region(const renderer_region<PixelFormat>& other) :
+			m_ren(other.m_ren),
+			m_region(other.m_region),
+			m_curr_cb(0),
+			m_bounds(other.m_bounds),
+			m_offset_x(other.m_offset_x),
+			m_offset_y(other.m_offset_y)
+		{
+		}
+
 		//--------------------------------------------------------------------
 		const pixfmt_type& ren() const { return m_ren.ren();  }
 		pixfmt_type& ren() { return m_ren.ren();  }
@@ -452,7 +466,6 @@ namespace agg
 		}
 
 	private:
-		renderer_region(const renderer_region<PixelFormat>&);
 		const renderer_region<PixelFormat>&
 			operator = (const renderer_region<PixelFormat>&);
 
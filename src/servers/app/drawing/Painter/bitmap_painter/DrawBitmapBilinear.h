@@ -9,6 +9,7 @@
 #define DRAW_BITMAP_BILINEAR_H
 
 #include "Painter.h"
+#include "WorkerPool.h"
 
 #include <typeinfo>
 
@@ -40,6 +41,77 @@ struct FilterData {
 };
 
 
+// Inner x-loop of BilinearDefault, processes one row of destination pixels
+typedef void (*bilinear_scale_xloop)(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow);
+
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+// Vectorized x-loops for the two combinations of color type and drawing mode
+// that BitmapPainter uses, see DrawBitmapBilinearSSE2.cpp and
+// DrawBitmapBilinearNEON.cpp. They produce exactly the same pixels as
+// BilinearDefault<ColorTypeRgb, DrawModeCopy> and
+// BilinearDefault<ColorTypeRgba, DrawModeAlphaOverlay>.
+void bilinear_scale_xloop_copy(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow);
+void bilinear_scale_xloop_alpha_overlay(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow);
+
+#	if defined(__x86_64__)
+#		define BILINEAR_SCALE_SIMD_FLAGS	APPSERVER_SIMD_SSE2
+#	else
+#		define BILINEAR_SCALE_SIMD_FLAGS	APPSERVER_SIMD_NEON
+#	endif
+#elif defined(__i386__)
+#	define BILINEAR_SCALE_SIMD_FLAGS	(APPSERVER_SIMD_MMX | APPSERVER_SIMD_SSE)
+#endif
+
+
+/*!	Draws horizontal bands of a clipping rect from the threads of the
+	WorkerPool. Every band gets its own copy of the painter, as
+	DrawToClipRect() advances the destination pointer.
+*/
+template<class OptimizedVersion>
+class BilinearBandsJob : public WorkerPool::Job {
+public:
+	BilinearBandsJob(const OptimizedVersion& painter, uint8* destination,
+		uint32 destinationBytesPerRow, int32 xIndexL, int32 xIndexR,
+		const int32* bandTops)
+		:
+		fPainter(painter),
+		fDestination(destination),
+		fDestinationBytesPerRow(destinationBytesPerRow),
+		fXIndexL(xIndexL),
+		fXIndexR(xIndexR),
+		fBandTops(bandTops)
+	{
+	}
+
+	virtual void Execute(int32 index)
+	{
+		const int32 top = fBandTops[index];
+		const int32 bottom = fBandTops[index + 1] - 1;
+
+		OptimizedVersion painter(fPainter);
+		painter.DrawBand(fDestination
+				+ (top - fBandTops[0]) * fDestinationBytesPerRow,
+			fXIndexL, fXIndexR, top, bottom);
+	}
+
+private:
+	const OptimizedVersion&	fPainter;
+	uint8*					fDestination;
+	uint32					fDestinationBytesPerRow;
+	int32					fXIndexL;
+	int32					fXIndexR;
+	const int32*			fBandTops;
+};
+
+
 template<class OptimizedVersion>
 struct DrawBitmapBilinearOptimized {
 	void Draw(PainterAggInterface& aggInterface, const BRect& destinationRect,
@@ -85,12 +157,55 @@ struct DrawBitmapBilinearOptimized {
 			//printf("x: %ld - %ld\n", xIndexL, xIndexR);
 			//printf("y: %ld - %ld\n", y1, y2);
 
-			static_cast<OptimizedVersion*>(this)->DrawToClipRect(
-				xIndexL, xIndexR, y1, y2);
+			_DrawToClipRect(xIndexL, xIndexR, y1, y2);
 
 		} while (baseRenderer.next_clip_box());
 	}
 
+	void DrawBand(uint8* destination, int32 xIndexL, int32 xIndexR,
+		int32 y1, int32 y2)
+	{
+		fDestination = destination;
+		static_cast<OptimizedVersion*>(this)->DrawToClipRect(
+			xIndexL, xIndexR, y1, y2);
+	}
+
+private:
+	void _DrawToClipRect(int32 xIndexL, int32 xIndexR, int32 y1, int32 y2)
+	{
+		OptimizedVersion* painter = static_cast<OptimizedVersion*>(this);
+
+		const int32 bandCount = WorkerPool::CountBands(xIndexR - xIndexL + 1,
+			y2 - y1 + 1);
+		if (bandCount < 2) {
+			painter->DrawToClipRect(xIndexL, xIndexR, y1, y2);
+			return;
+		}
+
+		// DrawToClipRect() draws a last row with a weight of 255 as the
+		// bottom row of the bitmap, so a band must not end on one unless
+		// the clipping rect does, or its pixels would differ.
+		int32 bandTops[WorkerPool::kMaxBands + 1];
+		int32 count = 0;
+		int32 top = y1;
+		for (int32 i = 1; i < bandCount; i++) {
+			int32 bottom = y1 + (y2 - y1 + 1) * i / bandCount - 1;
+			while (bottom >= top && fWeightsY[bottom].weight == 255)
+				bottom--;
+			if (bottom < top)
+				continue;
+
+			bandTops[count++] = top;
+			top = bottom + 1;
+		}
+		bandTops[count++] = top;
+		bandTops[count] = y2 + 1;
+
+		BilinearBandsJob<OptimizedVersion> job(*painter, fDestination,
+			fDestinationBytesPerRow, xIndexL, xIndexR, bandTops);
+		WorkerPool::Default()->Run(job, count);
+	}
+
 protected:
 	agg::rendering_buffer*	fSource;
 	uint32					fSourceBytesPerRow;
@@ -229,6 +344,12 @@ template<class ColorType, class DrawMode>
 struct BilinearDefault :
 	DrawBitmapBilinearOptimized<BilinearDefault<ColorType, DrawMode> > {
 
+	BilinearDefault(bilinear_scale_xloop xLoop = NULL)
+		:
+		fXLoop(xLoop)
+	{
+	}
+
 	void DrawToClipRect(int32 xIndexL, int32 xIndexR, int32 y1, int32 y2)
 	{
 		// In this mode we anticipate many pixels wich need filtering,
@@ -257,23 +378,32 @@ struct BilinearDefault :
 			// pixel
 			uint8* d = this->fDestination;
 
-			for (int32 x = xIndexL; x <= xIndexMax; x++) {
-				const uint8* s = src + this->fWeightsX[x].index;
+			if (fXLoop != NULL && this->fSource->height() > 1) {
+				fXLoop(src, d, this->fWeightsX, xIndexL, xIndexMax, wTop,
+					this->fSourceBytesPerRow);
+				// increase pointer by processed pixels
+				d += (xIndexMax - xIndexL + 1) * 4;
+			} else {
+				for (int32 x = xIndexL; x <= xIndexMax; x++) {
+					const uint8* s = src + this->fWeightsX[x].index;
 
-				// calculate the weighted sum of all four
-				// interpolated pixels
-				const uint16 wLeft = this->fWeightsX[x].weight;
-				const uint16 wRight = 255 - wLeft;
+					// calculate the weighted sum of all four
+					// interpolated pixels
+					const uint16 wLeft = this->fWeightsX[x].weight;
+					const uint16 wRight = 255 - wLeft;
 
-				uint32 t[4];
+					uint32 t[4];
 
-				if (this->fSource->height() > 1) {
-					ColorType::Interpolate(&t[0], s, this->fSourceBytesPerRow,
-						wLeft, wTop, wRight, wBottom);
-				} else {
-					ColorType::InterpolateLastRow(&t[0], s,  wLeft, wRight);
+					if (this->fSource->height() > 1) {
+						ColorType::Interpolate(&t[0], s,
+							this->fSourceBytesPerRow, wLeft, wTop, wRight,
+							wBottom);
+					} else {
+						ColorType::InterpolateLastRow(&t[0], s,  wLeft,
+							wRight);
+					}
+					DrawMode::Blend(d, &t[0]);
 				}
-				DrawMode::Blend(d, &t[0]);
 			}
 			// last column of pixels if necessary
 			if (xIndexMax < xIndexR && this->fSource->height() > 1) {
@@ -313,6 +443,9 @@ struct BilinearDefault :
 			*(uint32*)d = *(uint32*)s;
 		}
 	}
+
+private:
+	bilinear_scale_xloop	fXLoop;
 };
 
 
@@ -596,10 +729,16 @@ struct DrawBitmapBilinear {
 
 		int codeSelect = kUseDefaultVersion;
 
+#ifdef BILINEAR_SCALE_SIMD_FLAGS
+		const uint32 neededSIMDFlags = BILINEAR_SCALE_SIMD_FLAGS;
+		const bool hasSIMD = (gSIMDFlags & neededSIMDFlags) == neededSIMDFlags;
+#else
+		const bool hasSIMD = false;
+#endif
+
 		if (typeid(ColorType) == typeid(ColorTypeRgb)
 			&& typeid(DrawMode) == typeid(DrawModeCopy)) {
-			uint32 neededSIMDFlags = APPSERVER_SIMD_MMX | APPSERVER_SIMD_SSE;
-			if ((gSIMDFlags & neededSIMDFlags) == neededSIMDFlags)
+			if (hasSIMD)
 				codeSelect = kUseSIMDVersion;
 			else {
 				if (scaleX == scaleY && (scaleX == 1.5 || scaleX == 2.0
@@ -608,6 +747,13 @@ struct DrawBitmapBilinear {
 				}
 			}
 		}
+#if defined(__x86_64__) || defined(__aarch64__)
+		if (typeid(ColorType) == typeid(ColorTypeRgba)
+			&& typeid(DrawMode) == typeid(DrawModeAlphaOverlay)) {
+			if (hasSIMD)
+				codeSelect = kUseSIMDVersion;
+		}
+#endif
 
 		switch (codeSelect) {
 			case kUseDefaultVersion:
@@ -626,7 +772,7 @@ struct DrawBitmapBilinear {
 				break;
 			}
 
-#ifdef __i386__
+#if defined(__i386__)
 			case kUseSIMDVersion:
 			{
 				BilinearSimd bilinearPainter;
@@ -634,7 +780,19 @@ struct DrawBitmapBilinear {
 					filterData);
 				break;
 			}
-#endif	// __i386__
+#elif defined(__x86_64__) || defined(__aarch64__)
+			case kUseSIMDVersion:
+			{
+				bilinear_scale_xloop xLoop = bilinear_scale_xloop_copy;
+				if (typeid(DrawMode) == typeid(DrawModeAlphaOverlay))
+					xLoop = bilinear_scale_xloop_alpha_overlay;
+
+				BilinearDefault<ColorType, DrawMode> bilinearPainter(xLoop);
+				bilinearPainter.Draw(aggInterface, destinationRect, &bitmap,
+					filterData);
+				break;
+			}
+#endif
 		}
 
 #ifdef FILTER_INFOS_ON_HEAP
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * NEON versions of the bilinear scaling x-loops; Advanced SIMD is part of
+ * the arm64 baseline.
+ *
+ */
+
+#include "DrawBitmapBilinear.h"
+
+#include <arm_neon.h>
+
+
+namespace BitmapPainterPrivate {
+
+
+static const uint8 kAlphaMask[16] = {
+	0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff
+};
+
+
+/*!	Computes s[0..3] * wLeft + s[4..7] * wRight.
+*/
+static inline uint16x4_t
+interpolate_row(const uint8* s, uint16 wLeft, uint16 wRight)
+{
+	uint16x8_t pixels = vmovl_u8(vld1_u8(s));
+	return vmla_n_u16(vmul_n_u16(vget_low_u16(pixels), wLeft),
+		vget_high_u16(pixels), wRight);
+}
+
+
+/*!	Same as ColorTypeRgba::Interpolate() for one destination pixel.
+*/
+static inline uint16x4_t
+interpolate(const uint8* src, const FilterInfo& xWeight,
+	uint32 srcBytesPerRow, uint16 wTop)
+{
+	const uint8* s = src + xWeight.index;
+	const uint16 wLeft = xWeight.weight;
+	const uint16 wRight = 255 - wLeft;
+
+	uint16x4_t top = interpolate_row(s, wLeft, wRight);
+	uint16x4_t bottom = interpolate_row(s + srcBytesPerRow, wLeft, wRight);
+
+	return vshrn_n_u32(vmlal_n_u16(vmull_n_u16(top, wTop), bottom,
+		255 - wTop), 16);
+}
+
+
+/*!	Same as DrawModeAlphaOverlay::Blend() on one pixel with 16 bit lanes.
+	The interpolated alpha is at most 253, so its opaque case never happens.
+*/
+static inline uint16x4_t
+alpha_overlay(uint16x4_t dest, uint16x4_t source)
+{
+	uint16x4_t alpha = vdup_lane_u16(source, 3);
+	uint16x4_t inverse = vsub_u16(vdup_n_u16(256), alpha);
+
+	return vshr_n_u16(vmla_u16(vmul_u16(dest, inverse), source, alpha), 8);
+}
+
+
+/*!	Stores the color channels of four pixels and leaves the alpha channel
+	of the destination alone, like DrawModeCopy and DrawModeAlphaOverlay do.
+*/
+static inline void
+store_colors(uint8* dst, uint8x16_t dest, uint8x16_t pixels)
+{
+	vst1q_u8(dst, vbslq_u8(vld1q_u8(kAlphaMask), dest, pixels));
+}
+
+
+void
+bilinear_scale_xloop_copy(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow)
+{
+	int32 x = xMin;
+	for (; x + 3 <= xMax; x += 4) {
+		uint16x8_t low = vcombine_u16(
+			interpolate(src, xWeights[x], srcBytesPerRow, wTop),
+			interpolate(src, xWeights[x + 1], srcBytesPerRow, wTop));
+		uint16x8_t high = vcombine_u16(
+			interpolate(src, xWeights[x + 2], srcBytesPerRow, wTop),
+			interpolate(src, xWeights[x + 3], srcBytesPerRow, wTop));
+
+		store_colors(dst, vld1q_u8(dst),
+			vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+		dst += 16;
+	}
+
+	const uint16 wBottom = 255 - wTop;
+	for (; x <= xMax; x++) {
+		const uint16 wLeft = xWeights[x].weight;
+		uint32 t[4];
+		ColorTypeRgb::Interpolate(&t[0], src + xWeights[x].index,
+			srcBytesPerRow, wLeft, wTop, 255 - wLeft, wBottom);
+		DrawModeCopy::Blend(dst, &t[0]);
+	}
+}
+
+
+void
+bilinear_scale_xloop_alpha_overlay(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow)
+{
+	int32 x = xMin;
+	for (; x + 3 <= xMax; x += 4) {
+		uint8x16_t dest = vld1q_u8(dst);
+		uint16x8_t destLow = vmovl_u8(vget_low_u8(dest));
+		uint16x8_t destHigh = vmovl_u8(vget_high_u8(dest));
+
+		uint16x8_t low = vcombine_u16(
+			alpha_overlay(vget_low_u16(destLow),
+				interpolate(src, xWeights[x], srcBytesPerRow, wTop)),
+			alpha_overlay(vget_high_u16(destLow),
+				interpolate(src, xWeights[x + 1], srcBytesPerRow, wTop)));
+		uint16x8_t high = vcombine_u16(
+			alpha_overlay(vget_low_u16(destHigh),
+				interpolate(src, xWeights[x + 2], srcBytesPerRow, wTop)),
+			alpha_overlay(vget_high_u16(destHigh),
+				interpolate(src, xWeights[x + 3], srcBytesPerRow, wTop)));
+
+		store_colors(dst, dest, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+		dst += 16;
+	}
+
+	const uint16 wBottom = 255 - wTop;
+	for (; x <= xMax; x++) {
+		const uint16 wLeft = xWeights[x].weight;
+		uint32 t[4];
+		ColorTypeRgba::Interpolate(&t[0], src + xWeights[x].index,
+			srcBytesPerRow, wLeft, wTop, 255 - wLeft, wBottom);
+		DrawModeAlphaOverlay::Blend(dst, &t[0]);
+	}
+}
+
+
+}	// namespace BitmapPainterPrivate
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * SSE2 versions of the bilinear scaling x-loops; SSE2 is part of the x86_64
+ * baseline.
+ *
+ */
+
+#include "DrawBitmapBilinear.h"
+
+#include <emmintrin.h>
+
+
+namespace BitmapPainterPrivate {
+
+
+/*!	Returns the weights of the left and right source pixel of a destination
+	pixel, one 16 bit lane per channel.
+*/
+static inline __m128i
+horizontal_weights(uint16 weight)
+{
+	const __m128i kInvertRight = _mm_set_epi16(-1, -1, -1, -1, 0, 0, 0, 0);
+	const __m128i kRightOffset
+		= _mm_set_epi16(256, 256, 256, 256, 0, 0, 0, 0);
+
+	// ~weight + 256 == 255 - weight
+	return _mm_add_epi16(_mm_xor_si128(_mm_set1_epi16(weight), kInvertRight),
+		kRightOffset);
+}
+
+
+/*!	Computes s[0..3] * wLeft + s[4..7] * wRight of two destination pixels.
+*/
+static inline __m128i
+interpolate_row(const uint8* s0, const uint8* s1, __m128i weights0,
+	__m128i weights1)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i pixel0 = _mm_mullo_epi16(weights0,
+		_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)s0), zero));
+	__m128i pixel1 = _mm_mullo_epi16(weights1,
+		_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)s1), zero));
+
+	return _mm_add_epi16(_mm_unpacklo_epi64(pixel0, pixel1),
+		_mm_unpackhi_epi64(pixel0, pixel1));
+}
+
+
+/*!	Same as ColorTypeRgba::Interpolate() for two destination pixels, the
+	result has one 16 bit lane per channel.
+*/
+static inline __m128i
+interpolate(const uint8* src, const FilterInfo* xWeights,
+	uint32 srcBytesPerRow, __m128i yWeights)
+{
+	const uint8* s0 = src + xWeights[0].index;
+	const uint8* s1 = src + xWeights[1].index;
+	__m128i weights0 = horizontal_weights(xWeights[0].weight);
+	__m128i weights1 = horizontal_weights(xWeights[1].weight);
+
+	__m128i top = interpolate_row(s0, s1, weights0, weights1);
+	__m128i bottom = interpolate_row(s0 + srcBytesPerRow,
+		s1 + srcBytesPerRow, weights0, weights1);
+
+	// (top * wTop + bottom * wBottom) >> 16; _mm_madd_epi16() multiplies
+	// signed words, so both sums are biased by -32768 first, and
+	// 32768 * (wTop + wBottom) is added back afterwards.
+	const __m128i kBias = _mm_set1_epi16(-32768);
+	const __m128i kUnbias = _mm_set1_epi32(32768 * 255);
+	top = _mm_xor_si128(top, kBias);
+	bottom = _mm_xor_si128(bottom, kBias);
+
+	__m128i low = _mm_madd_epi16(_mm_unpacklo_epi16(top, bottom), yWeights);
+	__m128i high = _mm_madd_epi16(_mm_unpackhi_epi16(top, bottom), yWeights);
+	low = _mm_srli_epi32(_mm_add_epi32(low, kUnbias), 16);
+	high = _mm_srli_epi32(_mm_add_epi32(high, kUnbias), 16);
+
+	return _mm_packs_epi32(low, high);
+}
+
+
+/*!	Same as DrawModeAlphaOverlay::Blend() on two pixels with 16 bit lanes.
+	The interpolated alpha is at most 253, so its opaque case never happens.
+*/
+static inline __m128i
+alpha_overlay(__m128i dest, __m128i source)
+{
+	__m128i alpha = _mm_shufflehi_epi16(
+		_mm_shufflelo_epi16(source, _MM_SHUFFLE(3, 3, 3, 3)),
+		_MM_SHUFFLE(3, 3, 3, 3));
+	__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
+
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dest, inverse),
+		_mm_mullo_epi16(source, alpha)), 8);
+}
+
+
+static inline __m128i
+vertical_weights(uint16 wTop)
+{
+	return _mm_set1_epi32(wTop | ((255 - wTop) << 16));
+}
+
+
+/*!	Stores the color channels of four pixels and leaves the alpha channel
+	of the destination alone, like DrawModeCopy and DrawModeAlphaOverlay do.
+*/
+static inline void
+store_colors(uint8* dst, __m128i dest, __m128i pixels)
+{
+	const __m128i kAlpha = _mm_set1_epi32(0xff000000);
+
+	_mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(dest, kAlpha),
+		_mm_andnot_si128(kAlpha, pixels)));
+}
+
+
+void
+bilinear_scale_xloop_copy(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow)
+{
+	const __m128i yWeights = vertical_weights(wTop);
+
+	int32 x = xMin;
+	for (; x + 3 <= xMax; x += 4) {
+		__m128i low = interpolate(src, xWeights + x, srcBytesPerRow,
+			yWeights);
+		__m128i high = interpolate(src, xWeights + x + 2, srcBytesPerRow,
+			yWeights);
+
+		store_colors(dst, _mm_loadu_si128((const __m128i*)dst),
+			_mm_packus_epi16(low, high));
+		dst += 16;
+	}
+
+	const uint16 wBottom = 255 - wTop;
+	for (; x <= xMax; x++) {
+		const uint16 wLeft = xWeights[x].weight;
+		uint32 t[4];
+		ColorTypeRgb::Interpolate(&t[0], src + xWeights[x].index,
+			srcBytesPerRow, wLeft, wTop, 255 - wLeft, wBottom);
+		DrawModeCopy::Blend(dst, &t[0]);
+	}
+}
+
+
+void
+bilinear_scale_xloop_alpha_overlay(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow)
+{
+	const __m128i yWeights = vertical_weights(wTop);
+	const __m128i zero = _mm_setzero_si128();
+
+	int32 x = xMin;
+	for (; x + 3 <= xMax; x += 4) {
+		__m128i dest = _mm_loadu_si128((const __m128i*)dst);
+
+		__m128i low = alpha_overlay(_mm_unpacklo_epi8(dest, zero),
+			interpolate(src, xWeights + x, srcBytesPerRow, yWeights));
+		__m128i high = alpha_overlay(_mm_unpackhi_epi8(dest, zero),
+			interpolate(src, xWeights + x + 2, srcBytesPerRow, yWeights));
+
+		store_colors(dst, dest, _mm_packus_epi16(low, high));
+		dst += 16;
+	}
+
+	const uint16 wBottom = 255 - wTop;
+	for (; x <= xMax; x++) {
+		const uint16 wLeft = xWeights[x].weight;
+		uint32 t[4];
+		ColorTypeRgba::Interpolate(&t[0], src + xWeights[x].index,
+			srcBytesPerRow, wLeft, wTop, 255 - wLeft, wBottom);
+		DrawModeAlphaOverlay::Blend(dst, &t[0]);
+	}
+}
+
+
+}	// namespace BitmapPainterPrivate
@@ -8,6 +8,8 @@
 #ifndef DRAW_BITMAP_NEAREST_NEIGHBOR_H
 #define DRAW_BITMAP_NEAREST_NEIGHBOR_H
 
+#include <string.h>
+
 #include "Painter.h"
 
 
@@ -119,9 +121,23 @@ struct DrawBitmapNearestNeighborCopy {
 		//printf("x: %ld - %ld\n", xIndexL, xIndexR);
 		//printf("y: %ld - %ld\n", y1, y2);
 
+			const size_t rowBytes = (xIndexR - xIndexL + 1) * 4;
+			const uint8* previousSrc = NULL;
+
 			for (; y1 <= y2; y1++) {
 				// buffer offset into source (top row)
 				const uint8* src = bitmap.row_ptr(yIndices[y1]);
+
+				if (src == previousSrc) {
+					// When scaling up, consecutive rows are taken from the
+					// same source row, and copying the previous row is a lot
+					// faster than picking the pixels again.
+					memcpy(dst, dst - dstBPR, rowBytes);
+					dst += dstBPR;
+					continue;
+				}
+				previousSrc = src;
+
 				// buffer handle for destination to be incremented per pixel
 				uint32* d = (uint32*)dst;
 
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * AVX2 span blenders. Nothing in here may be called unless the CPU and the
+ * OS support AVX2.
+ *
+ */
+
+#include "DrawingModeSIMD.h"
+
+#include <immintrin.h>
+
+#include "DrawingMode.h"
+
+// Only the code below is compiled for AVX2. Building the whole file with
+// -mavx2 would also produce AVX2 copies of the inline functions from the
+// headers above, and the linker is free to use those everywhere.
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+#include "DrawingModeSIMDSpans.h"
+
+
+namespace {
+
+
+/*!	Operations on eight B_RGBA32 pixels. The byte unpack and pack
+	instructions work on both 128 bit halves separately, which is fine as
+	long as the weights are expanded the same way as the pixels.
+*/
+struct AVX2Vector {
+	typedef __m256i Pixels;
+	enum { kPixels = 8 };
+
+	static inline Pixels Zero()
+	{
+		return _mm256_setzero_si256();
+	}
+
+	static inline Pixels Splat(uint32 value)
+	{
+		return _mm256_set1_epi32(value);
+	}
+
+	static inline Pixels Load(const void* pointer)
+	{
+		return _mm256_loadu_si256((const __m256i*)pointer);
+	}
+
+	static inline void Store(void* pointer, Pixels pixels)
+	{
+		_mm256_storeu_si256((__m256i*)pointer, pixels);
+	}
+
+	static inline Pixels LoadColors(const color_type* colors)
+	{
+		// agg::rgba8 is stored as RGBA, the frame buffer as BGRA
+		const Pixels kSwapRedBlue = _mm256_setr_epi8(
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		return _mm256_shuffle_epi8(Load(colors), kSwapRedBlue);
+	}
+
+	static inline Pixels LoadCovers(const uint8* covers)
+	{
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)covers));
+	}
+
+	static inline Pixels Alpha(Pixels pixels)
+	{
+		return _mm256_srli_epi32(pixels, 24);
+	}
+
+	static inline Pixels Opaque(Pixels pixels)
+	{
+		return _mm256_or_si256(pixels, Splat(0xff000000));
+	}
+
+	static inline bool IsOpaque(Pixels pixels)
+	{
+		return All(_mm256_cmpeq_epi32(
+			_mm256_and_si256(pixels, Splat(0xff000000)), Splat(0xff000000)));
+	}
+
+	static inline Pixels Equal(Pixels a, Pixels b)
+	{
+		return _mm256_cmpeq_epi32(a, b);
+	}
+
+	static inline bool All(Pixels mask)
+	{
+		return _mm256_movemask_epi8(mask) == -1;
+	}
+
+	static inline Pixels Select(Pixels mask, Pixels a, Pixels b)
+	{
+		return _mm256_blendv_epi8(b, a, mask);
+	}
+
+	//! Both factors and the product must fit into 16 bits.
+	static inline Pixels Multiply(Pixels a, Pixels b)
+	{
+		return _mm256_mullo_epi16(a, b);
+	}
+
+	//! Computes value * factor / 255 exactly for values up to 255 * 255.
+	static inline Pixels MultiplyDivide255(Pixels value, uint8 factor)
+	{
+		Pixels product = _mm256_mullo_epi32(value, Splat(factor));
+
+		// The estimate is at most one too small
+		Pixels quotient = _mm256_srli_epi32(_mm256_add_epi32(product,
+			_mm256_add_epi32(_mm256_srli_epi32(product, 8),
+				_mm256_srli_epi32(product, 16))), 8);
+		Pixels rest = _mm256_sub_epi32(product,
+			_mm256_sub_epi32(_mm256_slli_epi32(quotient, 8), quotient));
+		return _mm256_sub_epi32(quotient,
+			_mm256_cmpgt_epi32(rest, Splat(254)));
+	}
+
+	//! Computes value / 255 exactly for values up to 255 * 255.
+	static inline Pixels Divide255(Pixels value)
+	{
+		return _mm256_srli_epi32(_mm256_mulhi_epu16(value, Splat(0x8081)), 7);
+	}
+
+	//! Rounds down like the (a + b) >> 1 in ASSIGN_BLEND().
+	static inline Pixels Average(Pixels a, Pixels b)
+	{
+		return _mm256_add_epi8(_mm256_and_si256(a, b),
+			_mm256_and_si256(_mm256_srli_epi16(_mm256_xor_si256(a, b), 1),
+				Splat(0x7f7f7f7f)));
+	}
+
+	//! Same as BLEND() with weights in the range 0..255.
+	static inline Pixels Blend(Pixels dest, Pixels source, Pixels weights)
+	{
+		weights = _mm256_or_si256(weights, _mm256_slli_epi32(weights, 16));
+		Pixels low = _Blend8(_mm256_unpacklo_epi8(dest, Zero()),
+			_mm256_unpacklo_epi8(source, Zero()),
+			_mm256_unpacklo_epi32(weights, weights));
+		Pixels high = _Blend8(_mm256_unpackhi_epi8(dest, Zero()),
+			_mm256_unpackhi_epi8(source, Zero()),
+			_mm256_unpackhi_epi32(weights, weights));
+		return Opaque(_mm256_packus_epi16(low, high));
+	}
+
+	//! Same as BLEND16() with weights in the range 0..65025.
+	static inline Pixels Blend16(Pixels dest, Pixels source, Pixels weights)
+	{
+		weights = _mm256_or_si256(weights, _mm256_slli_epi32(weights, 16));
+		Pixels low = _Blend16(_mm256_unpacklo_epi8(dest, Zero()),
+			_mm256_unpacklo_epi8(source, Zero()),
+			_mm256_unpacklo_epi32(weights, weights));
+		Pixels high = _Blend16(_mm256_unpackhi_epi8(dest, Zero()),
+			_mm256_unpackhi_epi8(source, Zero()),
+			_mm256_unpackhi_epi32(weights, weights));
+		return Opaque(_mm256_packus_epi16(low, high));
+	}
+
+	static inline Pixels _Blend8(Pixels dest, Pixels source, Pixels weights)
+	{
+		// (dest * (256 - weight) + source * weight) >> 8 fits into 16 bits
+		Pixels inverse = _mm256_sub_epi16(_mm256_set1_epi16(256), weights);
+		return _mm256_srli_epi16(_mm256_add_epi16(
+			_mm256_mullo_epi16(dest, inverse),
+			_mm256_mullo_epi16(source, weights)), 8);
+	}
+
+	static inline Pixels _Blend16(Pixels dest, Pixels source, Pixels weights)
+	{
+		// (dest * (65536 - weight) + source * weight) >> 16, the high words
+		// of both products plus the carry out of their low words
+		Pixels inverse = _mm256_sub_epi16(Zero(), weights);
+		Pixels destLow = _mm256_mullo_epi16(dest, inverse);
+		Pixels sourceLow = _mm256_mullo_epi16(source, weights);
+		Pixels sum = _mm256_add_epi16(destLow, sourceLow);
+		Pixels carry = _mm256_srli_epi16(_mm256_or_si256(
+			_mm256_and_si256(destLow, sourceLow),
+			_mm256_andnot_si256(sum, _mm256_or_si256(destLow, sourceLow))),
+			15);
+		return _mm256_add_epi16(_mm256_add_epi16(
+			_mm256_mulhi_epu16(dest, inverse),
+			_mm256_mulhi_epu16(source, weights)), carry);
+	}
+};
+
+
+}	// namespace
+
+
+const simd_span_blenders gAVX2SpanBlenders
+	= SIMD_SPAN_BLENDERS("AVX2", AVX2Vector);
+
+#pragma GCC pop_options
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * NEON span blenders; Advanced SIMD is part of the arm64 baseline.
+ *
+ */
+
+#include "DrawingModeSIMD.h"
+
+#include <string.h>
+
+#include <arm_neon.h>
+
+#include "DrawingModeSIMDSpans.h"
+
+
+namespace {
+
+
+static const uint8 kSwapRedBlue[16] = {
+	2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+};
+
+
+/*!	Operations on four B_RGBA32 pixels. Weights are kept in the pixel lanes
+	as well, one 32 bit value per pixel.
+*/
+struct NEONVector {
+	typedef uint32x4_t Pixels;
+	enum { kPixels = 4 };
+
+	static inline Pixels Zero()
+	{
+		return vdupq_n_u32(0);
+	}
+
+	static inline Pixels Splat(uint32 value)
+	{
+		return vdupq_n_u32(value);
+	}
+
+	static inline Pixels Load(const void* pointer)
+	{
+		return vreinterpretq_u32_u8(vld1q_u8((const uint8*)pointer));
+	}
+
+	static inline void Store(void* pointer, Pixels pixels)
+	{
+		vst1q_u8((uint8*)pointer, vreinterpretq_u8_u32(pixels));
+	}
+
+	static inline Pixels LoadColors(const color_type* colors)
+	{
+		// agg::rgba8 is stored as RGBA, the frame buffer as BGRA
+		return vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8((const uint8*)colors),
+			vld1q_u8(kSwapRedBlue)));
+	}
+
+	static inline Pixels LoadCovers(const uint8* covers)
+	{
+		uint32 value;
+		memcpy(&value, covers, sizeof(value));
+		uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(value)));
+		return vmovl_u16(vget_low_u16(words));
+	}
+
+	static inline Pixels Alpha(Pixels pixels)
+	{
+		return vshrq_n_u32(pixels, 24);
+	}
+
+	static inline Pixels Opaque(Pixels pixels)
+	{
+		return vorrq_u32(pixels, vdupq_n_u32(0xff000000));
+	}
+
+	static inline bool IsOpaque(Pixels pixels)
+	{
+		return All(vcgeq_u32(pixels, vdupq_n_u32(0xff000000)));
+	}
+
+	static inline Pixels Equal(Pixels a, Pixels b)
+	{
+		return vceqq_u32(a, b);
+	}
+
+	static inline bool All(Pixels mask)
+	{
+		return vminvq_u32(mask) == 0xffffffff;
+	}
+
+	static inline Pixels Select(Pixels mask, Pixels a, Pixels b)
+	{
+		return vbslq_u32(mask, a, b);
+	}
+
+	//! Both factors and the product must fit into 16 bits.
+	static inline Pixels Multiply(Pixels a, Pixels b)
+	{
+		return vmulq_u32(a, b);
+	}
+
+	//! Computes value * factor / 255 exactly for values up to 255 * 255.
+	static inline Pixels MultiplyDivide255(Pixels value, uint8 factor)
+	{
+		Pixels product = vmulq_n_u32(value, factor);
+
+		// The estimate is at most one too small
+		Pixels quotient = vshrq_n_u32(vaddq_u32(product,
+			vaddq_u32(vshrq_n_u32(product, 8), vshrq_n_u32(product, 16))), 8);
+		Pixels rest = vsubq_u32(product,
+			vsubq_u32(vshlq_n_u32(quotient, 8), quotient));
+		return vsubq_u32(quotient, vcgtq_u32(rest, vdupq_n_u32(254)));
+	}
+
+	//! Computes value / 255 exactly for values up to 255 * 255.
+	static inline Pixels Divide255(Pixels value)
+	{
+		return vshrq_n_u32(vmulq_n_u32(value, 0x8081), 23);
+	}
+
+	//! Rounds down like the (a + b) >> 1 in ASSIGN_BLEND().
+	static inline Pixels Average(Pixels a, Pixels b)
+	{
+		return vreinterpretq_u32_u8(vhaddq_u8(vreinterpretq_u8_u32(a),
+			vreinterpretq_u8_u32(b)));
+	}
+
+	//! Same as BLEND() with weights in the range 0..255.
+	static inline Pixels Blend(Pixels dest, Pixels source, Pixels weights)
+	{
+		uint8x16_t dest8 = vreinterpretq_u8_u32(dest);
+		uint8x16_t source8 = vreinterpretq_u8_u32(source);
+		uint8x16_t weights8
+			= vreinterpretq_u8_u32(vmulq_n_u32(weights, 0x01010101));
+
+		uint8x8_t low = _Blend8(vget_low_u8(dest8), vget_low_u8(source8),
+			vget_low_u8(weights8));
+		uint8x8_t high = _Blend8(vget_high_u8(dest8), vget_high_u8(source8),
+			vget_high_u8(weights8));
+		return Opaque(vreinterpretq_u32_u8(vcombine_u8(low, high)));
+	}
+
+	//! Same as BLEND16() with weights in the range 0..65025.
+	static inline Pixels Blend16(Pixels dest, Pixels source, Pixels weights)
+	{
+		uint8x16_t dest8 = vreinterpretq_u8_u32(dest);
+		uint8x16_t source8 = vreinterpretq_u8_u32(source);
+		weights = vsliq_n_u32(weights, weights, 16);
+
+		uint8x8_t low = _Blend16(vmovl_u8(vget_low_u8(dest8)),
+			vmovl_u8(vget_low_u8(source8)),
+			vreinterpretq_u16_u32(vzip1q_u32(weights, weights)));
+		uint8x8_t high = _Blend16(vmovl_u8(vget_high_u8(dest8)),
+			vmovl_u8(vget_high_u8(source8)),
+			vreinterpretq_u16_u32(vzip2q_u32(weights, weights)));
+		return Opaque(vreinterpretq_u32_u8(vcombine_u8(low, high)));
+	}
+
+	static inline uint8x8_t _Blend8(uint8x8_t dest, uint8x8_t source,
+		uint8x8_t weights)
+	{
+		// (dest * (256 - weight) + source * weight) >> 8 fits into 16 bits
+		uint16x8_t weights16 = vmovl_u8(weights);
+		uint16x8_t inverse = vsubq_u16(vdupq_n_u16(256), weights16);
+		return vshrn_n_u16(vmlaq_u16(vmulq_u16(vmovl_u8(dest), inverse),
+			vmovl_u8(source), weights16), 8);
+	}
+
+	static inline uint8x8_t _Blend16(uint16x8_t dest, uint16x8_t source,
+		uint16x8_t weights)
+	{
+		// (dest * (65536 - weight) + source * weight) >> 16
+		uint16x8_t inverse = vsubq_u16(vdupq_n_u16(0), weights);
+		uint32x4_t low = vmlal_u16(vmull_u16(vget_low_u16(dest),
+			vget_low_u16(inverse)), vget_low_u16(source),
+			vget_low_u16(weights));
+		uint32x4_t high = vmlal_high_u16(vmull_high_u16(dest, inverse),
+			source, weights);
+		return vmovn_u16(vcombine_u16(vshrn_n_u32(low, 16),
+			vshrn_n_u32(high, 16)));
+	}
+};
+
+
+}	// namespace
+
+
+const simd_span_blenders gNEONSpanBlenders
+	= SIMD_SPAN_BLENDERS("NEON", NEONVector);
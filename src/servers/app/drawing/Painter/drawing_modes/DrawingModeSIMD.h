@@ -0,0 +1,44 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * Tables of vectorized span blending functions for the drawing modes
+ * that are hit hardest when compositing the user interface.
+ *
+ */
+
+#ifndef DRAWING_MODE_SIMD_H
+#define DRAWING_MODE_SIMD_H
+
+#include "PixelFormat.h"
+
+
+// All functions produce exactly the same pixels as their scalar counterparts
+// in the DrawingMode*.h headers; they are only faster on long spans.
+// Functions that would not be faster than the scalar version are NULL.
+struct simd_span_blenders {
+	const char*						name;
+
+	PixelFormat::blend_solid_span	solid_hspan_over_solid;
+	PixelFormat::blend_solid_span	solid_hspan_alpha_co_solid;
+	PixelFormat::blend_solid_span	solid_hspan_alpha_po_solid;
+
+	PixelFormat::blend_color_span	color_hspan_over;
+	PixelFormat::blend_color_span	color_hspan_copy;
+	PixelFormat::blend_color_span	color_hspan_blend;
+	PixelFormat::blend_color_span	color_hspan_alpha_co;
+	PixelFormat::blend_color_span	color_hspan_alpha_pc;
+	PixelFormat::blend_color_span	color_hspan_alpha_po;
+};
+
+
+#if defined(__x86_64__)
+extern const simd_span_blenders gSSE2SpanBlenders;
+extern const simd_span_blenders gAVX2SpanBlenders;
+#endif
+#if defined(__aarch64__)
+extern const simd_span_blenders gNEONSpanBlenders;
+#endif
+
+
+#endif // DRAWING_MODE_SIMD_H
@@ -0,0 +1,558 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * Generic span blending loops shared by the SSE2, AVX2 and NEON
+ * implementations. Each of them provides a "Vector" type with the
+ * primitive operations on a block of kPixels B_RGBA32 pixels, and
+ * instantiates the span blenders for all supported drawing modes.
+ *
+ * This header must only be included by the DrawingMode<ISA>.cpp files.
+ * Everything lives in an anonymous namespace, so that code compiled with
+ * different instruction set flags in those files cannot get merged by the
+ * linker.
+ *
+ */
+
+#ifndef DRAWING_MODE_SIMD_SPANS_H
+#define DRAWING_MODE_SIMD_SPANS_H
+
+#include "DrawingMode.h"
+#include "DrawingModeSIMD.h"
+
+
+namespace {
+
+
+static inline uint32
+bgra_for(const color_type& c)
+{
+	return c.b | (c.g << 8) | (c.r << 16) | ((uint32)c.a << 24);
+}
+
+
+static inline void
+assign_opaque(uint8* p, const color_type& c)
+{
+	p[0] = c.b;
+	p[1] = c.g;
+	p[2] = c.r;
+	p[3] = 255;
+}
+
+
+//	#pragma mark - drawing modes
+
+
+/*!	Every mode computes a weight per pixel; a weight of zero leaves the
+	pixel untouched, a weight of kFull assigns the source color, anything
+	in between blends it. The scalar methods mirror the respective
+	DrawingMode*.h header exactly and are used for the span remainders and
+	for blocks the vector code cannot handle.
+*/
+template<class Vector>
+struct OverSpan {
+	typedef typename Vector::Pixels Pixels;
+	enum {
+		kFull = 255,
+		kUniformAlpha = false,
+		kUniformPartialCover = false
+	};
+
+	OverSpan(const PatternHandler* pattern, const color_type& c)
+	{
+	}
+
+	bool IsVisible() const
+	{
+		return true;
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return c.a > 0 ? cover : 0;
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return Vector::Select(Vector::Equal(Vector::Alpha(source),
+			Vector::Zero()), Vector::Zero(), covers);
+	}
+
+	bool CanBlend(Pixels dest) const
+	{
+		return true;
+	}
+
+	Pixels Assign(Pixels dest, Pixels source) const
+	{
+		return Vector::Opaque(source);
+	}
+
+	Pixels Blend(Pixels dest, Pixels source, Pixels weights) const
+	{
+		return Vector::Blend(dest, source, weights);
+	}
+
+	void AssignPixel(uint8* p, const color_type& c) const
+	{
+		assign_opaque(p, c);
+	}
+
+	void BlendPixel(uint8* p, const color_type& c, uint32 weight) const
+	{
+		uint8 alpha = weight;
+		BLEND(p, c.r, c.g, c.b, alpha);
+	}
+};
+
+
+template<class Vector>
+struct OverSolidSpan : OverSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	OverSolidSpan(const PatternHandler* pattern, const color_type& c)
+		:
+		OverSpan<Vector>(pattern, c),
+		fPattern(pattern)
+	{
+	}
+
+	bool IsVisible() const
+	{
+		return !fPattern->IsSolidLow();
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return cover;
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return covers;
+	}
+
+	const PatternHandler*	fPattern;
+};
+
+
+template<class Vector>
+struct CopySpan : OverSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	CopySpan(const PatternHandler* pattern, const color_type& c)
+		:
+		OverSpan<Vector>(pattern, c),
+		fLow(pattern->LowColor()),
+		fLowPixels(Vector::Splat(
+			fLow.blue | (fLow.green << 8) | (fLow.red << 16)))
+	{
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return cover;
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return covers;
+	}
+
+	Pixels Assign(Pixels dest, Pixels source) const
+	{
+		return source;
+	}
+
+	Pixels Blend(Pixels dest, Pixels source, Pixels weights) const
+	{
+		return Vector::Blend(fLowPixels, source, weights);
+	}
+
+	void AssignPixel(uint8* p, const color_type& c) const
+	{
+		p[0] = c.b;
+		p[1] = c.g;
+		p[2] = c.r;
+		p[3] = c.a;
+	}
+
+	void BlendPixel(uint8* p, const color_type& c, uint32 weight) const
+	{
+		uint8 alpha = weight;
+		BLEND_FROM(p, fLow.red, fLow.green, fLow.blue, c.r, c.g, c.b, alpha);
+	}
+
+	rgb_color				fLow;
+	Pixels					fLowPixels;
+};
+
+
+template<class Vector>
+struct BlendSpan : OverSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	// Without a coverage array, a partial cover also blends pixels with
+	// zero alpha.
+	enum { kUniformPartialCover = true };
+
+	BlendSpan(const PatternHandler* pattern, const color_type& c)
+		:
+		OverSpan<Vector>(pattern, c)
+	{
+	}
+
+	Pixels Assign(Pixels dest, Pixels source) const
+	{
+		return Vector::Opaque(Vector::Average(dest, source));
+	}
+
+	Pixels Blend(Pixels dest, Pixels source, Pixels weights) const
+	{
+		return Vector::Blend(dest, Vector::Average(dest, source), weights);
+	}
+
+	void AssignPixel(uint8* p, const color_type& c) const
+	{
+		p[0] = (p[0] + c.b) >> 1;
+		p[1] = (p[1] + c.g) >> 1;
+		p[2] = (p[2] + c.r) >> 1;
+		p[3] = 255;
+	}
+
+	void BlendPixel(uint8* p, const color_type& c, uint32 weight) const
+	{
+		uint8 b = (p[0] + c.b) >> 1;
+		uint8 g = (p[1] + c.g) >> 1;
+		uint8 r = (p[2] + c.r) >> 1;
+		uint8 alpha = weight;
+		BLEND(p, r, g, b, alpha);
+	}
+};
+
+
+template<class Vector>
+struct AlphaPOSpan {
+	typedef typename Vector::Pixels Pixels;
+	enum {
+		kFull = 255 * 255,
+		kUniformAlpha = true,
+		kUniformPartialCover = false
+	};
+
+	AlphaPOSpan(const PatternHandler* pattern, const color_type& c)
+	{
+	}
+
+	bool IsVisible() const
+	{
+		return true;
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return c.a * cover;
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return Vector::Multiply(Vector::Alpha(source), covers);
+	}
+
+	bool CanBlend(Pixels dest) const
+	{
+		return true;
+	}
+
+	Pixels Assign(Pixels dest, Pixels source) const
+	{
+		return Vector::Opaque(source);
+	}
+
+	Pixels Blend(Pixels dest, Pixels source, Pixels weights) const
+	{
+		return Vector::Blend16(dest, source, weights);
+	}
+
+	void AssignPixel(uint8* p, const color_type& c) const
+	{
+		assign_opaque(p, c);
+	}
+
+	void BlendPixel(uint8* p, const color_type& c, uint32 weight) const
+	{
+		uint16 alpha = weight;
+		BLEND16(p, c.r, c.g, c.b, alpha);
+	}
+};
+
+
+template<class Vector>
+struct AlphaPOSolidSpan : AlphaPOSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	AlphaPOSolidSpan(const PatternHandler* pattern, const color_type& c)
+		:
+		AlphaPOSpan<Vector>(pattern, c),
+		fAlpha(c.a)
+	{
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return fAlpha * cover;
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return Vector::Multiply(Vector::Splat(fAlpha), covers);
+	}
+
+	uint8					fAlpha;
+};
+
+
+template<class Vector>
+struct AlphaCOSpan : AlphaPOSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	AlphaCOSpan(const PatternHandler* pattern, const color_type& c)
+		:
+		AlphaPOSpan<Vector>(pattern, c),
+		fHighAlpha(pattern->HighColor().alpha)
+	{
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return (uint16)(fHighAlpha * c.a * cover / 255);
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return Vector::MultiplyDivide255(
+			Vector::Multiply(Vector::Alpha(source), covers), fHighAlpha);
+	}
+
+	uint8					fHighAlpha;
+};
+
+
+template<class Vector>
+struct AlphaCOSolidSpan : AlphaCOSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	AlphaCOSolidSpan(const PatternHandler* pattern, const color_type& c)
+		:
+		AlphaCOSpan<Vector>(pattern, c)
+	{
+	}
+
+	uint32 PixelWeight(const color_type& c, uint8 cover) const
+	{
+		return this->fHighAlpha * cover;
+	}
+
+	Pixels Weights(Pixels source, Pixels covers) const
+	{
+		return Vector::Multiply(Vector::Splat(this->fHighAlpha), covers);
+	}
+};
+
+
+/*!	B_ALPHA_COMPOSITE only reduces to a plain blend when the destination
+	is opaque, which is the common case for the frame buffer. Blocks with
+	translucent destination pixels are left to the scalar code.
+*/
+template<class Vector>
+struct AlphaPCSpan : AlphaPOSpan<Vector> {
+	typedef typename Vector::Pixels Pixels;
+
+	AlphaPCSpan(const PatternHandler* pattern, const color_type& c)
+		:
+		AlphaPOSpan<Vector>(pattern, c)
+	{
+	}
+
+	bool CanBlend(Pixels dest) const
+	{
+		return Vector::IsOpaque(dest);
+	}
+
+	Pixels Blend(Pixels dest, Pixels source, Pixels weights) const
+	{
+		return Vector::Blend(dest, source, Vector::Divide255(weights));
+	}
+
+	void BlendPixel(uint8* p, const color_type& c, uint32 weight) const
+	{
+		uint16 alpha = weight;
+		BLEND_COMPOSITE16(p, c.r, c.g, c.b, alpha);
+	}
+};
+
+
+//	#pragma mark - span loops
+
+
+template<class Vector, class Mode>
+struct SIMDSpanBlender {
+	typedef typename Vector::Pixels Pixels;
+
+	static inline void
+	blend_pixel(const Mode& mode, uint8* p, const color_type& c,
+		uint32 weight)
+	{
+		if (weight == 0)
+			return;
+
+		if (weight == Mode::kFull)
+			mode.AssignPixel(p, c);
+		else
+			mode.BlendPixel(p, c, weight);
+	}
+
+	/*!	Returns \c false if the block has to be blended by the scalar code.
+	*/
+	static inline bool
+	blend_block(const Mode& mode, uint8* p, Pixels source, Pixels weights)
+	{
+		Pixels skip = Vector::Equal(weights, Vector::Zero());
+		if (Vector::All(skip))
+			return true;
+
+		Pixels assign = Vector::Equal(weights, Vector::Splat(Mode::kFull));
+		Pixels dest = Vector::Load(p);
+		Pixels result;
+		if (Vector::All(assign))
+			result = mode.Assign(dest, source);
+		else {
+			if (!mode.CanBlend(dest))
+				return false;
+
+			result = Vector::Select(assign, mode.Assign(dest, source),
+				mode.Blend(dest, source, weights));
+		}
+
+		Vector::Store(p, Vector::Select(skip, dest, result));
+		return true;
+	}
+
+	static void
+	blend_solid_hspan(int x, int y, unsigned len, const color_type& c,
+		const uint8* covers, agg_buffer* buffer,
+		const PatternHandler* pattern)
+	{
+		Mode mode(pattern, c);
+		if (!mode.IsVisible())
+			return;
+
+		uint8* p = buffer->row_ptr(y) + (x << 2);
+		Pixels source = Vector::Splat(bgra_for(c));
+
+		for (; len >= Vector::kPixels; len -= Vector::kPixels) {
+			Pixels weights = mode.Weights(source, Vector::LoadCovers(covers));
+			if (!blend_block(mode, p, source, weights)) {
+				for (int i = 0; i < Vector::kPixels; i++) {
+					blend_pixel(mode, p + i * 4, c,
+						mode.PixelWeight(c, covers[i]));
+				}
+			}
+			p += Vector::kPixels * 4;
+			covers += Vector::kPixels;
+		}
+
+		for (; len > 0; len--) {
+			blend_pixel(mode, p, c, mode.PixelWeight(c, *covers));
+			p += 4;
+			covers++;
+		}
+	}
+
+	static void
+	blend_color_hspan(int x, int y, unsigned len, const color_type* colors,
+		const uint8* covers, uint8 cover, agg_buffer* buffer,
+		const PatternHandler* pattern)
+	{
+		Mode mode(pattern, *colors);
+		uint8* p = buffer->row_ptr(y) + (x << 2);
+
+		// Like the scalar code, the alpha modes take the alpha of the first
+		// color for the whole span when there is no coverage array.
+		bool uniform = false;
+		uint32 uniformWeight = 0;
+		if (covers == NULL) {
+			if (Mode::kUniformAlpha) {
+				uniform = true;
+				uniformWeight = mode.PixelWeight(*colors, cover);
+			} else if (Mode::kUniformPartialCover && cover != 255) {
+				uniform = true;
+				uniformWeight = cover;
+			}
+			if (uniform && uniformWeight == 0)
+				return;
+		}
+
+		Pixels constantCovers = Vector::Splat(cover);
+
+		for (; len >= Vector::kPixels; len -= Vector::kPixels) {
+			Pixels source = Vector::LoadColors(colors);
+			Pixels weights;
+			if (uniform)
+				weights = Vector::Splat(uniformWeight);
+			else if (covers != NULL)
+				weights = mode.Weights(source, Vector::LoadCovers(covers));
+			else
+				weights = mode.Weights(source, constantCovers);
+
+			if (!blend_block(mode, p, source, weights)) {
+				for (int i = 0; i < Vector::kPixels; i++) {
+					blend_pixel(mode, p + i * 4, colors[i], uniform
+						? uniformWeight : mode.PixelWeight(colors[i],
+							covers != NULL ? covers[i] : cover));
+				}
+			}
+
+			p += Vector::kPixels * 4;
+			colors += Vector::kPixels;
+			if (covers != NULL)
+				covers += Vector::kPixels;
+		}
+
+		for (; len > 0; len--) {
+			blend_pixel(mode, p, *colors, uniform ? uniformWeight
+				: mode.PixelWeight(*colors, covers != NULL ? *covers : cover));
+			p += 4;
+			colors++;
+			if (covers != NULL)
+				covers++;
+		}
+	}
+};
+
+
+}	// namespace
+
+
+// Expands to the initializer of a simd_span_blenders table. The table has to
+// be initialized statically, running any code compiled for a specific
+// instruction set before it has been detected is not an option.
+#define SIMD_SPAN_BLENDERS(name, Vector) \
+{ \
+	name, \
+\
+	SIMDSpanBlender<Vector, OverSolidSpan<Vector> >::blend_solid_hspan, \
+	SIMDSpanBlender<Vector, AlphaCOSolidSpan<Vector> >::blend_solid_hspan, \
+	SIMDSpanBlender<Vector, AlphaPOSolidSpan<Vector> >::blend_solid_hspan, \
+\
+	SIMDSpanBlender<Vector, OverSpan<Vector> >::blend_color_hspan, \
+	SIMDSpanBlender<Vector, CopySpan<Vector> >::blend_color_hspan, \
+	SIMDSpanBlender<Vector, BlendSpan<Vector> >::blend_color_hspan, \
+	SIMDSpanBlender<Vector, AlphaCOSpan<Vector> >::blend_color_hspan, \
+	SIMDSpanBlender<Vector, AlphaPCSpan<Vector> >::blend_color_hspan, \
+	SIMDSpanBlender<Vector, AlphaPOSpan<Vector> >::blend_color_hspan \
+}
+
+
+#endif // DRAWING_MODE_SIMD_SPANS_H
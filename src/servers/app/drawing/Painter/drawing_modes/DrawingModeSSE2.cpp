@@ -0,0 +1,205 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * SSE2 span blenders; SSE2 is part of the x86_64 baseline.
+ *
+ */
+
+#include "DrawingModeSIMD.h"
+
+#include <string.h>
+
+#include <emmintrin.h>
+
+#include "DrawingModeSIMDSpans.h"
+
+
+namespace {
+
+
+/*!	Operations on four B_RGBA32 pixels. Weights are kept in the pixel lanes
+	as well, one 32 bit value per pixel.
+*/
+struct SSE2Vector {
+	typedef __m128i Pixels;
+	enum { kPixels = 4 };
+
+	static inline Pixels Zero()
+	{
+		return _mm_setzero_si128();
+	}
+
+	static inline Pixels Splat(uint32 value)
+	{
+		return _mm_set1_epi32(value);
+	}
+
+	static inline Pixels Load(const void* pointer)
+	{
+		return _mm_loadu_si128((const __m128i*)pointer);
+	}
+
+	static inline void Store(void* pointer, Pixels pixels)
+	{
+		_mm_storeu_si128((__m128i*)pointer, pixels);
+	}
+
+	static inline Pixels LoadColors(const color_type* colors)
+	{
+		// agg::rgba8 is stored as RGBA, the frame buffer as BGRA
+		Pixels pixels = Load(colors);
+		Pixels redBlue = _mm_and_si128(pixels, Splat(0x00ff00ff));
+		return _mm_or_si128(_mm_andnot_si128(Splat(0x00ff00ff), pixels),
+			_mm_or_si128(_mm_slli_epi32(redBlue, 16),
+				_mm_srli_epi32(redBlue, 16)));
+	}
+
+	static inline Pixels LoadCovers(const uint8* covers)
+	{
+		uint32 value;
+		memcpy(&value, covers, sizeof(value));
+		Pixels pixels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(value), Zero());
+		return _mm_unpacklo_epi16(pixels, Zero());
+	}
+
+	static inline Pixels Alpha(Pixels pixels)
+	{
+		return _mm_srli_epi32(pixels, 24);
+	}
+
+	static inline Pixels Opaque(Pixels pixels)
+	{
+		return _mm_or_si128(pixels, Splat(0xff000000));
+	}
+
+	static inline bool IsOpaque(Pixels pixels)
+	{
+		return All(_mm_cmpeq_epi32(_mm_and_si128(pixels, Splat(0xff000000)),
+			Splat(0xff000000)));
+	}
+
+	static inline Pixels Equal(Pixels a, Pixels b)
+	{
+		return _mm_cmpeq_epi32(a, b);
+	}
+
+	static inline bool All(Pixels mask)
+	{
+		return _mm_movemask_epi8(mask) == 0xffff;
+	}
+
+	static inline Pixels Select(Pixels mask, Pixels a, Pixels b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	//! Both factors and the product must fit into 16 bits.
+	static inline Pixels Multiply(Pixels a, Pixels b)
+	{
+		return _mm_mullo_epi16(a, b);
+	}
+
+	//! Computes value * factor / 255 exactly for values up to 255 * 255.
+	static inline Pixels MultiplyDivide255(Pixels value, uint8 factor)
+	{
+		Pixels low = _mm_mullo_epi16(value, Splat(factor));
+		Pixels high = _mm_mulhi_epu16(value, Splat(factor));
+		Pixels product = _mm_or_si128(low, _mm_slli_epi32(high, 16));
+
+		// The estimate is at most one too small
+		Pixels quotient = _mm_srli_epi32(_mm_add_epi32(product,
+			_mm_add_epi32(_mm_srli_epi32(product, 8),
+				_mm_srli_epi32(product, 16))), 8);
+		Pixels rest = _mm_sub_epi32(product,
+			_mm_sub_epi32(_mm_slli_epi32(quotient, 8), quotient));
+		return _mm_sub_epi32(quotient, _mm_cmpgt_epi32(rest, Splat(254)));
+	}
+
+	//! Computes value / 255 exactly for values up to 255 * 255.
+	static inline Pixels Divide255(Pixels value)
+	{
+		return _mm_srli_epi32(_mm_mulhi_epu16(value, Splat(0x8081)), 7);
+	}
+
+	//! Rounds down like the (a + b) >> 1 in ASSIGN_BLEND().
+	static inline Pixels Average(Pixels a, Pixels b)
+	{
+		return _mm_add_epi8(_mm_and_si128(a, b),
+			_mm_and_si128(_mm_srli_epi16(_mm_xor_si128(a, b), 1),
+				Splat(0x7f7f7f7f)));
+	}
+
+	//! Same as BLEND() with weights in the range 0..255.
+	static inline Pixels Blend(Pixels dest, Pixels source, Pixels weights)
+	{
+		weights = _mm_or_si128(weights, _mm_slli_epi32(weights, 16));
+		Pixels low = _Blend8(_mm_unpacklo_epi8(dest, Zero()),
+			_mm_unpacklo_epi8(source, Zero()),
+			_mm_unpacklo_epi32(weights, weights));
+		Pixels high = _Blend8(_mm_unpackhi_epi8(dest, Zero()),
+			_mm_unpackhi_epi8(source, Zero()),
+			_mm_unpackhi_epi32(weights, weights));
+		return Opaque(_mm_packus_epi16(low, high));
+	}
+
+	//! Same as BLEND16() with weights in the range 0..65025.
+	static inline Pixels Blend16(Pixels dest, Pixels source, Pixels weights)
+	{
+		weights = _mm_or_si128(weights, _mm_slli_epi32(weights, 16));
+		Pixels low = _Blend16(_mm_unpacklo_epi8(dest, Zero()),
+			_mm_unpacklo_epi8(source, Zero()),
+			_mm_unpacklo_epi32(weights, weights));
+		Pixels high = _Blend16(_mm_unpackhi_epi8(dest, Zero()),
+			_mm_unpackhi_epi8(source, Zero()),
+			_mm_unpackhi_epi32(weights, weights));
+		return Opaque(_mm_packus_epi16(low, high));
+	}
+
+	static inline Pixels _Blend8(Pixels dest, Pixels source, Pixels weights)
+	{
+		// (dest * (256 - weight) + source * weight) >> 8 fits into 16 bits
+		Pixels inverse = _mm_sub_epi16(_mm_set1_epi16(256), weights);
+		return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dest, inverse),
+			_mm_mullo_epi16(source, weights)), 8);
+	}
+
+	static inline Pixels _Blend16(Pixels dest, Pixels source, Pixels weights)
+	{
+		// (dest * (65536 - weight) + source * weight) >> 16, the high words
+		// of both products plus the carry out of their low words
+		Pixels inverse = _mm_sub_epi16(Zero(), weights);
+		Pixels destLow = _mm_mullo_epi16(dest, inverse);
+		Pixels sourceLow = _mm_mullo_epi16(source, weights);
+		Pixels sum = _mm_add_epi16(destLow, sourceLow);
+		Pixels carry = _mm_srli_epi16(_mm_or_si128(
+			_mm_and_si128(destLow, sourceLow),
+			_mm_andnot_si128(sum, _mm_or_si128(destLow, sourceLow))), 15);
+		return _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epu16(dest, inverse),
+			_mm_mulhi_epu16(source, weights)), carry);
+	}
+};
+
+
+}	// namespace
+
+
+// The color spans of B_OP_COPY and of B_OP_ALPHA with B_CONSTANT_ALPHA and
+// B_ALPHA_OVERLAY are not faster with SSE2 once they have anti-aliased
+// covers, so the scalar versions are used for them.
+const simd_span_blenders gSSE2SpanBlenders = {
+	"SSE2",
+
+	SIMDSpanBlender<SSE2Vector, OverSolidSpan<SSE2Vector> >::blend_solid_hspan,
+	SIMDSpanBlender<SSE2Vector,
+		AlphaCOSolidSpan<SSE2Vector> >::blend_solid_hspan,
+	SIMDSpanBlender<SSE2Vector,
+		AlphaPOSolidSpan<SSE2Vector> >::blend_solid_hspan,
+
+	SIMDSpanBlender<SSE2Vector, OverSpan<SSE2Vector> >::blend_color_hspan,
+	NULL,
+	SIMDSpanBlender<SSE2Vector, BlendSpan<SSE2Vector> >::blend_color_hspan,
+	NULL,
+	SIMDSpanBlender<SSE2Vector, AlphaPCSpan<SSE2Vector> >::blend_color_hspan,
+	SIMDSpanBlender<SSE2Vector, AlphaPOSpan<SSE2Vector> >::blend_color_hspan
+};
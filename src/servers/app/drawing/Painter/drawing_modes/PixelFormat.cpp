@@ -54,8 +54,14 @@
 #include "DrawingModeSelectSUBPIX.h"
 #include "DrawingModeSubtractSUBPIX.h"
 
+#include "DrawingModeSIMD.h"
+#include "Painter.h"
 #include "PatternHandler.h"
 
+
+extern uint32 gSIMDFlags;
+
+
 // blend_pixel_empty
 void
 blend_pixel_empty(int x, int y, const color_type& c, uint8 cover,
@@ -130,6 +136,24 @@ blend_color_vspan_empty(int x, int y, unsigned len,
 	printf("blend_color_vspan_empty()\n");
 }
 
+/*!	Returns the fastest span blenders supported by all CPUs, or \c NULL if
+	only the scalar drawing modes can be used.
+*/
+static const simd_span_blenders*
+select_span_blenders()
+{
+#if defined(__x86_64__)
+	if ((gSIMDFlags & APPSERVER_SIMD_AVX2) != 0)
+		return &gAVX2SpanBlenders;
+	if ((gSIMDFlags & APPSERVER_SIMD_SSE2) != 0)
+		return &gSSE2SpanBlenders;
+#elif defined(__aarch64__)
+	if ((gSIMDFlags & APPSERVER_SIMD_NEON) != 0)
+		return &gNEONSpanBlenders;
+#endif
+	return NULL;
+}
+
 // #pragma mark -
 
 // constructor
@@ -137,6 +161,7 @@ PixelFormat::PixelFormat(agg::rendering_buffer& rb,
 						 const PatternHandler* handler)
 	: fBuffer(&rb),
 	  fPatternHandler(handler),
+	  fSpanBlenders(select_span_blenders()),
 
 	  fBlendPixel(blend_pixel_empty),
 	  fBlendHLine(blend_hline_empty),
@@ -169,6 +194,8 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 				fBlendSolidHSpan = blend_solid_hspan_over_solid;
 				fBlendSolidVSpan = blend_solid_vspan_over_solid;
 				fBlendSolidHSpanSubpix = blend_solid_hspan_over_solid_subpix;
+				if (fSpanBlenders != NULL)
+					fBlendSolidHSpan = fSpanBlenders->solid_hspan_over_solid;
 			} else {
 				fBlendPixel = blend_pixel_over;
 				fBlendHLine = blend_hline_over;
@@ -177,6 +204,8 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 				fBlendSolidVSpan = blend_solid_vspan_over;
 			}
 			fBlendColorHSpan = blend_color_hspan_over;
+			if (fSpanBlenders != NULL)
+				fBlendColorHSpan = fSpanBlenders->color_hspan_over;
 			break;
 		case B_OP_ERASE:
 			fBlendPixel = blend_pixel_erase;
@@ -220,6 +249,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 				fBlendSolidHSpan = blend_solid_hspan_copy;
 				fBlendSolidVSpan = blend_solid_vspan_copy;
 				fBlendColorHSpan = blend_color_hspan_copy;
+				if (fSpanBlenders != NULL
+					&& fSpanBlenders->color_hspan_copy != NULL) {
+					fBlendColorHSpan = fSpanBlenders->color_hspan_copy;
+				}
 			}
 			break;
 		case B_OP_ADD:
@@ -245,6 +278,8 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 			fBlendSolidHSpan = blend_solid_hspan_blend;
 			fBlendSolidVSpan = blend_solid_vspan_blend;
 			fBlendColorHSpan = blend_color_hspan_blend;
+			if (fSpanBlenders != NULL)
+				fBlendColorHSpan = fSpanBlenders->color_hspan_blend;
 			break;
 		case B_OP_MIN:
 			fBlendPixel = blend_pixel_min;
@@ -280,6 +315,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 						fBlendSolidHSpanSubpix = blend_solid_hspan_alpha_co_solid_subpix;
 						fBlendSolidHSpan = blend_solid_hspan_alpha_co_solid;
 						fBlendSolidVSpan = blend_solid_vspan_alpha_co_solid;
+						if (fSpanBlenders != NULL) {
+							fBlendSolidHSpan
+								= fSpanBlenders->solid_hspan_alpha_co_solid;
+						}
 					} else {
 						fBlendPixel = blend_pixel_alpha_co;
 						fBlendHLine = blend_hline_alpha_co;
@@ -288,6 +327,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 						fBlendSolidVSpan = blend_solid_vspan_alpha_co;
 					}
 					fBlendColorHSpan = blend_color_hspan_alpha_co;
+					if (fSpanBlenders != NULL
+						&& fSpanBlenders->color_hspan_alpha_co != NULL) {
+						fBlendColorHSpan = fSpanBlenders->color_hspan_alpha_co;
+					}
 				} else if (alphaFncMode == B_ALPHA_COMPOSITE) {
 					fBlendPixel = blend_pixel_alpha_cc;
 					fBlendHLine = blend_hline_alpha_cc;
@@ -304,6 +347,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 						fBlendSolidHSpanSubpix = blend_solid_hspan_alpha_po_solid_subpix;
 						fBlendSolidHSpan = blend_solid_hspan_alpha_po_solid;
 						fBlendSolidVSpan = blend_solid_vspan_alpha_po_solid;
+						if (fSpanBlenders != NULL) {
+							fBlendSolidHSpan
+								= fSpanBlenders->solid_hspan_alpha_po_solid;
+						}
 					} else {
 						fBlendPixel = blend_pixel_alpha_po;
 						fBlendHLine = blend_hline_alpha_po;
@@ -312,6 +359,8 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 						fBlendSolidVSpan = blend_solid_vspan_alpha_po;
 					}
 					fBlendColorHSpan = blend_color_hspan_alpha_po;
+					if (fSpanBlenders != NULL)
+						fBlendColorHSpan = fSpanBlenders->color_hspan_alpha_po;
 				} else if (alphaFncMode == B_ALPHA_COMPOSITE) {
 					if (fPatternHandler->IsSolid()) {
 						fBlendPixel = blend_pixel_alpha_pc_solid;
@@ -327,6 +376,10 @@ PixelFormat::SetDrawingMode(drawing_mode mode, source_alpha alphaSrcMode,
 						fBlendSolidHSpan = blend_solid_hspan_alpha_pc;
 						fBlendSolidVSpan = blend_solid_vspan_alpha_pc;
 						fBlendColorHSpan = blend_color_hspan_alpha_pc;
+						if (fSpanBlenders != NULL) {
+							fBlendColorHSpan
+								= fSpanBlenders->color_hspan_alpha_pc;
+						}
 					}
 				} else if (alphaFncMode == B_ALPHA_COMPOSITE_SOURCE_IN) {
 					SetAggCompOpAdapter<alpha_src_in>();
@@ -24,6 +24,7 @@
 #include "AggCompOpAdapter.h"
 
 class PatternHandler;
+struct simd_span_blenders;
 
 class PixelFormat {
  public:
@@ -167,6 +168,7 @@ class PixelFormat {
  private:
 	agg::rendering_buffer*		fBuffer;
 	const PatternHandler*		fPatternHandler;
+	const simd_span_blenders*	fSpanBlenders;
 
 	blend_pixel_f				fBlendPixel;
 	blend_line					fBlendHLine;
@@ -70,8 +70,11 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 				uint64* virtualPageDir = (uint64*)fPageMapper->GetPageTableAt(
 					virtualPDPT[j] & X86_64_PDPTE_ADDRESS_MASK);
 				for (uint32 k = 0; k < 512; k++) {
-					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
+					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0
+						|| (virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0) {
+						// the pages of large pages belong to their cache
 						continue;
+					}
 
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
@@ -106,6 +109,14 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 			vm_page_set_state(page, PAGE_STATE_FREE);
 		}
 
+		// Free the page tables reserved for splitting large pages.
+		VMCachePagesTree::Iterator it = fLargePageTables.GetIterator();
+		while (vm_page* page = it.Next()) {
+			it.Remove();
+			DEBUG_PAGE_ACCESS_START(page);
+			vm_page_set_state(page, PAGE_STATE_FREE);
+		}
+
 		fPageMapper->Delete();
 	}
 
@@ -207,9 +218,8 @@ X86VMTranslationMap64Bit::Map(addr_t virtualAddress, phys_addr_t physicalAddress
 
 	// Look up the page table for the virtual address, allocating new tables
 	// if required. Shouldn't fail.
-	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
-		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
-		true, reservation, fPageMapper, fMapCount);
+	uint64* entry = _PageTableEntryForAddress(virtualAddress, true,
+		reservation);
 	ASSERT(entry != NULL);
 
 	// The entry should not already exist.
@@ -243,9 +253,7 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
-		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
-			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
-			NULL, fPageMapper, fMapCount);
+		uint64* pageTable = _PageTableForAddress(start, false, NULL);
 		if (pageTable == NULL) {
 			// Move on to the next page table.
 			start = ROUNDUP(start + 1, k64BitPageTableRange);
@@ -279,6 +287,72 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 }
 
 
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	return k64BitPageTableRange;
+}
+
+
+status_t
+X86VMTranslationMap64Bit::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	TRACE("X86VMTranslationMap64Bit::MapLargePage(%#" B_PRIxADDR ", %#"
+		B_PRIxPHYSADDR ")\n", virtualAddress, physicalAddress);
+
+	ASSERT(virtualAddress % k64BitPageTableRange == 0);
+	ASSERT(physicalAddress % k64BitPageTableRange == 0);
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
+		true, reservation, fPageMapper, fMapCount);
+	ASSERT(pde != NULL);
+
+	// Every large page gets a page table put aside, so that it can be split
+	// later without having to allocate memory. If there already is a page
+	// table, we can only use it for that if it is empty.
+	vm_page* page;
+	if ((*pde & X86_64_PDE_PRESENT) != 0) {
+		if ((*pde & X86_64_PDE_LARGE_PAGE) != 0)
+			return B_BAD_VALUE;
+
+		uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+			*pde & X86_64_PDE_ADDRESS_MASK);
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			if ((pageTable[i] & X86_64_PTE_PRESENT) != 0)
+				return B_BUSY;
+		}
+
+		page = vm_lookup_page((*pde & X86_64_PDE_ADDRESS_MASK) / B_PAGE_SIZE);
+		memset(pageTable, 0, B_PAGE_SIZE);
+		fMapCount--;
+
+		// the processor may still have the page table cached
+		InvalidatePage(virtualAddress);
+	} else {
+		page = vm_page_allocate_page(reservation,
+			PAGE_STATE_WIRED | VM_PAGE_ALLOC_CLEAR);
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	page->cache_offset = virtualAddress / B_PAGE_SIZE;
+	fLargePageTables.Insert(page);
+
+	uint64 entry;
+	X86PagingMethod64Bit::PutPageTableEntryInTable(&entry, physicalAddress,
+		attributes, memoryType, fIsKernelMap);
+	X86PagingMethod64Bit::SetTableEntry(pde, entry | X86_64_PDE_LARGE_PAGE);
+
+	fMapCount += k64BitTableEntryCount;
+
+	return B_OK;
+}
+
+
 status_t
 X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	bool markPresent)
@@ -293,9 +367,7 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
-		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
-			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
-			NULL, fPageMapper, fMapCount);
+		uint64* pageTable = _PageTableForAddress(start, false, NULL);
 		if (pageTable == NULL) {
 			// Move on to the next page table.
 			start = ROUNDUP(start + 1, k64BitPageTableRange);
@@ -343,9 +415,7 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	// Look up the page table for the virtual address.
-	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
-		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
-		false, NULL, fPageMapper, fMapCount);
+	uint64* entry = _PageTableEntryForAddress(address, false, NULL);
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
@@ -410,9 +480,7 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
-		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
-			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
-			NULL, fPageMapper, fMapCount);
+		uint64* pageTable = _PageTableForAddress(start, false, NULL);
 		if (pageTable == NULL) {
 			// Move on to the next page table.
 			start = ROUNDUP(start + 1, k64BitPageTableRange);
@@ -543,9 +611,7 @@ X86VMTranslationMap64Bit::UnmapArea(VMArea* area, bool deletingAddressSpace,
 			addr_t address = area->Base()
 				+ ((page->cache_offset * B_PAGE_SIZE) - area->cache_offset);
 
-			uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
-				fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
-				false, NULL, fPageMapper, fMapCount);
+			uint64* entry = _PageTableEntryForAddress(address, false, NULL);
 			if (entry == NULL) {
 				panic("page %p has mapping for area %p (%#" B_PRIxADDR "), but "
 					"has no page table", page, area, address);
@@ -691,9 +757,25 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
-		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
+		uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
+		if (pde != NULL && (*pde & (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE))
+				== (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE)) {
+			if (start % k64BitPageTableRange == 0
+				&& end - start >= k64BitPageTableRange - 1) {
+				// the range covers the whole large page
+				_ProtectLargePage(pde, start, newProtectionFlags
+					| X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(
+						memoryType));
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, start);
+		}
+
+		uint64* pageTable = _PageTableForAddress(start, false, NULL);
 		if (pageTable == NULL) {
 			// Move on to the next page table.
 			start = ROUNDUP(start + 1, k64BitPageTableRange);
@@ -748,9 +830,7 @@ X86VMTranslationMap64Bit::ClearFlags(addr_t address, uint32 flags)
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
-	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
-		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
-		false, NULL, fPageMapper, fMapCount);
+	uint64* entry = _PageTableEntryForAddress(address, false, NULL);
 	if (entry == NULL)
 		return B_OK;
 
@@ -779,9 +859,7 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
-	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
-		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
-		false, NULL, fPageMapper, fMapCount);
+	uint64* entry = _PageTableEntryForAddress(address, false, NULL);
 	if (entry == NULL)
 		return false;
 
@@ -846,6 +924,129 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 }
 
 
+/*!	Returns the page table for the given address like
+	X86PagingMethod64Bit::PageTableForAddress(), but splits a large page
+	covering the address first.
+*/
+uint64*
+X86VMTranslationMap64Bit::_PageTableForAddress(addr_t virtualAddress,
+	bool allocateTables, vm_page_reservation* reservation)
+{
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
+		allocateTables, reservation, fPageMapper, fMapCount);
+	if (pde == NULL)
+		return NULL;
+
+	if ((*pde & (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE))
+			== (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE)) {
+		_SplitLargePage(pde, virtualAddress);
+	}
+
+	return X86PagingMethod64Bit::PageTableForAddress(
+		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
+		allocateTables, reservation, fPageMapper, fMapCount);
+}
+
+
+uint64*
+X86VMTranslationMap64Bit::_PageTableEntryForAddress(addr_t virtualAddress,
+	bool allocateTables, vm_page_reservation* reservation)
+{
+	uint64* pageTable = _PageTableForAddress(virtualAddress, allocateTables,
+		reservation);
+	if (pageTable == NULL)
+		return NULL;
+
+	return &pageTable[VADDR_TO_PTE(virtualAddress)];
+}
+
+
+/*!	Replaces the large page mapped by the given page directory entry with the
+	page table put aside for it by MapLargePage(), mapping the same memory
+	with regular pages.
+	The accessed and dirty flags are only known for the large page as a whole,
+	so all pages inherit them.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePage(uint64* pde, addr_t virtualAddress)
+{
+	addr_t base = ROUNDDOWN(virtualAddress, k64BitPageTableRange);
+
+	TRACE("X86VMTranslationMap64Bit::_SplitLargePage(%#" B_PRIxADDR ")\n",
+		base);
+
+	vm_page* page = fLargePageTables.Remove(base / B_PAGE_SIZE);
+	if (page == NULL) {
+		panic("X86VMTranslationMap64Bit: no page table to split large page "
+			"at %#" B_PRIxADDR, base);
+		return;
+	}
+
+	phys_addr_t physicalPageTable
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		physicalPageTable);
+
+	uint64 entry = *pde;
+	while (true) {
+		phys_addr_t physicalAddress = entry & X86_64_PDE_ADDRESS_MASK
+			& ~(phys_addr_t)(k64BitPageTableRange - 1);
+		uint64 flags = entry & ~(X86_64_PDE_ADDRESS_MASK
+			| X86_64_PDE_LARGE_PAGE);
+		if ((entry & X86_64_PDE_PAT) != 0)
+			flags |= X86_64_PTE_PAT;
+
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++)
+			pageTable[i] = (physicalAddress + i * B_PAGE_SIZE) | flags;
+
+		// the processor may have set the accessed or dirty flag meanwhile
+		uint64 oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(physicalPageTable & X86_64_PDE_ADDRESS_MASK)
+				| X86_64_PDE_PRESENT
+				| X86_64_PDE_WRITABLE
+				| X86_64_PDE_USER,
+			entry);
+		if (oldEntry == entry)
+			break;
+
+		entry = oldEntry;
+	}
+
+	fMapCount++;
+
+	// the large page may still be cached in the TLBs
+	InvalidatePage(base);
+}
+
+
+void
+X86VMTranslationMap64Bit::_ProtectLargePage(uint64* pde, addr_t virtualAddress,
+	uint64 protectionFlags)
+{
+	TRACE("X86VMTranslationMap64Bit::_ProtectLargePage(%#" B_PRIxADDR ")\n",
+		virtualAddress);
+
+	// The protection and memory type bits of page directory entries are the
+	// same as those of page table entries.
+	uint64 entry = *pde;
+	uint64 oldEntry;
+	while (true) {
+		oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(entry & ~(X86_64_PTE_PROTECTION_MASK
+					| X86_64_PTE_MEMORY_TYPE_MASK))
+				| protectionFlags,
+			entry);
+		if (oldEntry == entry)
+			break;
+		entry = oldEntry;
+	}
+
+	if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+		InvalidatePage(virtualAddress);
+}
+
+
 X86PagingStructures*
 X86VMTranslationMap64Bit::PagingStructures() const
 {
@@ -41,6 +41,11 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// bounds of the read-ahead window
+#define MIN_READ_AHEAD_SIZE	(MAX_IO_VECS * B_PAGE_SIZE)
+#define MAX_READ_AHEAD_SIZE	(4 * 1024 * 1024)
+#define READ_AHEAD_LIMIT	(64 * 1024 * 1024)
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -51,6 +56,19 @@ struct file_cache_ref {
 	int32			last_access_index;
 	uint16			disabled_count;
 
+	// read-ahead state, protected by the cache lock
+	off_t			read_ahead_next;
+		// where the next read starts if the access is sequential
+	off_t			read_ahead_end;
+		// end of the range that has been read ahead so far
+	uint32			read_ahead_size;
+		// current size of the read-ahead window
+
+	// statistics, updated atomically
+	int64			hits;
+	int64			misses;
+	int64			read_ahead_pages;
+
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
 		// we remember writes as negative offsets
@@ -96,6 +114,26 @@ private:
 #endif
 };
 
+struct CacheIOStatistics {
+	CacheIOStatistics(file_cache_ref* ref)
+		:
+		fRef(ref),
+		fHits(0),
+		fMisses(0)
+	{
+	}
+
+	~CacheIOStatistics();
+
+	void Hit()		{ fHits++; }
+	void Miss()		{ fMisses++; }
+
+private:
+	file_cache_ref*	fRef;
+	int64			fHits;
+	int64			fMisses;
+};
+
 typedef status_t (*cache_func)(file_cache_ref* ref, void* cookie, off_t offset,
 	int32 pageOffset, addr_t buffer, size_t bufferSize, bool useBuffer,
 	vm_page_reservation* reservation, size_t reservePages);
@@ -106,6 +144,13 @@ static void add_to_iovec(generic_io_vec* vecs, uint32 &index, uint32 max,
 
 static struct cache_module_info* sCacheModule;
 
+static uint32 sMaxReadAheadSize = MAX_READ_AHEAD_SIZE;
+static int64 sCacheHits;
+static int64 sCacheMisses;
+static int64 sReadAheadPages;
+static int64 sReadAheadGrown;
+static int64 sReadAheadShrunk;
+
 
 static const uint32 kZeroVecCount = 32;
 static const size_t kZeroVecSize = kZeroVecCount * B_PAGE_SIZE;
@@ -725,6 +770,158 @@ satisfy_cache_io(file_cache_ref* ref, void* cookie, cache_func function,
 }
 
 
+CacheIOStatistics::~CacheIOStatistics()
+{
+	if (fHits != 0) {
+		atomic_add64(&fRef->hits, fHits);
+		atomic_add64(&sCacheHits, fHits);
+	}
+	if (fMisses != 0) {
+		atomic_add64(&fRef->misses, fMisses);
+		atomic_add64(&sCacheMisses, fMisses);
+	}
+}
+
+
+/*!	Starts asynchronous reads for all pages in the given range that are not
+	in the cache yet. The pages are taken from \a reservation.
+	The cache must be locked; it is unlocked temporarily while the I/O is
+	started. Returns the number of pages that are being read.
+*/
+static size_t
+precache_range(file_cache_ref* ref, off_t offset, size_t size,
+	vm_page_reservation* reservation)
+{
+	VMCache* cache = ref->cache;
+	size_t bytesToRead = 0;
+	size_t pagesRead = 0;
+	off_t lastOffset = offset;
+
+	while (true) {
+		// check if this page is already in memory
+		if (size > 0) {
+			vm_page* page = cache->LookupPage(offset);
+
+			offset += B_PAGE_SIZE;
+			size -= B_PAGE_SIZE;
+
+			if (page == NULL) {
+				bytesToRead += B_PAGE_SIZE;
+				continue;
+			}
+		}
+		if (bytesToRead != 0) {
+			// read the part before the current page (or the end of the request)
+			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
+				bytesToRead);
+			if (io == NULL || io->Prepare(reservation) != B_OK) {
+				delete io;
+				break;
+			}
+
+			// we must not have the cache locked during I/O
+			cache->Unlock();
+			io->ReadAsync();
+			cache->Lock();
+
+			pagesRead += bytesToRead / B_PAGE_SIZE;
+			bytesToRead = 0;
+		}
+
+		if (size == 0) {
+			// we have reached the end of the request
+			break;
+		}
+
+		lastOffset = offset;
+	}
+
+	return pagesRead;
+}
+
+
+/*!	Adapts the read-ahead window of the file to a read of \a size bytes at
+	\a offset, and reads ahead asynchronously if the access is sequential.
+
+	The window starts growing only after a read has continued exactly where
+	the previous one ended. It is doubled every time a new part of it is read
+	(up to sMaxReadAheadSize), and halved on every random access; once it falls
+	below MIN_READ_AHEAD_SIZE, reading ahead stops until the file is accessed
+	sequentially again.
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	VMCache* cache = ref->cache;
+	AutoLocker<VMCache> locker(cache);
+
+	off_t end = offset + size;
+	bool sequential = offset == ref->read_ahead_next;
+	ref->read_ahead_next = end;
+
+	if (!sequential) {
+		if (ref->read_ahead_size != 0) {
+			ref->read_ahead_size /= 2;
+			if (ref->read_ahead_size < MIN_READ_AHEAD_SIZE)
+				ref->read_ahead_size = 0;
+			atomic_add64(&sReadAheadShrunk, 1);
+		}
+		ref->read_ahead_end = end;
+		return;
+	}
+
+	uint32 maxSize = sMaxReadAheadSize;
+	if (maxSize == 0)
+		return;
+
+	// Only extend the window once the reader has consumed half of the data
+	// that has been read ahead.
+	if (ref->read_ahead_end - end > (off_t)ref->read_ahead_size / 2)
+		return;
+
+	off_t start = ROUNDDOWN(max_c(ref->read_ahead_end, end), B_PAGE_SIZE);
+	if (start >= cache->virtual_end)
+		return;
+
+	uint32 windowSize = ref->read_ahead_size == 0
+		? MIN_READ_AHEAD_SIZE : min_c(ref->read_ahead_size * 2, maxSize);
+	if (windowSize != ref->read_ahead_size) {
+		ref->read_ahead_size = windowSize;
+		atomic_add64(&sReadAheadGrown, 1);
+	}
+
+	off_t windowEnd = min_c(ROUNDUP(end + windowSize, B_PAGE_SIZE),
+		ROUNDUP(cache->virtual_end, B_PAGE_SIZE));
+	if (windowEnd <= start)
+		return;
+
+	size_t pageCount = (windowEnd - start) / B_PAGE_SIZE;
+
+	// Reading ahead is only a hint, so it must neither wait for pages nor
+	// compete with the page daemon.
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE
+		|| vm_page_num_unused_pages() < 2 * pageCount) {
+		return;
+	}
+
+	vm_page_reservation reservation;
+	if (!vm_page_try_reserve_pages(&reservation, pageCount, VM_PRIORITY_USER))
+		return;
+
+	ref->read_ahead_end = windowEnd;
+
+	size_t pagesRead = precache_range(ref, start, windowEnd - start,
+		&reservation);
+	if (pagesRead > 0) {
+		atomic_add64(&ref->read_ahead_pages, pagesRead);
+		atomic_add64(&sReadAheadPages, pagesRead);
+	}
+
+	locker.Unlock();
+	vm_page_unreserve_pages(&reservation);
+}
+
+
 static status_t
 cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 	size_t* _size, bool doWrite)
@@ -757,6 +954,7 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 	size_t reservePages = 0;
 	size_t pagesProcessed = 0;
 	cache_func function = NULL;
+	CacheIOStatistics statistics(ref);
 
 	vm_page_reservation reservation;
 	reserve_pages(ref, &reservation, lastReservedPages, doWrite);
@@ -805,6 +1003,13 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 		TRACE(("lookup page from offset %lld: %p, size = %lu, pageOffset "
 			"= %lu\n", offset, page, bytesLeft, pageOffset));
 
+		if (!doWrite) {
+			if (page != NULL)
+				statistics.Hit();
+			else
+				statistics.Miss();
+		}
+
 		if (page != NULL) {
 			if (doWrite || useBuffer) {
 				// Since the following user_mem{cpy,set}() might cause a page
@@ -941,6 +1146,88 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 
 			return status;
 		}
+
+		case CACHE_GET_STATS:
+		{
+			if (bufferSize != sizeof(file_cache_stats))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer))
+				return B_BAD_ADDRESS;
+
+			file_cache_stats stats;
+			stats.hits = atomic_get64(&sCacheHits);
+			stats.misses = atomic_get64(&sCacheMisses);
+			stats.read_ahead_pages = atomic_get64(&sReadAheadPages);
+			stats.read_ahead_grown = atomic_get64(&sReadAheadGrown);
+			stats.read_ahead_shrunk = atomic_get64(&sReadAheadShrunk);
+			stats.max_read_ahead = sMaxReadAheadSize;
+
+			return user_memcpy(buffer, &stats, sizeof(stats));
+		}
+
+		case CACHE_GET_FILE_STATS:
+		{
+			file_cache_file_stats stats;
+			if (bufferSize != sizeof(file_cache_file_stats))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(&stats, buffer, sizeof(stats)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			struct vnode* vnode;
+			status_t status = vfs_get_vnode_from_fd(stats.fd, false, &vnode);
+			if (status != B_OK)
+				return status;
+
+			VMCache* cache;
+			status = vfs_get_vnode_cache(vnode, &cache, false);
+			vfs_put_vnode(vnode);
+			if (status != B_OK)
+				return status;
+
+			AutoLocker<VMCache> locker(cache);
+
+			file_cache_ref* ref = NULL;
+			if (cache->type == CACHE_TYPE_VNODE)
+				ref = ((VMVnodeCache*)cache)->FileCacheRef();
+			if (ref == NULL) {
+				cache->ReleaseRefAndUnlock();
+				locker.Detach();
+				return B_BAD_VALUE;
+			}
+
+			stats.hits = atomic_get64(&ref->hits);
+			stats.misses = atomic_get64(&ref->misses);
+			stats.read_ahead_pages = atomic_get64(&ref->read_ahead_pages);
+			stats.read_ahead_window = ref->read_ahead_size;
+			stats.read_ahead_end = ref->read_ahead_end;
+
+			cache->ReleaseRefAndUnlock();
+			locker.Detach();
+
+			return user_memcpy(buffer, &stats, sizeof(stats));
+		}
+
+		case CACHE_SET_READ_AHEAD:
+		{
+			uint32 size;
+			if (bufferSize != sizeof(uint32))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(&size, buffer, sizeof(size)) != B_OK)
+				return B_BAD_ADDRESS;
+			if (size > READ_AHEAD_LIMIT)
+				return B_BAD_VALUE;
+
+			// anything below the minimum window turns reading ahead off
+			if (size < MIN_READ_AHEAD_SIZE)
+				size = 0;
+
+			sMaxReadAheadSize = ROUNDUP(size, B_PAGE_SIZE);
+			dprintf("cache_control: maximum read-ahead %" B_PRIu32 " bytes\n",
+				sMaxReadAheadSize);
+			return B_OK;
+		}
 	}
 
 	return B_BAD_HANDLER;
@@ -950,18 +1237,18 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 //	#pragma mark - private kernel API
 
 
-extern "C" void
+extern "C" size_t
 cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 {
 	if (size == 0)
-		return;
+		return 0;
 
 	VMCache* cache;
 	if (vfs_get_vnode_cache(vnode, &cache, false) != B_OK)
-		return;
+		return 0;
 	if (cache->type != CACHE_TYPE_VNODE) {
 		cache->ReleaseRef();
-		return;
+		return 0;
 	}
 
 	file_cache_ref* ref = ((VMVnodeCache*)cache)->FileCacheRef();
@@ -981,61 +1268,22 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 	if (offset >= fileSize || vm_page_num_unused_pages() < 2 * reservePages
 		|| 3 * cache->page_count > 2 * fileSize / B_PAGE_SIZE) {
 		cache->ReleaseRef();
-		return;
+		return 0;
 	}
 
-	size_t bytesToRead = 0;
-	off_t lastOffset = offset;
-
 	vm_page_reservation reservation;
 	vm_page_reserve_pages(&reservation, reservePages, VM_PRIORITY_USER);
 
 	cache->Lock();
-
-	while (true) {
-		// check if this page is already in memory
-		if (size > 0) {
-			vm_page* page = cache->LookupPage(offset);
-
-			offset += B_PAGE_SIZE;
-			size -= B_PAGE_SIZE;
-
-			if (page == NULL) {
-				bytesToRead += B_PAGE_SIZE;
-				continue;
-			}
-		}
-		if (bytesToRead != 0) {
-			// read the part before the current page (or the end of the request)
-			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
-				bytesToRead);
-			if (io == NULL || io->Prepare(&reservation) != B_OK) {
-				delete io;
-				break;
-			}
-
-			// we must not have the cache locked during I/O
-			cache->Unlock();
-			io->ReadAsync();
-			cache->Lock();
-
-			bytesToRead = 0;
-		}
-
-		if (size == 0) {
-			// we have reached the end of the request
-			break;
-		}
-
-		lastOffset = offset;
-	}
-
+	size_t pagesRead = precache_range(ref, offset, size, &reservation);
 	cache->ReleaseRefAndUnlock();
 	vm_page_unreserve_pages(&reservation);
+
+	return pagesRead * B_PAGE_SIZE;
 }
 
 
-extern "C" void
+extern "C" size_t
 cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size)
 {
 	// ToDo: schedule prefetch
@@ -1045,10 +1293,11 @@ cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size)
 	// get the vnode for the object, this also grabs a ref to it
 	struct vnode* vnode;
 	if (vfs_get_vnode(mountID, vnodeID, true, &vnode) != B_OK)
-		return;
+		return 0;
 
-	cache_prefetch_vnode(vnode, offset, size);
+	size_t bytesRead = cache_prefetch_vnode(vnode, offset, size);
 	vfs_put_vnode(vnode);
+	return bytesRead;
 }
 
 
@@ -1097,6 +1346,20 @@ cache_node_launched(size_t argCount, char*  const* args)
 }
 
 
+extern "C" void
+cache_node_read(struct vnode* vnode, off_t offset, size_t size)
+{
+	if (sCacheModule == NULL || sCacheModule->node_read == NULL)
+		return;
+
+	dev_t mountID;
+	ino_t vnodeID;
+	vfs_vnode_to_node_ref(vnode, &mountID, &vnodeID);
+
+	sCacheModule->node_read(vnode, mountID, vnodeID, offset, size);
+}
+
+
 extern "C" status_t
 file_cache_init_post_boot_device(void)
 {
@@ -1148,6 +1411,12 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	ref->read_ahead_next = -1;
+	ref->read_ahead_end = 0;
+	ref->read_ahead_size = 0;
+	ref->hits = 0;
+	ref->misses = 0;
+	ref->read_ahead_pages = 0;
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -1325,7 +1594,14 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
-	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
+	status_t status = cache_io(ref, cookie, offset, (addr_t)buffer, _size,
+		false);
+	if (status == B_OK && *_size > 0) {
+		read_ahead(ref, offset, *_size);
+		cache_node_read(ref->vnode, offset, *_size);
+	}
+
+	return status;
 }
 
 
@@ -7,17 +7,29 @@
 #include "FileDevice.h"
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <new>
 
 #include <fs_interface.h>
 
+#include <debug.h>
+#include <util/AutoLock.h>
 #include <vfs.h>
+#include <vm/vm.h>
+
+#include "dma_resources.h"
+#include "IORequest.h"
+#include "IOSchedulerRoster.h"
 
 
 static const uint32 kBlockSize = 512;
+static const generic_size_t kMaxTransferSize = 256 * 1024;
+static const uint32 kDMAResourceBufferCount = 16;
+static const uint32 kDMAResourceBounceBufferCount = 16;
 
 static const uint8 kDeviceIcon[] = {
 	0x6e, 0x63, 0x69, 0x66, 0x08, 0x05, 0x00, 0x04, 0x00, 0x54, 0x02, 0x00,
@@ -58,11 +70,13 @@ static const uint8 kDeviceIcon[] = {
 
 
 struct FileDevice::Cookie {
-	int	fd;
+	int		fd;
+	bool	writable;
 
-	Cookie(int fd)
+	Cookie(int fd, bool writable)
 		:
-		fd(fd)
+		fd(fd),
+		writable(writable)
 	{
 	}
 
@@ -77,20 +91,38 @@ struct FileDevice::Cookie {
 FileDevice::FileDevice()
 	:
 	fFD(-1),
-	fFileSize(0)
+	fFileSize(0),
+	fDMAResource(NULL),
+	fIOScheduler(NULL),
+	fIOBuffer(NULL),
+	fWriteFD(-1),
+	fWriterCount(0)
 {
+	mutex_init(&fWriteLock, "file device write");
 }
 
 
 FileDevice::~FileDevice()
 {
+	delete fIOScheduler;
+	delete fDMAResource;
+	free(fIOBuffer);
+
+	if (fWriteFD >= 0)
+		close(fWriteFD);
 	if (fFD >= 0)
 		close(fFD);
+
+	mutex_destroy(&fWriteLock);
 }
 
 
+/*!	\a devicePath is the path the device will be published under, relative
+	to /dev. The I/O is done directly on the file, unless an I/O scheduler is
+	configured for that path in the "io_scheduler" driver settings file.
+*/
 status_t
-FileDevice::Init(const char* path)
+FileDevice::Init(const char* path, const char* devicePath)
 {
 	fFD = open(path, O_RDONLY | O_NOTRAVERSE);
 	if (fFD < 0)
@@ -105,6 +137,11 @@ FileDevice::Init(const char* path)
 
 	fFileSize = st.st_size / kBlockSize * kBlockSize;
 
+	if (devicePath != NULL
+		&& IOSchedulerRoster::Default()->HasDeviceSettings(devicePath)) {
+		return _InitIOScheduler(devicePath);
+	}
+
 	return B_OK;
 }
 
@@ -160,34 +197,43 @@ FileDevice::HasWrite() const
 bool
 FileDevice::HasIO() const
 {
-	// TODO: Support!
-	return false;
+	return fIOScheduler != NULL;
 }
 
 
 status_t
 FileDevice::Open(const char* path, int openMode, void** _cookie)
 {
-	// get the vnode
-	struct vnode* vnode;
-	status_t error = vfs_get_vnode_from_fd(fFD, true, &vnode);
-	if (error != B_OK)
-		return error;
-
-	// open it
-	int fd = vfs_open_vnode(vnode, openMode, true);
-	if (fd < 0) {
-		vfs_put_vnode(vnode);
+	int fd = _OpenFD(openMode);
+	if (fd < 0)
 		return fd;
-	}
-	// our vnode reference does now belong to the FD
 
-	Cookie* cookie = new(std::nothrow) Cookie(fd);
+	bool writable = fIOScheduler != NULL
+		&& (openMode & O_RWMASK) != O_RDONLY;
+
+	Cookie* cookie = new(std::nothrow) Cookie(fd, writable);
 	if (cookie == NULL) {
 		close(fd);
 		return B_NO_MEMORY;
 	}
 
+	if (writable) {
+		// The I/O scheduler's operations are not associated with a cookie,
+		// so it writes through an FD of its own, as long as the device is
+		// open for writing.
+		MutexLocker locker(fWriteLock);
+		if (fWriterCount == 0) {
+			fWriteFD = _OpenFD(O_WRONLY);
+			if (fWriteFD < 0) {
+				status_t error = fWriteFD;
+				locker.Unlock();
+				delete cookie;
+				return error;
+			}
+		}
+		fWriterCount++;
+	}
+
 	*_cookie = cookie;
 	return B_OK;
 }
@@ -198,6 +244,9 @@ FileDevice::Read(void* _cookie, off_t pos, void* buffer, size_t* _length)
 {
 	Cookie* cookie = (Cookie*)_cookie;
 
+	if (fIOScheduler != NULL)
+		return _DoSynchronousIO(pos, buffer, _length, false);
+
 	ssize_t bytesRead = pread(cookie->fd, buffer, *_length, pos);
 	if (bytesRead < 0) {
 		*_length = 0;
@@ -214,6 +263,9 @@ FileDevice::Write(void* _cookie, off_t pos, const void* buffer, size_t* _length)
 {
 	Cookie* cookie = (Cookie*)_cookie;
 
+	if (fIOScheduler != NULL)
+		return _DoSynchronousIO(pos, (void*)buffer, _length, true);
+
 	ssize_t bytesWritten = pwrite(cookie->fd, buffer, *_length, pos);
 	if (bytesWritten < 0) {
 		*_length = 0;
@@ -228,16 +280,15 @@ FileDevice::Write(void* _cookie, off_t pos, const void* buffer, size_t* _length)
 status_t
 FileDevice::IO(void* _cookie, io_request* request)
 {
-//	Cookie* cookie = (Cookie*)_cookie;
-//	return do_fd_io(cookie->fd, request);
-// TODO: The implementation is fine in principle, but do_fd_io() requires either
-// the io() hook or the {read,write}_pages() hooks of the underlying FS to be
-// implemented, which we can't guarantee. do_fd_io() should work around by using
-// read() and write(), but it's all quite of a mess, since we mix up the io()
-// hook -- which ATM has the semantics of uncached_io() hook (i.e. ignoring the
-// file cache) -- with the actual io() hook semantics (i.e. using the file
-// cache).
-	return B_UNSUPPORTED;
+	// Without an I/O scheduler, there is no io() hook (cf. HasIO()).
+	// We don't use do_fd_io() on the file, since that requires either the
+	// io() hook or the {read,write}_pages() hooks of the underlying FS to be
+	// implemented, which we can't guarantee. Instead the operations are
+	// performed with plain reads and writes by _DoIO().
+	if (fIOScheduler == NULL)
+		return B_UNSUPPORTED;
+
+	return fIOScheduler->ScheduleRequest(request);
 }
 
 
@@ -394,6 +445,177 @@ FileDevice::Close(void* cookie)
 status_t
 FileDevice::Free(void* _cookie)
 {
-	delete (Cookie*)_cookie;
+	Cookie* cookie = (Cookie*)_cookie;
+
+	if (cookie->writable) {
+		MutexLocker locker(fWriteLock);
+		if (--fWriterCount == 0) {
+			close(fWriteFD);
+			fWriteFD = -1;
+		}
+	}
+
+	delete cookie;
+	return B_OK;
+}
+
+
+// #pragma mark - private
+
+
+/*!	Creates the I/O scheduler for the device. The scheduler's operations refer
+	to physical memory, which _DoIO() copies through a buffer of the maximum
+	transfer size.
+*/
+status_t
+FileDevice::_InitIOScheduler(const char* devicePath)
+{
+	fIOBuffer = malloc(kMaxTransferSize);
+	if (fIOBuffer == NULL)
+		return B_NO_MEMORY;
+
+	fDMAResource = new(std::nothrow) DMAResource;
+	if (fDMAResource == NULL)
+		return B_NO_MEMORY;
+
+	dma_restrictions restrictions = {};
+	restrictions.max_transfer_size = kMaxTransferSize;
+
+	status_t error = fDMAResource->Init(restrictions, kBlockSize,
+		kDMAResourceBufferCount, kDMAResourceBounceBufferCount);
+	if (error != B_OK)
+		return error;
+
+	error = IOSchedulerRoster::Default()->CreateScheduler(fDMAResource,
+		"file device", devicePath, fIOScheduler);
+	if (error != B_OK)
+		return error;
+
+	fIOScheduler->SetCallback(&_DoIOEntry, this);
 	return B_OK;
 }
+
+
+/*!	Opens another FD for the file with the given \a openMode.
+	Returns the FD or an error code.
+*/
+int
+FileDevice::_OpenFD(int openMode)
+{
+	// get the vnode
+	struct vnode* vnode;
+	status_t error = vfs_get_vnode_from_fd(fFD, true, &vnode);
+	if (error != B_OK)
+		return error;
+
+	// open it
+	int fd = vfs_open_vnode(vnode, openMode, true);
+	if (fd < 0) {
+		vfs_put_vnode(vnode);
+		return fd;
+	}
+	// our vnode reference does now belong to the FD
+
+	return fd;
+}
+
+
+status_t
+FileDevice::_DoSynchronousIO(off_t pos, void* buffer, size_t* _length,
+	bool write)
+{
+	size_t length = *_length;
+	if (pos >= fFileSize)
+		length = 0;
+	else if (pos + (off_t)length > fFileSize)
+		length = fFileSize - pos;
+
+	if (length == 0) {
+		*_length = 0;
+		return B_OK;
+	}
+
+	IORequest request;
+	status_t status = request.Init(pos, (addr_t)buffer, length, write, 0);
+	if (status != B_OK)
+		return status;
+
+	status = fIOScheduler->ScheduleRequest(&request);
+	if (status != B_OK)
+		return status;
+
+	status = request.Wait(0, 0);
+	*_length = request.TransferredBytes();
+	return status;
+}
+
+
+/*static*/ status_t
+FileDevice::_DoIOEntry(void* data, IOOperation* operation)
+{
+	return ((FileDevice*)data)->_DoIO(operation);
+}
+
+
+/*!	Called by the I/O scheduler to execute an operation. The operation's
+	vectors are physical, so the data are copied through fIOBuffer, which is
+	only ever used by the scheduler thread.
+	Reads use fFD, writes the FD that is kept open while the device is open
+	for writing; the file is only ever opened writable on request.
+*/
+status_t
+FileDevice::_DoIO(IOOperation* operation)
+{
+	off_t offset = operation->Offset();
+	generic_size_t length = operation->Length();
+	const generic_io_vec* vecs = operation->Vecs();
+	uint32 vecCount = operation->VecCount();
+	bool isWrite = operation->IsWrite();
+	uint8* buffer = (uint8*)fIOBuffer;
+
+	ASSERT(length <= kMaxTransferSize);
+
+	int fd = fFD;
+	MutexLocker writeLocker;
+	if (isWrite) {
+		writeLocker.SetTo(fWriteLock, false);
+		fd = fWriteFD;
+	}
+
+	status_t error = fd >= 0 ? B_OK : B_READ_ONLY_DEVICE;
+	if (isWrite && error == B_OK) {
+		generic_size_t bufferOffset = 0;
+		for (uint32 i = 0; i < vecCount && error == B_OK; i++) {
+			error = vm_memcpy_from_physical(buffer + bufferOffset,
+				vecs[i].base, vecs[i].length, false);
+			bufferOffset += vecs[i].length;
+		}
+	}
+
+	ssize_t bytesTransferred = 0;
+	if (error == B_OK) {
+		bytesTransferred = isWrite
+			? pwrite(fd, buffer, length, offset)
+			: pread(fd, buffer, length, offset);
+		if (bytesTransferred < 0)
+			error = errno;
+	}
+
+	if (!isWrite && error == B_OK) {
+		generic_size_t bufferOffset = 0;
+		for (uint32 i = 0; i < vecCount && error == B_OK
+				&& bufferOffset < (generic_size_t)bytesTransferred; i++) {
+			generic_size_t toCopy = std::min(vecs[i].length,
+				(generic_size_t)bytesTransferred - bufferOffset);
+			error = vm_memcpy_to_physical(vecs[i].base, buffer + bufferOffset,
+				toCopy, false);
+			bufferOffset += toCopy;
+		}
+	}
+
+	writeLocker.Unlock();
+
+	fIOScheduler->OperationCompleted(operation, error,
+		error == B_OK ? bytesTransferred : 0);
+	return error;
+}
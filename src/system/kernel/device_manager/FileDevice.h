@@ -6,9 +6,16 @@
 #define FILE_DEVICE_H
 
 
+#include <lock.h>
+
 #include "BaseDevice.h"
 
 
+class DMAResource;
+class IOScheduler;
+struct IOOperation;
+
+
 namespace BPrivate {
 
 
@@ -17,7 +24,8 @@ public:
 							FileDevice();
 	virtual					~FileDevice();
 
-			status_t		Init(const char* path);
+			status_t		Init(const char* path,
+								const char* devicePath);
 
 	virtual	status_t		InitDevice();
 	virtual	void			UninitDevice();
@@ -49,9 +57,23 @@ public:
 private:
 	struct Cookie;
 
+private:
+			status_t		_InitIOScheduler(const char* devicePath);
+			int				_OpenFD(int openMode);
+			status_t		_DoSynchronousIO(off_t pos, void* buffer,
+								size_t* _length, bool write);
+	static	status_t		_DoIOEntry(void* data, IOOperation* operation);
+			status_t		_DoIO(IOOperation* operation);
+
 private:
 	int						fFD;
 	off_t					fFileSize;
+	DMAResource*			fDMAResource;
+	IOScheduler*			fIOScheduler;
+	void*					fIOBuffer;
+	mutex					fWriteLock;
+	int						fWriteFD;
+	int32					fWriterCount;
 };
 
 
@@ -232,6 +232,13 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 									{ fOwner = owner; }
 			IORequestOwner*		Owner() const	{ return fOwner; }
 
+			void				SetScheduledTime(bigtime_t time)
+									{ fScheduledTime = time; }
+			bigtime_t			ScheduledTime() const
+									{ return fScheduledTime; }
+									// time the request was handed to the
+									// I/O scheduler
+
 			status_t			CreateSubRequest(off_t parentOffset,
 									off_t offset, generic_size_t length,
 									IORequest*& subRequest);
@@ -326,6 +333,7 @@ private:
 
 			mutex				fLock;
 			IORequestOwner*		fOwner;
+			bigtime_t			fScheduledTime;
 			IOBuffer*			fBuffer;
 			off_t				fOffset;
 			generic_size_t		fLength;
@@ -0,0 +1,935 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	A deadline I/O scheduler.
+
+	Reads and writes are kept in separate queues in arrival order. Requests are
+	dispatched in batches: a batch serves only one direction and follows the
+	disk position upwards (elevator order), picking up requests that continue
+	exactly where the previous one ended back-to-back. A batch starts at the
+	oldest request of its queue when that request's deadline has expired, so
+	no request waits much longer than its queue's expiry time.
+
+	Reads are preferred over writes, since there is usually a thread waiting
+	for them, but writes are served at the latest after \c kMaxWritesStarved
+	read batches. Within a batch, a team gets only a share of the bandwidth as
+	long as other teams have requests queued in the same direction, so that a
+	single team streaming a large file cannot monopolize the device.
+
+	Per team statistics (request counts, transferred bytes, and latencies) are
+	kept for the most recently active teams and can be inspected via the
+	"io_scheduler" debugger command.
+*/
+
+
+#include "IOSchedulerDeadline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <lock.h>
+#include <thread_types.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+
+#include "IOSchedulerRoster.h"
+
+
+//#define TRACE_IO_SCHEDULER
+#ifdef TRACE_IO_SCHEDULER
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+static const bigtime_t kReadExpiry = 500000;
+static const bigtime_t kWriteExpiry = 5000000;
+static const int32 kMaxWritesStarved = 2;
+static const int32 kTeamAccountCount = 64;
+
+
+struct IOSchedulerDeadline::TeamAccount : IORequestOwner {
+	int32		pending;
+	int32		queued[QUEUE_COUNT];
+	uint32		batch_generation;
+	off_t		batch_bandwidth;
+
+	int64		requests[QUEUE_COUNT];
+	int64		bytes[QUEUE_COUNT];
+	bigtime_t	total_latency[QUEUE_COUNT];
+	bigtime_t	max_latency[QUEUE_COUNT];
+
+	void Reset(team_id team)
+	{
+		this->team = team;
+		thread = -1;
+		priority = B_IDLE_PRIORITY;
+		pending = 0;
+		batch_generation = 0;
+		batch_bandwidth = 0;
+
+		for (int32 i = 0; i < QUEUE_COUNT; i++) {
+			queued[i] = 0;
+			requests[i] = 0;
+			bytes[i] = 0;
+			total_latency[i] = 0;
+			max_latency[i] = 0;
+		}
+	}
+
+	void Dump() const
+	{
+		static const char* const kDirections[] = { "read", "write" };
+
+		kprintf("  team %6" B_PRId32 ": %" B_PRId32 " pending\n", team,
+			pending);
+		for (int32 i = 0; i < QUEUE_COUNT; i++) {
+			if (requests[i] == 0)
+				continue;
+
+			kprintf("    %-5s %8" B_PRId64 " requests, %10" B_PRId64 " KiB, "
+				"latency: avg %" B_PRIdBIGTIME " us, max %" B_PRIdBIGTIME
+				" us\n", kDirections[i], requests[i], bytes[i] / 1024,
+				total_latency[i] / requests[i], max_latency[i]);
+		}
+	}
+};
+
+
+struct IOSchedulerDeadline::TeamAccountHashDefinition {
+	typedef team_id			KeyType;
+	typedef IORequestOwner	ValueType;
+
+	size_t HashKey(team_id key) const				{ return key; }
+	size_t Hash(const IORequestOwner* value) const	{ return value->team; }
+	bool Compare(team_id key, const IORequestOwner* value) const
+		{ return value->team == key; }
+	IORequestOwner*& GetLink(IORequestOwner* value) const
+		{ return value->hash_link; }
+};
+
+struct IOSchedulerDeadline::TeamAccountHashTable
+		: BOpenHashTable<TeamAccountHashDefinition, false> {
+};
+
+
+IOSchedulerDeadline::IOSchedulerDeadline(DMAResource* resource)
+	:
+	IOScheduler(resource),
+	fSchedulerThread(-1),
+	fRequestNotifierThread(-1),
+	fTeamAccounts(NULL),
+	fSharedAccount(NULL),
+	fTeamAccountTable(NULL),
+	fBlockSize(0),
+	fPendingOperations(0),
+	fBatchGeneration(0),
+	fLastDirection(READ_QUEUE),
+	fLastPosition(0),
+	fWritesStarved(0),
+	fTerminating(false)
+{
+	mutex_init(&fLock, "I/O scheduler");
+	B_INITIALIZE_SPINLOCK(&fFinisherLock);
+
+	fNewRequestCondition.Init(this, "I/O new request");
+	fFinishedOperationCondition.Init(this, "I/O finished operation");
+	fFinishedRequestCondition.Init(this, "I/O finished request");
+
+	for (int32 i = 0; i < QUEUE_COUNT; i++) {
+		RequestQueue& queue = fQueues[i];
+		queue.count = 0;
+		queue.expiry = i == READ_QUEUE ? kReadExpiry : kWriteExpiry;
+		queue.dispatched_requests = 0;
+		queue.dispatched_bytes = 0;
+		queue.expired_batches = 0;
+		queue.merged_requests = 0;
+	}
+}
+
+
+IOSchedulerDeadline::~IOSchedulerDeadline()
+{
+	// shutdown threads
+	MutexLocker locker(fLock);
+	InterruptsSpinLocker finisherLocker(fFinisherLock);
+	fTerminating = true;
+
+	fNewRequestCondition.NotifyAll();
+	fFinishedOperationCondition.NotifyAll();
+	fFinishedRequestCondition.NotifyAll();
+
+	finisherLocker.Unlock();
+	locker.Unlock();
+
+	if (fSchedulerThread >= 0)
+		wait_for_thread(fSchedulerThread, NULL);
+
+	if (fRequestNotifierThread >= 0)
+		wait_for_thread(fRequestNotifierThread, NULL);
+
+	// destroy our belongings
+	mutex_lock(&fLock);
+	mutex_destroy(&fLock);
+
+	while (IOOperation* operation = fUnusedOperations.RemoveHead())
+		delete operation;
+
+	delete fTeamAccountTable;
+	delete[] fTeamAccounts;
+}
+
+
+status_t
+IOSchedulerDeadline::Init(const char* name)
+{
+	status_t error = IOScheduler::Init(name);
+	if (error != B_OK)
+		return error;
+
+	size_t count = fDMAResource != NULL ? fDMAResource->BufferCount() : 16;
+	for (size_t i = 0; i < count; i++) {
+		IOOperation* operation = new(std::nothrow) IOOperation;
+		if (operation == NULL)
+			return B_NO_MEMORY;
+
+		fUnusedOperations.Add(operation);
+	}
+
+	if (fDMAResource != NULL)
+		fBlockSize = fDMAResource->BlockSize();
+	if (fBlockSize == 0)
+		fBlockSize = 512;
+
+	// The last account is shared by all teams we run out of accounts for.
+	fTeamAccounts = new(std::nothrow) TeamAccount[kTeamAccountCount + 1];
+	if (fTeamAccounts == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < kTeamAccountCount + 1; i++) {
+		TeamAccount& account = fTeamAccounts[i];
+		account.Reset(-1);
+		if (i < kTeamAccountCount)
+			fIdleAccounts.Add(&account);
+	}
+	fSharedAccount = &fTeamAccounts[kTeamAccountCount];
+
+	fTeamAccountTable = new(std::nothrow) TeamAccountHashTable;
+	if (fTeamAccountTable == NULL)
+		return B_NO_MEMORY;
+
+	error = fTeamAccountTable->Init(kTeamAccountCount);
+	if (error != B_OK)
+		return error;
+
+	// TODO: Use a device speed dependent bandwidths!
+	fBatchBandwidth = fBlockSize * 2048;
+	fTeamBandwidth = fBatchBandwidth / 4;
+
+	// start threads
+	char buffer[B_OS_NAME_LENGTH];
+	strlcpy(buffer, name, sizeof(buffer));
+	strlcat(buffer, " scheduler ", sizeof(buffer));
+	size_t nameLength = strlen(buffer);
+	snprintf(buffer + nameLength, sizeof(buffer) - nameLength, "%" B_PRId32,
+		fID);
+	fSchedulerThread = spawn_kernel_thread(&_SchedulerThread, buffer,
+		B_NORMAL_PRIORITY + 2, (void *)this);
+	if (fSchedulerThread < B_OK)
+		return fSchedulerThread;
+
+	strlcpy(buffer, name, sizeof(buffer));
+	strlcat(buffer, " notifier ", sizeof(buffer));
+	nameLength = strlen(buffer);
+	snprintf(buffer + nameLength, sizeof(buffer) - nameLength, "%" B_PRId32,
+		fID);
+	fRequestNotifierThread = spawn_kernel_thread(&_RequestNotifierThread,
+		buffer, B_NORMAL_PRIORITY + 2, (void *)this);
+	if (fRequestNotifierThread < B_OK)
+		return fRequestNotifierThread;
+
+	resume_thread(fSchedulerThread);
+	resume_thread(fRequestNotifierThread);
+
+	return B_OK;
+}
+
+
+status_t
+IOSchedulerDeadline::ScheduleRequest(IORequest* request)
+{
+	TRACE("%p->IOSchedulerDeadline::ScheduleRequest(%p)\n", this, request);
+
+	IOBuffer* buffer = request->Buffer();
+
+	// TODO: it would be nice to be able to lock the memory later, but we can't
+	// easily do it in the I/O scheduler without being able to asynchronously
+	// lock memory (via another thread or a dedicated call).
+
+	if (buffer->IsVirtual()) {
+		status_t status = buffer->LockMemory(request->TeamID(),
+			request->IsWrite());
+		if (status != B_OK) {
+			request->SetStatusAndNotify(status);
+			return status;
+		}
+	}
+
+	MutexLocker locker(fLock);
+
+	TeamAccount* account = _GetTeamAccount(request->TeamID());
+	if (account->pending++ == 0 && account != fSharedAccount)
+		fIdleAccounts.Remove(account);
+
+	int32 direction = _Direction(request);
+	account->queued[direction]++;
+
+	request->SetOwner(account);
+	request->SetScheduledTime(system_time());
+
+	RequestQueue& queue = fQueues[direction];
+	queue.requests.Add(request);
+	queue.count++;
+
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_SCHEDULED, this,
+		request);
+
+	fNewRequestCondition.NotifyAll();
+
+	return B_OK;
+}
+
+
+/*!	Aborts the given request, if none of it has been processed yet. Otherwise
+	the request is left alone and completes normally.
+*/
+void
+IOSchedulerDeadline::AbortRequest(IORequest* request, status_t status)
+{
+	MutexLocker locker(fLock);
+
+	if (!fQueues[_Direction(request)].requests.Contains(request)
+		|| request->RemainingBytes() != request->Length()) {
+		return;
+	}
+
+	IOOperationList noOperations;
+	_AbortRequest(request, status, noOperations);
+}
+
+
+void
+IOSchedulerDeadline::OperationCompleted(IOOperation* operation, status_t status,
+	generic_size_t transferredBytes)
+{
+	InterruptsSpinLocker _(fFinisherLock);
+
+	// finish operation only once
+	if (operation->Status() <= 0)
+		return;
+
+	operation->SetStatus(status, transferredBytes);
+
+	fCompletedOperations.Add(operation);
+	fFinishedOperationCondition.NotifyAll();
+}
+
+
+void
+IOSchedulerDeadline::Dump() const
+{
+	static const char* const kQueueNames[] = { "read", "write" };
+
+	kprintf("IOSchedulerDeadline at %p\n", this);
+	kprintf("  DMA resource:   %p\n", fDMAResource);
+	kprintf("  batch:          %" B_PRIdOFF " bytes (team share %" B_PRIdOFF
+		")\n", fBatchBandwidth, fTeamBandwidth);
+	kprintf("  last position:  %" B_PRIdOFF " (%s)\n", fLastPosition,
+		kQueueNames[fLastDirection]);
+	kprintf("  writes starved: %" B_PRId32 "\n", fWritesStarved);
+
+	for (int32 i = 0; i < QUEUE_COUNT; i++) {
+		const RequestQueue& queue = fQueues[i];
+		kprintf("  %s queue: %" B_PRId32 " requests, expiry %" B_PRIdBIGTIME
+			" us\n", kQueueNames[i], queue.count, queue.expiry);
+		kprintf("    dispatched: %" B_PRId64 " requests, %" B_PRId64 " KiB\n",
+			queue.dispatched_requests, queue.dispatched_bytes / 1024);
+		kprintf("    expired batches: %" B_PRId64 ", merged requests: %"
+			B_PRId64 "\n", queue.expired_batches, queue.merged_requests);
+
+		kprintf("    queued:");
+		for (IORequestList::ConstIterator it = queue.requests.GetIterator();
+				IORequest* request = it.Next();) {
+			kprintf(" %p", request);
+		}
+		kprintf("\n");
+	}
+
+	kprintf("  teams:\n");
+	for (int32 i = 0; i < kTeamAccountCount + 1; i++) {
+		const TeamAccount& account = fTeamAccounts[i];
+		if (account.team >= 0 || &account == fSharedAccount)
+			account.Dump();
+	}
+}
+
+
+/*!	Must not be called with the fLock held. */
+void
+IOSchedulerDeadline::_Finisher()
+{
+	while (true) {
+		InterruptsSpinLocker locker(fFinisherLock);
+		IOOperation* operation = fCompletedOperations.RemoveHead();
+		if (operation == NULL)
+			return;
+
+		locker.Unlock();
+
+		TRACE("IOSchedulerDeadline::_Finisher(): operation: %p\n", operation);
+
+		bool operationFinished = operation->Finish();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_FINISHED,
+			this, operation->Parent(), operation);
+			// Notify for every time the operation is passed to the I/O hook,
+			// not only when it is fully finished.
+
+		if (!operationFinished) {
+			TRACE("  operation: %p not finished yet\n", operation);
+			MutexLocker _(fLock);
+			fUnfinishedOperations.Add(operation);
+			fPendingOperations--;
+			continue;
+		}
+
+		// notify request and remove operation
+		IORequest* request = operation->Parent();
+
+		request->OperationFinished(operation);
+
+		// recycle the operation
+		MutexLocker _(fLock);
+		if (fDMAResource != NULL)
+			fDMAResource->RecycleBuffer(operation->Buffer());
+
+		fPendingOperations--;
+		fUnusedOperations.Add(operation);
+
+		// If the request is done, we need to perform its notifications.
+		if (!request->IsFinished())
+			continue;
+
+		// An aborted request must leave the list before it is finished, as
+		// it shares the list link with fFinishedRequests.
+		bool aborted = fAbortedRequests.Contains(request);
+		if (aborted)
+			fAbortedRequests.Remove(request);
+
+		if (request->Status() == B_OK && request->RemainingBytes() > 0) {
+			if (!aborted) {
+				// The request has been processed OK so far, but it isn't
+				// really finished yet.
+				request->SetUnfinished();
+				continue;
+			}
+
+			// The rest of the request could not be translated; report what
+			// we got as a partial transfer.
+			request->SetTransferredBytes(true, request->TransferredBytes());
+		}
+
+		_RequestFinished(request);
+
+		if (request->HasCallbacks()) {
+			// The request has callbacks that may take some time to
+			// perform, so we hand it over to the request notifier.
+			fFinishedRequests.Add(request);
+			fFinishedRequestCondition.NotifyAll();
+		} else {
+			// No callbacks -- finish the request right now.
+			IOSchedulerRoster::Default()->Notify(
+				IO_SCHEDULER_REQUEST_FINISHED, this, request);
+			request->NotifyFinished();
+		}
+	}
+}
+
+
+/*!	Called with \c fFinisherLock held.
+*/
+bool
+IOSchedulerDeadline::_FinisherWorkPending()
+{
+	return !fCompletedOperations.IsEmpty();
+}
+
+
+/*!	Waits until there are requests or unfinished operations to process.
+	Must be called with \c fLock held; returns with it held again.
+	Returns \c false, when the scheduler is asked to terminate.
+*/
+bool
+IOSchedulerDeadline::_WaitForWork()
+{
+	while (true) {
+		if (fTerminating)
+			return false;
+
+		if (fQueues[READ_QUEUE].count > 0 || fQueues[WRITE_QUEUE].count > 0
+			|| !fUnfinishedOperations.IsEmpty()) {
+			return true;
+		}
+
+		// First check whether any finisher work has to be done.
+		InterruptsSpinLocker finisherLocker(fFinisherLock);
+		if (_FinisherWorkPending()) {
+			finisherLocker.Unlock();
+			mutex_unlock(&fLock);
+			_Finisher();
+			mutex_lock(&fLock);
+			continue;
+		}
+
+		// Wait for new requests.
+		ConditionVariableEntry entry;
+		fNewRequestCondition.Add(&entry);
+
+		finisherLocker.Unlock();
+		mutex_unlock(&fLock);
+
+		entry.Wait(B_CAN_INTERRUPT);
+		_Finisher();
+		mutex_lock(&fLock);
+	}
+}
+
+
+/*!	Chooses the direction of the next batch and prepares its operations.
+	Called with \c fLock held.
+*/
+void
+IOSchedulerDeadline::_PrepareBatch(IOOperationList& operations,
+	int32& operationCount)
+{
+	bool readsQueued = fQueues[READ_QUEUE].count > 0;
+	bool writesQueued = fQueues[WRITE_QUEUE].count > 0;
+	if (!readsQueued && !writesQueued)
+		return;
+
+	int32 direction;
+	if (readsQueued && (!writesQueued || fWritesStarved < kMaxWritesStarved)) {
+		direction = READ_QUEUE;
+		if (writesQueued)
+			fWritesStarved++;
+	} else {
+		direction = WRITE_QUEUE;
+		fWritesStarved = 0;
+	}
+
+	RequestQueue& queue = fQueues[direction];
+	fBatchGeneration++;
+
+	// Continue the elevator run in the same direction, unless the oldest
+	// request has expired.
+	IORequest* request = queue.requests.Head();
+	if (request->ScheduledTime() + queue.expiry <= system_time()) {
+		queue.expired_batches++;
+	} else if (direction == fLastDirection) {
+		IORequest* next = _NextRequest(direction, fLastPosition);
+		if (next != NULL)
+			request = next;
+	}
+	fLastDirection = direction;
+
+	off_t batchBandwidth = fBatchBandwidth;
+	while (request != NULL && batchBandwidth >= (off_t)fBlockSize) {
+		TeamAccount* account = static_cast<TeamAccount*>(request->Owner());
+		if (account->batch_generation != fBatchGeneration) {
+			account->batch_generation = fBatchGeneration;
+			account->batch_bandwidth = 0;
+		}
+
+		// Limit the team to its share, if others are waiting, too.
+		off_t quantum = batchBandwidth;
+		if (account->queued[direction] < queue.count) {
+			quantum = std::min(quantum,
+				fTeamBandwidth - account->batch_bandwidth);
+		}
+
+		bool firstTranslation = request->RemainingBytes() == request->Length();
+		off_t usedBandwidth = 0;
+		bool resourcesAvailable = _PrepareRequestOperations(request,
+			operations, operationCount, quantum, usedBandwidth);
+		batchBandwidth -= usedBandwidth;
+		account->batch_bandwidth += usedBandwidth;
+		queue.dispatched_bytes += usedBandwidth;
+		if (firstTranslation && usedBandwidth > 0)
+			queue.dispatched_requests++;
+
+		if (!queue.requests.Contains(request)) {
+			// The request has been aborted and might already be gone.
+			if (!resourcesAvailable)
+				break;
+
+			request = _NextRequest(direction, fLastPosition);
+			continue;
+		}
+
+		off_t position = _Position(request);
+		bool queued = true;
+		if (request->RemainingBytes() == 0) {
+			_Dequeue(request);
+			queued = false;
+		}
+
+		if (!resourcesAvailable || (queued && usedBandwidth == 0))
+			break;
+
+		fLastPosition = position;
+
+		IORequest* next = _NextRequest(direction, position);
+		if (next == request)
+			break;
+		if (next != NULL && _Position(next) == position)
+			queue.merged_requests++;
+
+		request = next;
+	}
+}
+
+
+bool
+IOSchedulerDeadline::_PrepareRequestOperations(IORequest* request,
+	IOOperationList& operations, int32& operationsPrepared, off_t quantum,
+	off_t& usedBandwidth)
+{
+	usedBandwidth = 0;
+
+	if (fDMAResource != NULL) {
+		while (quantum >= (off_t)fBlockSize && request->RemainingBytes() > 0) {
+			IOOperation* operation = fUnusedOperations.RemoveHead();
+			if (operation == NULL)
+				return false;
+
+			status_t status = fDMAResource->TranslateNext(request, operation,
+				quantum);
+			if (status != B_OK) {
+				operation->SetParent(NULL);
+				fUnusedOperations.Add(operation);
+
+				// B_BUSY means some resource (DMABuffers or
+				// DMABounceBuffers) was temporarily unavailable. That's OK,
+				// we'll retry later.
+				if (status == B_BUSY)
+					return false;
+
+				_AbortRequest(request, status, operations);
+				return true;
+			}
+
+			off_t bandwidth = operation->Length();
+			quantum -= bandwidth;
+			usedBandwidth += bandwidth;
+
+			operations.Add(operation);
+			operationsPrepared++;
+		}
+	} else {
+		// TODO: If the device has block size restrictions, we might need to use
+		// a bounce buffer.
+		IOOperation* operation = fUnusedOperations.RemoveHead();
+		if (operation == NULL)
+			return false;
+
+		status_t status = operation->Prepare(request);
+		if (status != B_OK) {
+			operation->SetParent(NULL);
+			fUnusedOperations.Add(operation);
+			_AbortRequest(request, status, operations);
+			return true;
+		}
+
+		operation->SetOriginalRange(request->Offset(), request->Length());
+		request->Advance(request->Length());
+
+		off_t bandwidth = operation->Length();
+		usedBandwidth += bandwidth;
+
+		operations.Add(operation);
+		operationsPrepared++;
+	}
+
+	return true;
+}
+
+
+/*!	Returns the queued request of the given direction that is closest to, but
+	not before the given position, skipping teams that have used up their
+	share of the current batch.
+*/
+IORequest*
+IOSchedulerDeadline::_NextRequest(int32 direction, off_t position)
+{
+	RequestQueue& queue = fQueues[direction];
+
+	IORequest* next = NULL;
+	off_t nextPosition = 0;
+
+	for (IORequestList::Iterator it = queue.requests.GetIterator();
+			IORequest* request = it.Next();) {
+		off_t requestPosition = _Position(request);
+		if (requestPosition < position
+			|| (next != NULL && requestPosition >= nextPosition)) {
+			continue;
+		}
+
+		TeamAccount* account = static_cast<TeamAccount*>(request->Owner());
+		if (account->batch_generation == fBatchGeneration
+			&& account->batch_bandwidth + (off_t)fBlockSize > fTeamBandwidth
+			&& account->queued[direction] < queue.count) {
+			continue;
+		}
+
+		next = request;
+		nextPosition = requestPosition;
+	}
+
+	return next;
+}
+
+
+void
+IOSchedulerDeadline::_Dequeue(IORequest* request)
+{
+	int32 direction = _Direction(request);
+	RequestQueue& queue = fQueues[direction];
+	queue.requests.Remove(request);
+	queue.count--;
+
+	TeamAccount* account = static_cast<TeamAccount*>(request->Owner());
+	account->queued[direction]--;
+}
+
+
+/*!	Removes a request that cannot be processed any further from its queue.
+	If none of its operations are pending, the request is finished right away,
+	otherwise as soon as they are done.
+	Called with \c fLock held.
+*/
+void
+IOSchedulerDeadline::_AbortRequest(IORequest* request, status_t status,
+	const IOOperationList& operations)
+{
+	if (fQueues[_Direction(request)].requests.Contains(request))
+		_Dequeue(request);
+
+	// Since all operations of the previous batch have finished before a new
+	// one is prepared, only those of the current batch can still be pending.
+	bool operationsPending = false;
+	for (IOOperationList::ConstIterator it = operations.GetIterator();
+			IOOperation* operation = it.Next();) {
+		if (operation->Parent() == request) {
+			operationsPending = true;
+			break;
+		}
+	}
+
+	if (operationsPending) {
+		fAbortedRequests.Add(request);
+		return;
+	}
+
+	_RequestFinished(request);
+
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED, this,
+		request);
+	request->SetStatusAndNotify(status);
+}
+
+
+/*!	Updates the statistics of the request's team.
+	Called with \c fLock held.
+*/
+void
+IOSchedulerDeadline::_RequestFinished(IORequest* request)
+{
+	TeamAccount* account = static_cast<TeamAccount*>(request->Owner());
+	int32 direction = _Direction(request);
+
+	bigtime_t latency = system_time() - request->ScheduledTime();
+	account->requests[direction]++;
+	account->bytes[direction] += request->TransferredBytes();
+	account->total_latency[direction] += latency;
+	account->max_latency[direction] = std::max(account->max_latency[direction],
+		latency);
+
+	if (--account->pending == 0 && account != fSharedAccount)
+		fIdleAccounts.Add(account);
+
+	request->SetOwner(NULL);
+}
+
+
+status_t
+IOSchedulerDeadline::_Scheduler()
+{
+	while (!fTerminating) {
+		MutexLocker locker(fLock);
+
+		if (!_WaitForWork()) {
+			// we've been asked to terminate
+			return B_OK;
+		}
+
+		IOOperationList operations;
+		int32 operationCount = 0;
+
+		// Operations that need another pass (e.g. the read phase of a partial
+		// block write) are continued first.
+		while (IOOperation* operation = fUnfinishedOperations.RemoveHead()) {
+			operations.Add(operation);
+			operationCount++;
+		}
+
+		_PrepareBatch(operations, operationCount);
+
+		if (operations.IsEmpty())
+			continue;
+
+		fPendingOperations = operationCount;
+
+		locker.Unlock();
+
+		// execute the operations -- the batch is already in elevator order
+#ifdef TRACE_IO_SCHEDULER
+		int32 i = 0;
+#endif
+		while (IOOperation* operation = operations.RemoveHead()) {
+			TRACE("IOSchedulerDeadline::_Scheduler(): calling callback for "
+				"operation %ld: %p\n", i++, operation);
+
+			IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_STARTED,
+				this, operation->Parent(), operation);
+
+			fIOCallback(fIOCallbackData, operation);
+
+			_Finisher();
+		}
+
+		// wait for all operations to finish
+		while (!fTerminating) {
+			locker.Lock();
+
+			if (fPendingOperations == 0)
+				break;
+
+			// Before waiting first check whether any finisher work has to be
+			// done.
+			InterruptsSpinLocker finisherLocker(fFinisherLock);
+			if (_FinisherWorkPending()) {
+				finisherLocker.Unlock();
+				locker.Unlock();
+				_Finisher();
+				continue;
+			}
+
+			// wait for finished operations
+			ConditionVariableEntry entry;
+			fFinishedOperationCondition.Add(&entry);
+
+			finisherLocker.Unlock();
+			locker.Unlock();
+
+			entry.Wait(B_CAN_INTERRUPT);
+			_Finisher();
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ status_t
+IOSchedulerDeadline::_SchedulerThread(void *_self)
+{
+	IOSchedulerDeadline *self = (IOSchedulerDeadline *)_self;
+	return self->_Scheduler();
+}
+
+
+status_t
+IOSchedulerDeadline::_RequestNotifier()
+{
+	while (true) {
+		MutexLocker locker(fLock);
+
+		// get a request
+		IORequest* request = fFinishedRequests.RemoveHead();
+
+		if (request == NULL) {
+			if (fTerminating)
+				return B_OK;
+
+			ConditionVariableEntry entry;
+			fFinishedRequestCondition.Add(&entry);
+
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		locker.Unlock();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED,
+			this, request);
+
+		// notify the request
+		request->NotifyFinished();
+	}
+
+	// never can get here
+	return B_OK;
+}
+
+
+/*static*/ status_t
+IOSchedulerDeadline::_RequestNotifierThread(void *_self)
+{
+	IOSchedulerDeadline *self = (IOSchedulerDeadline*)_self;
+	return self->_RequestNotifier();
+}
+
+
+/*!	Returns the account of the given team, recycling the one of the team that
+	has been idle the longest, if necessary.
+	Called with \c fLock held.
+*/
+IOSchedulerDeadline::TeamAccount*
+IOSchedulerDeadline::_GetTeamAccount(team_id team)
+{
+	IORequestOwner* owner = fTeamAccountTable->Lookup(team);
+	if (owner != NULL)
+		return static_cast<TeamAccount*>(owner);
+
+	TeamAccount* account = static_cast<TeamAccount*>(fIdleAccounts.Head());
+	if (account == NULL)
+		return fSharedAccount;
+
+	if (account->team >= 0)
+		fTeamAccountTable->RemoveUnchecked(account);
+
+	// keep it in the idle list, ScheduleRequest() takes care of that
+	account->Reset(team);
+	fTeamAccountTable->InsertUnchecked(account);
+
+	return account;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef IO_SCHEDULER_DEADLINE_H
+#define IO_SCHEDULER_DEADLINE_H
+
+
+#include <KernelExport.h>
+
+#include <condition_variable.h>
+#include <lock.h>
+#include <util/OpenHashTable.h>
+
+#include "dma_resources.h"
+#include "IOScheduler.h"
+
+
+class IOSchedulerDeadline : public IOScheduler {
+public:
+								IOSchedulerDeadline(DMAResource* resource);
+	virtual						~IOSchedulerDeadline();
+
+	virtual	status_t			Init(const char* name);
+
+	virtual	status_t			ScheduleRequest(IORequest* request);
+
+	virtual	void				AbortRequest(IORequest* request,
+									status_t status = B_CANCELED);
+	virtual	void				OperationCompleted(IOOperation* operation,
+									status_t status,
+									generic_size_t transferredBytes);
+									// called by the driver when the operation
+									// has been completed successfully or failed
+									// for some reason
+
+	virtual	void				Dump() const;
+
+private:
+			enum {
+				READ_QUEUE	= 0,
+				WRITE_QUEUE	= 1,
+				QUEUE_COUNT	= 2
+			};
+
+			struct TeamAccount;
+			struct TeamAccountHashDefinition;
+			struct TeamAccountHashTable;
+
+			typedef DoublyLinkedList<IORequestOwner> RequestOwnerList;
+
+			struct RequestQueue {
+				IORequestList	requests;
+									// in arrival, and thus deadline order
+				int32			count;
+				bigtime_t		expiry;
+				int64			dispatched_requests;
+				int64			dispatched_bytes;
+				int64			expired_batches;
+				int64			merged_requests;
+			};
+
+			void				_Finisher();
+			bool				_FinisherWorkPending();
+			bool				_WaitForWork();
+			void				_PrepareBatch(IOOperationList& operations,
+									int32& operationCount);
+			bool				_PrepareRequestOperations(IORequest* request,
+									IOOperationList& operations,
+									int32& operationsPrepared, off_t quantum,
+									off_t& usedBandwidth);
+			IORequest*			_NextRequest(int32 direction, off_t position);
+			void				_Dequeue(IORequest* request);
+			void				_AbortRequest(IORequest* request,
+									status_t status,
+									const IOOperationList& operations);
+			void				_RequestFinished(IORequest* request);
+			status_t			_Scheduler();
+	static	status_t			_SchedulerThread(void* self);
+			status_t			_RequestNotifier();
+	static	status_t			_RequestNotifierThread(void* self);
+
+			TeamAccount*		_GetTeamAccount(team_id team);
+
+	static	int32				_Direction(const IORequest* request)
+									{ return request->IsWrite()
+										? WRITE_QUEUE : READ_QUEUE; }
+	static	off_t				_Position(const IORequest* request)
+									{ return request->Offset()
+										+ (off_t)request->Length()
+										- (off_t)request->RemainingBytes(); }
+
+private:
+			spinlock			fFinisherLock;
+			mutex				fLock;
+			thread_id			fSchedulerThread;
+			thread_id			fRequestNotifierThread;
+			RequestQueue		fQueues[QUEUE_COUNT];
+			IORequestList		fAbortedRequests;
+			IORequestList		fFinishedRequests;
+			ConditionVariable	fNewRequestCondition;
+			ConditionVariable	fFinishedOperationCondition;
+			ConditionVariable	fFinishedRequestCondition;
+			IOOperationList		fUnusedOperations;
+			IOOperationList		fUnfinishedOperations;
+			IOOperationList		fCompletedOperations;
+			TeamAccount*		fTeamAccounts;
+			TeamAccount*		fSharedAccount;
+			RequestOwnerList	fIdleAccounts;
+			TeamAccountHashTable* fTeamAccountTable;
+			generic_size_t		fBlockSize;
+			int32				fPendingOperations;
+			off_t				fBatchBandwidth;
+			off_t				fTeamBandwidth;
+			uint32				fBatchGeneration;
+			int32				fLastDirection;
+			off_t				fLastPosition;
+			int32				fWritesStarved;
+	volatile bool				fTerminating;
+};
+
+
+#endif	// IO_SCHEDULER_DEADLINE_H
@@ -6,8 +6,16 @@
 
 #include "IOSchedulerRoster.h"
 
+#include <string.h>
+
+#include <new>
+
+#include <driver_settings.h>
 #include <util/AutoLock.h>
 
+#include "IOSchedulerDeadline.h"
+#include "IOSchedulerSimple.h"
+
 
 /*static*/ IOSchedulerRoster IOSchedulerRoster::sDefaultInstance;
 
@@ -19,6 +27,96 @@ IOSchedulerRoster::Init()
 }
 
 
+/*!	Reads the "io_scheduler" driver settings file. Sets \a _deadline to
+	whether a deadline scheduler is configured for \a device, and returns
+	whether there is an entry for \a device itself, as opposed to the default
+	for all devices.
+*/
+static bool
+get_scheduler_settings(const char* device, bool& _deadline)
+{
+	_deadline = false;
+
+	void* handle = load_driver_settings("io_scheduler");
+	if (handle == NULL)
+		return false;
+
+	const char* type = get_driver_parameter(handle, "default", NULL, NULL);
+	bool deviceEntry = false;
+
+	const driver_settings* settings = get_driver_settings(handle);
+	for (int32 i = 0; device != NULL && settings != NULL
+			&& i < settings->parameter_count; i++) {
+		const driver_parameter& parameter = settings->parameters[i];
+		if (strcmp(parameter.name, "device") == 0
+			&& parameter.value_count == 2
+			&& strcmp(parameter.values[0], device) == 0) {
+			type = parameter.values[1];
+			deviceEntry = true;
+		}
+	}
+
+	if (type != NULL) {
+		if (strcmp(type, "deadline") == 0)
+			_deadline = true;
+		else if (strcmp(type, "simple") != 0) {
+			dprintf("I/O scheduler \"%s\": unknown type \"%s\", using "
+				"\"simple\"\n", device != NULL ? device : "default", type);
+		}
+	}
+
+	unload_driver_settings(handle);
+	return deviceEntry;
+}
+
+
+/*!	Creates and initializes an I/O scheduler for a device.
+
+	The kind of scheduler can be chosen in the "io_scheduler" driver settings
+	file, for all devices via "default <type>", or for single devices via
+	"device <path> <type>", where \a path is compared with \a device, the
+	path of the device relative to /dev, e.g. "disk/scsi/0/0/0/raw".
+	\a device may be \c NULL, if the device has no such path. Supported
+	types are "simple" (the default) and "deadline".
+*/
+status_t
+IOSchedulerRoster::CreateScheduler(DMAResource* resource, const char* name,
+	const char* device, IOScheduler*& _scheduler)
+{
+	bool deadline;
+	get_scheduler_settings(device, deadline);
+
+	IOScheduler* scheduler;
+	if (deadline)
+		scheduler = new(std::nothrow) IOSchedulerDeadline(resource);
+	else
+		scheduler = new(std::nothrow) IOSchedulerSimple(resource);
+	if (scheduler == NULL)
+		return B_NO_MEMORY;
+
+	status_t error = scheduler->Init(name);
+	if (error != B_OK) {
+		delete scheduler;
+		return error;
+	}
+
+	_scheduler = scheduler;
+	return B_OK;
+}
+
+
+/*!	Returns whether the "io_scheduler" driver settings file has an entry for
+	\a device (see CreateScheduler()). Devices that don't need a scheduler
+	can use this to only create one on request.
+*/
+bool
+IOSchedulerRoster::HasDeviceSettings(const char* device)
+{
+	bool deadline;
+	return get_scheduler_settings(device, deadline);
+}
+
+
 void
 IOSchedulerRoster::AddScheduler(IOScheduler* scheduler)
 {
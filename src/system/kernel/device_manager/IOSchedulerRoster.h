@@ -38,6 +38,11 @@ public:
 									// caller must keep the roster locked,
 									// while accessing the list
 
+			status_t			CreateScheduler(DMAResource* resource,
+									const char* name, const char* device,
+									IOScheduler*& _scheduler);
+			bool				HasDeviceSettings(const char* device);
+
 			void				AddScheduler(IOScheduler* scheduler);
 			void				RemoveScheduler(IOScheduler* scheduler);
 
@@ -2060,7 +2060,7 @@ devfs_publish_file_device(const char* path, const char* filePath)
 		return B_NO_MEMORY;
 	ObjectDeleter<FileDevice> deviceDeleter(device);
 
-	status_t error = device->Init(filePath);
+	status_t error = device->Init(filePath, path);
 	if (error != B_OK)
 		return error;
 
@@ -0,0 +1,766 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <event_queue.h>
+
+#include <fcntl.h>
+#include <new>
+
+#include <OS.h>
+
+#include <AutoDeleter.h>
+#include <Referenceable.h>
+#include <StackOrHeapArray.h>
+
+#include <condition_variable.h>
+#include <fs/fd.h>
+#include <lock.h>
+#include <syscall_restart.h>
+#include <team.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+#include <wait_for_objects.h>
+
+
+//#define TRACE_EVENT_QUEUE
+#ifdef TRACE_EVENT_QUEUE
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+// the events that are always reported
+static const uint16 kAlwaysSelectedEvents
+	= B_EVENT_INVALID | B_EVENT_ERROR | B_EVENT_DISCONNECTED;
+
+static const int32 kBehaviorFlags = B_EVENT_EDGE_TRIGGERED | B_EVENT_ONE_SHOT;
+
+// upper bound for the number of infos per syscall, to keep the kernel buffers
+// bounded
+static const int kMaxEventInfos = 32768;
+
+
+struct select_event_key {
+	int32	object;
+	uint16	type;
+};
+
+
+class EventQueue;
+
+
+/*!	An object selected by an event queue.
+
+	The event is its own select_sync, so that the objects it is attached to
+	can hold references to it, like they do to the syncs of
+	wait_for_objects(). The queue's table holds another one. The event is
+	thus only deleted once neither the queue nor any object can still
+	access it, no matter which side lets go of it first.
+*/
+struct select_event : select_info, select_sync,
+	DoublyLinkedListLinkImpl<select_event> {
+								select_event(EventQueue* queue);
+	virtual						~select_event();
+
+	virtual	status_t			Notify(select_info* info, uint16 events);
+
+	EventQueue*		queue;
+
+	int32			object;
+	uint16			type;
+	uint16			requested_events;
+	int32			behavior;
+	void*			user_data;
+
+	bool			queued;
+		// in the queue's ready list, protected by the queue lock
+	bool			removed;
+		// no longer in the queue's table, must not be queued anymore;
+		// protected by the queue lock
+	int32			detached;
+		// not attached to the object (anymore), or the object is gone;
+		// accessed atomically
+
+	select_event*	hash_link;
+};
+
+
+struct SelectEventHashDefinition {
+	typedef select_event_key	KeyType;
+	typedef	select_event		ValueType;
+
+	size_t HashKey(const select_event_key& key) const
+	{
+		return (size_t)key.object ^ ((size_t)key.type << 24);
+	}
+
+	size_t Hash(select_event* value) const
+	{
+		select_event_key key = { value->object, value->type };
+		return HashKey(key);
+	}
+
+	bool Compare(const select_event_key& key, select_event* value) const
+	{
+		return value->object == key.object && value->type == key.type;
+	}
+
+	select_event*& GetLink(select_event* value) const
+	{
+		return value->hash_link;
+	}
+};
+
+
+typedef BOpenHashTable<SelectEventHashDefinition> SelectEventTable;
+typedef DoublyLinkedList<select_event> SelectEventList;
+
+
+/*!	A persistent set of selected objects.
+
+	Unlike the select_sync objects wait_for_objects(), select(), and poll()
+	use, an event queue stays attached to the objects between waits. Objects
+	notify it via Notify(), which puts the object's event into the ready list
+	and wakes up a waiter. Waiting is thus O(number of ready objects) instead
+	of O(number of selected objects).
+
+	Locking: fLock (a mutex) serializes changing the set of selected objects,
+	fQueueLock (a spinlock, since Notify() may be called with interrupts
+	disabled) protects the ready list. Objects that don't hold references to
+	the events (semaphores and ports) only notify them with fQueueLock held,
+	and an event is only deleted after the queue has acquired fQueueLock
+	once after removing it.
+
+	FDs are looked up in the I/O context of the team that created the queue,
+	so the queue can only be used by that team; a queue FD that is inherited
+	or passed to another team cannot select or wait.
+*/
+class EventQueue : public BReferenceable {
+public:
+								EventQueue(bool kernel);
+	virtual						~EventQueue();
+
+			status_t			Init();
+			void				Closed();
+
+			team_id				Team() const { return fTeam; }
+
+			status_t			Select(int32 object, uint16 type,
+									int32 events, void* userData);
+			ssize_t				Wait(event_wait_info* infos, int numInfos,
+									uint32 flags, bigtime_t timeout);
+
+			void				Notify(select_event* event, uint16 events);
+
+private:
+			status_t			_SelectEvent(select_event* event);
+			void				_DeselectEvent(select_event* event);
+			void				_Dequeue(select_event* event, bool remove);
+			void				_DeleteEvent(select_event* event);
+			void				_EventDelivered(const event_wait_info& info);
+
+private:
+			mutex				fLock;
+			SelectEventTable	fEvents;
+
+			spinlock			fQueueLock;
+			SelectEventList		fQueue;
+			ConditionVariable	fQueueCondition;
+
+			team_id				fTeam;
+			bool				fKernel;
+			bool				fClosing;
+};
+
+
+select_event::select_event(EventQueue* queue)
+	:
+	queue(queue),
+	queued(false),
+	removed(false),
+	detached(1)
+{
+	next = NULL;
+	sync = this;
+	queue->AcquireReference();
+}
+
+
+select_event::~select_event()
+{
+	queue->ReleaseReference();
+}
+
+
+status_t
+select_event::Notify(select_info* info, uint16 events)
+{
+	queue->Notify(this, events);
+	return B_OK;
+}
+
+
+//	#pragma mark -
+
+
+EventQueue::EventQueue(bool kernel)
+	:
+	fTeam(kernel ? team_get_kernel_team_id() : team_get_current_team_id()),
+	fKernel(kernel),
+	fClosing(false)
+{
+	mutex_init(&fLock, "event queue");
+	B_INITIALIZE_SPINLOCK(&fQueueLock);
+	fQueueCondition.Init(this, "event queue");
+}
+
+
+EventQueue::~EventQueue()
+{
+	// Every event holds a reference to the queue, so the table is empty.
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+EventQueue::Init()
+{
+	return fEvents.Init();
+}
+
+
+/*!	Called when the queue's file descriptor is closed.
+
+	Semaphores, ports, and threads are deselected right away. Deselecting FDs
+	requires the I/O context's lock, which might be held already when the
+	queue is closed as part of the team's I/O context being destroyed. Those
+	are only removed from the table; the FDs release their references to the
+	events, and thus to the queue, when they are closed.
+*/
+void
+EventQueue::Closed()
+{
+	MutexLocker locker(fLock);
+
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	fClosing = true;
+	while (select_event* event = fQueue.RemoveHead())
+		event->queued = false;
+	fQueueCondition.NotifyAll(B_FILE_ERROR);
+	queueLocker.Unlock();
+
+	SelectEventTable::Iterator it = fEvents.GetIterator();
+	while (select_event* event = it.Next()) {
+		fEvents.RemoveUnchecked(event);
+
+		if (event->type != B_OBJECT_TYPE_FD)
+			_DeselectEvent(event);
+		_DeleteEvent(event);
+	}
+}
+
+
+/*!	Selects, reselects with new events, or -- if \a events is 0 -- deselects
+	the given object.
+*/
+status_t
+EventQueue::Select(int32 object, uint16 type, int32 events, void* userData)
+{
+	MutexLocker locker(fLock);
+	if (fClosing)
+		return B_FILE_ERROR;
+
+	select_event_key key = { object, type };
+	select_event* event = fEvents.Lookup(key);
+
+	if (event != NULL) {
+		fEvents.RemoveUnchecked(event);
+		_DeselectEvent(event);
+
+		if ((events & ~kBehaviorFlags) == 0) {
+			_DeleteEvent(event);
+			return B_OK;
+		}
+
+		// The object might still be about to notify the event, if it has
+		// been closed or deleted concurrently; it must not be reused then.
+		if (atomic_get(&event->ref_count) > 1) {
+			_DeleteEvent(event);
+			event = NULL;
+		}
+	} else if ((events & ~kBehaviorFlags) == 0)
+		return B_ENTRY_NOT_FOUND;
+
+	if (event == NULL) {
+		event = new(std::nothrow) select_event(this);
+		if (event == NULL)
+			return B_NO_MEMORY;
+
+		event->object = object;
+		event->type = type;
+	}
+
+	event->requested_events = (uint16)events;
+	event->behavior = events & kBehaviorFlags;
+	event->user_data = userData;
+	fEvents.Insert(event);
+
+	status_t status = _SelectEvent(event);
+	if (status != B_OK) {
+		fEvents.RemoveUnchecked(event);
+		_DeleteEvent(event);
+	}
+
+	return status;
+}
+
+
+ssize_t
+EventQueue::Wait(event_wait_info* infos, int numInfos, uint32 flags,
+	bigtime_t timeout)
+{
+	InterruptsSpinLocker queueLocker(fQueueLock);
+
+	ssize_t count = 0;
+	while (count == 0) {
+		while (fQueue.IsEmpty()) {
+			if (fClosing)
+				return B_FILE_ERROR;
+
+			if ((flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT)) != 0
+				&& timeout <= 0) {
+				return B_WOULD_BLOCK;
+			}
+
+			status_t status = fQueueCondition.Wait(&fQueueLock,
+				flags | B_CAN_INTERRUPT, timeout);
+			if (status != B_OK)
+				return status;
+		}
+
+		while (count < numInfos) {
+			select_event* event = fQueue.RemoveHead();
+			if (event == NULL)
+				break;
+			event->queued = false;
+
+			int32 events = atomic_get_and_set(&event->events, 0)
+				& event->selected_events;
+			if (events == 0)
+				continue;
+
+			infos[count].object = event->object;
+			infos[count].type = event->type;
+			infos[count].events = events;
+			infos[count].user_data = event->user_data;
+			count++;
+		}
+	}
+
+	queueLocker.Unlock();
+
+	// Level-triggered events are reselected, so that they are reported
+	// again as long as the condition holds; one-shot and invalid events are
+	// removed.
+	MutexLocker locker(fLock);
+	for (ssize_t i = 0; i < count; i++)
+		_EventDelivered(infos[i]);
+
+	return count;
+}
+
+
+/*!	Called by \a event when its object has changed. Everything is done with
+	fQueueLock held, as objects that don't hold a reference to the event
+	could otherwise have it deleted while this is still running.
+*/
+void
+EventQueue::Notify(select_event* event, uint16 events)
+{
+	InterruptsSpinLocker queueLocker(fQueueLock);
+
+	atomic_or(&event->events, events);
+
+	if ((events & B_EVENT_INVALID) != 0)
+		atomic_set(&event->detached, 1);
+
+	if ((event->selected_events & events) == 0 || fClosing || event->queued
+		|| event->removed) {
+		return;
+	}
+
+	event->queued = true;
+	fQueue.Add(event);
+	fQueueCondition.NotifyOne();
+}
+
+
+/*!	Attaches \a event to its object. fLock must be held. */
+status_t
+EventQueue::_SelectEvent(select_event* event)
+{
+	event->next = NULL;
+	event->events = 0;
+	event->selected_events = event->requested_events | kAlwaysSelectedEvents;
+	atomic_set(&event->detached, 0);
+
+	status_t status = select_object(event->type, event->object, event,
+		fKernel);
+	if (status != B_OK)
+		atomic_set(&event->detached, 1);
+
+	return status;
+}
+
+
+/*!	Detaches \a event from its object and removes it from the ready list.
+	If the object has been closed or deleted in the meantime, it might still
+	hold a reference to the event, though.
+	fLock must be held.
+*/
+void
+EventQueue::_DeselectEvent(select_event* event)
+{
+	if (atomic_get_and_set(&event->detached, 1) == 0)
+		deselect_object(event->type, event->object, event, fKernel);
+
+	_Dequeue(event, false);
+}
+
+
+void
+EventQueue::_Dequeue(select_event* event, bool remove)
+{
+	InterruptsSpinLocker queueLocker(fQueueLock);
+	if (event->queued) {
+		fQueue.Remove(event);
+		event->queued = false;
+	}
+	if (remove)
+		event->removed = true;
+}
+
+
+/*!	Releases the reference of the table to \a event, which must have been
+	removed from it already. fLock must be held.
+*/
+void
+EventQueue::_DeleteEvent(select_event* event)
+{
+	_Dequeue(event, true);
+	put_select_sync(event);
+}
+
+
+/*!	Applies the event's behavior after it has been reported as \a info.
+	fLock must be held.
+*/
+void
+EventQueue::_EventDelivered(const event_wait_info& info)
+{
+	select_event_key key = { info.object, info.type };
+	select_event* event = fEvents.Lookup(key);
+	if (event == NULL)
+		return;
+
+	if (atomic_get(&event->detached) != 0
+		|| (info.events & B_EVENT_INVALID) != 0
+		|| (event->behavior & B_EVENT_ONE_SHOT) != 0) {
+		fEvents.RemoveUnchecked(event);
+		_DeselectEvent(event);
+		_DeleteEvent(event);
+		return;
+	}
+
+	if ((event->behavior & B_EVENT_EDGE_TRIGGERED) != 0)
+		return;
+
+	// Reselecting makes the object check its state and notify us right away,
+	// if the condition still holds. If the object still references the
+	// event after deselecting it, it is going away, and will notify it a
+	// last time.
+	_DeselectEvent(event);
+	if (atomic_get(&event->ref_count) > 1 || _SelectEvent(event) != B_OK) {
+		fEvents.RemoveUnchecked(event);
+		_DeleteEvent(event);
+	}
+}
+
+
+// #pragma mark - FD ops
+
+
+struct FDPutter {
+	FDPutter(file_descriptor* descriptor)
+		: descriptor(descriptor)
+	{
+	}
+
+	~FDPutter()
+	{
+		if (descriptor != NULL)
+			put_fd(descriptor);
+	}
+
+	file_descriptor*	descriptor;
+};
+
+
+static status_t
+event_queue_close(file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->Closed();
+	return B_OK;
+}
+
+
+static void
+event_queue_free(file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->ReleaseReference();
+}
+
+
+static struct fd_ops sEventQueueFDOps = {
+	NULL,	// fd_read
+	NULL,	// fd_write
+	NULL,	// fd_seek
+	NULL,	// fd_ioctl
+	NULL,	// fd_set_flags
+	NULL,	// fd_select
+	NULL,	// fd_deselect
+	NULL,	// fd_read_dir
+	NULL,	// fd_rewind_dir
+	NULL,	// fd_read_stat
+	NULL,	// fd_write_stat
+	&event_queue_close,
+	&event_queue_free
+};
+
+
+static status_t
+get_event_queue(int fd, bool kernel, file_descriptor*& descriptor,
+	EventQueue*& queue)
+{
+	descriptor = get_fd(get_current_io_context(kernel), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	if (descriptor->type != FDTYPE_EVENT_QUEUE) {
+		put_fd(descriptor);
+		return B_BAD_VALUE;
+	}
+
+	queue = (EventQueue*)descriptor->cookie;
+
+	// the queue's FDs refer to the I/O context of the team that created it
+	team_id team = kernel
+		? team_get_kernel_team_id() : team_get_current_team_id();
+	if (queue->Team() != team) {
+		put_fd(descriptor);
+		return B_NOT_ALLOWED;
+	}
+
+	return B_OK;
+}
+
+
+// #pragma mark - common implementation
+
+
+static int
+common_event_queue_create(int openFlags, bool kernel)
+{
+	if ((openFlags & ~O_CLOEXEC) != 0)
+		return B_BAD_VALUE;
+
+	EventQueue* queue = new(std::nothrow) EventQueue(kernel);
+	if (queue == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = queue->Init();
+	if (status != B_OK) {
+		queue->ReleaseReference();
+		return status;
+	}
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL) {
+		queue->ReleaseReference();
+		return B_NO_MEMORY;
+	}
+
+	descriptor->type = FDTYPE_EVENT_QUEUE;
+	descriptor->ops = &sEventQueueFDOps;
+	descriptor->cookie = queue;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(kernel);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		descriptor->ops = NULL;
+		put_fd(descriptor);
+		queue->ReleaseReference();
+		return fd;
+	}
+
+	mutex_lock(&context->io_mutex);
+	fd_set_close_on_exec(context, fd, (openFlags & O_CLOEXEC) != 0);
+	mutex_unlock(&context->io_mutex);
+
+	TRACE(("event_queue_create(): fd %d, queue %p\n", fd, queue));
+	return fd;
+}
+
+
+static status_t
+common_event_queue_select(int fd, event_wait_info* infos, int numInfos,
+	bool kernel)
+{
+	file_descriptor* descriptor;
+	EventQueue* queue;
+	status_t status = get_event_queue(fd, kernel, descriptor, queue);
+	if (status != B_OK)
+		return status;
+	FDPutter _(descriptor);
+
+	status_t result = B_OK;
+	for (int i = 0; i < numInfos; i++) {
+		status = queue->Select(infos[i].object, infos[i].type,
+			infos[i].events, infos[i].user_data);
+		if (status != B_OK) {
+			infos[i].events = B_EVENT_INVALID;
+			if (result == B_OK)
+				result = status;
+		} else
+			infos[i].events = 0;
+	}
+
+	return result;
+}
+
+
+static ssize_t
+common_event_queue_wait(int fd, event_wait_info* infos, int numInfos,
+	uint32 flags, bigtime_t timeout, bool kernel)
+{
+	if (numInfos <= 0)
+		return B_BAD_VALUE;
+
+	file_descriptor* descriptor;
+	EventQueue* queue;
+	status_t status = get_event_queue(fd, kernel, descriptor, queue);
+	if (status != B_OK)
+		return status;
+	FDPutter _(descriptor);
+
+	// convert relative timeouts, so that we can wait repeatedly
+	if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout != B_INFINITE_TIMEOUT
+		&& timeout > 0) {
+		flags = (flags & ~B_RELATIVE_TIMEOUT) | B_ABSOLUTE_TIMEOUT;
+		timeout += system_time();
+		if (timeout < 0)
+			timeout = B_INFINITE_TIMEOUT;
+	}
+
+	return queue->Wait(infos, numInfos, flags, timeout);
+}
+
+
+// #pragma mark - kernel private
+
+
+int
+_kern_event_queue_create(int openFlags)
+{
+	return common_event_queue_create(openFlags, true);
+}
+
+
+status_t
+_kern_event_queue_select(int queue, event_wait_info* infos, int numInfos)
+{
+	return common_event_queue_select(queue, infos, numInfos, true);
+}
+
+
+ssize_t
+_kern_event_queue_wait(int queue, event_wait_info* infos, int numInfos,
+	uint32 flags, bigtime_t timeout)
+{
+	return common_event_queue_wait(queue, infos, numInfos, flags, timeout,
+		true);
+}
+
+
+// #pragma mark - syscalls
+
+
+int
+_user_event_queue_create(int openFlags)
+{
+	return common_event_queue_create(openFlags, false);
+}
+
+
+status_t
+_user_event_queue_select(int queue, event_wait_info* userInfos, int numInfos)
+{
+	if (numInfos <= 0 || numInfos > kMaxEventInfos)
+		return B_BAD_VALUE;
+
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	BStackOrHeapArray<event_wait_info, 16> infos(numInfos);
+	if (!infos.IsValid())
+		return B_NO_MEMORY;
+	const size_t bytes = sizeof(event_wait_info) * numInfos;
+
+	if (user_memcpy(infos, userInfos, bytes) != B_OK)
+		return B_BAD_ADDRESS;
+
+	status_t result = common_event_queue_select(queue, infos, numInfos, false);
+
+	if (user_memcpy(userInfos, infos, bytes) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return result;
+}
+
+
+ssize_t
+_user_event_queue_wait(int queue, event_wait_info* userInfos, int numInfos,
+	uint32 flags, bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (numInfos <= 0 || numInfos > kMaxEventInfos)
+		return B_BAD_VALUE;
+
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	BStackOrHeapArray<event_wait_info, 16> infos(numInfos);
+	if (!infos.IsValid())
+		return B_NO_MEMORY;
+
+	ssize_t result = common_event_queue_wait(queue, infos, numInfos, flags,
+		timeout, false);
+
+	if (result > 0 && user_memcpy(userInfos, infos,
+			sizeof(event_wait_info) * result) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result < 0
+		? syscall_restart_handle_timeout_post(result, timeout) : result;
+}
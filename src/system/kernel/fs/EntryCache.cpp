@@ -7,12 +7,16 @@
 #include "EntryCache.h"
 
 #include <new>
+#include <smp.h>
 #include <vm/vm.h>
 
 
 static const int32 kEntryNotInArray = -1;
 static const int32 kEntryRemoved = -2;
 
+static const int32 kMaxShardCount = 16;
+static const int32 kMinShardEntriesSize = 256;
+
 
 // #pragma mark - EntryCacheGeneration
 
@@ -44,10 +48,10 @@ EntryCacheGeneration::Init(int32 entriesSize)
 }
 
 
-// #pragma mark - EntryCache
+// #pragma mark - EntryCacheShard
 
 
-EntryCache::EntryCache()
+EntryCacheShard::EntryCacheShard()
 	:
 	fGenerationCount(0),
 	fGenerations(NULL),
@@ -59,7 +63,7 @@ EntryCache::EntryCache()
 }
 
 
-EntryCache::~EntryCache()
+EntryCacheShard::~EntryCacheShard()
 {
 	// delete entries
 	EntryCacheEntry* entry = fEntries.Clear(true);
@@ -75,38 +79,30 @@ EntryCache::~EntryCache()
 
 
 status_t
-EntryCache::Init()
+EntryCacheShard::Init(int32 generationCount, int32 entriesSize)
 {
 	status_t error = fEntries.Init();
 	if (error != B_OK)
 		return error;
 
-	int32 entriesSize = 1024;
-	fGenerationCount = 8;
-
-	// TODO: Choose generation size/count more scientifically?
-	// TODO: Add low_resource handler hook?
-	if (vm_available_memory() >= (1024*1024*1024)) {
-		entriesSize = 8096;
-		fGenerationCount = 16;
-	}
+	fGenerations = new(std::nothrow) EntryCacheGeneration[generationCount];
+	if (fGenerations == NULL)
+		return B_NO_MEMORY;
 
-	fGenerations = new(std::nothrow) EntryCacheGeneration[fGenerationCount];
-	for (int32 i = 0; i < fGenerationCount; i++) {
+	for (int32 i = 0; i < generationCount; i++) {
 		error = fGenerations[i].Init(entriesSize);
 		if (error != B_OK)
 			return error;
 	}
 
+	fGenerationCount = generationCount;
 	return B_OK;
 }
 
 
 status_t
-EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
+EntryCacheShard::Add(const EntryCacheKey& key, ino_t nodeID, bool missing)
 {
-	EntryCacheKey key(dirID, name);
-
 	WriteLocker _(fLock);
 
 	if (fGenerationCount == 0)
@@ -125,16 +121,17 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 		return B_OK;
 	}
 
-	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
+	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry)
+		+ strlen(key.name));
 	if (entry == NULL)
 		return B_NO_MEMORY;
 
 	entry->node_id = nodeID;
-	entry->dir_id = dirID;
+	entry->dir_id = key.dir_id;
 	entry->missing = missing;
 	entry->generation = fCurrentGeneration;
 	entry->index = kEntryNotInArray;
-	strcpy(entry->name, name);
+	strcpy(entry->name, key.name);
 
 	fEntries.Insert(entry);
 
@@ -145,10 +142,8 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 
 
 status_t
-EntryCache::Remove(ino_t dirID, const char* name)
+EntryCacheShard::Remove(const EntryCacheKey& key)
 {
-	EntryCacheKey key(dirID, name);
-
 	WriteLocker writeLocker(fLock);
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
@@ -173,17 +168,23 @@ EntryCache::Remove(ino_t dirID, const char* name)
 
 
 bool
-EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
+EntryCacheShard::Lookup(const EntryCacheKey& key, ino_t& _nodeID,
 	bool& _missing)
 {
-	EntryCacheKey key(dirID, name);
-
 	ReadLocker readLocker(fLock);
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
 	if (entry == NULL)
 		return false;
 
+	if (entry->generation == fCurrentGeneration) {
+		// Fast path for hot entries: they are already in the current
+		// generation, so there is no need to write to them.
+		_nodeID = entry->node_id;
+		_missing = entry->missing;
+		return true;
+	}
+
 	const int32 oldGeneration = atomic_get_and_set(&entry->generation,
 		fCurrentGeneration);
 	if (oldGeneration == fCurrentGeneration || entry->index < 0) {
@@ -228,7 +229,7 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 
 
 const char*
-EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
+EntryCacheShard::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 {
 	for (EntryTable::Iterator it = fEntries.GetIterator();
 			EntryCacheEntry* entry = it.Next();) {
@@ -244,7 +245,7 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 
 
 void
-EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
+EntryCacheShard::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 {
 	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
 
@@ -276,3 +277,102 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 	entry->generation = newGeneration;
 	entry->index = 0;
 }
+
+
+// #pragma mark - EntryCache
+
+
+EntryCache::EntryCache()
+	:
+	fShards(NULL),
+	fShardShift(32)
+{
+}
+
+
+EntryCache::~EntryCache()
+{
+	delete[] fShards;
+}
+
+
+status_t
+EntryCache::Init()
+{
+	int32 entriesSize = 1024;
+	int32 generationCount = 8;
+
+	// TODO: Choose generation size/count more scientifically?
+	// TODO: Add low_resource handler hook?
+	if (vm_available_memory() >= (1024*1024*1024)) {
+		entriesSize = 8096;
+		generationCount = 16;
+	}
+
+	// Use about one shard per CPU, but keep the shards large enough for their
+	// LRU to remain useful.
+	int32 shardCount = 1;
+	int32 shardBits = 0;
+	while (shardCount < smp_get_num_cpus() && shardCount < kMaxShardCount
+		&& entriesSize / (shardCount * 2) >= kMinShardEntriesSize) {
+		shardCount *= 2;
+		shardBits++;
+	}
+
+	fShards = new(std::nothrow) EntryCacheShard[shardCount];
+	if (fShards == NULL)
+		return B_NO_MEMORY;
+
+	fShardShift = 32 - shardBits;
+
+	for (int32 i = 0; i < shardCount; i++) {
+		status_t error = fShards[i].Init(generationCount,
+			entriesSize / shardCount);
+		if (error != B_OK)
+			return error;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
+{
+	EntryCacheKey key(dirID, name);
+	return _ShardFor(key).Add(key, nodeID, missing);
+}
+
+
+status_t
+EntryCache::Remove(ino_t dirID, const char* name)
+{
+	EntryCacheKey key(dirID, name);
+	return _ShardFor(key).Remove(key);
+}
+
+
+bool
+EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
+	bool& _missing)
+{
+	EntryCacheKey key(dirID, name);
+	return _ShardFor(key).Lookup(key, _nodeID, _missing);
+}
+
+
+const char*
+EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
+{
+	if (fShards == NULL)
+		return NULL;
+
+	int32 shardCount = 1 << (32 - fShardShift);
+	for (int32 i = 0; i < shardCount; i++) {
+		const char* name = fShards[i].DebugReverseLookup(nodeID, _dirID);
+		if (name != NULL)
+			return name;
+	}
+
+	return NULL;
+}
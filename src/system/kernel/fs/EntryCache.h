@@ -8,6 +8,7 @@
 
 #include <stdlib.h>
 
+#include <arch/cpu.h>
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
 #include <util/OpenHashTable.h>
@@ -82,26 +83,31 @@ struct EntryCacheHashDefinition {
 };
 
 
-class EntryCache {
+/*!	A part of the entry cache with its own lock, hash table, and generations
+	(the latter implementing an approximated LRU). Entries are distributed
+	over the shards by their hash, so that lookups on different CPUs rarely
+	touch the same lock.
+*/
+class EntryCacheShard {
 public:
-								EntryCache();
-								~EntryCache();
+								EntryCacheShard();
+								~EntryCacheShard();
 
-			status_t			Init();
+			status_t			Init(int32 generationCount,
+									int32 entriesSize);
 
-			status_t			Add(ino_t dirID, const char* name,
-									ino_t nodeID, bool missing);
+			status_t			Add(const EntryCacheKey& key, ino_t nodeID,
+									bool missing);
 
-			status_t			Remove(ino_t dirID, const char* name);
+			status_t			Remove(const EntryCacheKey& key);
 
-			bool				Lookup(ino_t dirID, const char* name,
+			bool				Lookup(const EntryCacheKey& key,
 									ino_t& nodeID, bool& missing);
 
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
 private:
 			typedef BOpenHashTable<EntryCacheHashDefinition> EntryTable;
-			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
 
 private:
 			void				_AddEntryToCurrentGeneration(
@@ -113,7 +119,43 @@ private:
 			int32				fGenerationCount;
 			EntryCacheGeneration* fGenerations;
 			int32				fCurrentGeneration;
+} CACHE_LINE_ALIGN;
+
+
+class EntryCache {
+public:
+								EntryCache();
+								~EntryCache();
+
+			status_t			Init();
+
+			status_t			Add(ino_t dirID, const char* name,
+									ino_t nodeID, bool missing);
+
+			status_t			Remove(ino_t dirID, const char* name);
+
+			bool				Lookup(ino_t dirID, const char* name,
+									ino_t& nodeID, bool& missing);
+
+			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
+
+private:
+	inline	EntryCacheShard&	_ShardFor(const EntryCacheKey& key);
+
+private:
+			EntryCacheShard*	fShards;
+			uint32				fShardShift;
 };
 
 
+EntryCacheShard&
+EntryCache::_ShardFor(const EntryCacheKey& key)
+{
+	// Use the upper bits of a multiplicative hash, so that the entries within
+	// a shard are still spread over all buckets of its hash table.
+	return fShards[(uint64)(uint32)((uint32)key.hash * 0x9e3779b1)
+		>> fShardShift];
+}
+
+
 #endif	// ENTRY_CACHE_H
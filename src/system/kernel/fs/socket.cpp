@@ -641,6 +641,28 @@ common_get_next_socket_stat(int family, uint32 *cookie, struct net_stat *stat)
 }
 
 
+// #pragma mark - kernel private API
+
+
+/*!	Sends \a length bytes at \a data over the socket \a descriptor refers to
+	without copying them, see net_socket_module_info::send_external().
+	\return \c B_NOT_SUPPORTED, if \a descriptor isn't a socket, or if the
+		socket's protocol cannot refer to external data.
+*/
+ssize_t
+socket_send_external(struct file_descriptor* descriptor, const void* data,
+	size_t length, int flags, struct net_buffer_external* external)
+{
+	if (descriptor->type != FDTYPE_SOCKET
+		|| sStackInterface->send_external == NULL) {
+		return B_NOT_SUPPORTED;
+	}
+
+	return sStackInterface->send_external(descriptor->u.socket, data, length,
+		flags, external);
+}
+
+
 // #pragma mark - kernel sockets API
 
 
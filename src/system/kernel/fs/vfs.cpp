@@ -42,9 +42,11 @@
 #include <fd.h>
 #include <file_cache.h>
 #include <fs/node_monitor.h>
+#include <heap.h>
 #include <KPath.h>
 #include <lock.h>
 #include <low_resource_manager.h>
+#include <net_buffer.h>
 #include <slab/Slab.h>
 #include <StackOrHeapArray.h>
 #include <syscalls.h>
@@ -56,6 +58,7 @@
 #include <util/DoublyLinkedList.h>
 #include <vfs.h>
 #include <vm/vm.h>
+#include <vm/VMAddressSpace.h>
 #include <vm/VMCache.h>
 #include <wait_for_objects.h>
 
@@ -3663,6 +3666,14 @@ free_io_context(io_context* context)
 
 	for (i = 0; i < context->table_size; i++) {
 		if (struct file_descriptor* descriptor = context->fds[i]) {
+			// Detach what is still selected, so that persistent selectors
+			// (event queues) release their references.
+			if (context->select_infos[i] != NULL) {
+				deselect_select_infos(descriptor, context->select_infos[i],
+					true);
+				context->select_infos[i] = NULL;
+			}
+
 			close_fd(context, descriptor);
 			put_fd(descriptor);
 		}
@@ -6478,6 +6489,298 @@ common_preallocate(int fd, off_t offset, off_t length, bool kernel)
 }
 
 
+/*!	A part of a file mapped into the kernel address space, with its pages
+	wired, so that the file cache pages can be handed on without copying
+	them first.
+	When the data is sent over a socket, the network buffers keep references
+	to the window, and it is unmapped once the last one of them is gone.
+*/
+struct FileTransferWindow : DeferredDeletable, net_buffer_external {
+	FileTransferWindow()
+		:
+		fArea(-1),
+		fData(NULL),
+		fLength(0)
+	{
+		ref_count = 1;
+		free = &_Free;
+	}
+
+	~FileTransferWindow()
+	{
+		if (fData != NULL)
+			unlock_memory(fData, fLength, B_READ_DEVICE);
+		if (fArea >= 0)
+			delete_area(fArea);
+	}
+
+	status_t Map(int fd, off_t offset, size_t length)
+	{
+		off_t mapOffset = ROUNDDOWN(offset, B_PAGE_SIZE);
+		size_t pageOffset = offset - mapOffset;
+
+		void* address;
+		fArea = vm_map_file(VMAddressSpace::KernelID(), "file transfer window",
+			&address, B_ANY_KERNEL_ADDRESS, PAGE_ALIGN(pageOffset + length),
+			B_KERNEL_READ_AREA, REGION_NO_PRIVATE_MAP, false, fd, mapOffset);
+		if (fArea < 0)
+			return fArea;
+
+		uint8* data = (uint8*)address + pageOffset;
+		status_t status = lock_memory(data, length, B_READ_DEVICE);
+		if (status != B_OK)
+			return status;
+
+		fData = data;
+		fLength = length;
+		return B_OK;
+	}
+
+	const uint8* Data() const
+	{
+		return fData;
+	}
+
+	/*!	Releases the caller's reference. Unlike when the network stack
+		releases the last reference, the window is deleted right away.
+	*/
+	void ReleaseReference()
+	{
+		if (atomic_add(&ref_count, -1) == 1)
+			delete this;
+	}
+
+private:
+	static void _Free(net_buffer_external* external)
+	{
+		// We might be called with locks held.
+		deferred_delete(static_cast<FileTransferWindow*>(external));
+	}
+
+private:
+	area_id		fArea;
+	uint8*		fData;
+	size_t		fLength;
+};
+
+
+static const size_t kFileTransferWindowSize = 1024 * 1024;
+static const size_t kFileTransferBufferSize = 64 * 1024;
+
+
+/*!	Copies up to \a count bytes from \a input to \a output through a
+	kernel buffer. Used whenever the data can't be passed on directly.
+*/
+static ssize_t
+copy_file_data(struct file_descriptor* input, off_t inPos,
+	struct file_descriptor* output, off_t outPos, size_t count)
+{
+	size_t bufferSize = min_c(count, kFileTransferBufferSize);
+	void* buffer = malloc(bufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	size_t transferred = 0;
+	while (transferred < count) {
+		size_t length = min_c(count - transferred, bufferSize);
+		status_t status = input->ops->fd_read(input, inPos, buffer, &length);
+		if (status != B_OK || length == 0) {
+			if (transferred == 0 && status != B_OK)
+				return status;
+			break;
+		}
+
+		size_t written = length;
+		status = output->ops->fd_write(output, outPos, buffer, &written);
+		if (status != B_OK) {
+			if (transferred == 0)
+				return status;
+			break;
+		}
+
+		transferred += written;
+		inPos += written;
+		if (outPos >= 0)
+			outPos += written;
+
+		if (written < length)
+			break;
+	}
+
+	return transferred;
+}
+
+
+/*!	Transfers up to \a count bytes of the regular file \a vnode from
+	\a inPos to \a output.
+	The file is mapped into the kernel in windows of
+	\c kFileTransferWindowSize bytes, so that its cached pages can be sent
+	over a socket without being copied at all, or be written to another file
+	with a single copy. If that isn't possible, copy_file_data() is used.
+*/
+static ssize_t
+transfer_file_data(struct vnode* vnode, struct file_descriptor* input,
+	off_t inPos, struct file_descriptor* output, off_t outPos, size_t count)
+{
+	bool toSocket = output->type == FDTYPE_SOCKET;
+
+	// Map the file via a kernel FD of our own; only file systems using the
+	// file cache support that.
+	VMCache* cache;
+	int fd = -1;
+	if (vfs_get_vnode_cache(vnode, &cache, false) == B_OK) {
+		cache->ReleaseRef();
+
+		inc_vnode_ref_count(vnode);
+		fd = open_vnode(vnode, O_RDONLY, true);
+		if (fd < 0)
+			put_vnode(vnode);
+	}
+	if (fd < 0)
+		return copy_file_data(input, inPos, output, outPos, count);
+	FDCloser fdCloser(fd, true);
+
+	size_t transferred = 0;
+	while (transferred < count) {
+		size_t length = min_c(count - transferred,
+			kFileTransferWindowSize - inPos % B_PAGE_SIZE);
+
+		FileTransferWindow* window = new(std::nothrow) FileTransferWindow;
+		if (window == NULL) {
+			if (transferred > 0)
+				break;
+			return B_NO_MEMORY;
+		}
+
+		status_t status = window->Map(fd, inPos, length);
+		if (status != B_OK) {
+			window->ReleaseReference();
+			if (transferred > 0)
+				break;
+			return copy_file_data(input, inPos, output, outPos, count);
+		}
+
+		ssize_t written;
+		if (toSocket) {
+			written = socket_send_external(output, window->Data(), length, 0,
+				window);
+		} else {
+			size_t bytes = length;
+			status = output->ops->fd_write(output, outPos, window->Data(),
+				&bytes);
+			written = status == B_OK ? (ssize_t)bytes : status;
+		}
+
+		window->ReleaseReference();
+
+		if (written < 0) {
+			if (transferred > 0)
+				break;
+			if (written == B_NOT_SUPPORTED) {
+				// the socket can't refer to the mapped pages
+				return copy_file_data(input, inPos, output, outPos, count);
+			}
+			return written;
+		}
+
+		transferred += written;
+		inPos += written;
+		if (outPos >= 0)
+			outPos += written;
+
+		if ((size_t)written < length)
+			break;
+	}
+
+	return transferred;
+}
+
+
+/*!	Backend for sendfile() and copy_file_range(): transfers up to \a count
+	bytes from the regular file \a inFD refers to to \a outFD.
+	If \a _inOffset or \a _outOffset are given, they specify the file
+	position to use and are updated accordingly; the FD's position is left
+	alone in this case. Otherwise the FD's position is used and updated.
+	With \a filesOnly, \a outFD must refer to a regular file as well.
+*/
+static ssize_t
+common_transfer_file(int inFD, off_t* _inOffset, int outFD, off_t* _outOffset,
+	size_t count, bool filesOnly, bool kernel)
+{
+	struct vnode* vnode;
+	struct file_descriptor* input = get_fd_and_vnode(inFD, &vnode, kernel);
+	if (input == NULL)
+		return B_FILE_ERROR;
+	CObjectDeleter<struct file_descriptor, void, put_fd> inputPutter(input);
+
+	struct file_descriptor* output = get_fd(get_current_io_context(kernel),
+		outFD);
+	if (output == NULL)
+		return B_FILE_ERROR;
+	CObjectDeleter<struct file_descriptor, void, put_fd> outputPutter(output);
+
+	if ((input->open_mode & O_RWMASK) == O_WRONLY
+		|| (output->open_mode & O_RWMASK) == O_RDONLY) {
+		return B_FILE_ERROR;
+	}
+
+	if (!S_ISREG(vnode->Type()) || output->ops->fd_write == NULL)
+		return B_BAD_VALUE;
+
+	struct vnode* outputVnode = fd_vnode(output);
+	if (filesOnly && (outputVnode == NULL || !S_ISREG(outputVnode->Type())))
+		return B_BAD_VALUE;
+
+	off_t inPos = _inOffset != NULL ? *_inOffset : input->pos;
+	off_t outPos = -1;
+	if (_outOffset != NULL)
+		outPos = *_outOffset;
+	else if (output->ops->fd_seek != NULL)
+		outPos = output->pos;
+	if (inPos < 0 || (outputVnode != NULL && outPos < 0))
+		return B_BAD_VALUE;
+
+	// don't transfer beyond the end of the file
+	struct stat stat;
+	status_t status = vfs_stat_vnode(vnode, &stat);
+	if (status != B_OK)
+		return status;
+	if (inPos >= stat.st_size)
+		return 0;
+	if ((off_t)count > stat.st_size - inPos)
+		count = stat.st_size - inPos;
+	if (count > SSIZE_MAX)
+		count = SSIZE_MAX;
+
+	if (outputVnode == vnode && outPos < inPos + (off_t)count
+		&& inPos < outPos + (off_t)count) {
+		// overlapping ranges in the same file
+		return B_BAD_VALUE;
+	}
+
+	ssize_t transferred = transfer_file_data(vnode, input, inPos, output,
+		outPos, count);
+	if (transferred <= 0)
+		return transferred;
+
+	if (_inOffset != NULL)
+		*_inOffset = inPos + transferred;
+	else
+		input->pos = inPos + transferred;
+
+	if (_outOffset != NULL)
+		*_outOffset = outPos + transferred;
+	else if (output->ops->fd_seek != NULL) {
+		output->pos = (output->open_mode & O_APPEND) != 0
+			? output->ops->fd_seek(output, 0, SEEK_END)
+			: outPos + transferred;
+	}
+
+	return transferred;
+}
+
+
 static status_t
 common_read_link(int fd, char* path, char* buffer, size_t* _bufferSize,
 	bool kernel)
@@ -8483,6 +8786,26 @@ _kern_preallocate(int fd, off_t offset, off_t length)
 }
 
 
+ssize_t
+_kern_send_file(int outFD, int inFD, off_t* _offset, size_t count)
+{
+	return common_transfer_file(inFD, _offset, outFD, NULL, count, false,
+		true);
+}
+
+
+ssize_t
+_kern_copy_file_range(int inFD, off_t* _inOffset, int outFD,
+	off_t* _outOffset, size_t length, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	return common_transfer_file(inFD, _inOffset, outFD, _outOffset, length,
+		true, true);
+}
+
+
 status_t
 _kern_create_dir_entry_ref(dev_t device, ino_t inode, const char* name,
 	int perms)
@@ -9374,6 +9697,64 @@ _user_preallocate(int fd, off_t offset, off_t length)
 }
 
 
+ssize_t
+_user_send_file(int outFD, int inFD, off_t* userOffset, size_t count)
+{
+	off_t offset;
+	if (userOffset != NULL) {
+		if (!IS_USER_ADDRESS(userOffset)
+			|| user_memcpy(&offset, userOffset, sizeof(off_t)) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+	}
+
+	ssize_t transferred = common_transfer_file(inFD,
+		userOffset != NULL ? &offset : NULL, outFD, NULL, count, false, false);
+
+	if (transferred > 0 && userOffset != NULL
+		&& user_memcpy(userOffset, &offset, sizeof(off_t)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return transferred;
+}
+
+
+ssize_t
+_user_copy_file_range(int inFD, off_t* userInOffset, int outFD,
+	off_t* userOutOffset, size_t length, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	off_t inOffset;
+	off_t outOffset;
+	if ((userInOffset != NULL && (!IS_USER_ADDRESS(userInOffset)
+			|| user_memcpy(&inOffset, userInOffset, sizeof(off_t)) != B_OK))
+		|| (userOutOffset != NULL && (!IS_USER_ADDRESS(userOutOffset)
+			|| user_memcpy(&outOffset, userOutOffset, sizeof(off_t))
+				!= B_OK))) {
+		return B_BAD_ADDRESS;
+	}
+
+	ssize_t transferred = common_transfer_file(inFD,
+		userInOffset != NULL ? &inOffset : NULL, outFD,
+		userOutOffset != NULL ? &outOffset : NULL, length, true, false);
+
+	if (transferred > 0) {
+		if ((userInOffset != NULL
+				&& user_memcpy(userInOffset, &inOffset, sizeof(off_t)) != B_OK)
+			|| (userOutOffset != NULL
+				&& user_memcpy(userOutOffset, &outOffset, sizeof(off_t))
+					!= B_OK)) {
+			return B_BAD_ADDRESS;
+		}
+	}
+
+	return transferred;
+}
+
+
 status_t
 _user_create_dir_entry_ref(dev_t device, ino_t inode, const char* userName,
 	int perms)
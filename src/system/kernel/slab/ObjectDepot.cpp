@@ -42,9 +42,24 @@ public:
 struct depot_cpu_store {
 	DepotMagazine*	loaded;
 	DepotMagazine*	previous;
+	uint64			obtain_hits;
+	uint64			obtain_misses;
+	uint64			store_hits;
+	uint64			store_misses;
 };
 
 
+// The magazine capacity of a depot grows when the depot lock sees more than
+// one contended acquisition in kContentionRatio within a window of
+// kContentionWindow acquisitions, as suggested by Bonwick. Larger magazines
+// mean fewer trips to the depot. The capacity is reset whenever the depot
+// has to be emptied due to low memory.
+static const uint32 kContentionWindow = 1024;
+static const uint32 kContentionRatio = 16;
+static const size_t kMaxCapacityGrowth = 8;
+static const size_t kMaxMagazineCapacity = 256;
+
+
 RANGE_MARKER_FUNCTION_BEGIN(SlabObjectDepot)
 
 
@@ -102,13 +117,15 @@ DepotMagazine::ContainsObject(void* object) const
 static DepotMagazine*
 alloc_magazine(object_depot* depot, uint32 flags)
 {
+	// the capacity may grow concurrently, use a consistent value
+	size_t capacity = depot->magazine_capacity;
+
 	DepotMagazine* magazine = (DepotMagazine*)slab_internal_alloc(
-		sizeof(DepotMagazine) + depot->magazine_capacity * sizeof(void*),
-		flags);
+		sizeof(DepotMagazine) + capacity * sizeof(void*), flags);
 	if (magazine) {
 		magazine->next = NULL;
 		magazine->current_round = 0;
-		magazine->round_count = depot->magazine_capacity;
+		magazine->round_count = capacity;
 	}
 
 	return magazine;
@@ -131,12 +148,45 @@ empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
 }
 
 
+/*!	Acquires the depot's inner lock, and keeps track of how often it had to
+	wait for it. Grows the magazine capacity of the depot if it had to wait
+	too often.
+*/
+static void
+lock_depot(object_depot* depot)
+{
+	bool contended = !try_acquire_spinlock(&depot->inner_lock);
+	if (contended)
+		acquire_spinlock(&depot->inner_lock);
+
+	depot->lock_acquisitions++;
+	if (contended) {
+		depot->lock_contentions++;
+		depot->window_contentions++;
+	}
+
+	if (++depot->window_acquisitions < kContentionWindow)
+		return;
+
+	if (depot->window_contentions > kContentionWindow / kContentionRatio
+		&& depot->magazine_capacity < depot->max_capacity) {
+		depot->magazine_capacity = std::min(depot->magazine_capacity * 2,
+			depot->max_capacity);
+		depot->resizes++;
+	}
+
+	depot->window_acquisitions = 0;
+	depot->window_contentions = 0;
+}
+
+
 static bool
 exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 {
 	ASSERT(magazine->IsEmpty());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	if (depot->full == NULL)
 		return false;
@@ -156,7 +206,8 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 {
 	ASSERT(magazine == NULL || magazine->IsFull());
 
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	if (depot->empty == NULL)
 		return false;
@@ -180,7 +231,8 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 static void
 push_empty_magazine(object_depot* depot, DepotMagazine* magazine)
 {
-	SpinLocker _(depot->inner_lock);
+	lock_depot(depot);
+	SpinLocker _(depot->inner_lock, true);
 
 	_push(depot->empty, magazine);
 	depot->empty_count++;
@@ -207,6 +259,15 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	depot->full_count = depot->empty_count = 0;
 	depot->max_count = maxCount;
 	depot->magazine_capacity = capacity;
+	depot->initial_capacity = capacity;
+	depot->max_capacity = std::max(capacity,
+		std::min(capacity * kMaxCapacityGrowth, kMaxMagazineCapacity));
+
+	depot->window_acquisitions = 0;
+	depot->window_contentions = 0;
+	depot->lock_acquisitions = 0;
+	depot->lock_contentions = 0;
+	depot->resizes = 0;
 
 	rw_lock_init(&depot->outer_lock, "object depot");
 	B_INITIALIZE_SPINLOCK(&depot->inner_lock);
@@ -222,6 +283,10 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	for (int i = 0; i < cpuCount; i++) {
 		depot->stores[i].loaded = NULL;
 		depot->stores[i].previous = NULL;
+		depot->stores[i].obtain_hits = 0;
+		depot->stores[i].obtain_misses = 0;
+		depot->stores[i].store_hits = 0;
+		depot->stores[i].store_misses = 0;
 	}
 
 	depot->cookie = cookie;
@@ -257,19 +322,25 @@ object_depot_obtain(object_depot* depot)
 	// if it's not empty, or from the previous magazine if it's full
 	// and finally from the Slab if the magazine depot has no full magazines.
 
-	if (store->loaded == NULL)
+	if (store->loaded == NULL) {
+		store->obtain_misses++;
 		return NULL;
+	}
 
 	while (true) {
-		if (!store->loaded->IsEmpty())
+		if (!store->loaded->IsEmpty()) {
+			store->obtain_hits++;
 			return store->loaded->Pop();
+		}
 
 		if (store->previous
 			&& (store->previous->IsFull()
 				|| exchange_with_full(depot, store->previous))) {
 			std::swap(store->previous, store->loaded);
-		} else
+		} else {
+			store->obtain_misses++;
 			return NULL;
+		}
 	}
 }
 
@@ -288,20 +359,33 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 	// we return the object directly to the slab.
 
 	while (true) {
-		if (store->loaded != NULL && store->loaded->Push(object))
+		if (store->loaded != NULL && store->loaded->Push(object)) {
+			store->store_hits++;
 			return;
+		}
 
 		DepotMagazine* freeMagazine = NULL;
+		DepotMagazine* undersizedMagazine = NULL;
 		if ((store->previous != NULL && store->previous->IsEmpty())
 			|| exchange_with_empty(depot, store->previous, freeMagazine)) {
 			std::swap(store->loaded, store->previous);
 
-			if (freeMagazine != NULL) {
+			if (store->loaded->round_count < depot->magazine_capacity) {
+				// The magazine was allocated before the depot's magazine
+				// capacity grew -- replace it with a larger one.
+				undersizedMagazine = store->loaded;
+				store->loaded = NULL;
+			}
+
+			if (freeMagazine != NULL || undersizedMagazine != NULL) {
 				// Free the magazine that didn't have space in the list
 				interruptsLocker.Unlock();
 				readLocker.Unlock();
 
-				empty_magazine(depot, freeMagazine, flags);
+				if (freeMagazine != NULL)
+					empty_magazine(depot, freeMagazine, flags);
+				if (undersizedMagazine != NULL)
+					free_magazine(undersizedMagazine, flags);
 
 				readLocker.Lock();
 				interruptsLocker.Lock();
@@ -315,6 +399,10 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 
 			DepotMagazine* magazine = alloc_magazine(depot, flags);
 			if (magazine == NULL) {
+				interruptsLocker.Lock();
+				object_depot_cpu(depot)->store_misses++;
+				interruptsLocker.Unlock();
+
 				depot->return_object(depot, depot->cookie, object, flags);
 				return;
 			}
@@ -361,6 +449,14 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 	DepotMagazine* emptyMagazines = depot->empty;
 	depot->empty = NULL;
 
+	depot->full_count = depot->empty_count = 0;
+
+	// start over with the initial magazine size, the larger magazines
+	// hold on to too many objects when memory is getting low
+	depot->magazine_capacity = depot->initial_capacity;
+	depot->window_acquisitions = 0;
+	depot->window_contentions = 0;
+
 	writeLocker.Unlock();
 
 	// free all magazines
@@ -410,6 +506,35 @@ object_depot_contains_object(object_depot* depot, void* object)
 #endif // PARANOID_KERNEL_FREE
 
 
+/*!	Fills in the depot part of \a stats. The counters are read without
+	locking, as this is also used from the kernel debugger; they are only
+	meant to be informational anyway.
+*/
+void
+object_depot_get_stats(object_depot* depot, slab_depot_stats* stats)
+{
+	stats->magazine_capacity = depot->magazine_capacity;
+	stats->max_magazine_capacity = depot->max_capacity;
+	stats->obtain_hits = 0;
+	stats->obtain_misses = 0;
+	stats->store_hits = 0;
+	stats->store_misses = 0;
+
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		depot_cpu_store& store = depot->stores[i];
+		stats->obtain_hits += store.obtain_hits;
+		stats->obtain_misses += store.obtain_misses;
+		stats->store_hits += store.store_hits;
+		stats->store_misses += store.store_misses;
+	}
+
+	stats->lock_acquisitions = depot->lock_acquisitions;
+	stats->lock_contentions = depot->lock_contentions;
+	stats->resizes = depot->resizes;
+}
+
+
 // #pragma mark - private kernel API
 
 
@@ -419,14 +544,23 @@ dump_object_depot(object_depot* depot)
 	kprintf("  full:     %p, count %lu\n", depot->full, depot->full_count);
 	kprintf("  empty:    %p, count %lu\n", depot->empty, depot->empty_count);
 	kprintf("  max full: %lu\n", depot->max_count);
-	kprintf("  capacity: %lu\n", depot->magazine_capacity);
+	kprintf("  capacity: %lu (initial %lu, max %lu, %" B_PRIu64
+		" resizes)\n", depot->magazine_capacity, depot->initial_capacity,
+		depot->max_capacity, depot->resizes);
+	kprintf("  locked:   %" B_PRIu64 ", contended %" B_PRIu64 "\n",
+		depot->lock_acquisitions, depot->lock_contentions);
 	kprintf("  stores:\n");
 
 	int cpuCount = smp_get_num_cpus();
 
 	for (int i = 0; i < cpuCount; i++) {
-		kprintf("  [%d] loaded:   %p\n", i, depot->stores[i].loaded);
-		kprintf("      previous: %p\n", depot->stores[i].previous);
+		depot_cpu_store& store = depot->stores[i];
+		kprintf("  [%d] loaded:   %p\n", i, store.loaded);
+		kprintf("      previous: %p\n", store.previous);
+		kprintf("      obtain:   %" B_PRIu64 " hits, %" B_PRIu64 " misses\n",
+			store.obtain_hits, store.obtain_misses);
+		kprintf("      store:    %" B_PRIu64 " hits, %" B_PRIu64 " misses\n",
+			store.store_hits, store.store_misses);
 	}
 }
 
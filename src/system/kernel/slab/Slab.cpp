@@ -18,6 +18,7 @@
 
 #include <condition_variable.h>
 #include <elf.h>
+#include <generic_syscall.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
 #include <slab/ObjectDepot.h>
@@ -277,6 +278,40 @@ dump_slabs(int argc, char* argv[])
 }
 
 
+static int
+dump_depot_stats(int argc, char* argv[])
+{
+	if (argc > 1) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	kprintf("%*s %22s %5s %10s %10s %10s %10s %10s %8s\n",
+		B_PRINTF_POINTER_WIDTH + 2, "address", "name", "mag", "obt hits",
+		"obt misses", "str hits", "str misses", "locked", "contend");
+
+	ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+
+	while (it.HasNext()) {
+		ObjectCache* cache = it.Next();
+		if ((cache->flags & CACHE_NO_DEPOT) != 0)
+			continue;
+
+		object_depot& depot = cache->depot;
+		slab_depot_stats stats;
+		object_depot_get_stats(&depot, &stats);
+
+		kprintf("%p %22s %5" B_PRIu32 " %10" B_PRIu64 " %10" B_PRIu64 " %10"
+			B_PRIu64 " %10" B_PRIu64 " %10" B_PRIu64 " %8" B_PRIu64 "\n",
+			cache, cache->name, stats.magazine_capacity, stats.obtain_hits,
+			stats.obtain_misses, stats.store_hits, stats.store_misses,
+			stats.lock_acquisitions, stats.lock_contentions);
+	}
+
+	return 0;
+}
+
+
 static int
 dump_cache_info(int argc, char* argv[])
 {
@@ -1115,6 +1150,91 @@ object_cache_maintainer(void*)
 }
 
 
+static uint32
+depot_cache_count()
+{
+	uint32 count = 0;
+	ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+	while (ObjectCache* cache = it.Next()) {
+		if ((cache->flags & CACHE_NO_DEPOT) == 0)
+			count++;
+	}
+
+	return count;
+}
+
+
+static status_t
+slab_control(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	switch (function) {
+		case SLAB_GET_DEPOT_STATS:
+		{
+			slab_depot_stats_request request;
+			if (bufferSize != sizeof(request))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(&request, buffer, sizeof(request)) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			if (request.count > 0 && !IS_USER_ADDRESS(request.stats))
+				return B_BAD_ADDRESS;
+
+			// Collect the statistics into a kernel buffer first -- we must
+			// not touch userland memory, nor allocate memory, while holding
+			// the cache list lock.
+			MutexLocker locker(sObjectCacheListLock);
+			uint32 count = depot_cache_count();
+			locker.Unlock();
+
+			uint32 copyCount = std::min(count, request.count);
+			slab_depot_stats* stats = NULL;
+			if (copyCount > 0) {
+				stats = (slab_depot_stats*)malloc(
+					copyCount * sizeof(slab_depot_stats));
+				if (stats == NULL)
+					return B_NO_MEMORY;
+			}
+
+			locker.Lock();
+
+			uint32 index = 0;
+			ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+			while (index < copyCount) {
+				ObjectCache* cache = it.Next();
+				if (cache == NULL)
+					break;
+				if ((cache->flags & CACHE_NO_DEPOT) != 0)
+					continue;
+
+				slab_depot_stats& entry = stats[index++];
+				strlcpy(entry.name, cache->name, sizeof(entry.name));
+				entry.object_size = cache->object_size;
+				object_depot_get_stats(&cache->depot, &entry);
+			}
+
+			count = depot_cache_count();
+			locker.Unlock();
+
+			request.count = count;
+			status_t status = B_OK;
+			if (index > 0) {
+				status = user_memcpy(request.stats, stats,
+					index * sizeof(slab_depot_stats));
+			}
+			free(stats);
+
+			if (status == B_OK)
+				status = user_memcpy(buffer, &request, sizeof(request));
+			return status;
+		}
+	}
+
+	return B_BAD_VALUE;
+}
+
+
 // #pragma mark - public API
 
 
@@ -1354,6 +1474,13 @@ slab_init_post_area()
 		"dump contents of an object depot");
 	add_debugger_command("slab_magazine", dump_depot_magazine,
 		"dump contents of a depot magazine");
+	add_debugger_command_etc("slab_depot_stats", dump_depot_stats,
+		"list the magazine statistics of all object depots",
+		"\n"
+		"Lists the current magazine capacity, the magazine hits and misses\n"
+		"for allocations and frees, and how often the depot lock had to be\n"
+		"acquired, and was contended, for all object caches with a depot.\n",
+		0);
 #if SLAB_ALLOCATION_TRACKING_AVAILABLE
 	add_debugger_command_etc("allocations_per_caller",
 		&dump_allocations_per_caller,
@@ -1414,6 +1541,8 @@ slab_init_post_thread()
 	}
 
 	resume_thread(objectCacheResizer);
+
+	register_generic_syscall(SLAB_SYSCALLS, slab_control, 1, 0);
 }
 
 
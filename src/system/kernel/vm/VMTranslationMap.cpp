@@ -31,6 +31,34 @@ VMTranslationMap::~VMTranslationMap()
 }
 
 
+/*!	Returns the size of the large pages MapLargePage() can map, or \c 0, if
+	the translation map doesn't support large pages.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Maps LargePageSize() bytes of physically contiguous memory with a single
+	large page. Both addresses must be aligned to the large page size.
+
+	The mapping behaves like the respective number of pages mapped via Map(),
+	i.e. all other methods operating on single pages or ranges of pages must
+	work as well; they may split the large page into regular pages as needed.
+	The caller must have reserved the pages returned by MaxPagesNeededToMap()
+	for the range.
+*/
+status_t
+VMTranslationMap::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 status_t
 VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 	bool markPresent)
@@ -33,6 +33,7 @@
 #include <condition_variable.h>
 #include <console.h>
 #include <debug.h>
+#include <driver_settings.h>
 #include <file_cache.h>
 #include <fs/fd.h>
 #include <heap.h>
@@ -253,6 +254,21 @@ static off_t sNeededMemory;
 static mutex sAvailableMemoryLock = MUTEX_INITIALIZER("available memory lock");
 static uint32 sPageFaults;
 
+// large page policy, set via the "large_pages" kernel setting
+enum {
+	LARGE_PAGES_NEVER = 0,
+	LARGE_PAGES_AREA,		// only for areas with B_LARGE_PAGES_AREA set
+	LARGE_PAGES_ALWAYS		// for all eligible anonymous areas
+};
+
+static const bigtime_t kLargePageBackOffTime = 1000000;
+	// how long not to try allocating large pages after a failure
+
+static int32 sLargePagesPolicy = LARGE_PAGES_AREA;
+static bigtime_t sLargePagesBackOffUntil;
+static int32 sLargePagesMapped;
+static int32 sLargePagesFailed;
+
 static VMPhysicalPageMapper* sPhysicalPageMapper;
 
 #if DEBUG_CACHE_LIST
@@ -611,6 +627,153 @@ map_page(VMArea* area, vm_page* page, addr_t address, uint32 protection,
 }
 
 
+/*!	Tries to map the large page containing \a address into the area. This is
+	only done for anonymous memory the large page policy allows it for, and
+	only if none of the pages in the range exist yet.
+	The pages are allocated as a single physically contiguous run, are
+	inserted into the cache, and get a mapping object each as usual, so that
+	the rest of the VM can treat them like any other page. The translation map
+	transparently splits the large page when an operation affects only a part
+	of it.
+	The caller must have reserved the pages the translation map might need to
+	map a page at \a address. The address space and the area's cache must be
+	locked.
+	\return \c true, if the large page has been mapped.
+*/
+static bool
+map_large_page(VMArea* area, VMCache* cache, addr_t address,
+	uint32 protection, vm_page_reservation* reservation)
+{
+	int32 policy = sLargePagesPolicy;
+	if (policy == LARGE_PAGES_NEVER
+		|| (policy == LARGE_PAGES_AREA
+			&& (area->protection & B_LARGE_PAGES_AREA) == 0)) {
+		return false;
+	}
+
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	size_t largePageSize = map->LargePageSize();
+	if (largePageSize == 0)
+		return false;
+
+	// Only plain anonymous memory with a uniform protection qualifies. Areas
+	// that are shared copy-on-write, or have guard pages, don't.
+	if (area->cache_type != CACHE_TYPE_RAM || area->wiring != B_NO_LOCK
+		|| area->page_protections != NULL || cache != area->cache
+		|| cache->source != NULL || !cache->temporary
+		|| cache->GuardSize() != 0) {
+		return false;
+	}
+
+	addr_t base = ROUNDDOWN(address, largePageSize);
+	if (base < area->Base()
+		|| base + (largePageSize - 1) > area->Base() + (area->Size() - 1)) {
+		return false;
+	}
+
+	if (system_time() < sLargePagesBackOffUntil)
+		return false;
+
+	// The cache must already have committed the memory for all pages. This
+	// rules out overcommitting caches, which commit one page at a time.
+	page_num_t pageCount = largePageSize / B_PAGE_SIZE;
+	off_t cacheOffset = base - area->Base() + area->cache_offset;
+	if (cache->committed_size / B_PAGE_SIZE
+			< (off_t)(cache->page_count + pageCount)) {
+		return false;
+	}
+
+	// none of the pages must exist yet, neither in memory, nor swapped out
+	vm_page* page = cache->pages.FindClosest(cacheOffset >> PAGE_SHIFT, true,
+		true);
+	if (page != NULL && page->cache_offset < (cacheOffset >> PAGE_SHIFT)
+			+ pageCount) {
+		return false;
+	}
+	for (page_num_t i = 0; i < pageCount; i++) {
+		if (cache->HasPage(cacheOffset + i * B_PAGE_SIZE))
+			return false;
+	}
+
+	// allocate the mapping objects
+	bool isKernelSpace = area->address_space == VMAddressSpace::Kernel();
+	uint32 freeFlags = CACHE_DONT_WAIT_FOR_MEMORY
+		| (isKernelSpace ? CACHE_DONT_LOCK_KERNEL_SPACE : 0);
+
+	VMAreaMappings mappings;
+	for (page_num_t i = 0; i < pageCount; i++) {
+		vm_page_mapping* mapping = (vm_page_mapping*)object_cache_alloc(
+			gPageMappingsObjectCache, freeFlags);
+		if (mapping == NULL) {
+			while ((mapping = mappings.RemoveHead()) != NULL)
+				object_cache_free(gPageMappingsObjectCache, mapping, freeFlags);
+			return false;
+		}
+
+		mappings.Add(mapping);
+	}
+
+	// allocate the pages
+	physical_address_restrictions restrictions = {};
+	restrictions.alignment = largePageSize;
+	vm_page* firstPage = vm_page_try_allocate_page_run(
+		PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_CLEAR, pageCount, &restrictions,
+		isKernelSpace ? VM_PRIORITY_SYSTEM : VM_PRIORITY_USER);
+	if (firstPage == NULL) {
+		sLargePagesBackOffUntil = system_time() + kLargePageBackOffTime;
+		atomic_add(&sLargePagesFailed, 1);
+
+		while (vm_page_mapping* mapping = mappings.RemoveHead())
+			object_cache_free(gPageMappingsObjectCache, mapping, freeFlags);
+		return false;
+	}
+
+	phys_addr_t physicalAddress
+		= (phys_addr_t)firstPage->physical_page_number * B_PAGE_SIZE;
+
+	for (page_num_t i = 0; i < pageCount; i++) {
+		page = vm_lookup_page(firstPage->physical_page_number + i);
+		cache->InsertPage(page, cacheOffset + i * B_PAGE_SIZE);
+	}
+
+	map->Lock();
+
+	if (map->MapLargePage(base, physicalAddress, protection,
+			area->MemoryType(), reservation) != B_OK) {
+		map->Unlock();
+
+		for (page_num_t i = 0; i < pageCount; i++) {
+			page = vm_lookup_page(firstPage->physical_page_number + i);
+			cache->RemovePage(page);
+			vm_page_set_state(page, PAGE_STATE_FREE);
+		}
+		while (vm_page_mapping* mapping = mappings.RemoveHead())
+			object_cache_free(gPageMappingsObjectCache, mapping, freeFlags);
+		return false;
+	}
+
+	for (page_num_t i = 0; i < pageCount; i++) {
+		page = vm_lookup_page(firstPage->physical_page_number + i);
+
+		vm_page_mapping* mapping = mappings.RemoveHead();
+		mapping->page = page;
+		mapping->area = area;
+
+		page->mappings.Add(mapping);
+		area->mappings.Add(mapping);
+
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	atomic_add(&gMappedPagesCount, pageCount);
+
+	map->Unlock();
+
+	atomic_add(&sLargePagesMapped, 1);
+	return true;
+}
+
+
 /*!	If \a preserveModified is \c true, the caller must hold the lock of the
 	page's cache.
 */
@@ -2279,6 +2442,8 @@ _vm_map_file(team_id team, const char* name, void** _address,
 		// prefetch stuff, and also, probably don't trigger it at this place.
 		cache_prefetch_vnode(vnode, offset, min_c(size, 10LL * 1024 * 1024));
 			// prefetches at max 10 MB starting from "offset"
+		cache_node_read(vnode, offset, min_c(size, 10LL * 1024 * 1024));
+			// let the cache module know the range is going to be used
 	}
 
 	if (status != B_OK)
@@ -3764,6 +3929,37 @@ dump_available_memory(int argc, char** argv)
 }
 
 
+static int
+dump_large_pages(int argc, char** argv)
+{
+	if (argc > 2) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "never") == 0)
+			sLargePagesPolicy = LARGE_PAGES_NEVER;
+		else if (strcmp(argv[1], "area") == 0)
+			sLargePagesPolicy = LARGE_PAGES_AREA;
+		else if (strcmp(argv[1], "always") == 0)
+			sLargePagesPolicy = LARGE_PAGES_ALWAYS;
+		else {
+			print_debugger_command_usage(argv[0]);
+			return 0;
+		}
+	}
+
+	static const char* const kPolicies[] = { "never", "area", "always" };
+	kprintf("policy:    %s\n", kPolicies[sLargePagesPolicy]);
+	kprintf("page size: %" B_PRIuSIZE "\n",
+		VMAddressSpace::Kernel()->TranslationMap()->LargePageSize());
+	kprintf("mapped:    %" B_PRId32 "\n", sLargePagesMapped);
+	kprintf("failed:    %" B_PRId32 "\n", sLargePagesFailed);
+	return 0;
+}
+
+
 static int
 dump_mapping_info(int argc, char** argv)
 {
@@ -4448,6 +4644,14 @@ vm_init(kernel_args* args)
 #endif
 	add_debugger_command("avail", &dump_available_memory,
 		"Dump available memory");
+	add_debugger_command_etc("large_pages", &dump_large_pages,
+		"Print or set the large page policy",
+		"[ \"never\" | \"area\" | \"always\" ]\n"
+		"Prints the large page policy and statistics. If an argument is\n"
+		"given, the policy is changed: \"never\" disables large pages,\n"
+		"\"area\" uses them only for areas created with B_LARGE_PAGES_AREA,\n"
+		"and \"always\" uses them for all anonymous areas.\n",
+		0);
 	add_debugger_command("dl", &display_mem, "dump memory long words (64-bit)");
 	add_debugger_command("dw", &display_mem, "dump memory words (32-bit)");
 	add_debugger_command("ds", &display_mem, "dump memory shorts (16-bit)");
@@ -4513,6 +4717,21 @@ vm_init_post_thread(kernel_args* args)
 status_t
 vm_init_post_modules(kernel_args* args)
 {
+	if (void* handle = load_driver_settings("kernel")) {
+		const char* policy = get_driver_parameter(handle, "large_pages", NULL,
+			NULL);
+		if (policy != NULL) {
+			if (strcmp(policy, "never") == 0)
+				sLargePagesPolicy = LARGE_PAGES_NEVER;
+			else if (strcmp(policy, "always") == 0)
+				sLargePagesPolicy = LARGE_PAGES_ALWAYS;
+			else
+				sLargePagesPolicy = LARGE_PAGES_AREA;
+		}
+
+		unload_driver_settings(handle);
+	}
+
 	return arch_vm_init_post_modules(args);
 }
 
@@ -4945,6 +5164,14 @@ vm_soft_fault(VMAddressSpace* addressSpace, addr_t originalAddress,
 				break;
 		}
 
+		// For regular faults into anonymous memory we may be able to map a
+		// whole large page at once.
+		if (wirePage == NULL && map_large_page(area, context.topCache, address,
+				protection, &context.reservation)) {
+			status = B_OK;
+			break;
+		}
+
 		// The top most cache has no fault handler, so let's see if the cache or
 		// its sources already have the page we're searching for (we're going
 		// from top to bottom).
@@ -2079,8 +2079,13 @@ PageWriteWrapper::Done(status_t result)
 			// keep trying to write it over and over again. We keep
 			// non-temporary pages in the modified queue, though, so they don't
 			// get lost in the inactive queue.
-			dprintf("PageWriteWrapper: Failed to write page %p: %s\n", fPage,
-				strerror(result));
+			// B_WOULD_BLOCK is no I/O error: the file system could not write
+			// the page without waiting (for example on its journal), which the
+			// page writer must not do. The page is just tried again later.
+			if (result != B_WOULD_BLOCK) {
+				dprintf("PageWriteWrapper: Failed to write page %p: %s\n",
+					fPage, strerror(result));
+			}
 
 			fPage->modified = true;
 			if (!fCache->temporary)
@@ -3839,29 +3844,10 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 }
 
 
-/*! Allocate a physically contiguous range of pages.
-
-	\param flags Page allocation flags. Encodes the state the function shall
-		set the allocated pages to, whether the pages shall be marked busy
-		(VM_PAGE_ALLOC_BUSY), and whether the pages shall be cleared
-		(VM_PAGE_ALLOC_CLEAR).
-	\param length The number of contiguous pages to allocate.
-	\param restrictions Restrictions to the physical addresses of the page run
-		to allocate, including \c low_address, the first acceptable physical
-		address where the page run may start, \c high_address, the last
-		acceptable physical address where the page run may end (i.e. it must
-		hold \code runStartAddress + length <= high_address \endcode),
-		\c alignment, the alignment of the page run start address, and
-		\c boundary, multiples of which the page run must not cross.
-		Values set to \c 0 are ignored.
-	\param priority The page reservation priority (as passed to
-		vm_page_reserve_pages()).
-	\return The first page of the allocated page run on success; \c NULL
-		when the allocation failed.
-*/
-vm_page*
-vm_page_allocate_page_run(uint32 flags, page_num_t length,
-	const physical_address_restrictions* restrictions, int priority)
+static vm_page*
+allocate_page_run_etc(uint32 flags, page_num_t length,
+	const physical_address_restrictions* restrictions, int priority,
+	bool dontWait)
 {
 	// compute start and end page index
 	page_num_t requestedStart
@@ -3897,7 +3883,11 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	}
 
 	vm_page_reservation reservation;
-	vm_page_reserve_pages(&reservation, length, priority);
+	if (dontWait) {
+		if (!vm_page_try_reserve_pages(&reservation, length, priority))
+			return NULL;
+	} else
+		vm_page_reserve_pages(&reservation, length, priority);
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
 
@@ -3905,8 +3895,10 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	// consider cached pages. If there are only few free pages and many cached
 	// ones, the odds are that we won't find enough contiguous ones, so we skip
 	// the first iteration in this case.
+	// When we must not wait, we don't steal cached pages at all.
 	int32 freePages = sUnreservedFreePages;
-	int useCached = freePages > 0 && (page_num_t)freePages > 2 * length ? 0 : 1;
+	int useCached = dontWait
+		|| (freePages > 0 && (page_num_t)freePages > 2 * length) ? 0 : 1;
 
 	for (;;) {
 		if (alignmentMask != 0 || boundaryMask != 0) {
@@ -3926,7 +3918,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		}
 
 		if (start + length > end) {
-			if (useCached == 0) {
+			if (useCached == 0 && !dontWait) {
 				// The first iteration with free pages only was unsuccessful.
 				// Try again also considering cached pages.
 				useCached = 1;
@@ -3934,11 +3926,14 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				continue;
 			}
 
-			dprintf("vm_page_allocate_page_run(): Failed to allocate run of "
-				"length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
-				B_PRIuPHYSADDR ") in second iteration (align: %" B_PRIuPHYSADDR
-				" boundary: %" B_PRIuPHYSADDR ")!\n", length, requestedStart,
-				end, restrictions->alignment, restrictions->boundary);
+			if (!dontWait) {
+				dprintf("vm_page_allocate_page_run(): Failed to allocate run "
+					"of length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
+					B_PRIuPHYSADDR ") in second iteration (align: %"
+					B_PRIuPHYSADDR " boundary: %" B_PRIuPHYSADDR ")!\n",
+					length, requestedStart, end, restrictions->alignment,
+					restrictions->boundary);
+			}
 
 			freeClearQueueLocker.Unlock();
 			vm_page_unreserve_pages(&reservation);
@@ -3972,6 +3967,47 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 }
 
 
+/*! Allocate a physically contiguous range of pages.
+
+	\param flags Page allocation flags. Encodes the state the function shall
+		set the allocated pages to, whether the pages shall be marked busy
+		(VM_PAGE_ALLOC_BUSY), and whether the pages shall be cleared
+		(VM_PAGE_ALLOC_CLEAR).
+	\param length The number of contiguous pages to allocate.
+	\param restrictions Restrictions to the physical addresses of the page run
+		to allocate, including \c low_address, the first acceptable physical
+		address where the page run may start, \c high_address, the last
+		acceptable physical address where the page run may end (i.e. it must
+		hold \code runStartAddress + length <= high_address \endcode),
+		\c alignment, the alignment of the page run start address, and
+		\c boundary, multiples of which the page run must not cross.
+		Values set to \c 0 are ignored.
+	\param priority The page reservation priority (as passed to
+		vm_page_reserve_pages()).
+	\return The first page of the allocated page run on success; \c NULL
+		when the allocation failed.
+*/
+vm_page*
+vm_page_allocate_page_run(uint32 flags, page_num_t length,
+	const physical_address_restrictions* restrictions, int priority)
+{
+	return allocate_page_run_etc(flags, length, restrictions, priority, false);
+}
+
+
+/*!	Like vm_page_allocate_page_run(), but never waits for pages to become
+	available, and only uses pages that are free or clear, i.e. no cached
+	pages are stolen. This makes it suitable for opportunistic allocations,
+	like large pages, that have a fallback if no run can be found.
+*/
+vm_page*
+vm_page_try_allocate_page_run(uint32 flags, page_num_t length,
+	const physical_address_restrictions* restrictions, int priority)
+{
+	return allocate_page_run_etc(flags, length, restrictions, priority, true);
+}
+
+
 vm_page *
 vm_page_at_index(int32 index)
 {
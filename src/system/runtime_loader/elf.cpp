@@ -30,6 +30,7 @@
 #include "elf_versioning.h"
 #include "errors.h"
 #include "images.h"
+#include "resolution_cache.h"
 
 
 // TODO: implement better locking strategy
@@ -264,9 +265,12 @@ load_dependencies(image_t* image, bool preload = false)
 
 
 static status_t
-relocate_image(image_t *rootImage, image_t *image)
+relocate_image(image_t *rootImage, image_t *image,
+	ResolutionCache *resolutionCache)
 {
 	SymbolLookupCache cache(image);
+	if (resolutionCache != NULL)
+		resolutionCache->Restore(image, &cache);
 
 	status_t status = arch_relocate_image(rootImage, image, &cache);
 	if (status < B_OK) {
@@ -274,6 +278,9 @@ relocate_image(image_t *rootImage, image_t *image)
 		return status;
 	}
 
+	if (resolutionCache != NULL)
+		resolutionCache->Remember(image, &cache);
+
 	_kern_image_relocated(image->id);
 	image_event(image, IMAGE_EVENT_RELOCATED);
 	return B_OK;
@@ -281,7 +288,7 @@ relocate_image(image_t *rootImage, image_t *image)
 
 
 static status_t
-relocate_dependencies(image_t *image)
+relocate_dependencies(image_t *image, ResolutionCache *resolutionCache = NULL)
 {
 	// get the images that still have to be relocated
 	image_t **list;
@@ -291,7 +298,7 @@ relocate_dependencies(image_t *image)
 
 	// relocate
 	for (ssize_t i = 0; i < count; i++) {
-		status_t status = relocate_image(image, list[i]);
+		status_t status = relocate_image(image, list[i], resolutionCache);
 		if (status < B_OK) {
 			free(list);
 			return status;
@@ -550,9 +557,19 @@ load_program(char const *path, void **_entry)
 	// This results in the desired symbol resolution for dlopen()ed libraries.
 	set_image_flags_recursively(gProgramImage, RTLD_GLOBAL);
 
-	status = relocate_dependencies(gProgramImage);
-	if (status < B_OK)
-		goto err;
+	{
+		// If enabled, use and update the persistent resolution cache.
+		ResolutionCache resolutionCache;
+		bool useResolutionCache = resolutionCache.Init(gProgramImage) == B_OK;
+
+		status = relocate_dependencies(gProgramImage,
+			useResolutionCache ? &resolutionCache : NULL);
+		if (status < B_OK)
+			goto err;
+
+		if (useResolutionCache)
+			resolutionCache.Store();
+	}
 
 	inject_runtime_loader_api(gProgramImage);
 
@@ -258,6 +258,7 @@ parse_dynamic_segment(image_t* image)
 	int sonameOffset = -1;
 
 	image->symhash = 0;
+	image->gnuhash = 0;
 	image->syms = 0;
 	image->strtab = 0;
 
@@ -274,6 +275,10 @@ parse_dynamic_segment(image_t* image)
 				image->symhash
 					= (uint32*)(d[i].d_un.d_ptr + image->regions[0].delta);
 				break;
+			case DT_GNU_HASH:
+				image->gnuhash
+					= (uint32*)(d[i].d_un.d_ptr + image->regions[0].delta);
+				break;
 			case DT_STRTAB:
 				image->strtab
 					= (char*)(d[i].d_un.d_ptr + image->regions[0].delta);
@@ -393,6 +398,18 @@ parse_dynamic_segment(image_t* image)
 	if (!image->symhash || !image->syms || !image->strtab)
 		return false;
 
+	// The GNU hash table is optional. We only use it, if it is sane, i.e. its
+	// bloom filter size is a power of two and it has at least one bucket.
+	// Otherwise we silently fall back to the SysV hash table.
+	if (image->gnuhash != NULL) {
+		uint32 bloomSize = GNUHASHBLOOMSIZE(image);
+		if (GNUHASHBUCKETCOUNT(image) == 0 || bloomSize == 0
+			|| (bloomSize & (bloomSize - 1)) != 0
+			|| GNUHASHBLOOMSHIFT(image) >= sizeof(elf_addr) * 8) {
+			image->gnuhash = NULL;
+		}
+	}
+
 	if (sonameOffset >= 0)
 		strlcpy(image->name, STRING(image, sonameOffset), sizeof(image->name));
 
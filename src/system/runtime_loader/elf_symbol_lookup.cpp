@@ -63,6 +63,19 @@ elf_hash(const char* _name)
 }
 
 
+uint32
+elf_gnu_hash(const char* _name)
+{
+	const uint8* name = (const uint8*)_name;
+
+	uint32 hash = 5381;
+	while (*name)
+		hash = hash * 33 + *name++;
+
+	return hash;
+}
+
+
 void
 patch_defined_symbol(image_t* image, const char* name, void** symbol,
 	int32* type)
@@ -93,6 +106,73 @@ patch_undefined_symbol(image_t* rootImage, image_t* image, const char* name,
 }
 
 
+/*!	Returns the index of the first symbol in \a image's hash table chain that
+	might match the symbol described by \a lookupInfo.
+
+	If the image has a GNU hash table, the bloom filter is consulted first,
+	which allows rejecting most lookups of symbols the image doesn't define
+	without touching the buckets or the symbol table at all. Chain entries
+	whose hash doesn't match are skipped, too. Otherwise the SysV hash table
+	is used.
+
+	\return The symbol index or \c STN_UNDEF, if there's no candidate.
+*/
+static inline uint32
+first_hash_chain_symbol(image_t* image, const SymbolLookupInfo& lookupInfo)
+{
+	if (image->gnuhash == NULL)
+		return HASHBUCKETS(image)[lookupInfo.hash % HASHTABSIZE(image)];
+
+	const uint32 hash = lookupInfo.gnuHash;
+	const uint32 wordBits = sizeof(elf_addr) * 8;
+	elf_addr bloomWord = GNUHASHBLOOM(image)[
+		(hash / wordBits) & (GNUHASHBLOOMSIZE(image) - 1)];
+	elf_addr mask = ((elf_addr)1 << (hash % wordBits))
+		| ((elf_addr)1 << ((hash >> GNUHASHBLOOMSHIFT(image)) % wordBits));
+	if ((bloomWord & mask) != mask)
+		return STN_UNDEF;
+
+	uint32 index = GNUHASHBUCKETS(image)[hash % GNUHASHBUCKETCOUNT(image)];
+	if (index < GNUHASHSYMOFFSET(image))
+		return STN_UNDEF;
+
+	const uint32* chains = GNUHASHCHAINS(image) - GNUHASHSYMOFFSET(image);
+	while (true) {
+		uint32 chainHash = chains[index];
+		if (((chainHash ^ hash) >> 1) == 0)
+			return index;
+		if ((chainHash & 1) != 0)
+			return STN_UNDEF;
+		index++;
+	}
+}
+
+
+/*!	Returns the index of the symbol following \a index in \a image's hash
+	table chain that might match the symbol described by \a lookupInfo.
+
+	\return The symbol index or \c STN_UNDEF, if the end of the chain has been
+		reached.
+*/
+static inline uint32
+next_hash_chain_symbol(image_t* image, const SymbolLookupInfo& lookupInfo,
+	uint32 index)
+{
+	if (image->gnuhash == NULL)
+		return HASHCHAINS(image)[index];
+
+	const uint32 hash = lookupInfo.gnuHash;
+	const uint32* chains = GNUHASHCHAINS(image) - GNUHASHSYMOFFSET(image);
+	while ((chains[index] & 1) == 0) {
+		index++;
+		if (((chains[index] ^ hash) >> 1) == 0)
+			return index;
+	}
+
+	return STN_UNDEF;
+}
+
+
 static bool
 is_symbol_visible(elf_sym* symbol)
 {
@@ -113,10 +193,8 @@ find_symbol(image_t* image, const SymbolLookupInfo& lookupInfo, bool allowLocal)
 	elf_sym* versionedSymbol = NULL;
 	uint32 versionedSymbolCount = 0;
 
-	uint32 bucket = lookupInfo.hash % HASHTABSIZE(image);
-
-	for (uint32 i = HASHBUCKETS(image)[bucket]; i != STN_UNDEF;
-			i = HASHCHAINS(image)[i]) {
+	for (uint32 i = first_hash_chain_symbol(image, lookupInfo);
+			i != STN_UNDEF; i = next_hash_chain_symbol(image, lookupInfo, i)) {
 		elf_sym* symbol = &image->syms[i];
 
 		if (symbol->st_shndx != SHN_UNDEF
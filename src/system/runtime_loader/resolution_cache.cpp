@@ -0,0 +1,385 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "resolution_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <syscalls.h>
+
+#include "elf_symbol_lookup.h"
+#include "images.h"
+#include "runtime_loader_private.h"
+
+
+static const uint32 kResolutionCacheMagic = 'rlrc';
+static const uint32 kResolutionCacheVersion = 1;
+
+// Caches larger than this are considered corrupt.
+static const off_t kMaxResolutionCacheSize = 64 * 1024 * 1024;
+
+
+struct resolution_cache_header {
+	uint32	magic;
+	uint32	version;
+	uint32	image_count;
+	uint32	group_count;
+};
+
+struct resolution_cache_group {
+	uint32	image_index;
+	uint32	entry_count;
+};
+
+
+struct ResolutionCache::ImageKey {
+	dev_t	device;
+	ino_t	node;
+	off_t	size;
+	int64	modification_time;
+	uint32	path_hash;
+	uint32	reserved;
+};
+
+
+struct ResolutionCache::Entry {
+	uint32	symbol_index;
+	int32	image_index;
+		// -1, if the symbol resolved to NULL
+	uint64	value;
+		// relative to the defining image's delta, except for TLS symbols
+};
+
+
+ResolutionCache::ResolutionCache()
+	:
+	fImages(NULL),
+	fKeys(NULL),
+	fImageCount(0),
+	fData(NULL),
+	fImageEntries(NULL),
+	fEntryCounts(NULL),
+	fNewData(NULL),
+	fNewDataSize(0),
+	fNewGroupCount(0),
+	fValid(false),
+	fFailed(true)
+{
+	fPath[0] = '\0';
+}
+
+
+ResolutionCache::~ResolutionCache()
+{
+	free(fImages);
+	free(fKeys);
+	free(fData);
+	free(fImageEntries);
+	free(fEntryCounts);
+	free(fNewData);
+}
+
+
+/*!	Prepares the cache for relocating \a programImage and all images loaded
+	so far.
+
+	The cache is only used, if the \c LD_RESOLUTION_CACHE environment variable
+	names the directory the cache files shall live in. It is also disabled as
+	soon as any image has symbol patchers registered, since those can
+	redirect resolutions in ways that aren't reflected in the key.
+
+	\return \c B_OK, if the cache can be used, i.e. Restore() and Remember()
+		shall be called for the images to be relocated. Whether any cached
+		data was found can be checked via IsValid().
+*/
+status_t
+ResolutionCache::Init(image_t* programImage)
+{
+	const char* directory = getenv("LD_RESOLUTION_CACHE");
+	if (directory == NULL || directory[0] == '\0')
+		return B_NOT_SUPPORTED;
+
+	int length = snprintf(fPath, sizeof(fPath), "%s/%s-%08" B_PRIx32,
+		directory, programImage->name, elf_hash(programImage->path));
+	if (length < 0 || (size_t)length >= sizeof(fPath) - 16)
+		return B_NAME_TOO_LONG;
+
+	fImageCount = count_loaded_images();
+	fImages = (image_t**)malloc(sizeof(image_t*) * fImageCount);
+	fKeys = (ImageKey*)malloc(sizeof(ImageKey) * fImageCount);
+	fImageEntries = (const Entry**)malloc(sizeof(Entry*) * fImageCount);
+	fEntryCounts = (uint32*)malloc(sizeof(uint32) * fImageCount);
+	if (fImages == NULL || fKeys == NULL || fImageEntries == NULL
+		|| fEntryCounts == NULL) {
+		return B_NO_MEMORY;
+	}
+
+	// Zero everything, so that the keys can be compared with memcmp(),
+	// padding included.
+	memset(fKeys, 0, sizeof(ImageKey) * fImageCount);
+	memset(fImageEntries, 0, sizeof(Entry*) * fImageCount);
+	memset(fEntryCounts, 0, sizeof(uint32) * fImageCount);
+
+	uint32 index = 0;
+	for (image_t* image = get_loaded_images().head; image != NULL;
+			image = image->next, index++) {
+		if (image->defined_symbol_patchers != NULL
+			|| image->undefined_symbol_patchers != NULL) {
+			return B_NOT_SUPPORTED;
+		}
+
+		struct stat st;
+		status_t status = _kern_read_stat(-1, image->path, true, &st,
+			sizeof(st));
+		if (status != B_OK)
+			return status;
+
+		fImages[index] = image;
+		fKeys[index].device = st.st_dev;
+		fKeys[index].node = st.st_ino;
+		fKeys[index].size = st.st_size;
+		fKeys[index].modification_time
+			= (int64)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+		fKeys[index].path_hash = elf_hash(image->path);
+	}
+
+	fFailed = false;
+	fValid = _Load() == B_OK;
+	return B_OK;
+}
+
+
+/*!	Feeds the cached resolutions for \a image into \a cache.
+	Does nothing, if the cache isn't valid.
+*/
+void
+ResolutionCache::Restore(image_t* image, SymbolLookupCache* cache) const
+{
+	if (!fValid)
+		return;
+
+	int32 index = _IndexOf(image);
+	if (index < 0)
+		return;
+
+	const Entry* entries = fImageEntries[index];
+	for (uint32 i = 0; i < fEntryCounts[index]; i++) {
+		const Entry& entry = entries[i];
+		if (entry.symbol_index >= cache->TableSize()
+			|| entry.image_index >= (int32)fImageCount) {
+			continue;
+		}
+
+		if (entry.image_index < 0) {
+			cache->SetSymbolValueAt(entry.symbol_index, 0, NULL);
+			continue;
+		}
+
+		image_t* symbolImage = fImages[entry.image_index];
+		addr_t value = (addr_t)entry.value;
+		if (image->syms[entry.symbol_index].Type() != STT_TLS)
+			value += symbolImage->regions[0].delta;
+
+		cache->SetSymbolValueAt(entry.symbol_index, value, symbolImage);
+	}
+}
+
+
+/*!	Records the resolutions \a cache holds after \a image has been relocated,
+	so that they can be written by Store().
+	Does nothing, if the cache is valid already.
+*/
+void
+ResolutionCache::Remember(image_t* image, const SymbolLookupCache* cache)
+{
+	if (fValid || fFailed)
+		return;
+
+	int32 imageIndex = _IndexOf(image);
+	if (imageIndex < 0) {
+		fFailed = true;
+		return;
+	}
+
+	uint32 count = 0;
+	for (size_t i = 0; i < cache->TableSize(); i++) {
+		if (cache->IsSymbolValueCached(i))
+			count++;
+	}
+
+	size_t size = sizeof(resolution_cache_group) + count * sizeof(Entry);
+	uint8* data = (uint8*)realloc(fNewData, fNewDataSize + size);
+	if (data == NULL) {
+		fFailed = true;
+		return;
+	}
+	fNewData = data;
+
+	resolution_cache_group* group
+		= (resolution_cache_group*)(fNewData + fNewDataSize);
+	group->image_index = imageIndex;
+	group->entry_count = count;
+
+	Entry* entries = (Entry*)(group + 1);
+	uint32 entryIndex = 0;
+	for (size_t i = 0; i < cache->TableSize(); i++) {
+		if (!cache->IsSymbolValueCached(i))
+			continue;
+
+		image_t* symbolImage;
+		addr_t value = cache->SymbolValueAt(i, &symbolImage);
+
+		Entry& entry = entries[entryIndex++];
+		memset(&entry, 0, sizeof(entry));
+		entry.symbol_index = i;
+
+		if (symbolImage == NULL) {
+			entry.image_index = -1;
+			continue;
+		}
+
+		entry.image_index = _IndexOf(symbolImage);
+		if (entry.image_index < 0) {
+			fFailed = true;
+			return;
+		}
+
+		if (image->syms[i].Type() != STT_TLS)
+			value -= symbolImage->regions[0].delta;
+		entry.value = value;
+	}
+
+	fNewDataSize += size;
+	fNewGroupCount++;
+}
+
+
+/*!	Writes the resolutions collected via Remember() to the cache file.
+	The file is replaced atomically, so that concurrently launched instances
+	of the program never see a partially written cache.
+*/
+status_t
+ResolutionCache::Store()
+{
+	if (fValid || fFailed || fNewGroupCount == 0)
+		return B_OK;
+
+	char tempPath[B_PATH_NAME_LENGTH];
+	snprintf(tempPath, sizeof(tempPath), "%s.%" B_PRId32, fPath,
+		find_thread(NULL));
+
+	int fd = _kern_open(-1, tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return fd;
+
+	resolution_cache_header header;
+	header.magic = kResolutionCacheMagic;
+	header.version = kResolutionCacheVersion;
+	header.image_count = fImageCount;
+	header.group_count = fNewGroupCount;
+
+	off_t offset = 0;
+	ssize_t written = _kern_write(fd, offset, &header, sizeof(header));
+	if (written == (ssize_t)sizeof(header)) {
+		offset += written;
+		written = _kern_write(fd, offset, fKeys,
+			sizeof(ImageKey) * fImageCount);
+	}
+	if (written == (ssize_t)(sizeof(ImageKey) * fImageCount)) {
+		offset += written;
+		written = _kern_write(fd, offset, fNewData, fNewDataSize);
+	}
+	_kern_close(fd);
+
+	if (written != (ssize_t)fNewDataSize) {
+		_kern_unlink(-1, tempPath);
+		return written < 0 ? written : B_IO_ERROR;
+	}
+
+	status_t status = _kern_rename(-1, tempPath, -1, fPath);
+	if (status != B_OK)
+		_kern_unlink(-1, tempPath);
+	return status;
+}
+
+
+int32
+ResolutionCache::_IndexOf(const image_t* image) const
+{
+	for (uint32 i = 0; i < fImageCount; i++) {
+		if (fImages[i] == image)
+			return i;
+	}
+
+	return -1;
+}
+
+
+status_t
+ResolutionCache::_Load()
+{
+	int fd = _kern_open(-1, fPath, O_RDONLY, 0);
+	if (fd < 0)
+		return fd;
+
+	struct stat st;
+	status_t status = _kern_read_stat(fd, NULL, false, &st, sizeof(st));
+	if (status == B_OK) {
+		if (st.st_size < (off_t)sizeof(resolution_cache_header)
+			|| st.st_size > kMaxResolutionCacheSize) {
+			status = B_BAD_DATA;
+		} else {
+			fData = (uint8*)malloc(st.st_size);
+			if (fData == NULL)
+				status = B_NO_MEMORY;
+		}
+	}
+	if (status == B_OK) {
+		ssize_t bytesRead = _kern_read(fd, 0, fData, st.st_size);
+		if (bytesRead != st.st_size)
+			status = bytesRead < 0 ? bytesRead : B_IO_ERROR;
+	}
+	_kern_close(fd);
+
+	if (status != B_OK)
+		return status;
+
+	// validate the header and the key
+	const resolution_cache_header* header
+		= (const resolution_cache_header*)fData;
+	size_t keySize = sizeof(ImageKey) * fImageCount;
+	if (header->magic != kResolutionCacheMagic
+		|| header->version != kResolutionCacheVersion
+		|| header->image_count != fImageCount
+		|| (size_t)st.st_size < sizeof(*header) + keySize
+		|| memcmp(header + 1, fKeys, keySize) != 0) {
+		return B_MISMATCHED_VALUES;
+	}
+
+	// index the entry groups
+	const uint8* data = fData + sizeof(*header) + keySize;
+	const uint8* dataEnd = fData + st.st_size;
+	for (uint32 i = 0; i < header->group_count; i++) {
+		const resolution_cache_group* group
+			= (const resolution_cache_group*)data;
+		if (dataEnd - data < (ssize_t)sizeof(*group)
+			|| group->image_index >= fImageCount
+			|| (size_t)(dataEnd - data - sizeof(*group)) / sizeof(Entry)
+				< group->entry_count) {
+			return B_BAD_DATA;
+		}
+
+		fImageEntries[group->image_index] = (const Entry*)(group + 1);
+		fEntryCounts[group->image_index] = group->entry_count;
+		data += sizeof(*group) + group->entry_count * sizeof(Entry);
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RESOLUTION_CACHE_H
+#define RESOLUTION_CACHE_H
+
+
+#include <runtime_loader.h>
+
+
+struct SymbolLookupCache;
+
+
+/*!	Persistent cache of the symbol resolutions done while relocating a
+	program and its dependencies.
+
+	The cache is keyed by the complete set of loaded images, identified by
+	their path, node, size, and modification time. If the set matches, the
+	cached resolutions are fed into each image's SymbolLookupCache before it
+	is relocated, so that no hash table has to be walked at all. Otherwise
+	the symbols are resolved as usual and the results are written back.
+*/
+class ResolutionCache {
+public:
+								ResolutionCache();
+								~ResolutionCache();
+
+			status_t			Init(image_t* programImage);
+
+			bool				IsValid() const	{ return fValid; }
+
+			void				Restore(image_t* image,
+									SymbolLookupCache* cache) const;
+			void				Remember(image_t* image,
+									const SymbolLookupCache* cache);
+			status_t			Store();
+
+private:
+			struct ImageKey;
+			struct Entry;
+
+			int32				_IndexOf(const image_t* image) const;
+			status_t			_Load();
+
+private:
+			char				fPath[B_PATH_NAME_LENGTH];
+			image_t**			fImages;
+			ImageKey*			fKeys;
+			uint32				fImageCount;
+			uint8*				fData;
+			const Entry**		fImageEntries;
+			uint32*				fEntryCounts;
+			uint8*				fNewData;
+			size_t				fNewDataSize;
+			uint32				fNewGroupCount;
+			bool				fValid;
+			bool				fFailed;
+};
+
+
+#endif	// RESOLUTION_CACHE_H
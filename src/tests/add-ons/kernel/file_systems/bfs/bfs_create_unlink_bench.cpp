@@ -0,0 +1,171 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Creates and removes files from a number of threads at the same time, and
+	prints how many operations per second the file system managed. Every
+	thread uses a directory of its own, so that the threads only compete for
+	the file system's locks, and not for the directory.
+
+	With -s, every thread also calls sync() after that many operations; the
+	journal batches concurrent syncs into a single flush of the device.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+struct Workload {
+	const char*	directory;
+	int32		index;
+	int32		files;
+	int32		rounds;
+	int32		syncInterval;
+	int64		operations;
+	status_t	status;
+};
+
+
+static void*
+worker_thread(void* data)
+{
+	Workload& workload = *(Workload*)data;
+
+	char directory[B_PATH_NAME_LENGTH];
+	snprintf(directory, sizeof(directory), "%s/thread%" B_PRId32,
+		workload.directory, workload.index);
+	if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+		workload.status = errno;
+		return NULL;
+	}
+
+	for (int32 round = 0; round < workload.rounds; round++) {
+		for (int32 pass = 0; pass < 2; pass++) {
+			// create all files first, then remove them again
+			for (int32 i = 0; i < workload.files; i++) {
+				char path[B_PATH_NAME_LENGTH];
+				snprintf(path, sizeof(path), "%s/file%" B_PRId32, directory,
+					i);
+
+				if (pass == 0) {
+					int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+					if (fd < 0) {
+						workload.status = errno;
+						return NULL;
+					}
+					close(fd);
+				} else if (unlink(path) != 0) {
+					workload.status = errno;
+					return NULL;
+				}
+
+				workload.operations++;
+				if (workload.syncInterval > 0
+					&& workload.operations % workload.syncInterval == 0)
+					sync();
+			}
+		}
+	}
+
+	rmdir(directory);
+	return NULL;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-t <threads>] [-n <files per thread>] "
+		"[-r <rounds>] [-s <sync interval>] <directory>\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 threadCount = 4;
+	int32 files = 1000;
+	int32 rounds = 5;
+	int32 syncInterval = 0;
+
+	int option;
+	while ((option = getopt(argc, argv, "t:n:r:s:")) != -1) {
+		switch (option) {
+			case 't':
+				threadCount = atoi(optarg);
+				break;
+			case 'n':
+				files = atoi(optarg);
+				break;
+			case 'r':
+				rounds = atoi(optarg);
+				break;
+			case 's':
+				syncInterval = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind + 1 != argc || threadCount < 1 || files < 1 || rounds < 1
+		|| syncInterval < 0) {
+		usage(argv[0]);
+	}
+
+	const char* directory = argv[optind];
+
+	pthread_t* threads = new pthread_t[threadCount];
+	Workload* workloads = new Workload[threadCount];
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < threadCount; i++) {
+		Workload& workload = workloads[i];
+		workload.directory = directory;
+		workload.index = i;
+		workload.files = files;
+		workload.rounds = rounds;
+		workload.syncInterval = syncInterval;
+		workload.operations = 0;
+		workload.status = B_OK;
+
+		pthread_create(&threads[i], NULL, &worker_thread, &workload);
+	}
+
+	int64 operations = 0;
+	int result = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		pthread_join(threads[i], NULL);
+		operations += workloads[i].operations;
+
+		if (workloads[i].status != B_OK) {
+			fprintf(stderr, "Thread %" B_PRId32 " failed: %s\n", i,
+				strerror(workloads[i].status));
+			result = 1;
+		}
+	}
+
+	bigtime_t time = system_time() - startTime;
+
+	printf("%" B_PRId32 " threads, %" B_PRId64 " operations in %.3f s: "
+		"%.0f ops/s\n", threadCount, operations, time / 1000000.0,
+		operations * 1000000.0 / time);
+
+	delete[] workloads;
+	delete[] threads;
+	return result;
+}
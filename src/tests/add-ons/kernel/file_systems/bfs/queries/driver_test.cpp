@@ -0,0 +1,172 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests that an "and" query, whose one term has an index and the other
+	has not, finds its entries without B_QUERY_NON_INDEXED, whatever the
+	costs of the terms are estimated to be. Also tests that terms on the
+	"size" and "last_modified" indices don't filter out directories.
+*/
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <fs_attr.h>
+#include <fs_info.h>
+#include <fs_query.h>
+#include <TypeConstants.h>
+
+
+static const int32 kFileCount = 64;
+static const char* kAttribute = "_driver_test:unindexed";
+static const char* kDirectory = "_driver_test_directory";
+
+
+static void
+file_name(int32 index, char* name, size_t size)
+{
+	snprintf(name, size, "_driver_test_%" B_PRId32, index);
+}
+
+
+static bool
+create_files()
+{
+	for (int32 i = 0; i < kFileCount; i++) {
+		char name[B_FILE_NAME_LENGTH];
+		file_name(i, name, sizeof(name));
+
+		int fd = open(name, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "Could not create %s: %s\n", name,
+				strerror(errno));
+			return false;
+		}
+
+		const char* value = (i % 2) != 0 ? "odd" : "even";
+		ssize_t written = fs_write_attr(fd, kAttribute, B_STRING_TYPE, 0,
+			value, strlen(value) + 1);
+		close(fd);
+
+		if (written < 0) {
+			fprintf(stderr, "Could not write attribute of %s: %s\n", name,
+				strerror(errno));
+			return false;
+		}
+	}
+
+	if (mkdir(kDirectory, 0755) != 0) {
+		fprintf(stderr, "Could not create %s: %s\n", kDirectory,
+			strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+
+static void
+remove_files()
+{
+	for (int32 i = 0; i < kFileCount; i++) {
+		char name[B_FILE_NAME_LENGTH];
+		file_name(i, name, sizeof(name));
+		unlink(name);
+	}
+	rmdir(kDirectory);
+}
+
+
+static int32
+count_entries(dev_t device, const char* predicate)
+{
+	DIR* query = fs_open_query(device, predicate, 0);
+	if (query == NULL) {
+		fprintf(stderr, "Could not open query \"%s\": %s\n", predicate,
+			strerror(errno));
+		return -1;
+	}
+
+	int32 count = 0;
+	while (fs_read_query(query) != NULL)
+		count++;
+
+	fs_close_query(query);
+	return count;
+}
+
+
+static bool
+test_query(dev_t device, const char* predicate, int32 expected)
+{
+	int32 count = count_entries(device, predicate);
+	if (count != expected) {
+		fprintf(stderr, "Query \"%s\" found %" B_PRId32 " entries, expected "
+			"%" B_PRId32 "\n", predicate, count, expected);
+		return false;
+	}
+
+	printf("Query \"%s\": passed\n", predicate);
+	return true;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	dev_t device = dev_for_path(".");
+	if (device < 0) {
+		fprintf(stderr, "Could not get the device of the current "
+			"directory\n");
+		return 1;
+	}
+
+	if (!create_files()) {
+		remove_files();
+		return 1;
+	}
+
+	bool passed = true;
+
+	// The order of the terms must not matter
+	passed &= test_query(device,
+		"((name==\"_driver_test_*\")&&(_driver_test:unindexed==odd))",
+		kFileCount / 2);
+	passed &= test_query(device,
+		"((_driver_test:unindexed==odd)&&(name==\"_driver_test_*\"))",
+		kFileCount / 2);
+
+	// The indexed terms are estimated to be expensive here, as the pattern
+	// has to be matched against the whole index, and as the size term
+	// matches every file
+	passed &= test_query(device,
+		"((name==\"*_driver_test_*\")&&(_driver_test:unindexed==even))",
+		kFileCount / 2);
+	passed &= test_query(device,
+		"(((name==\"_driver_test_*\")&&(size>=0))"
+			"&&(_driver_test:unindexed==even))",
+		kFileCount / 2);
+
+	// Directories are neither part of the "size" nor of the "last_modified"
+	// index, but match terms on them nevertheless
+	passed &= test_query(device,
+		"((name==\"_driver_test_*\")&&(size>=0))", kFileCount + 1);
+	passed &= test_query(device,
+		"((name==\"_driver_test_*\")&&(last_modified>0))", kFileCount + 1);
+
+	remove_files();
+
+	if (!passed)
+		return 1;
+
+	puts("All tests passed.");
+	return 0;
+}
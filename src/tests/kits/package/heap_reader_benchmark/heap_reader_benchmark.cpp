@@ -0,0 +1,248 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Reads all file and attribute data of a package in TOC order, like
+	"package extract" does, once through the plain heap reader and twice
+	through a CachedPackageFileHeapReader, and prints the times and the
+	cache statistics.
+
+	Usage: package_heap_reader_benchmark [-c <cache size in MB>]
+		[-j <read-ahead threads>] <package>
+
+	This is built as a build platform tool, so that it can also be run on the
+	host used to build Haiku.
+*/
+
+
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <DataIO.h>
+#include <OS.h>
+
+#include <package/hpkg/CachedPackageFileHeapReader.h>
+#include <package/hpkg/ErrorOutput.h>
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageData.h>
+#include <package/hpkg/PackageEntry.h>
+#include <package/hpkg/PackageEntryAttribute.h>
+#include <package/hpkg/PackageFileHeapReader.h>
+#include <package/hpkg/PackageReaderImpl.h>
+
+
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BHPKG::BPrivate::CachedPackageFileHeapReader;
+using BPackageKit::BHPKG::BPrivate::ChunkCacheStatistics;
+using BPackageKit::BHPKG::BPrivate::PackageReaderImpl;
+
+
+struct DataRange {
+	uint64	offset;
+	uint64	size;
+};
+
+
+struct StdErrOutput : BErrorOutput {
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		vfprintf(stderr, format, args);
+	}
+};
+
+
+struct NullOutput : BDataIO {
+	virtual ssize_t Write(const void* buffer, size_t size)
+	{
+		return size;
+	}
+};
+
+
+struct RangeCollector : BPackageContentHandler {
+	RangeCollector(std::vector<DataRange>& ranges)
+		:
+		fRanges(ranges)
+	{
+	}
+
+	virtual status_t HandleEntry(BPackageEntry* entry)
+	{
+		_Add(entry->Data());
+		return B_OK;
+	}
+
+	virtual status_t HandleEntryAttribute(BPackageEntry* entry,
+		BPackageEntryAttribute* attribute)
+	{
+		_Add(attribute->Data());
+		return B_OK;
+	}
+
+	virtual status_t HandleEntryDone(BPackageEntry* entry)
+	{
+		return B_OK;
+	}
+
+	virtual status_t HandlePackageAttribute(
+		const BPackageInfoAttributeValue& value)
+	{
+		return B_OK;
+	}
+
+	virtual void HandleErrorOccurred()
+	{
+	}
+
+private:
+	void _Add(const BPackageData& data)
+	{
+		if (data.IsEncodedInline() || data.Size() == 0)
+			return;
+
+		DataRange range = { data.Offset(), data.Size() };
+		fRanges.push_back(range);
+	}
+
+private:
+	std::vector<DataRange>&	fRanges;
+};
+
+
+static status_t
+read_ranges(BAbstractBufferedDataReader* reader,
+	const std::vector<DataRange>& ranges, bigtime_t& _time)
+{
+	NullOutput output;
+	bigtime_t startTime = system_time();
+
+	for (size_t i = 0; i < ranges.size(); i++) {
+		status_t error = reader->ReadDataToOutput(ranges[i].offset,
+			ranges[i].size, &output);
+		if (error != B_OK)
+			return error;
+	}
+
+	_time = system_time() - startTime;
+	return B_OK;
+}
+
+
+static void
+print_result(const char* name, uint64 bytes, bigtime_t time,
+	CachedPackageFileHeapReader* cachedReader)
+{
+	printf("%-14s %8.1f ms, %8.1f MB/s", name, time / 1000.0,
+		(double)bytes / (1024 * 1024) / (time / 1000000.0));
+
+	if (cachedReader != NULL) {
+		ChunkCacheStatistics statistics;
+		cachedReader->GetStatistics(statistics);
+
+		uint64 accesses = statistics.hits + statistics.misses
+			+ statistics.readAheadWaits;
+		printf(", hit rate %5.1f%% (read-ahead %" B_PRIu64 "/%" B_PRIu64
+			", waits %" B_PRIu64 "), %" B_PRIu64 " evictions",
+			accesses > 0 ? 100.0 * statistics.hits / accesses : 0.0,
+			statistics.readAheadHits, statistics.readAheadChunks,
+			statistics.readAheadWaits, statistics.evictions);
+	}
+
+	printf("\n");
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-c <cache size in MB>] "
+		"[-j <read-ahead threads>] <package>\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	size_t cacheSize = CachedPackageFileHeapReader::kDefaultMemoryBudget;
+	int32 threadCount
+		= CachedPackageFileHeapReader::kDefaultReadAheadThreadCount;
+
+	int option;
+	while ((option = getopt(argc, argv, "c:j:")) != -1) {
+		switch (option) {
+			case 'c':
+				cacheSize = (size_t)atoi(optarg) * 1024 * 1024;
+				break;
+			case 'j':
+				threadCount = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind + 1 != argc || threadCount < 0)
+		usage(argv[0]);
+
+	StdErrOutput errorOutput;
+	PackageReaderImpl packageReader(&errorOutput);
+	status_t error = packageReader.Init(argv[optind], 0);
+	if (error != B_OK) {
+		fprintf(stderr, "Failed to open package \"%s\": %s\n", argv[optind],
+			strerror(error));
+		return 1;
+	}
+
+	std::vector<DataRange> ranges;
+	RangeCollector collector(ranges);
+	error = packageReader.ParseContent(&collector);
+	if (error != B_OK) {
+		fprintf(stderr, "Failed to parse package: %s\n", strerror(error));
+		return 1;
+	}
+
+	uint64 totalBytes = 0;
+	for (size_t i = 0; i < ranges.size(); i++)
+		totalBytes += ranges[i].size;
+
+	printf("%zu data ranges, %" B_PRIu64 " KB, heap %" B_PRIu64 " KB, "
+		"cache %zu KB, %" B_PRId32 " read-ahead threads\n", ranges.size(),
+		totalBytes / 1024,
+		packageReader.RawHeapReader()->UncompressedHeapSize() / 1024,
+		cacheSize / 1024, threadCount);
+
+	bigtime_t time;
+	error = read_ranges(packageReader.RawHeapReader(), ranges, time);
+	if (error != B_OK) {
+		fprintf(stderr, "Failed to read data: %s\n", strerror(error));
+		return 1;
+	}
+	print_result("uncached", totalBytes, time, NULL);
+
+	CachedPackageFileHeapReader cachedReader(packageReader.RawHeapReader());
+	error = cachedReader.Init(cacheSize, threadCount);
+	if (error != B_OK) {
+		fprintf(stderr, "Failed to init cache: %s\n", strerror(error));
+		return 1;
+	}
+
+	const char* const passNames[] = { "cached (cold)", "cached (warm)" };
+	for (int pass = 0; pass < 2; pass++) {
+		error = read_ranges(&cachedReader, ranges, time);
+		if (error != B_OK) {
+			fprintf(stderr, "Failed to read data: %s\n", strerror(error));
+			return 1;
+		}
+		print_result(passNames[pass], totalBytes, time, &cachedReader);
+	}
+
+	return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the throughput of PackageFileHeapWriter with an increasing number
+	of compression threads, and verifies that the resulting heap is identical
+	to the one written with a single thread.
+
+	Usage: package_heap_writer_benchmark [-s <size in MB>] [-l <level>]
+		[-j <max threads>] [-z zlib|zstd]
+
+	This is built as a build platform tool, so that it can also be run on the
+	host used to build Haiku.
+*/
+
+
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <CompressionAlgorithm.h>
+#include <DataIO.h>
+#include <OS.h>
+#include <ZlibCompressionAlgorithm.h>
+#include <ZstdCompressionAlgorithm.h>
+
+#include <package/hpkg/DataReader.h>
+#include <package/hpkg/ErrorOutput.h>
+#include <package/hpkg/HPKGDefs.h>
+#include <package/hpkg/PackageFileHeapWriter.h>
+
+
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BHPKG::BPrivate::CompressionAlgorithmOwner;
+using BPackageKit::BHPKG::BPrivate::DecompressionAlgorithmOwner;
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapWriter;
+
+
+static const char* const kWords[] = {
+	"package", "haiku", "system", "lib", "bin", "add-ons", "data", "kernel",
+	"_kern_", "return", "status_t", "B_OK", "void", "int32", "const", "char",
+	"\n", "\t", " ", " ", " ", "(", ")", ";", "{", "}", "0x", "1024", "error"
+};
+
+
+struct StdErrOutput : BErrorOutput {
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		vfprintf(stderr, format, args);
+	}
+};
+
+
+/*!	Fills the buffer with something resembling source code and binaries,
+	so that the data compress roughly like a typical package.
+*/
+static void
+fill_buffer(uint8* buffer, size_t size)
+{
+	unsigned int seed = 42;
+	size_t wordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+	size_t offset = 0;
+	while (offset < size) {
+		if (rand_r(&seed) % 64 == 0) {
+			// some incompressible data
+			size_t toFill = std::min(size - offset,
+				(size_t)rand_r(&seed) % 64);
+			for (size_t i = 0; i < toFill; i++)
+				buffer[offset++] = (uint8)rand_r(&seed);
+			continue;
+		}
+
+		const char* word = kWords[rand_r(&seed) % wordCount];
+		size_t toCopy = std::min(size - offset, strlen(word));
+		memcpy(buffer + offset, word, toCopy);
+		offset += toCopy;
+	}
+}
+
+
+static status_t
+write_heap(const uint8* data, size_t size, uint32 compression, int32 level,
+	int32 threadCount, BMallocIO& file, bigtime_t& _time)
+{
+	CompressionAlgorithmOwner* compressionAlgorithm;
+	DecompressionAlgorithmOwner* decompressionAlgorithm;
+	if (compression == B_HPKG_COMPRESSION_ZSTD) {
+		compressionAlgorithm = CompressionAlgorithmOwner::Create(
+			new(std::nothrow) BZstdCompressionAlgorithm,
+			new(std::nothrow) BZstdCompressionParameters(level));
+		decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+			new(std::nothrow) BZstdCompressionAlgorithm,
+			new(std::nothrow) BZstdDecompressionParameters);
+	} else {
+		compressionAlgorithm = CompressionAlgorithmOwner::Create(
+			new(std::nothrow) BZlibCompressionAlgorithm,
+			new(std::nothrow) BZlibCompressionParameters(level));
+		decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+			new(std::nothrow) BZlibCompressionAlgorithm,
+			new(std::nothrow) BZlibDecompressionParameters);
+	}
+	if (compressionAlgorithm == NULL || decompressionAlgorithm == NULL)
+		return B_NO_MEMORY;
+
+	BReference<CompressionAlgorithmOwner> compressionReference(
+		compressionAlgorithm, true);
+	BReference<DecompressionAlgorithmOwner> decompressionReference(
+		decompressionAlgorithm, true);
+
+	StdErrOutput errorOutput;
+	status_t error;
+	try {
+		PackageFileHeapWriter writer(&errorOutput, &file, 0,
+			compressionAlgorithm, decompressionAlgorithm);
+
+		bigtime_t startTime = system_time();
+		writer.Init(threadCount);
+
+		BBufferDataReader reader(data, size);
+		uint64 offset;
+		error = writer.AddData(reader, size, offset);
+		if (error == B_OK)
+			error = writer.Finish();
+
+		_time = system_time() - startTime;
+	} catch (std::bad_alloc&) {
+		error = B_NO_MEMORY;
+	} catch (status_t thrownError) {
+		error = thrownError;
+	}
+
+	return error;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-s <size in MB>] [-l <level>] "
+		"[-j <max threads>] [-z zlib|zstd]\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	size_t size = 64;
+	int32 level = 9;
+	int32 maxThreadCount = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+	uint32 compression = B_HPKG_COMPRESSION_ZLIB;
+
+	int option;
+	while ((option = getopt(argc, argv, "s:l:j:z:")) != -1) {
+		switch (option) {
+			case 's':
+				size = atoi(optarg);
+				break;
+			case 'l':
+				level = atoi(optarg);
+				break;
+			case 'j':
+				maxThreadCount = atoi(optarg);
+				break;
+			case 'z':
+				if (strcmp(optarg, "zstd") == 0)
+					compression = B_HPKG_COMPRESSION_ZSTD;
+				else if (strcmp(optarg, "zlib") == 0)
+					compression = B_HPKG_COMPRESSION_ZLIB;
+				else
+					usage(argv[0]);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind != argc || size == 0 || maxThreadCount < 1)
+		usage(argv[0]);
+
+	size *= 1024 * 1024;
+	uint8* data = (uint8*)malloc(size);
+	if (data == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	fill_buffer(data, size);
+
+	printf("%zu MB, %s level %" B_PRId32 "\n", size / (1024 * 1024),
+		compression == B_HPKG_COMPRESSION_ZSTD ? "zstd" : "zlib", level);
+
+	BMallocIO reference;
+	bigtime_t singleThreadTime = 0;
+	bool success = true;
+
+	for (int32 threadCount = 1; threadCount <= maxThreadCount;
+			threadCount = threadCount < maxThreadCount
+				? std::min(threadCount * 2, maxThreadCount)
+				: threadCount + 1) {
+		BMallocIO file;
+		BMallocIO& output = threadCount == 1 ? reference : file;
+		bigtime_t time;
+		status_t error = write_heap(data, size, compression, level,
+			threadCount, output, time);
+		if (error != B_OK) {
+			fprintf(stderr, "Failed to write heap with %" B_PRId32
+				" threads: %s\n", threadCount, strerror(error));
+			success = false;
+			break;
+		}
+
+		if (threadCount == 1)
+			singleThreadTime = time;
+
+		bool identical = output.BufferLength() == reference.BufferLength()
+			&& memcmp(output.Buffer(), reference.Buffer(),
+				reference.BufferLength()) == 0;
+		if (!identical)
+			success = false;
+
+		printf("%3" B_PRId32 " threads: %8.1f MB/s, %5.2fx, ratio %5.3f%s\n",
+			threadCount, (double)size / (1024 * 1024) / (time / 1000000.0),
+			(double)singleThreadTime / time,
+			(double)output.BufferLength() / size,
+			identical ? "" : "  HEAP DIFFERS!");
+	}
+
+	free(data);
+	return success ? 0 : 1;
+}
@@ -16,7 +16,9 @@
 
 // tests
 #include "HorizontalLineTest.h"
+#include "LargeFillTest.h"
 #include "RandomLineTest.h"
+#include "SmallCommandTest.h"
 #include "StringTest.h"
 #include "VerticalLineTest.h"
 
@@ -28,7 +30,9 @@ struct test_info {
 
 const test_info kTestInfos[] = {
 	{ "HorizontalLines",	HorizontalLineTest::CreateTest },
+	{ "LargeFills",			LargeFillTest::CreateTest },
 	{ "RandomLines",		RandomLineTest::CreateTest },
+	{ "SmallCommands",		SmallCommandTest::CreateTest },
 	{ "Strings",			StringTest::CreateTest },
 	{ "VerticalLines",		VerticalLineTest::CreateTest },
 	{ NULL, NULL }
@@ -37,12 +41,13 @@ const test_info kTestInfos[] = {
 
 class Benchmark : public BApplication {
 public:
-	Benchmark(Test* test, drawing_mode mode, bool clipping)
+	Benchmark(Test* test, drawing_mode mode, bool clipping, uint32 size)
 		: BApplication("application/x-vnd.haiku-benchmark"),
 		  fTest(test),
 		  fTestWindow(NULL),
 		  fDrawingMode(mode),
-		  fUseClipping(clipping)
+		  fUseClipping(clipping),
+		  fSize(size)
 	{
 	}
 
@@ -53,8 +58,8 @@ public:
 
 	virtual	void ReadyToRun()
 	{
-		uint32 width = 500;
-		uint32 height = 500;
+		uint32 width = fSize;
+		uint32 height = fSize;
 		BScreen screen;
 		BRect frame = screen.Frame();
 		frame.left = (frame.left + frame.right - width) / 2;
@@ -96,6 +101,7 @@ private:
 	TestWindow*		fTestWindow;
 	drawing_mode	fDrawingMode;
 	bool			fUseClipping;
+	uint32			fSize;
 };
 
 
@@ -117,7 +123,8 @@ main(int argc, char** argv)
 	// get test name
 	const char* testName;
 	if (argc < 2) {
-		fprintf(stderr, "Usage: %s <test name>\n", argv[0]);
+		fprintf(stderr, "Usage: %s <test name> [--clipping] [--size <pixels>] "
+			"[<drawing mode>]\n", argv[0]);
 		print_test_list(true);
 		exit(1);
 	}
@@ -128,11 +135,17 @@ main(int argc, char** argv)
 	testName = argv[0];
 	bool clipping = false;
 	drawing_mode mode = B_OP_COPY;
+	uint32 size = 500;
 
 	while (argc > 0) {
 		drawing_mode possibleMode;
 		if (strcmp(argv[0], "--clipping") == 0 || strcmp(argv[0], "-c") == 0) {
 			clipping = true;
+		} else if ((strcmp(argv[0], "--size") == 0
+				|| strcmp(argv[0], "-s") == 0) && argc > 1) {
+			argc--;
+			argv++;
+			size = max_c(atoi(argv[0]), 16);
 		} else if (ToDrawingMode(argv[0], possibleMode)) {
 			mode = possibleMode;
 		}
@@ -161,7 +174,7 @@ main(int argc, char** argv)
 		exit(1);
 	}
 
-	Benchmark app(test, mode, clipping);
+	Benchmark app(test, mode, clipping, size);
 	app.Run();
 	return 0;
 }
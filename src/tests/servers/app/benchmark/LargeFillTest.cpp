@@ -0,0 +1,154 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "LargeFillTest.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Bitmap.h>
+#include <GradientLinear.h>
+#include <GradientRadial.h>
+#include <OS.h>
+#include <View.h>
+
+
+LargeFillTest::LargeFillTest()
+	: Test(),
+	  fTestDuration(0),
+	  fTestStart(-1),
+
+	  fPixelsRendered(0),
+
+	  fIterations(0),
+	  fMaxIterations(200),
+
+	  fViewBounds(0, 0, -1, -1),
+	  fBitmap(NULL)
+{
+}
+
+
+LargeFillTest::~LargeFillTest()
+{
+	delete fBitmap;
+}
+
+
+void
+LargeFillTest::Prepare(BView* view)
+{
+	fViewBounds = view->Bounds();
+
+	delete fBitmap;
+	fBitmap = new BBitmap(BRect(0, 0, 63, 63), B_RGB32);
+	uint8* bits = (uint8*)fBitmap->Bits();
+	for (int32 y = 0; y < 64; y++) {
+		uint8* pixel = bits + y * fBitmap->BytesPerRow();
+		for (int32 x = 0; x < 64; x++) {
+			pixel[0] = x * 4;
+			pixel[1] = y * 4;
+			pixel[2] = (x ^ y) * 4;
+			pixel[3] = 255;
+			pixel += 4;
+		}
+	}
+
+	fTestDuration = 0;
+	fPixelsRendered = 0;
+	fIterations = 0;
+	fTestStart = system_time();
+}
+
+
+bool
+LargeFillTest::RunIteration(BView* view)
+{
+	const BRect bounds = fViewBounds;
+	const BPoint center((bounds.left + bounds.right) / 2,
+		(bounds.top + bounds.bottom) / 2);
+	const float radius = min_c(bounds.Width(), bounds.Height()) / 2;
+	const uint64 area = (uint64)(bounds.IntegerWidth() + 1)
+		* (bounds.IntegerHeight() + 1);
+
+	// let the shapes move a little, so that their edges are not always
+	// on the same pixels
+	const float phase = (fIterations % 16) / 4.0f;
+
+	bigtime_t now = system_time();
+
+	BGradientLinear linear(bounds.LeftTop(),
+		bounds.RightBottom() + BPoint(phase, 0));
+	linear.AddColor(make_color(255, 200, 100, 255), 0);
+	linear.AddColor(make_color(40, 80, 160, 255), 255);
+	view->FillRect(bounds, linear);
+	fPixelsRendered += area;
+
+	BGradientRadial radial(center, radius);
+	radial.AddColor(make_color(255, 255, 255, 255), 0);
+	radial.AddColor(make_color(200, 40, 40, 255), 255);
+	view->FillEllipse(bounds.InsetByCopy(phase, phase), radial);
+	fPixelsRendered += (uint64)(area * M_PI / 4);
+
+	BPoint star[10];
+	for (int32 i = 0; i < 10; i++) {
+		float angle = i * M_PI / 5 + phase / 10;
+		float distance = (i & 1) != 0 ? radius * 0.45f : radius;
+		star[i] = center + BPoint(distance * sinf(angle),
+			-distance * cosf(angle));
+	}
+	view->SetHighColor(40, 160, 80, 160);
+	view->FillPolygon(star, 10);
+	fPixelsRendered += (uint64)(radius * radius * 1.5f);
+
+	view->DrawBitmap(fBitmap, fBitmap->Bounds(),
+		bounds.InsetByCopy(phase, phase), B_FILTER_BITMAP_BILINEAR);
+	fPixelsRendered += area;
+
+	view->Sync();
+
+	fTestDuration += system_time() - now;
+	fIterations++;
+
+	return fIterations < fMaxIterations;
+}
+
+
+void
+LargeFillTest::PrintResults(BView* view)
+{
+	if (fTestDuration == 0) {
+		printf("Test was not run.\n");
+		return;
+	}
+	bigtime_t timeLeak = system_time() - fTestStart - fTestDuration;
+
+	Test::PrintResults(view);
+
+	system_info info;
+	get_system_info(&info);
+	const char* threads = getenv("APP_SERVER_RENDERING_THREADS");
+
+	printf("CPUs: %" B_PRIu32 "\n", info.cpu_count);
+	printf("APP_SERVER_RENDERING_THREADS: %s\n",
+		threads != NULL ? threads : "(not set)");
+	printf("View size: %" B_PRId32 "x%" B_PRId32 "\n",
+		fViewBounds.IntegerWidth() + 1, fViewBounds.IntegerHeight() + 1);
+	printf("Total pixels rendered: %" B_PRIu64 "\n", fPixelsRendered);
+	printf("Megapixels per second: %.3f\n",
+		fPixelsRendered / (double)fTestDuration);
+	printf("Average time per iteration: %.3f ms\n",
+		fTestDuration / 1000.0 / fIterations);
+	printf("Average time between iterations: %.4f seconds.\n",
+		(float)timeLeak / fIterations / 1000000);
+}
+
+
+Test*
+LargeFillTest::CreateTest()
+{
+	return new LargeFillTest();
+}
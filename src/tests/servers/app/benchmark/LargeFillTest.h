@@ -0,0 +1,42 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef LARGE_FILL_TEST_H
+#define LARGE_FILL_TEST_H
+
+#include <Rect.h>
+
+#include "Test.h"
+
+class BBitmap;
+
+/*!	Draws view sized gradients, a polygon and a scaled bitmap, which are the
+	operations app_server splits into bands for its rendering threads. Run it
+	with different APP_SERVER_RENDERING_THREADS settings for the (test)
+	app_server, and with --size to see how it scales with the number of cores.
+*/
+class LargeFillTest : public Test {
+public:
+								LargeFillTest();
+	virtual						~LargeFillTest();
+
+	virtual	void				Prepare(BView* view);
+	virtual	bool				RunIteration(BView* view);
+	virtual	void				PrintResults(BView* view);
+
+	static	Test*				CreateTest();
+
+private:
+	bigtime_t					fTestDuration;
+	bigtime_t					fTestStart;
+	uint64						fPixelsRendered;
+
+	uint32						fIterations;
+	uint32						fMaxIterations;
+
+	BRect						fViewBounds;
+	BBitmap*					fBitmap;
+};
+
+#endif // LARGE_FILL_TEST_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "SmallCommandTest.h"
+
+#include <stdio.h>
+
+#include <View.h>
+
+#include "TestSupport.h"
+
+
+SmallCommandTest::SmallCommandTest()
+	: Test(),
+	  fTestDuration(0),
+	  fTestStart(-1),
+
+	  fCommandsIssued(0),
+	  fCommandsPerIteration(2000),
+
+	  fIterations(0),
+	  fMaxIterations(500),
+
+	  fViewBounds(0, 0, -1, -1)
+{
+}
+
+
+SmallCommandTest::~SmallCommandTest()
+{
+}
+
+
+void
+SmallCommandTest::Prepare(BView* view)
+{
+	fViewBounds = view->Bounds();
+
+	fTestDuration = 0;
+	fCommandsIssued = 0;
+	fIterations = 0;
+	fTestStart = system_time();
+}
+
+
+bool
+SmallCommandTest::RunIteration(BView* view)
+{
+	static const char* kStrings[] = { "OK", "Cancel", "42", "File", "Edit" };
+	static const uint32 kStringCount = sizeof(kStrings) / sizeof(kStrings[0]);
+
+	bigtime_t now = system_time();
+
+	for (uint32 i = 0; i < fCommandsPerIteration; i += 2) {
+		BPoint a;
+		a.x = random_number_between(fViewBounds.left, fViewBounds.right - 8);
+		a.y = random_number_between(fViewBounds.top + 12, fViewBounds.bottom);
+
+		view->StrokeLine(a, a + BPoint(8, 0));
+		view->DrawString(kStrings[i / 2 % kStringCount], a);
+
+		fCommandsIssued += 2;
+	}
+
+	view->Sync();
+
+	fTestDuration += system_time() - now;
+	fIterations++;
+
+	return fIterations < fMaxIterations;
+}
+
+
+void
+SmallCommandTest::PrintResults(BView* view)
+{
+	if (fTestDuration == 0) {
+		printf("Test was not run.\n");
+		return;
+	}
+	bigtime_t timeLeak = system_time() - fTestStart - fTestDuration;
+
+	Test::PrintResults(view);
+
+	printf("Commands per iteration: %" B_PRIu32 "\n", fCommandsPerIteration);
+	printf("Total commands issued: %" B_PRIu64 "\n", fCommandsIssued);
+	printf("Commands per second: %.3f\n",
+		fCommandsIssued * 1000000.0 / fTestDuration);
+	printf("Average time between iterations: %.4f seconds.\n",
+		(float)timeLeak / fIterations / 1000000);
+}
+
+
+Test*
+SmallCommandTest::CreateTest()
+{
+	return new SmallCommandTest();
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SMALL_COMMAND_TEST_H
+#define SMALL_COMMAND_TEST_H
+
+#include <Rect.h>
+
+#include "Test.h"
+
+/*!	Issues many short StrokeLine() and DrawString() calls, which take next to
+	no time to render, so that the result mostly shows how fast drawing
+	commands get from the client to app_server.
+*/
+class SmallCommandTest : public Test {
+public:
+								SmallCommandTest();
+	virtual						~SmallCommandTest();
+
+	virtual	void				Prepare(BView* view);
+	virtual	bool				RunIteration(BView* view);
+	virtual	void				PrintResults(BView* view);
+
+	static	Test*				CreateTest();
+
+private:
+	bigtime_t					fTestDuration;
+	bigtime_t					fTestStart;
+
+	uint64						fCommandsIssued;
+	uint32						fCommandsPerIteration;
+
+	uint32						fIterations;
+	uint32						fMaxIterations;
+
+	BRect						fViewBounds;
+};
+
+#endif // SMALL_COMMAND_TEST_H
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//! Measures the span throughput of the scalar and SIMD drawing modes.
+
+
+#include <OS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DrawingModeAlphaCOSolid.h"
+#include "DrawingModeAlphaPC.h"
+#include "DrawingModeAlphaPOSolid.h"
+#include "DrawingModeBlend.h"
+#include "DrawingModeCopy.h"
+#include "DrawingModeOverSolid.h"
+#include "DrawingModeSIMD.h"
+#include "PatternHandler.h"
+
+
+extern const char* __progname;
+
+static const simd_span_blenders kScalarSpanBlenders = {
+	"scalar",
+
+	blend_solid_hspan_over_solid,
+	blend_solid_hspan_alpha_co_solid,
+	blend_solid_hspan_alpha_po_solid,
+
+	blend_color_hspan_over,
+	blend_color_hspan_copy,
+	blend_color_hspan_blend,
+	blend_color_hspan_alpha_co,
+	blend_color_hspan_alpha_pc,
+	blend_color_hspan_alpha_po
+};
+
+struct solid_span_mode {
+	const char*						name;
+	PixelFormat::blend_solid_span	simd_span_blenders::*function;
+};
+
+struct color_span_mode {
+	const char*						name;
+	PixelFormat::blend_color_span	simd_span_blenders::*function;
+};
+
+static const solid_span_mode kSolidSpanModes[] = {
+	{ "over solid", &simd_span_blenders::solid_hspan_over_solid },
+	{ "alpha co solid", &simd_span_blenders::solid_hspan_alpha_co_solid },
+	{ "alpha po solid", &simd_span_blenders::solid_hspan_alpha_po_solid },
+};
+
+static const color_span_mode kColorSpanModes[] = {
+	{ "over", &simd_span_blenders::color_hspan_over },
+	{ "copy", &simd_span_blenders::color_hspan_copy },
+	{ "blend", &simd_span_blenders::color_hspan_blend },
+	{ "alpha co", &simd_span_blenders::color_hspan_alpha_co },
+	{ "alpha pc", &simd_span_blenders::color_hspan_alpha_pc },
+	{ "alpha po", &simd_span_blenders::color_hspan_alpha_po },
+};
+
+
+static int
+available_span_blenders(const simd_span_blenders** blenders)
+{
+	int count = 0;
+	blenders[count++] = &kScalarSpanBlenders;
+#if defined(__x86_64__)
+	blenders[count++] = &gSSE2SpanBlenders;
+	if (__builtin_cpu_supports("avx2"))
+		blenders[count++] = &gAVX2SpanBlenders;
+#elif defined(__aarch64__)
+	blenders[count++] = &gNEONSpanBlenders;
+#endif
+	return count;
+}
+
+
+/*!	Mimics a typical user interface: mostly opaque or fully transparent
+	pixels, and anti-aliased edges.
+*/
+static uint8
+interface_alpha()
+{
+	int value = rand() % 8;
+	if (value < 5)
+		return 255;
+	if (value < 7)
+		return 0;
+	return rand() % 256;
+}
+
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: %s [-w <span width>] [-n <rounds>]\n",
+		__progname);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int width = 3840;
+	int rounds = 2000;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-w") && i + 1 < argc)
+			width = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			rounds = atoi(argv[++i]);
+		else
+			usage();
+	}
+	if (width <= 0 || rounds <= 0)
+		usage();
+
+	uint8* bits = (uint8*)malloc(width * 4);
+	color_type* colors = (color_type*)malloc(width * sizeof(color_type));
+	uint8* covers = (uint8*)malloc(width);
+	if (bits == NULL || colors == NULL || covers == NULL) {
+		fprintf(stderr, "%s: out of memory\n", __progname);
+		return 1;
+	}
+
+	for (int i = 0; i < width; i++) {
+		colors[i].r = rand() % 256;
+		colors[i].g = rand() % 256;
+		colors[i].b = rand() % 256;
+		colors[i].a = interface_alpha();
+		covers[i] = interface_alpha();
+	}
+
+	agg::rendering_buffer buffer(bits, width, 1, width * 4);
+	PatternHandler pattern;
+	rgb_color high = { 40, 80, 160, 200 };
+	rgb_color low = { 255, 255, 255, 255 };
+	pattern.SetColors(high, low);
+	color_type color(high.red, high.green, high.blue, high.alpha);
+
+	const simd_span_blenders* blenders[4];
+	int count = available_span_blenders(blenders);
+
+	printf("%-24s", "Mpixels/s");
+	for (int i = 0; i < count; i++)
+		printf("%10s", blenders[i]->name);
+	printf("\n");
+
+	for (size_t j = 0; j < B_COUNT_OF(kSolidSpanModes); j++) {
+		printf("%-24s", kSolidSpanModes[j].name);
+		for (int i = 0; i < count; i++) {
+			PixelFormat::blend_solid_span function
+				= blenders[i]->*kSolidSpanModes[j].function;
+			if (function == NULL) {
+				printf("%10s", "-");
+				continue;
+			}
+			memset(bits, 0xff, width * 4);
+
+			bigtime_t start = system_time();
+			for (int round = 0; round < rounds; round++)
+				function(0, 0, width, color, covers, &buffer, &pattern);
+			bigtime_t time = system_time() - start;
+
+			printf("%10.1f", (double)width * rounds / max_c(time, 1));
+		}
+		printf("\n");
+	}
+
+	for (int withCovers = 1; withCovers >= 0; withCovers--) {
+		for (size_t j = 0; j < B_COUNT_OF(kColorSpanModes); j++) {
+			char name[32];
+			snprintf(name, sizeof(name), "%s%s", kColorSpanModes[j].name,
+				withCovers ? "" : " (no covers)");
+			printf("%-24s", name);
+
+			for (int i = 0; i < count; i++) {
+				PixelFormat::blend_color_span function
+					= blenders[i]->*kColorSpanModes[j].function;
+				if (function == NULL) {
+					printf("%10s", "-");
+					continue;
+				}
+				memset(bits, 0xff, width * 4);
+
+				bigtime_t start = system_time();
+				for (int round = 0; round < rounds; round++) {
+					function(0, 0, width, colors, withCovers ? covers : NULL,
+						255, &buffer, &pattern);
+				}
+				bigtime_t time = system_time() - start;
+
+				printf("%10.1f", (double)width * rounds / max_c(time, 1));
+			}
+			printf("\n");
+		}
+	}
+
+	free(bits);
+	free(colors);
+	free(covers);
+	return 0;
+}
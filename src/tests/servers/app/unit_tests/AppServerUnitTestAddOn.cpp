@@ -6,6 +6,10 @@
 #include <TestSuite.h>
 #include <TestSuiteAddon.h>
 
+#if defined(__x86_64__) || defined(__aarch64__)
+#	include "DrawBitmapBilinearTest.h"
+#endif
+#include "DrawingModeSIMDTest.h"
 #include "SimpleTransformTest.h"
 
 
@@ -14,6 +18,10 @@ getTestSuite()
 {
 	BTestSuite* suite = new BTestSuite("AppServerUnitTests");
 
+#if defined(__x86_64__) || defined(__aarch64__)
+	DrawBitmapBilinearTest::AddTests(*suite);
+#endif
+	DrawingModeSIMDTest::AddTests(*suite);
 	SimpleTransformTest::AddTests(*suite);
 
 	return suite;
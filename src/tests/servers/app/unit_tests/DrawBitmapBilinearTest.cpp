@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "DrawBitmapBilinearTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+
+#include "DrawBitmapBilinear.h"
+
+
+using namespace BitmapPainterPrivate;
+
+
+static const int kSourceWidth = 48;
+static const int kSourceHeight = 2;
+static const int kDestinationWidth = 80;
+static const int kIterations = 50000;
+
+
+/*!	The inner x-loop of BilinearDefault for the given color type and drawing
+	mode, as the vectorized versions have to reproduce it.
+*/
+template<class ColorType, class DrawMode>
+static void
+bilinear_scale_xloop_generic(const uint8* src, uint8* dst,
+	const FilterInfo* xWeights, int32 xMin, int32 xMax, uint16 wTop,
+	uint32 srcBytesPerRow)
+{
+	for (int32 x = xMin; x <= xMax; x++) {
+		const uint16 wLeft = xWeights[x].weight;
+		uint32 t[4];
+		ColorType::Interpolate(&t[0], src + xWeights[x].index,
+			srcBytesPerRow, wLeft, wTop, 255 - wLeft, 255 - wTop);
+		DrawMode::Blend(dst, &t[0]);
+	}
+}
+
+
+/*!	Weights and values of 0 and 255 take special paths in the scalar code,
+	so they are chosen a lot more often than the others.
+*/
+static uint8
+random_value()
+{
+	switch (rand() % 4) {
+		case 0:
+			return 0;
+		case 1:
+			return 255;
+		default:
+			return rand() % 256;
+	}
+}
+
+
+static void
+check_xloop(bilinear_scale_xloop generic, bilinear_scale_xloop vectorized)
+{
+	uint8 source[kSourceWidth * 4 * kSourceHeight];
+	uint8 genericBits[kDestinationWidth * 4];
+	uint8 vectorizedBits[kDestinationWidth * 4];
+	FilterInfo xWeights[kDestinationWidth];
+
+	for (int i = 0; i < kIterations; i++) {
+		for (size_t j = 0; j < sizeof(source); j++)
+			source[j] = random_value();
+		for (size_t j = 0; j < sizeof(genericBits); j++)
+			genericBits[j] = random_value();
+		memcpy(vectorizedBits, genericBits, sizeof(genericBits));
+
+		for (int j = 0; j < kDestinationWidth; j++) {
+			xWeights[j].index = (rand() % (kSourceWidth - 1)) * 4;
+			xWeights[j].weight = random_value();
+		}
+
+		int32 xMin = rand() % 8;
+		int32 xMax = xMin - 1 + rand() % (kDestinationWidth - xMin + 1);
+		uint16 wTop = random_value();
+
+		generic(source, genericBits, xWeights, xMin, xMax, wTop,
+			kSourceWidth * 4);
+		vectorized(source, vectorizedBits, xWeights, xMin, xMax, wTop,
+			kSourceWidth * 4);
+
+		CPPUNIT_ASSERT(memcmp(genericBits, vectorizedBits,
+			sizeof(genericBits)) == 0);
+	}
+}
+
+
+void
+DrawBitmapBilinearTest::Copy()
+{
+	check_xloop(bilinear_scale_xloop_generic<ColorTypeRgb, DrawModeCopy>,
+		bilinear_scale_xloop_copy);
+}
+
+
+void
+DrawBitmapBilinearTest::AlphaOverlay()
+{
+	check_xloop(
+		bilinear_scale_xloop_generic<ColorTypeRgba, DrawModeAlphaOverlay>,
+		bilinear_scale_xloop_alpha_overlay);
+}
+
+
+void
+DrawBitmapBilinearTest::AddTests(BTestSuite& parent)
+{
+	CppUnit::TestSuite* const suite = new CppUnit::TestSuite(
+		"DrawBitmapBilinearTest");
+
+	suite->addTest(new CppUnit::TestCaller<DrawBitmapBilinearTest>(
+		"DrawBitmapBilinearTest::Copy", &DrawBitmapBilinearTest::Copy));
+	suite->addTest(new CppUnit::TestCaller<DrawBitmapBilinearTest>(
+		"DrawBitmapBilinearTest::AlphaOverlay",
+		&DrawBitmapBilinearTest::AlphaOverlay));
+
+	parent.addTest("DrawBitmapBilinearTest", suite);
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DRAW_BITMAP_BILINEAR_TEST_H
+#define DRAW_BITMAP_BILINEAR_TEST_H
+
+#include <TestCase.h>
+#include <TestSuite.h>
+
+
+class DrawBitmapBilinearTest : public BTestCase {
+public:
+	static	void			AddTests(BTestSuite& parent);
+
+			void			Copy();
+			void			AlphaOverlay();
+};
+
+
+#endif // DRAW_BITMAP_BILINEAR_TEST_H
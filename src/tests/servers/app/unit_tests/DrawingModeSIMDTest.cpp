@@ -0,0 +1,263 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "DrawingModeSIMDTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <String.h>
+
+#include <cppunit/TestCaller.h>
+#include <cppunit/TestSuite.h>
+
+#include "DrawingModeAlphaCOSolid.h"
+#include "DrawingModeAlphaPC.h"
+#include "DrawingModeAlphaPOSolid.h"
+#include "DrawingModeBlend.h"
+#include "DrawingModeCopy.h"
+#include "DrawingModeOverSolid.h"
+#include "DrawingModeSIMD.h"
+#include "PatternHandler.h"
+
+
+static const int kSpanWidth = 72;
+static const int kIterations = 20000;
+
+
+struct solid_span_mode {
+	const char*						name;
+	PixelFormat::blend_solid_span	scalar;
+	PixelFormat::blend_solid_span	simd_span_blenders::*simd;
+};
+
+struct color_span_mode {
+	const char*						name;
+	PixelFormat::blend_color_span	scalar;
+	PixelFormat::blend_color_span	simd_span_blenders::*simd;
+};
+
+
+static const solid_span_mode kSolidSpanModes[] = {
+	{ "over solid", blend_solid_hspan_over_solid,
+		&simd_span_blenders::solid_hspan_over_solid },
+	{ "alpha co solid", blend_solid_hspan_alpha_co_solid,
+		&simd_span_blenders::solid_hspan_alpha_co_solid },
+	{ "alpha po solid", blend_solid_hspan_alpha_po_solid,
+		&simd_span_blenders::solid_hspan_alpha_po_solid },
+};
+
+static const color_span_mode kColorSpanModes[] = {
+	{ "over", blend_color_hspan_over,
+		&simd_span_blenders::color_hspan_over },
+	{ "copy", blend_color_hspan_copy,
+		&simd_span_blenders::color_hspan_copy },
+	{ "blend", blend_color_hspan_blend,
+		&simd_span_blenders::color_hspan_blend },
+	{ "alpha co", blend_color_hspan_alpha_co,
+		&simd_span_blenders::color_hspan_alpha_co },
+	{ "alpha pc", blend_color_hspan_alpha_pc,
+		&simd_span_blenders::color_hspan_alpha_pc },
+	{ "alpha po", blend_color_hspan_alpha_po,
+		&simd_span_blenders::color_hspan_alpha_po },
+};
+
+
+/*!	Returns the span blenders the CPU running the test can execute.
+*/
+static int
+available_span_blenders(const simd_span_blenders** blenders)
+{
+	int count = 0;
+#if defined(__x86_64__)
+	blenders[count++] = &gSSE2SpanBlenders;
+	if (__builtin_cpu_supports("avx2"))
+		blenders[count++] = &gAVX2SpanBlenders;
+#elif defined(__aarch64__)
+	blenders[count++] = &gNEONSpanBlenders;
+#endif
+	return count;
+}
+
+
+/*!	Values of 0 and 255 take different paths through the drawing modes,
+	so they are chosen a lot more often than the others.
+*/
+static uint8
+random_value()
+{
+	switch (rand() % 4) {
+		case 0:
+			return 0;
+		case 1:
+			return 255;
+		default:
+			return rand() % 256;
+	}
+}
+
+
+static rgb_color
+random_color()
+{
+	rgb_color color;
+	color.red = rand() % 256;
+	color.green = rand() % 256;
+	color.blue = rand() % 256;
+	color.alpha = random_value();
+	return color;
+}
+
+
+struct span_test_data {
+	uint8			scalarBits[kSpanWidth * 4];
+	uint8			simdBits[kSpanWidth * 4];
+	color_type		colors[kSpanWidth];
+	uint8			covers[kSpanWidth];
+	PatternHandler	pattern;
+	int				x;
+	unsigned		length;
+
+	void Randomize()
+	{
+		// Half of the spans are drawn onto an opaque frame buffer
+		bool opaque = (rand() & 1) != 0;
+		for (int i = 0; i < kSpanWidth * 4; i++) {
+			if (i % 4 == 3 && opaque)
+				scalarBits[i] = 255;
+			else
+				scalarBits[i] = random_value();
+		}
+		memcpy(simdBits, scalarBits, sizeof(simdBits));
+
+		for (int i = 0; i < kSpanWidth; i++) {
+			colors[i].r = rand() % 256;
+			colors[i].g = rand() % 256;
+			colors[i].b = rand() % 256;
+			colors[i].a = random_value();
+			covers[i] = random_value();
+		}
+
+		pattern.SetColors(random_color(), random_color());
+		if (rand() % 8 == 0)
+			pattern.SetPattern(B_SOLID_LOW);
+		else
+			pattern.SetPattern(B_SOLID_HIGH);
+
+		x = rand() % 8;
+		length = 1 + rand() % (kSpanWidth - x);
+	}
+
+	bool Matches() const
+	{
+		return memcmp(scalarBits, simdBits, sizeof(simdBits)) == 0;
+	}
+};
+
+
+static void
+check_color_spans(bool withCovers)
+{
+	const simd_span_blenders* blenders[4];
+	int count = available_span_blenders(blenders);
+
+	span_test_data data;
+	agg::rendering_buffer scalarBuffer(data.scalarBits, kSpanWidth, 1,
+		kSpanWidth * 4);
+	agg::rendering_buffer simdBuffer(data.simdBits, kSpanWidth, 1,
+		kSpanWidth * 4);
+
+	for (int i = 0; i < count; i++) {
+		for (size_t j = 0; j < B_COUNT_OF(kColorSpanModes); j++) {
+			const color_span_mode& mode = kColorSpanModes[j];
+			if (blenders[i]->*mode.simd == NULL)
+				continue;
+
+			for (int k = 0; k < kIterations; k++) {
+				data.Randomize();
+				const uint8* covers = withCovers ? data.covers : NULL;
+				uint8 cover = random_value();
+
+				mode.scalar(data.x, 0, data.length, data.colors, covers,
+					cover, &scalarBuffer, &data.pattern);
+				(blenders[i]->*mode.simd)(data.x, 0, data.length,
+					data.colors, covers, cover, &simdBuffer, &data.pattern);
+
+				BString message;
+				message << blenders[i]->name << " " << mode.name;
+				CPPUNIT_ASSERT_MESSAGE(message.String(), data.Matches());
+			}
+		}
+	}
+}
+
+
+void
+DrawingModeSIMDTest::SolidSpans()
+{
+	const simd_span_blenders* blenders[4];
+	int count = available_span_blenders(blenders);
+
+	span_test_data data;
+	agg::rendering_buffer scalarBuffer(data.scalarBits, kSpanWidth, 1,
+		kSpanWidth * 4);
+	agg::rendering_buffer simdBuffer(data.simdBits, kSpanWidth, 1,
+		kSpanWidth * 4);
+
+	for (int i = 0; i < count; i++) {
+		for (size_t j = 0; j < B_COUNT_OF(kSolidSpanModes); j++) {
+			const solid_span_mode& mode = kSolidSpanModes[j];
+			if (blenders[i]->*mode.simd == NULL)
+				continue;
+
+			for (int k = 0; k < kIterations; k++) {
+				data.Randomize();
+
+				mode.scalar(data.x, 0, data.length, data.colors[0],
+					data.covers, &scalarBuffer, &data.pattern);
+				(blenders[i]->*mode.simd)(data.x, 0, data.length,
+					data.colors[0], data.covers, &simdBuffer, &data.pattern);
+
+				BString message;
+				message << blenders[i]->name << " " << mode.name;
+				CPPUNIT_ASSERT_MESSAGE(message.String(), data.Matches());
+			}
+		}
+	}
+}
+
+
+void
+DrawingModeSIMDTest::ColorSpans()
+{
+	check_color_spans(true);
+}
+
+
+void
+DrawingModeSIMDTest::ColorSpansWithoutCovers()
+{
+	check_color_spans(false);
+}
+
+
+void
+DrawingModeSIMDTest::AddTests(BTestSuite& parent)
+{
+	CppUnit::TestSuite* const suite = new CppUnit::TestSuite(
+		"DrawingModeSIMDTest");
+
+	suite->addTest(new CppUnit::TestCaller<DrawingModeSIMDTest>(
+		"DrawingModeSIMDTest::SolidSpans",
+		&DrawingModeSIMDTest::SolidSpans));
+	suite->addTest(new CppUnit::TestCaller<DrawingModeSIMDTest>(
+		"DrawingModeSIMDTest::ColorSpans",
+		&DrawingModeSIMDTest::ColorSpans));
+	suite->addTest(new CppUnit::TestCaller<DrawingModeSIMDTest>(
+		"DrawingModeSIMDTest::ColorSpansWithoutCovers",
+		&DrawingModeSIMDTest::ColorSpansWithoutCovers));
+
+	parent.addTest("DrawingModeSIMDTest", suite);
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DRAWING_MODE_SIMD_TEST_H
+#define DRAWING_MODE_SIMD_TEST_H
+
+#include <TestCase.h>
+#include <TestSuite.h>
+
+
+class DrawingModeSIMDTest : public BTestCase {
+public:
+	static	void			AddTests(BTestSuite& parent);
+
+			void			SolidSpans();
+			void			ColorSpans();
+			void			ColorSpansWithoutCovers();
+};
+
+
+#endif // DRAWING_MODE_SIMD_TEST_H
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares poll() with event queues for growing numbers of mostly idle FDs.
+
+	For every FD count N pipes are created, and in each round a single byte
+	is written to one of them. Then the readable pipe is searched via poll()
+	respectively event_queue_wait(), and the byte is read again.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const int kRounds = 10000;
+
+
+struct Pipes {
+	int*	readFDs;
+	int*	writeFDs;
+	int		count;
+};
+
+
+static bool
+create_pipes(Pipes& pipes, int count)
+{
+	pipes.readFDs = new int[count];
+	pipes.writeFDs = new int[count];
+	pipes.count = 0;
+
+	for (int i = 0; i < count; i++) {
+		int fds[2];
+		if (pipe(fds) != 0) {
+			fprintf(stderr, "Failed to create pipe %d: %s\n", i,
+				strerror(errno));
+			return false;
+		}
+		pipes.readFDs[i] = fds[0];
+		pipes.writeFDs[i] = fds[1];
+		pipes.count++;
+	}
+
+	return true;
+}
+
+
+static void
+delete_pipes(Pipes& pipes)
+{
+	for (int i = 0; i < pipes.count; i++) {
+		close(pipes.readFDs[i]);
+		close(pipes.writeFDs[i]);
+	}
+
+	delete[] pipes.readFDs;
+	delete[] pipes.writeFDs;
+}
+
+
+static bigtime_t
+bench_poll(Pipes& pipes)
+{
+	struct pollfd* fds = new struct pollfd[pipes.count];
+	for (int i = 0; i < pipes.count; i++) {
+		fds[i].fd = pipes.readFDs[i];
+		fds[i].events = POLLIN;
+	}
+
+	bigtime_t startTime = system_time();
+
+	for (int round = 0; round < kRounds; round++) {
+		char byte = 0;
+		write(pipes.writeFDs[rand() % pipes.count], &byte, 1);
+
+		int count = poll(fds, pipes.count, -1);
+		for (int i = 0; i < pipes.count && count > 0; i++) {
+			if ((fds[i].revents & POLLIN) != 0) {
+				read(fds[i].fd, &byte, 1);
+				count--;
+			}
+		}
+	}
+
+	bigtime_t time = system_time() - startTime;
+	delete[] fds;
+	return time;
+}
+
+
+static bigtime_t
+bench_event_queue(Pipes& pipes, int32 behavior)
+{
+	int queue = event_queue_create(O_CLOEXEC);
+	if (queue < 0) {
+		fprintf(stderr, "Failed to create event queue: %s\n",
+			strerror(queue));
+		return -1;
+	}
+
+	event_wait_info* infos = new event_wait_info[pipes.count];
+	for (int i = 0; i < pipes.count; i++) {
+		infos[i].object = pipes.readFDs[i];
+		infos[i].type = B_OBJECT_TYPE_FD;
+		infos[i].events = B_EVENT_READ | behavior;
+		infos[i].user_data = NULL;
+	}
+
+	status_t status = event_queue_select(queue, infos, pipes.count);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to select FDs: %s\n", strerror(status));
+		delete[] infos;
+		close(queue);
+		return -1;
+	}
+
+	bigtime_t startTime = system_time();
+
+	for (int round = 0; round < kRounds; round++) {
+		char byte = 0;
+		write(pipes.writeFDs[rand() % pipes.count], &byte, 1);
+
+		ssize_t count = event_queue_wait(queue, infos, pipes.count, 0, 0);
+		for (ssize_t i = 0; i < count; i++) {
+			if ((infos[i].events & B_EVENT_READ) != 0)
+				read(infos[i].object, &byte, 1);
+		}
+	}
+
+	bigtime_t time = system_time() - startTime;
+	delete[] infos;
+	close(queue);
+	return time;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	static const int kFDCounts[] = { 100, 1000, 10000 };
+	static const int kFDCountCount = sizeof(kFDCounts) / sizeof(kFDCounts[0]);
+
+	struct rlimit limit;
+	limit.rlim_cur = limit.rlim_max
+		= 2 * kFDCounts[kFDCountCount - 1] + 64;
+	if (setrlimit(RLIMIT_NOFILE, &limit) != 0) {
+		fprintf(stderr, "Failed to raise the FD limit: %s\n",
+			strerror(errno));
+	}
+
+	printf("%8s %16s %16s %16s\n", "FDs", "poll()", "level-triggered",
+		"edge-triggered");
+
+	for (int i = 0; i < kFDCountCount; i++) {
+		Pipes pipes;
+		if (!create_pipes(pipes, kFDCounts[i])) {
+			delete_pipes(pipes);
+			return 1;
+		}
+
+		bigtime_t pollTime = bench_poll(pipes);
+		bigtime_t levelTime = bench_event_queue(pipes,
+			B_EVENT_LEVEL_TRIGGERED);
+		bigtime_t edgeTime = bench_event_queue(pipes, B_EVENT_EDGE_TRIGGERED);
+
+		printf("%8d %13.2f us %13.2f us %13.2f us\n", kFDCounts[i],
+			(double)pollTime / kRounds, (double)levelTime / kRounds,
+			(double)edgeTime / kRounds);
+
+		delete_pipes(pipes);
+	}
+
+	return 0;
+}
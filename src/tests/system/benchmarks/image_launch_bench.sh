@@ -0,0 +1,87 @@
+#!/bin/sh
+
+# Measures the image launch time, i.e. the time the runtime loader needs to
+# load a program depending on many shared objects and to resolve all of their
+# relocations. The shared objects export lots of symbols, and every one of
+# them references symbols of all the objects loaded before it, so that
+# symbol lookups miss in most of the images searched.
+#
+# Usage: image_launch_bench.sh [ <hash style> [ <libraries> [ <symbols> \
+#	[ <runs> ] ] ] ]
+#
+# <hash style> is passed to the linker's --hash-style option. Use "sysv" to
+# measure the SysV hash table lookup and "both" to have the runtime loader
+# use the GNU hash table.
+
+hashStyle=${1-both}
+libraryCount=${2-100}
+symbolCount=${3-500}
+runCount=${4-100}
+
+testDir=/tmp/image_launch_bench
+rm -rf $testDir
+mkdir -p $testDir
+cd $testDir
+
+libraries=
+for lib in $(seq $libraryCount); do
+	echo -n .
+	{
+		for symbol in $(seq $symbolCount); do
+			echo "int lib${lib}_function${symbol}() { return $symbol; }"
+		done
+
+		# reference one symbol of every previously generated library
+		if [ $lib -gt 1 ]; then
+			for other in $(seq $(($lib - 1))); do
+				echo "extern int lib${other}_function${lib}();"
+			done
+		fi
+		echo "int lib${lib}_entry() {"
+		echo "	int result = 0;"
+		if [ $lib -gt 1 ]; then
+			for other in $(seq $(($lib - 1))); do
+				echo "	result += lib${other}_function${lib}();"
+			done
+		fi
+		echo "	return result;"
+		echo "}"
+	} > lib${lib}.c
+
+	gcc -shared -fPIC -Wl,--hash-style=$hashStyle -o lib${lib}.so \
+		lib${lib}.c $libraries || exit 1
+	libraries="$libraries ./lib${lib}.so"
+done
+echo
+
+cat << EOF > program.c
+extern int lib${libraryCount}_entry();
+
+int
+main()
+{
+	lib${libraryCount}_entry();
+	return 0;
+}
+EOF
+
+gcc -Wl,--hash-style=$hashStyle -Wl,-rpath,. -o program program.c \
+	$libraries || exit 1
+
+export LIBRARY_PATH=.:$LIBRARY_PATH
+export LD_LIBRARY_PATH=.:$LD_LIBRARY_PATH
+export LD_BIND_NOW=1
+	# make glibc resolve everything at startup, like our runtime loader does
+
+launch_all()
+{
+	for run in $(seq $runCount); do
+		./program
+	done
+}
+
+echo "$libraryCount libraries, $symbolCount symbols each," \
+	"hash style $hashStyle, $runCount launches:"
+time launch_all
+
+rm -rf $testDir
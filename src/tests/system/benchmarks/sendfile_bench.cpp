@@ -0,0 +1,217 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the throughput of serving a large file over a loopback TCP
+	connection, once with read()/write() through a user buffer, and once with
+	sendfile().
+
+	Usage: sendfile_bench [ <file size in MB> [ <runs> ] ]
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const size_t kBufferSize = 64 * 1024;
+
+
+static void*
+receiver_thread(void* data)
+{
+	int listenSocket = *(int*)data;
+	char* buffer = (char*)malloc(kBufferSize);
+
+	while (true) {
+		int connection = accept(listenSocket, NULL, NULL);
+		if (connection < 0)
+			break;
+
+		while (recv(connection, buffer, kBufferSize, 0) > 0)
+			;
+
+		close(connection);
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+
+static int
+connect_to(const sockaddr_in& address)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, (const sockaddr*)&address, sizeof(address)) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+
+static void
+finish_connection(int fd)
+{
+	// wait until the receiver has read everything and closed its end
+	shutdown(fd, SHUT_WR);
+	char dummy;
+	while (recv(fd, &dummy, 1, 0) > 0)
+		;
+	close(fd);
+}
+
+
+static bigtime_t
+serve_with_copy(const sockaddr_in& address, int file, off_t size)
+{
+	int fd = connect_to(address);
+	if (fd < 0)
+		return -1;
+
+	char* buffer = (char*)malloc(kBufferSize);
+	bigtime_t startTime = system_time();
+
+	off_t offset = 0;
+	while (offset < size) {
+		ssize_t bytesRead = pread(file, buffer, kBufferSize, offset);
+		if (bytesRead <= 0)
+			break;
+
+		ssize_t bytesWritten = 0;
+		while (bytesWritten < bytesRead) {
+			ssize_t written = write(fd, buffer + bytesWritten,
+				bytesRead - bytesWritten);
+			if (written <= 0)
+				break;
+			bytesWritten += written;
+		}
+
+		offset += bytesRead;
+	}
+
+	finish_connection(fd);
+	bigtime_t time = system_time() - startTime;
+
+	free(buffer);
+	return time;
+}
+
+
+static bigtime_t
+serve_with_sendfile(const sockaddr_in& address, int file, off_t size)
+{
+	int fd = connect_to(address);
+	if (fd < 0)
+		return -1;
+
+	bigtime_t startTime = system_time();
+
+	off_t offset = 0;
+	while (offset < size) {
+		ssize_t bytesSent = sendfile(fd, file, &offset, size - offset);
+		if (bytesSent <= 0) {
+			fprintf(stderr, "sendfile() failed: %s\n", strerror(errno));
+			break;
+		}
+	}
+
+	finish_connection(fd);
+	return system_time() - startTime;
+}
+
+
+static void
+print_result(const char* name, off_t size, bigtime_t time)
+{
+	if (time <= 0) {
+		printf("%-12s failed\n", name);
+		return;
+	}
+
+	printf("%-12s %8.1f MB/s\n", name,
+		(double)size / (1024 * 1024) / (time / 1000000.0));
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	off_t size = (off_t)(argc > 1 ? atoi(argv[1]) : 256) * 1024 * 1024;
+	int runs = argc > 2 ? atoi(argv[2]) : 5;
+	if (size <= 0 || runs <= 0) {
+		fprintf(stderr, "Usage: %s [ <file size in MB> [ <runs> ] ]\n",
+			argv[0]);
+		return 1;
+	}
+
+	// create the file to serve and get it into the cache
+	char path[] = "/tmp/sendfile_bench-XXXXXX";
+	int file = mkstemp(path);
+	if (file < 0) {
+		fprintf(stderr, "Failed to create file: %s\n", strerror(errno));
+		return 1;
+	}
+	unlink(path);
+
+	char* buffer = (char*)malloc(kBufferSize);
+	for (size_t i = 0; i < kBufferSize; i++)
+		buffer[i] = (char)i;
+	for (off_t offset = 0; offset < size; offset += kBufferSize) {
+		if (pwrite(file, buffer, kBufferSize, offset) != (ssize_t)kBufferSize) {
+			fprintf(stderr, "Failed to write file: %s\n", strerror(errno));
+			return 1;
+		}
+	}
+	free(buffer);
+
+	// set up the receiving end
+	int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	if (listenSocket < 0
+		|| bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0
+		|| listen(listenSocket, 1) != 0
+		|| getsockname(listenSocket, (sockaddr*)&address, &addressLength)
+			!= 0) {
+		fprintf(stderr, "Failed to set up listener: %s\n", strerror(errno));
+		return 1;
+	}
+
+	pthread_t receiver;
+	pthread_create(&receiver, NULL, &receiver_thread, &listenSocket);
+
+	printf("serving %" B_PRIdOFF " MB, %d runs\n", size / (1024 * 1024),
+		runs);
+
+	for (int i = 0; i < runs; i++) {
+		print_result("read/write", size, serve_with_copy(address, file, size));
+		print_result("sendfile", size,
+			serve_with_sendfile(address, file, size));
+	}
+
+	close(listenSocket);
+	close(file);
+	return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the cost of TLB misses by chasing pointers through a large area
+	in random order, once with an area using regular pages, and once with one
+	created with B_LARGE_PAGES_AREA. Also reports how long it took to fault in
+	all pages of the area.
+
+	Usage: tlb_bench [ <area size in MB> [ <accesses in millions> ] ]
+
+	Whether large pages are used depends on the "large_pages" kernel setting,
+	and on the availability of physically contiguous memory; the "large_pages"
+	KDL command shows how many have been mapped.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <vm_defs.h>
+
+
+static const size_t kStride = B_PAGE_SIZE;
+	// one pointer per page, so that every access needs its own TLB entry
+
+
+static void
+run(const char* name, size_t size, int64 accesses, uint32 flags)
+{
+	void* address;
+	area_id area = create_area(name, &address, B_ANY_ADDRESS, size,
+		B_NO_LOCK, B_READ_AREA | B_WRITE_AREA | flags);
+	if (area < 0) {
+		fprintf(stderr, "Failed to create area: %s\n", strerror(area));
+		return;
+	}
+
+	// fault in all pages
+	bigtime_t startTime = system_time();
+	memset(address, 0, size);
+	bigtime_t faultTime = system_time() - startTime;
+
+	// link all pages in a random cycle
+	size_t count = size / kStride;
+	size_t* order = new size_t[count];
+	for (size_t i = 0; i < count; i++)
+		order[i] = i;
+
+	unsigned int seed = 42;
+	for (size_t i = count - 1; i > 0; i--) {
+		size_t j = rand_r(&seed) % (i + 1);
+		size_t temp = order[i];
+		order[i] = order[j];
+		order[j] = temp;
+	}
+
+	char* base = (char*)address;
+	for (size_t i = 0; i < count; i++) {
+		*(void**)(base + order[i] * kStride)
+			= base + order[(i + 1) % count] * kStride;
+	}
+	delete[] order;
+
+	// chase the pointers
+	void** pointer = (void**)base;
+	startTime = system_time();
+	for (int64 i = 0; i < accesses; i++)
+		pointer = (void**)*pointer;
+	bigtime_t accessTime = system_time() - startTime;
+
+	printf("%-14s fault-in %6.1f ms, %6.2f ns/access%s\n", name,
+		faultTime / 1000.0, accessTime * 1000.0 / accesses,
+		pointer == NULL ? "!" : "");
+			// use the pointer, so that the loop isn't optimized away
+
+	delete_area(area);
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 1024) * 1024 * 1024;
+	int64 accesses = (int64)(argc > 2 ? atoi(argv[2]) : 20) * 1000000;
+	if (size == 0 || accesses <= 0) {
+		fprintf(stderr, "Usage: %s [ <area size in MB> [ <accesses in "
+			"millions> ] ]\n", argv[0]);
+		return 1;
+	}
+
+	printf("area size %zu MB, %" B_PRId64 " million accesses\n",
+		size / (1024 * 1024), accesses / 1000000);
+
+	for (int i = 0; i < 3; i++) {
+		run("regular pages", size, accesses, 0);
+		run("large pages", size, accesses, B_LARGE_PAGES_AREA);
+	}
+
+	return 0;
+}
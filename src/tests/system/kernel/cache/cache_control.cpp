@@ -10,8 +10,12 @@
 
 #include <file_cache.h>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 
 extern const char *__progname;
@@ -20,11 +24,64 @@ extern const char *__progname;
 void
 usage()
 {
-	fprintf(stderr, "usage: %s [clear | unset | set <module-name>]\n", __progname);
+	fprintf(stderr, "usage: %s [clear | unset | set <module-name> | stats [<file>]\n"
+		"\t| read-ahead <max-kb>]\n", __progname);
 	exit(0);
 }
 
 
+static uint64
+percentage(uint64 hits, uint64 misses)
+{
+	if (hits + misses == 0)
+		return 0;
+	return hits * 100 / (hits + misses);
+}
+
+
+status_t
+print_stats()
+{
+	file_cache_stats stats;
+	status_t status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_GET_STATS, &stats, sizeof(stats));
+	if (status != B_OK)
+		return status;
+
+	printf("hits:              %" B_PRIu64 " pages (%" B_PRIu64 "%%)\n", stats.hits,
+		percentage(stats.hits, stats.misses));
+	printf("misses:            %" B_PRIu64 " pages\n", stats.misses);
+	printf("read ahead:        %" B_PRIu64 " pages\n", stats.read_ahead_pages);
+	printf("windows grown:     %" B_PRIu64 "\n", stats.read_ahead_grown);
+	printf("windows shrunk:    %" B_PRIu64 "\n", stats.read_ahead_shrunk);
+	printf("max. read-ahead:   %" B_PRIu32 " KB\n", stats.max_read_ahead / 1024);
+	return B_OK;
+}
+
+
+status_t
+print_file_stats(const char* path)
+{
+	file_cache_file_stats stats;
+	stats.fd = open(path, O_RDONLY);
+	if (stats.fd < 0)
+		return errno;
+
+	status_t status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_GET_FILE_STATS, &stats, sizeof(stats));
+	close(stats.fd);
+	if (status != B_OK)
+		return status;
+
+	printf("%s:\n", path);
+	printf("hits:              %" B_PRIu64 " pages (%" B_PRIu64 "%%)\n", stats.hits,
+		percentage(stats.hits, stats.misses));
+	printf("misses:            %" B_PRIu64 " pages\n", stats.misses);
+	printf("read ahead:        %" B_PRIu64 " pages\n", stats.read_ahead_pages);
+	printf("read-ahead window: %" B_PRIu32 " KB\n", stats.read_ahead_window / 1024);
+	printf("read ahead up to:  %" B_PRIdOFF "\n", stats.read_ahead_end);
+	return B_OK;
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -50,6 +107,15 @@ main(int argc, char **argv)
 		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_MODULE, argv[2], strlen(argv[2]));
 		if (status != B_OK)
 			fprintf(stderr, "%s: setting the module failed: %s\n", __progname, strerror(status));
+	} else if (!strcmp(argv[1], "stats")) {
+		status = argc > 2 ? print_file_stats(argv[2]) : print_stats();
+		if (status != B_OK)
+			fprintf(stderr, "%s: getting the statistics failed: %s\n", __progname, strerror(status));
+	} else if (!strcmp(argv[1], "read-ahead") && argc > 2) {
+		uint32 size = strtoul(argv[2], NULL, 0) * 1024;
+		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_READ_AHEAD, &size, sizeof(size));
+		if (status != B_OK)
+			fprintf(stderr, "%s: setting the read-ahead failed: %s\n", __progname, strerror(status));
 	} else
 		usage();
 
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Runs a mixed workload against a file backed disk device: a number of
+	threads issue small random reads, while others stream large sequential
+	writes. Prints the read latencies and the write throughput.
+
+	The I/O scheduler for file devices is chosen via the "io_scheduler" driver
+	settings when the device is registered, e.g. with
+		device "file device" deadline
+	so that runs with different settings can be compared without a reboot.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <OS.h>
+#include <Path.h>
+
+#include <DiskDevice.h>
+#include <DiskDeviceRoster.h>
+
+
+static const size_t kReadSize = 4096;
+static const size_t kWriteSize = 1024 * 1024;
+static const int32 kMaxSamples = 1024 * 1024;
+
+
+struct Workload {
+	const char*	device;
+	off_t		size;
+	bigtime_t	end;
+};
+
+struct ReaderResult {
+	bigtime_t*	latencies;
+	int32		count;
+};
+
+struct WriterResult {
+	off_t		bytes;
+};
+
+
+static void*
+reader_thread(void* data)
+{
+	const Workload& workload = *(const Workload*)data;
+
+	ReaderResult* result = new ReaderResult;
+	result->latencies = new bigtime_t[kMaxSamples];
+	result->count = 0;
+
+	int fd = open(workload.device, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open \"%s\": %s\n", workload.device,
+			strerror(errno));
+		return result;
+	}
+
+	char buffer[kReadSize];
+	unsigned int seed = find_thread(NULL);
+	off_t blocks = workload.size / 2 / kReadSize;
+
+	while (system_time() < workload.end && result->count < kMaxSamples) {
+		off_t offset = (off_t)(rand_r(&seed) % blocks) * kReadSize;
+
+		bigtime_t startTime = system_time();
+		if (pread(fd, buffer, kReadSize, offset) != (ssize_t)kReadSize) {
+			fprintf(stderr, "Read failed: %s\n", strerror(errno));
+			break;
+		}
+		result->latencies[result->count++] = system_time() - startTime;
+	}
+
+	close(fd);
+	return result;
+}
+
+
+static void*
+writer_thread(void* data)
+{
+	const Workload& workload = *(const Workload*)data;
+
+	WriterResult* result = new WriterResult;
+	result->bytes = 0;
+
+	int fd = open(workload.device, O_WRONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open \"%s\": %s\n", workload.device,
+			strerror(errno));
+		return result;
+	}
+
+	char* buffer = (char*)malloc(kWriteSize);
+	memset(buffer, 0x55, kWriteSize);
+
+	// the writers use the second half of the device
+	off_t start = workload.size / 2;
+	off_t offset = start;
+
+	while (system_time() < workload.end) {
+		if (offset + (off_t)kWriteSize > workload.size)
+			offset = start;
+
+		if (pwrite(fd, buffer, kWriteSize, offset) != (ssize_t)kWriteSize) {
+			fprintf(stderr, "Write failed: %s\n", strerror(errno));
+			break;
+		}
+
+		offset += kWriteSize;
+		result->bytes += kWriteSize;
+	}
+
+	free(buffer);
+	close(fd);
+	return result;
+}
+
+
+static bool
+create_file(const char* path, off_t size)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to create \"%s\": %s\n", path,
+			strerror(errno));
+		return false;
+	}
+
+	// actually write the file, so that the reads have to hit the disk
+	char* buffer = (char*)malloc(kWriteSize);
+	memset(buffer, 0xaa, kWriteSize);
+
+	bool success = true;
+	for (off_t offset = 0; offset < size; offset += kWriteSize) {
+		if (write(fd, buffer, kWriteSize) != (ssize_t)kWriteSize) {
+			fprintf(stderr, "Failed to write \"%s\": %s\n", path,
+				strerror(errno));
+			success = false;
+			break;
+		}
+	}
+
+	free(buffer);
+	close(fd);
+	return success;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-s <size in MB>] [-t <seconds>] "
+		"[-r <readers>] [-w <writers>] <file>\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	off_t size = 256;
+	int seconds = 10;
+	int readerCount = 4;
+	int writerCount = 1;
+
+	int option;
+	while ((option = getopt(argc, argv, "s:t:r:w:")) != -1) {
+		switch (option) {
+			case 's':
+				size = atoi(optarg);
+				break;
+			case 't':
+				seconds = atoi(optarg);
+				break;
+			case 'r':
+				readerCount = atoi(optarg);
+				break;
+			case 'w':
+				writerCount = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind + 1 != argc || size <= 0 || seconds <= 0 || readerCount < 1
+		|| writerCount < 0) {
+		usage(argv[0]);
+	}
+
+	const char* fileName = argv[optind];
+	size *= 1024 * 1024;
+
+	if (!create_file(fileName, size))
+		return 1;
+
+	BDiskDeviceRoster roster;
+	partition_id id = roster.RegisterFileDevice(fileName);
+	if (id < 0) {
+		fprintf(stderr, "Failed to register file device: %s\n", strerror(id));
+		return 1;
+	}
+
+	BDiskDevice device;
+	BPath path;
+	status_t status = roster.GetDeviceWithID(id, &device);
+	if (status == B_OK)
+		status = device.GetPath(&path);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to get device path: %s\n", strerror(status));
+		roster.UnregisterFileDevice(id);
+		return 1;
+	}
+
+	printf("%s: %d readers (%zu bytes), %d writers (%zu bytes), %d s\n",
+		path.Path(), readerCount, kReadSize, writerCount, kWriteSize, seconds);
+
+	Workload workload;
+	workload.device = path.Path();
+	workload.size = size;
+	workload.end = system_time() + seconds * 1000000LL;
+
+	pthread_t* threads = new pthread_t[readerCount + writerCount];
+	for (int i = 0; i < readerCount; i++)
+		pthread_create(&threads[i], NULL, &reader_thread, &workload);
+	for (int i = 0; i < writerCount; i++) {
+		pthread_create(&threads[readerCount + i], NULL, &writer_thread,
+			&workload);
+	}
+
+	// collect the results
+	bigtime_t* latencies = new bigtime_t[(size_t)readerCount * kMaxSamples];
+	int32 readCount = 0;
+	for (int i = 0; i < readerCount; i++) {
+		ReaderResult* result;
+		pthread_join(threads[i], (void**)&result);
+		memcpy(latencies + readCount, result->latencies,
+			result->count * sizeof(bigtime_t));
+		readCount += result->count;
+		delete[] result->latencies;
+		delete result;
+	}
+
+	off_t bytesWritten = 0;
+	for (int i = 0; i < writerCount; i++) {
+		WriterResult* result;
+		pthread_join(threads[readerCount + i], (void**)&result);
+		bytesWritten += result->bytes;
+		delete result;
+	}
+
+	roster.UnregisterFileDevice(id);
+
+	if (readCount > 0) {
+		std::sort(latencies, latencies + readCount);
+
+		bigtime_t total = 0;
+		for (int32 i = 0; i < readCount; i++)
+			total += latencies[i];
+
+		printf("reads:  %8" B_PRId32 " (%.1f/s)\n", readCount,
+			(double)readCount / seconds);
+		printf("  latency: avg %" B_PRIdBIGTIME " us, median %" B_PRIdBIGTIME
+			" us, 99%% %" B_PRIdBIGTIME " us, max %" B_PRIdBIGTIME " us\n",
+			total / readCount, latencies[readCount / 2],
+			latencies[(int64)readCount * 99 / 100], latencies[readCount - 1]);
+	}
+
+	if (writerCount > 0) {
+		printf("writes: %8.1f MB/s\n",
+			(double)bytesWritten / (1024 * 1024) / seconds);
+	}
+
+	delete[] latencies;
+	delete[] threads;
+	return 0;
+}
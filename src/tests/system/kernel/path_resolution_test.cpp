@@ -3,20 +3,47 @@
  * Distributed under the terms of the MIT License.
  */
 
+#include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 
 #include <OS.h>
 
 
+static const char* const kPaths[] = {
+	"/",
+	"/boot",
+	"/boot/develop",
+	"/boot/develop/headers",
+	"/boot/develop/headers/posix",
+	"/boot/develop/headers/posix/sys",
+	"/boot/develop/headers/posix/sys/stat.h",
+	NULL
+};
+
+static const char* const kMissingPaths[] = {
+	"/boot/develop/headers/posix/sys/missing.h",
+	"/boot/develop/headers/posix/missing/stat.h",
+	"/boot/develop/missing",
+	NULL
+};
+
+
+struct Workload {
+	const char* const*	paths;
+	bigtime_t			end;
+	int64				calls;
+};
+
+
 static void
-time_lstat(const char* path)
+time_lstat(const char* path, int32 iterations)
 {
 	printf("%-60s ...", path);
 	fflush(stdout);
 	bigtime_t startTime = system_time();
 
-	static const int32 iterations = 10000;
 	for (int32 i = 0; i < iterations; i++) {
 		struct stat st;
 		lstat(path, &st);
@@ -27,22 +54,107 @@ time_lstat(const char* path)
 }
 
 
+static status_t
+lstat_thread(void* data)
+{
+	Workload& workload = *(Workload*)data;
+
+	int64 calls = 0;
+	while (system_time() < workload.end) {
+		for (int32 i = 0; workload.paths[i] != NULL; i++) {
+			struct stat st;
+			lstat(workload.paths[i], &st);
+			calls++;
+		}
+	}
+
+	atomic_add64(&workload.calls, calls);
+	return B_OK;
+}
+
+
+/*!	Lets \a threadCount threads resolve the given paths concurrently for
+	\a duration, and prints the resulting throughput.
+*/
+static void
+time_parallel_lstat(const char* name, const char* const* paths,
+	int32 threadCount, bigtime_t duration)
+{
+	Workload workload;
+	workload.paths = paths;
+	workload.end = system_time() + duration;
+	workload.calls = 0;
+
+	thread_id* threads = new thread_id[threadCount];
+	for (int32 i = 0; i < threadCount; i++) {
+		threads[i] = spawn_thread(&lstat_thread, "lstat", B_NORMAL_PRIORITY,
+			&workload);
+		resume_thread(threads[i]);
+	}
+
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+	}
+	delete[] threads;
+
+	double callsPerSecond = workload.calls * 1000000.0 / duration;
+	printf("%-8s %3" B_PRId32 " threads: %12.0f calls/s, %10.0f per thread\n",
+		name, threadCount, callsPerSecond, callsPerSecond / threadCount);
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-i <iterations>] [-m <max threads>] "
+		"[-t <seconds per run>]\n", program);
+	exit(1);
+}
+
+
 int
-main()
+main(int argc, char** argv)
 {
-	const char* const paths[] = {
-		"/",
-		"/boot",
-		"/boot/develop",
-		"/boot/develop/headers",
-		"/boot/develop/headers/posix",
-		"/boot/develop/headers/posix/sys",
-		"/boot/develop/headers/posix/sys/stat.h",
-		NULL
-	};
-
-	for (int32 i = 0; paths[i] != NULL; i++)
-		time_lstat(paths[i]);
+	system_info info;
+	get_system_info(&info);
+
+	int32 iterations = 10000;
+	int32 maxThreads = info.cpu_count;
+	int seconds = 2;
+
+	int option;
+	while ((option = getopt(argc, argv, "i:m:t:")) != -1) {
+		switch (option) {
+			case 'i':
+				iterations = atoi(optarg);
+				break;
+			case 'm':
+				maxThreads = atoi(optarg);
+				break;
+			case 't':
+				seconds = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind != argc || iterations < 1 || maxThreads < 0 || seconds < 1)
+		usage(argv[0]);
+
+	for (int32 i = 0; kPaths[i] != NULL; i++)
+		time_lstat(kPaths[i], iterations);
+	for (int32 i = 0; kMissingPaths[i] != NULL; i++)
+		time_lstat(kMissingPaths[i], iterations);
+
+	// stat() storms from an increasing number of threads
+	for (int32 threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+		time_parallel_lstat("existing", kPaths, threadCount,
+			seconds * 1000000LL);
+		time_parallel_lstat("missing", kMissingPaths, threadCount,
+			seconds * 1000000LL);
+	}
 
 	return 0;
 }
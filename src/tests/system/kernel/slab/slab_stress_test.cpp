@@ -0,0 +1,234 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Stresses the kernel's object caches from userland, and prints the
+	alloc/free throughput for an increasing number of threads, together with
+	how the object depots behaved.
+
+	Every thread owns a port, and writes bursts of small messages to it that it
+	reads back right away; each message is allocated from, and freed back to,
+	one of the kernel's block allocator caches.
+
+	Usage: slab_stress_test [ -t <seconds per run> ] [ -m <max threads> ]
+		[ -s <message size> ] [ -b <burst size> ]
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <syscalls.h>
+#include <generic_syscall.h>
+
+#include <slab/SlabStatistics.h>
+
+
+struct Workload {
+	size_t		message_size;
+	int32		burst_size;
+	bigtime_t	end;
+	int64		operations;
+};
+
+
+static status_t
+get_depot_stats(slab_depot_stats*& stats, uint32& count)
+{
+	slab_depot_stats_request request;
+	request.stats = NULL;
+	request.count = 0;
+
+	while (true) {
+		status_t status = _kern_generic_syscall(SLAB_SYSCALLS,
+			SLAB_GET_DEPOT_STATS, &request, sizeof(request));
+		if (status != B_OK)
+			return status;
+
+		if (request.stats != NULL && request.count <= count) {
+			count = request.count;
+			return B_OK;
+		}
+
+		// (re)allocate the array with some room for new caches
+		count = request.count + 16;
+		delete[] stats;
+		stats = new slab_depot_stats[count];
+		request.stats = stats;
+		request.count = count;
+	}
+}
+
+
+static const slab_depot_stats*
+find_stats(const slab_depot_stats* stats, uint32 count, const char* name)
+{
+	for (uint32 i = 0; i < count; i++) {
+		if (strcmp(stats[i].name, name) == 0)
+			return &stats[i];
+	}
+
+	return NULL;
+}
+
+
+static status_t
+stress_thread(void* data)
+{
+	Workload& workload = *(Workload*)data;
+
+	port_id port = create_port(workload.burst_size, "slab stress");
+	if (port < 0)
+		return port;
+
+	char* buffer = (char*)malloc(workload.message_size);
+	memset(buffer, 0, workload.message_size);
+
+	int64 operations = 0;
+	while (system_time() < workload.end) {
+		for (int32 i = 0; i < workload.burst_size; i++)
+			write_port(port, i, buffer, workload.message_size);
+
+		int32 code;
+		for (int32 i = 0; i < workload.burst_size; i++)
+			read_port(port, &code, buffer, workload.message_size);
+
+		operations += workload.burst_size;
+	}
+
+	atomic_add64(&workload.operations, operations);
+
+	free(buffer);
+	delete_port(port);
+	return B_OK;
+}
+
+
+static void
+run(int32 threadCount, bigtime_t duration, size_t messageSize,
+	int32 burstSize)
+{
+	slab_depot_stats* before = NULL;
+	uint32 beforeCount = 0;
+	if (get_depot_stats(before, beforeCount) != B_OK) {
+		fprintf(stderr, "Failed to get the depot statistics.\n");
+		exit(1);
+	}
+
+	Workload workload;
+	workload.message_size = messageSize;
+	workload.burst_size = burstSize;
+	workload.end = system_time() + duration;
+	workload.operations = 0;
+
+	thread_id* threads = new thread_id[threadCount];
+	for (int32 i = 0; i < threadCount; i++) {
+		threads[i] = spawn_thread(&stress_thread, "slab stress",
+			B_NORMAL_PRIORITY, &workload);
+		resume_thread(threads[i]);
+	}
+
+	for (int32 i = 0; i < threadCount; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+	}
+	delete[] threads;
+
+	slab_depot_stats* after = NULL;
+	uint32 afterCount = 0;
+	get_depot_stats(after, afterCount);
+
+	// sum up the depot activity of the caches that were used
+	uint64 hits = 0;
+	uint64 misses = 0;
+	uint64 acquisitions = 0;
+	uint64 contentions = 0;
+	uint32 resized = 0;
+	for (uint32 i = 0; i < afterCount; i++) {
+		const slab_depot_stats& stats = after[i];
+		const slab_depot_stats* previous = find_stats(before, beforeCount,
+			stats.name);
+		if (previous == NULL)
+			continue;
+
+		hits += stats.obtain_hits + stats.store_hits
+			- previous->obtain_hits - previous->store_hits;
+		misses += stats.obtain_misses + stats.store_misses
+			- previous->obtain_misses - previous->store_misses;
+		acquisitions += stats.lock_acquisitions - previous->lock_acquisitions;
+		contentions += stats.lock_contentions - previous->lock_contentions;
+		if (stats.resizes != previous->resizes)
+			resized++;
+	}
+
+	double seconds = duration / 1000000.0;
+	printf("%3" B_PRId32 " threads: %10.0f alloc/free per s, %8.0f per thread,"
+		" magazine hit rate %5.1f%%, depot contention %5.1f%%, %" B_PRIu32
+		" caches grew\n", threadCount, workload.operations / seconds,
+		workload.operations / seconds / threadCount,
+		hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0,
+		acquisitions > 0 ? 100.0 * contentions / acquisitions : 0.0,
+		resized);
+
+	delete[] before;
+	delete[] after;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-t <seconds per run>] [-m <max threads>] "
+		"[-s <message size>] [-b <burst size>]\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int seconds = 3;
+	int32 maxThreads = info.cpu_count * 2;
+	size_t messageSize = 64;
+	int32 burstSize = 64;
+
+	int option;
+	while ((option = getopt(argc, argv, "t:m:s:b:")) != -1) {
+		switch (option) {
+			case 't':
+				seconds = atoi(optarg);
+				break;
+			case 'm':
+				maxThreads = atoi(optarg);
+				break;
+			case 's':
+				messageSize = atoi(optarg);
+				break;
+			case 'b':
+				burstSize = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (optind != argc || seconds <= 0 || maxThreads < 1 || burstSize < 1)
+		usage(argv[0]);
+
+	printf("%" B_PRIu32 " CPUs, %zu byte messages, bursts of %" B_PRId32 "\n",
+		info.cpu_count, messageSize, burstSize);
+
+	for (int32 threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+		run(threadCount, seconds * 1000000LL, messageSize, burstSize);
+
+	return 0;
+}
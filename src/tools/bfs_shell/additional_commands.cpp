@@ -6,7 +6,11 @@
 
 #include "fssh.h"
 
+#include "command_agefs.h"
+#include "command_appendfs.h"
+#include "command_bulkloadfs.h"
 #include "command_checkfs.h"
+#include "command_explainquery.h"
 #include "command_resizefs.h"
 
 
@@ -16,8 +20,16 @@ namespace FSShell {
 void
 register_additional_commands()
 {
+	CommandManager::Default()->AddCommand(command_agefs, "agefs",
+		"age file system, and report free space fragmentation");
+	CommandManager::Default()->AddCommand(command_appendfs, "appendfs",
+		"write files in small appends, and report free space fragmentation");
+	CommandManager::Default()->AddCommand(command_bulkloadfs, "bulkloadfs",
+		"compare adding keys to a B+tree one by one with bulk loading them");
 	CommandManager::Default()->AddCommand(command_checkfs, "checkfs",
 		"check file system");
+	CommandManager::Default()->AddCommand(command_explainquery, "explainquery",
+		"show how a query would be executed");
 	CommandManager::Default()->AddCommand(command_resizefs, "resizefs",
 		"resize file system");
 }
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Ages the file system, and reports how fragmented its free space gets.
+
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+#include "Utility.h"
+
+#include "fragmentation_utils.h"
+
+
+namespace FSShell {
+
+
+static const char* const kDirectory = "/myfs/agefs";
+static const size_t kBufferSize = 64 * 1024;
+
+
+static off_t
+random_file_size(uint32& state, off_t maxSize)
+{
+	// sizes are distributed logarithmically between 1 KB and maxSize
+	off_t size = 1024;
+	while (size < maxSize && (xorshift32(state) & 1) != 0)
+		size *= 2;
+
+	size += xorshift32(state) % size;
+	return size < maxSize ? size : maxSize;
+}
+
+
+static fssh_status_t
+write_file(uint32 id, off_t size, const uint8* buffer)
+{
+	char path[B_PATH_NAME_LENGTH];
+	fssh_snprintf(path, sizeof(path), "%s/%" B_PRIu32, kDirectory, id);
+
+	int fd = _kern_open(-1, path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return fd;
+
+	fssh_status_t status = B_OK;
+	for (off_t offset = 0; offset < size; offset += kBufferSize) {
+		size_t length = kBufferSize;
+		if (offset + (off_t)length > size)
+			length = size - offset;
+
+		fssh_ssize_t written = _kern_write(fd, offset, buffer, length);
+		if (written != (fssh_ssize_t)length) {
+			status = written < 0 ? written : B_DEVICE_FULL;
+			break;
+		}
+	}
+
+	_kern_close(fd);
+	return status;
+}
+
+
+static fssh_status_t
+remove_file(uint32 id)
+{
+	char path[B_PATH_NAME_LENGTH];
+	fssh_snprintf(path, sizeof(path), "%s/%" B_PRIu32, kDirectory, id);
+
+	return _kern_unlink(-1, path);
+}
+
+
+static void
+print_statistics(int rootDir, int32 round, int32 fileCount, bigtime_t time)
+{
+	char label[64];
+	fssh_snprintf(label, sizeof(label), "%5" B_PRId32 " %7" B_PRId32 " %9.3f",
+		round, fileCount, time / 1000000.0);
+	print_allocator_stats(rootDir, label);
+}
+
+
+fssh_status_t
+command_agefs(int argc, const char* const* argv)
+{
+	off_t rounds = 20;
+	off_t filesPerRound = 200;
+	off_t maxFileSize = 1024 * 1024;
+	off_t keepPercent = 50;
+	off_t seedValue = 42;
+
+	const number_option options[] = {
+		{"-r", &rounds, 1},
+		{"-n", &filesPerRound, 1},
+		{"-s", &maxFileSize, 1024},
+		{"-k", &keepPercent, 1},
+		{"-S", &seedValue, 1},
+	};
+	if (!parse_number_options(argc, argv, options,
+			sizeof(options) / sizeof(options[0]))) {
+		fssh_dprintf("Usage: %s [-r <rounds>] [-n <files per round>] "
+			"[-s <max file size in KB>] [-k <percent kept>] [-S <seed>]\n"
+			"Repeatedly creates files of random sizes, and removes a "
+			"random part of them,\nand prints how fragmented the free "
+			"space is after each round.\n", argv[0]);
+		return B_BAD_VALUE;
+	}
+
+	uint32 seed = (uint32)seedValue;
+	if (rounds <= 0 || filesPerRound <= 0 || maxFileSize < 1024
+		|| keepPercent < 0 || keepPercent > 100 || seed == 0
+		|| rounds * filesPerRound > INT32_MAX) {
+		fssh_dprintf("Invalid arguments\n");
+		return B_BAD_VALUE;
+	}
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0) {
+		fssh_dprintf("Error: Couldn't open root directory\n");
+		return rootDir;
+	}
+
+	fssh_status_t status = _kern_create_dir(-1, kDirectory, 0755);
+	if (status != B_OK && status != B_FILE_EXISTS) {
+		_kern_close(rootDir);
+		return status;
+	}
+
+	uint8* buffer = (uint8*)malloc(kBufferSize);
+	uint32* files = (uint32*)malloc(rounds * filesPerRound * sizeof(uint32));
+	if (buffer == NULL || files == NULL) {
+		free(buffer);
+		free(files);
+		_kern_close(rootDir);
+		return B_NO_MEMORY;
+	}
+	memset(buffer, 0x55, kBufferSize);
+
+	print_allocator_stats_header("round   files  time (s)");
+
+	uint32 nextID = 0;
+	int32 fileCount = 0;
+	bigtime_t totalTime = 0;
+	status = B_OK;
+
+	for (int32 round = 0; round < rounds && status == B_OK; round++) {
+		bigtime_t startTime = system_time();
+
+		for (int32 i = 0; i < filesPerRound; i++) {
+			uint32 id = nextID++;
+			status = write_file(id, random_file_size(seed, maxFileSize),
+				buffer);
+			if (status != B_OK) {
+				remove_file(id);
+				break;
+			}
+			files[fileCount++] = id;
+		}
+
+		// remove a random part of all files
+		int32 removeCount = fileCount - fileCount * keepPercent / 100;
+		for (int32 i = 0; i < removeCount; i++) {
+			int32 index = xorshift32(seed) % fileCount;
+			remove_file(files[index]);
+			files[index] = files[--fileCount];
+		}
+
+		totalTime += system_time() - startTime;
+		print_statistics(rootDir, round, fileCount, totalTime);
+	}
+
+	if (status == B_DEVICE_FULL) {
+		fssh_dprintf("The volume is full.\n");
+		status = B_OK;
+	}
+
+	// clean up
+	for (int32 i = 0; i < fileCount; i++)
+		remove_file(files[i]);
+	_kern_remove_dir(-1, kDirectory);
+
+	free(buffer);
+	free(files);
+	_kern_close(rootDir);
+	return status;
+}
+
+
+}	// namespace FSShell
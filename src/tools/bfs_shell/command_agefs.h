@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef AGEFS_H
+#define AGEFS_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_agefs(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// AGEFS_H
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Writes a number of files by appending small chunks to them in turn, like
+	log files or downloads do, and reports how fragmented the free space is
+	once every other file has been removed again.
+
+	The fs_shell file cache writes everything through right away, so BFS has
+	to allocate the blocks with every append here. For comparison, the same
+	files are then written in one go, which is what the file cache write back
+	gets to see with delayed allocation.
+*/
+
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+#include "fragmentation_utils.h"
+
+
+namespace FSShell {
+
+
+static const char* const kDirectory = "/myfs/appendfs";
+
+
+static void
+file_path(char* path, size_t size, int32 index)
+{
+	fssh_snprintf(path, size, "%s/%" B_PRId32, kDirectory, index);
+}
+
+
+static void
+print_statistics(int rootDir, const char* name, const char* state)
+{
+	char title[64];
+	fssh_snprintf(title, sizeof(title), "%s, %s", name, state);
+
+	char label[64];
+	fssh_snprintf(label, sizeof(label), "%-22s", title);
+	print_allocator_stats(rootDir, label);
+}
+
+
+static fssh_status_t
+write_files(int32 fileCount, off_t fileSize, size_t chunkSize,
+	const uint8* buffer)
+{
+	int* fds = (int*)malloc(fileCount * sizeof(int));
+	if (fds == NULL)
+		return B_NO_MEMORY;
+
+	fssh_status_t status = B_OK;
+	int32 openCount = 0;
+	for (; openCount < fileCount; openCount++) {
+		char path[B_PATH_NAME_LENGTH];
+		file_path(path, sizeof(path), openCount);
+
+		fds[openCount] = _kern_open(-1, path, O_WRONLY | O_CREAT | O_TRUNC,
+			0644);
+		if (fds[openCount] < 0) {
+			status = fds[openCount];
+			break;
+		}
+	}
+
+	// append to all files in turn
+	for (off_t offset = 0; status == B_OK && offset < fileSize;
+			offset += chunkSize) {
+		size_t length = chunkSize;
+		if (offset + (off_t)length > fileSize)
+			length = fileSize - offset;
+
+		for (int32 i = 0; i < openCount; i++) {
+			fssh_ssize_t written = _kern_write(fds[i], offset, buffer, length);
+			if (written != (fssh_ssize_t)length) {
+				status = written < 0 ? written : B_DEVICE_FULL;
+				break;
+			}
+		}
+	}
+
+	for (int32 i = 0; i < openCount; i++)
+		_kern_close(fds[i]);
+
+	free(fds);
+	return status;
+}
+
+
+static void
+remove_files(int32 fileCount, int32 first, int32 step)
+{
+	for (int32 i = first; i < fileCount; i += step) {
+		char path[B_PATH_NAME_LENGTH];
+		file_path(path, sizeof(path), i);
+		_kern_unlink(-1, path);
+	}
+}
+
+
+static fssh_status_t
+run(int rootDir, const char* name, int32 fileCount, off_t fileSize,
+	size_t chunkSize, const uint8* buffer)
+{
+	fssh_status_t status = _kern_create_dir(-1, kDirectory, 0755);
+	if (status != B_OK && status != B_FILE_EXISTS)
+		return status;
+
+	print_statistics(rootDir, name, "before");
+
+	bigtime_t startTime = system_time();
+	status = write_files(fileCount, fileSize, chunkSize, buffer);
+	bigtime_t time = system_time() - startTime;
+
+	if (status == B_OK) {
+		print_statistics(rootDir, name, "written");
+
+		// removing every other file leaves holes as large as the runs
+		// the files were written in
+		remove_files(fileCount, 0, 2);
+
+		print_statistics(rootDir, name, "half removed");
+
+		fssh_dprintf("%-22s %9.3f s\n", "", time / 1000000.0);
+	}
+
+	remove_files(fileCount, 0, 1);
+	_kern_remove_dir(-1, kDirectory);
+	return status;
+}
+
+
+fssh_status_t
+command_appendfs(int argc, const char* const* argv)
+{
+	off_t fileCount = 16;
+	off_t fileSize = 4 * 1024 * 1024;
+	off_t chunkSize = 4096;
+
+	const number_option options[] = {
+		{"-n", &fileCount, 1},
+		{"-s", &fileSize, 1024},
+		{"-c", &chunkSize, 1},
+	};
+	if (!parse_number_options(argc, argv, options,
+			sizeof(options) / sizeof(options[0]))) {
+		fssh_dprintf("Usage: %s [-n <files>] [-s <file size in KB>] "
+			"[-c <append size in bytes>]\n"
+			"Writes files by appending to them in turn, and prints how "
+			"fragmented the free\nspace is before and after, compared to "
+			"writing the files in one go.\n", argv[0]);
+		return B_BAD_VALUE;
+	}
+
+	if (fileCount <= 0 || fileCount > 65536 || fileSize <= 0
+		|| chunkSize <= 0 || chunkSize > 1024 * 1024) {
+		fssh_dprintf("Invalid arguments\n");
+		return B_BAD_VALUE;
+	}
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0) {
+		fssh_dprintf("Error: Couldn't open root directory\n");
+		return rootDir;
+	}
+
+	size_t bufferSize = max_c((size_t)chunkSize, (size_t)1024 * 1024);
+	uint8* buffer = (uint8*)malloc(bufferSize);
+	if (buffer == NULL) {
+		_kern_close(rootDir);
+		return B_NO_MEMORY;
+	}
+	memset(buffer, 0x55, bufferSize);
+
+	char label[64];
+	fssh_snprintf(label, sizeof(label), "%-22s", "");
+	print_allocator_stats_header(label);
+
+	fssh_status_t status = run(rootDir, "appended", fileCount, fileSize,
+		chunkSize, buffer);
+	if (status == B_OK) {
+		status = run(rootDir, "written at once", fileCount, fileSize,
+			min_c((off_t)bufferSize, fileSize), buffer);
+	}
+
+	if (status == B_DEVICE_FULL)
+		fssh_dprintf("The volume is full.\n");
+
+	free(buffer);
+	_kern_close(rootDir);
+	return status;
+}
+
+
+}	// namespace FSShell
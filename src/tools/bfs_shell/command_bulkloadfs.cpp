@@ -0,0 +1,89 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Compares adding keys to a B+tree one by one with bulk loading them.
+
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+static void
+print_result(const char* name, uint32 count,
+	const bfs_tree_benchmark_result& result)
+{
+	double seconds = result.time / 1000000.0;
+	fssh_dprintf("%-7s %9.3f %11.0f %8" B_PRIu64 " %6" B_PRIu32 " %7" B_PRIu32
+		"%% %s\n", name, seconds, seconds > 0 ? count / seconds : 0.0,
+		result.nodes, result.levels, result.leaf_fill,
+		result.valid ? "yes" : "no");
+}
+
+
+fssh_status_t
+command_bulkloadfs(int argc, const char* const* argv)
+{
+	bfs_tree_benchmark benchmark;
+	memset(&benchmark, 0, sizeof(benchmark));
+	benchmark.count = 100000;
+	benchmark.distinct_keys = 0;
+	benchmark.key_length = 16;
+	benchmark.seed = 42;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && !strcmp(argv[i], "-n"))
+			benchmark.count = strtoul(argv[++i], NULL, 0);
+		else if (i + 1 < argc && !strcmp(argv[i], "-d"))
+			benchmark.distinct_keys = strtoul(argv[++i], NULL, 0);
+		else if (i + 1 < argc && !strcmp(argv[i], "-l"))
+			benchmark.key_length = strtoul(argv[++i], NULL, 0);
+		else if (i + 1 < argc && !strcmp(argv[i], "-S"))
+			benchmark.seed = strtoul(argv[++i], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-n <keys>] [-d <distinct keys>] "
+				"[-l <key length>] [-S <seed>]\n"
+				"Adds random keys to a temporary B+tree one by one, and to "
+				"another one in a\nsorted batch, and compares the time it "
+				"took, and how full the trees are.\n", argv[0]);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (benchmark.distinct_keys == 0)
+		benchmark.distinct_keys = benchmark.count;
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0) {
+		fssh_dprintf("Error: Couldn't open root directory\n");
+		return rootDir;
+	}
+
+	fssh_status_t status = _kern_ioctl(rootDir, BFS_IOCTL_BENCHMARK_TREE,
+		&benchmark, sizeof(benchmark));
+
+	_kern_close(rootDir);
+
+	if (status != B_OK) {
+		fssh_dprintf("Benchmarking the B+tree failed: %s\n",
+			fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("method   time (s)  keys per s    nodes levels leaf "
+		"fill valid\n");
+	print_result("insert", benchmark.count, benchmark.insert);
+	print_result("batch", benchmark.count, benchmark.batch);
+	return B_OK;
+}
+
+
+}	// namespace FSShell
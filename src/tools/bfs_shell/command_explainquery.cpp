@@ -0,0 +1,67 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Shows how BFS would execute a query.
+
+
+#include "fssh_stdio.h"
+#include "fssh_string.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t
+command_explainquery(int argc, const char* const* argv)
+{
+	uint32 flags = 0;
+	int32 argi = 1;
+	if (argc > 1 && !fssh_strcmp(argv[1], "-a")) {
+		flags |= B_QUERY_NON_INDEXED;
+		argi++;
+	}
+
+	if (argi != argc - 1) {
+		fssh_dprintf("Usage: %s [-a] <query>\n"
+			"  -a  consider attributes without an index, too\n", argv[0]);
+		return B_ERROR;
+	}
+
+	int rootDir = _kern_open_dir(-1, "/myfs");
+	if (rootDir < 0) {
+		fssh_dprintf("Error: Couldn't open root directory\n");
+		return rootDir;
+	}
+
+	char plan[4096];
+	bfs_explain_query explain;
+	explain.query = argv[argi];
+	explain.query_length = fssh_strlen(argv[argi]);
+	explain.flags = flags;
+	explain.plan = plan;
+	explain.plan_size = sizeof(plan);
+
+	fssh_status_t status = _kern_ioctl(rootDir, BFS_IOCTL_EXPLAIN_QUERY,
+		&explain, sizeof(explain));
+
+	_kern_close(rootDir);
+
+	if (status != B_OK && status != B_BUFFER_OVERFLOW) {
+		fssh_dprintf("Explaining the query failed: %s\n",
+			fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("%s", plan);
+	return B_OK;
+}
+
+
+}	// namespace FSShell
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Helpers shared by the commands that measure free space fragmentation.
+
+
+#include "fragmentation_utils.h"
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+/*!	Parses arguments of the form "<name> <number>"; the number is multiplied
+	with the option's factor. Returns \c false for anything else, so that
+	the caller can print its usage.
+*/
+bool
+parse_number_options(int argc, const char* const* argv,
+	const number_option* options, int optionCount)
+{
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			return false;
+
+		int index = 0;
+		for (; index < optionCount; index++) {
+			if (!strcmp(argv[i], options[index].name))
+				break;
+		}
+		if (index == optionCount)
+			return false;
+
+		*options[index].value = strtoll(argv[++i], NULL, 0)
+			* options[index].factor;
+	}
+
+	return true;
+}
+
+
+/*!	Prints the column titles for print_allocator_stats(); \a label is
+	printed in front of them, and should be as wide as the labels of the
+	rows.
+*/
+void
+print_allocator_stats_header(const char* label)
+{
+	fssh_dprintf("%s %11s %9s %9s %s\n", label, "free blocks", "ranges",
+		"largest", "indexed");
+}
+
+
+status_t
+print_allocator_stats(int rootDir, const char* label)
+{
+	bfs_allocator_stats stats;
+	status_t status = _kern_ioctl(rootDir, BFS_IOCTL_ALLOCATOR_STATS,
+		&stats, sizeof(stats));
+	if (status != B_OK) {
+		fssh_dprintf("Could not get allocator statistics: %s\n",
+			fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("%s %11" B_PRIu64 " %9" B_PRIu64 " %9" B_PRIu64 " %3"
+		B_PRIu32 "/%" B_PRIu32 "\n", label, stats.free_blocks,
+		stats.free_ranges, stats.largest_free_range, stats.indexed_groups,
+		stats.allocation_groups);
+	return B_OK;
+}
+
+
+}	// namespace FSShell
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FRAGMENTATION_UTILS_H
+#define FRAGMENTATION_UTILS_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+struct number_option {
+	const char*		name;
+	fssh_off_t*		value;
+	fssh_off_t		factor;
+};
+
+
+bool parse_number_options(int argc, const char* const* argv,
+	const number_option* options, int optionCount);
+
+void print_allocator_stats_header(const char* label);
+fssh_status_t print_allocator_stats(int rootDir, const char* label);
+
+
+}	// namespace FSShell
+
+
+#endif	// FRAGMENTATION_UTILS_H